@@ -4,7 +4,7 @@ if(NOT GLSLC)
     message(WARNING "glslc not found. Shaders must be manually compiled")
 else()
     file(COPY ${SHADER_DIR} DESTINATION ${OUT_DIR}/../)
-    file(GLOB_RECURSE SHADER_SRC "${OUT_DIR}/*.vert" "${OUT_DIR}/*.frag")
+    file(GLOB_RECURSE SHADER_SRC "${OUT_DIR}/*.vert" "${OUT_DIR}/*.frag" "${OUT_DIR}/*.comp")
     foreach(file ${SHADER_SRC})
         message(STATUS "Compiling Shader Source: ${file}")
         execute_process(COMMAND ${GLSLC} ${file} -o ${file}.spv RESULT_VARIABLE GLSLC_CMD_RES OUTPUT_VARIABLE GLSLC_CMD_OUT)
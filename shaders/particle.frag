@@ -0,0 +1,18 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 FragColor;
+layout(location = 1) in vec2 FragCorner;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // Round and soft edged instead of a square
+    float falloff = 1.0 - dot(FragCorner, FragCorner);
+    if(falloff <= 0.0)
+    {
+        discard;
+    }
+    outColor = vec4(FragColor.rgb, FragColor.a * falloff);
+}
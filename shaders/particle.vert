@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+struct Particle
+{
+    // xyz position, w seconds left to live
+    vec4 position;
+    // xyz velocity, w seconds the particle lived for in total
+    vec4 velocity;
+};
+
+layout(set = 0, binding = 0) readonly buffer Particles
+{
+    Particle particles[];
+} particles;
+
+layout(push_constant) uniform Camera
+{
+    mat4 viewProj;
+    // Clip space extent of a billboard before the perspective divide
+    vec2 billboardScale;
+} camera;
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out vec2 FragCorner;
+
+// Two triangles making up a billboard
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
+void main()
+{
+    // No vertex buffer, every particle is six vertices in a row
+    Particle particle = particles.particles[gl_VertexIndex / 6];
+    vec2 corner = corners[gl_VertexIndex % 6];
+
+    gl_Position = camera.viewProj * vec4(particle.position.xyz, 1.0);
+    gl_Position.xy += corner * camera.billboardScale;
+
+    // Hot and fast when emitted, cooling down and fading out as the particle ages
+    float age = 1.0 - particle.position.w / particle.velocity.w;
+    vec3 color = mix(vec3(1.0, 0.8, 0.3), vec3(0.8, 0.1, 0.05), age);
+    FragColor = vec4(color, 1.0 - age);
+    FragCorner = corner;
+}
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 VertPos;
+layout(location = 1) in vec2 VertTexCoord;
+layout(location = 2) in vec4 VertColor;
+// Bindless texture index in the low 24 bits, sampler index in the high 8
+layout(location = 3) in uint VertTextureIndices;
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out vec2 FragTexCoord;
+layout(location = 2) flat out uint FragTextureIndices;
+
+// Maps framebuffer pixels to clip space
+layout(push_constant) uniform Transform
+{
+    vec2 scale;
+    vec2 translate;
+} transform;
+
+void main()
+{
+    gl_Position = vec4(VertPos * transform.scale + transform.translate, 0.0, 1.0);
+    FragColor = VertColor;
+    FragTexCoord = VertTexCoord;
+    FragTextureIndices = VertTextureIndices;
+}
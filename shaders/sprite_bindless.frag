@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// Runtime sized descriptor arrays
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndices;
+
+layout(set = 0, binding = 1) uniform texture2D textures[];
+layout(set = 0, binding = 2) uniform sampler samplers[];
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Sprites with different textures share a draw, so the indices can differ within it
+    uint textureIndex = fragTextureIndices & 0xFFFFFFu;
+    uint samplerIndex = fragTextureIndices >> 24;
+    vec4 texColor = texture(sampler2D(textures[nonuniformEXT(textureIndex)], samplers[nonuniformEXT(samplerIndex)]), fragTexCoord);
+    outColor = fragColor * texColor;
+}
@@ -2,9 +2,21 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(binding = 1) uniform sampler2D texSampler;
 
 layout(location = 0) out vec4 outColor;
 
+// Baked in when the pipeline is created, so the disabled paths are compiled out. Must match TriangleApp::ShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = true;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec4 color = VERTEX_COLOR ? vec4(fragColor, 1.0) : vec4(1.0);
+    if(TEXTURED)
+    {
+        color *= texture(texSampler, fragTexCoord);
+    }
+    outColor = color;
 }
\ No newline at end of file
@@ -1,20 +1,28 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec2 VertPos;
+layout(location = 0) in vec3 VertPos;
 layout(location = 1) in vec3 VertColor;
+layout(location = 2) in vec2 VertTexCoord;
 
 layout(location = 0) out vec3 FragColor;
+layout(location = 1) out vec2 FragTexCoord;
 
 layout(binding = 0) uniform MVP_UBO
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } mvp;
 
+// World matrix of every scene node. Draws pass their node as the first instance
+layout(binding = 2) readonly buffer Transforms
+{
+    mat4 world[];
+} transforms;
+
 void main()
 {
-    gl_Position = mvp.proj * mvp.view * mvp.model * vec4(VertPos, 0.0, 1.0);
+    gl_Position = mvp.proj * mvp.view * transforms.world[gl_InstanceIndex] * vec4(VertPos, 1.0);
     FragColor = VertColor;
+    FragTexCoord = VertTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// Runtime sized descriptor arrays
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+// Every texture and sampler the renderer knows about, picked by index
+layout(set = 0, binding = 1) uniform texture2D textures[];
+layout(set = 0, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform DrawIndices
+{
+    uint mvpIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint transformIndex;
+} draw;
+
+layout(location = 0) out vec4 outColor;
+
+// Baked in when the pipeline is created, so the disabled paths are compiled out. Must match TriangleApp::ShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = true;
+
+void main() {
+    vec4 color = VERTEX_COLOR ? vec4(fragColor, 1.0) : vec4(1.0);
+    if(TEXTURED)
+    {
+        // Push constants are uniform across the draw, so no nonuniformEXT is needed here
+        color *= texture(sampler2D(textures[draw.textureIndex], samplers[draw.samplerIndex]), fragTexCoord);
+    }
+    outColor = color;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// Runtime sized descriptor arrays
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec3 VertPos;
+layout(location = 1) in vec3 VertColor;
+layout(location = 2) in vec2 VertTexCoord;
+
+layout(location = 0) out vec3 FragColor;
+layout(location = 1) out vec2 FragTexCoord;
+
+// Every MVP block the renderer knows about, picked by index
+layout(set = 0, binding = 0) readonly buffer MVP_SSBO
+{
+    mat4 view;
+    mat4 proj;
+} mvps[];
+
+// Same array seen as scene node world matrices. Draws pass their node as the first instance
+layout(set = 0, binding = 0) readonly buffer Transforms
+{
+    mat4 world[];
+} transforms[];
+
+layout(push_constant) uniform DrawIndices
+{
+    uint mvpIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint transformIndex;
+} draw;
+
+void main()
+{
+    // Push constants are uniform across the draw, so no nonuniformEXT is needed here
+    mat4 model = transforms[draw.transformIndex].world[gl_InstanceIndex];
+    mat4 view = mvps[draw.mvpIndex].view;
+    mat4 proj = mvps[draw.mvpIndex].proj;
+    gl_Position = proj * view * model * vec4(VertPos, 1.0);
+    FragColor = VertColor;
+    FragTexCoord = VertTexCoord;
+}
@@ -0,0 +1,242 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include "BindlessHeap.h"
+
+auto BindlessHeap::isSupported(VkPhysicalDevice device) -> bool
+{
+    type::uint32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    bool extensionFound = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+            [](const VkExtensionProperties& extension)
+            {
+                return strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+            });
+    if(!extensionFound)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return indexingFeatures.runtimeDescriptorArray
+           && indexingFeatures.descriptorBindingPartiallyBound
+           && indexingFeatures.descriptorBindingUpdateUnusedWhilePending
+           && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind
+           && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+           && indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+}
+
+auto BindlessHeap::requiredFeatures() -> VkPhysicalDeviceDescriptorIndexingFeaturesEXT
+{
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    // Arrays declared without a size in the shader
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    // Not every slot has to hold a valid descriptor, only the ones actually accessed
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    // Free slots can be written while command buffers using the set are in flight
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    // Texture index can differ between invocations of a draw
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    return indexingFeatures;
+}
+
+auto BindlessHeap::init(VkPhysicalDevice physicalDevice, VkDevice device) -> void
+{
+    // Overload instead of a default argument, as Capacity isn't complete until the end of the class
+    init(physicalDevice, device, Capacity());
+}
+
+auto BindlessHeap::init(VkPhysicalDevice physicalDevice, VkDevice device, Capacity capacity) -> void
+{
+    this->device = device;
+
+    // Clamp the requested array sizes to the update-after-bind limits of the device
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProps = {};
+    indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &indexingProps;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+
+    storageBufferSlots.capacity = std::min({capacity.storageBuffers,
+            indexingProps.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+    sampledImageSlots.capacity = std::min({capacity.sampledImages,
+            indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    samplerSlots.capacity = std::min({capacity.samplers,
+            indexingProps.maxDescriptorSetUpdateAfterBindSamplers,
+            indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    /* Layout */
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+    bindings[0].binding = STORAGE_BUFFER_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = storageBufferSlots.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[1].binding = SAMPLED_IMAGE_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[1].descriptorCount = sampledImageSlots.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[2].binding = SAMPLER_BINDING;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[2].descriptorCount = samplerSlots.capacity;
+    bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Every array can be written after the set has been bound and may have holes in it
+    std::array<VkDescriptorBindingFlagsEXT, 3> bindingFlags = {};
+    bindingFlags.fill(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+                      | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT
+                      | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT);
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = static_cast<type::uint32>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = static_cast<type::uint32>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Bindless descriptor set layout creation failed");
+    }
+
+    /* Pool and Set */
+    std::array<VkDescriptorPoolSize, 3> poolSizes =
+            {
+                    VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBufferSlots.capacity},
+                    VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sampledImageSlots.capacity},
+                    VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLER, samplerSlots.capacity}
+            };
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = static_cast<type::uint32>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Bindless descriptor pool creation failed");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    if(vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Bindless descriptor set allocation failed");
+    }
+}
+
+auto BindlessHeap::cleanup() -> void
+{
+    // Destroying the pool frees the set along with it
+    vkDestroyDescriptorPool(device, pool, nullptr);
+    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+auto BindlessHeap::SlotAllocator::acquire() -> type::uint32
+{
+    if(!freeSlots.empty())
+    {
+        type::uint32 index = freeSlots.back();
+        freeSlots.pop_back();
+        return index;
+    }
+    if(next >= capacity)
+    {
+        throw std::runtime_error("Bindless heap is full");
+    }
+    return next++;
+}
+
+auto BindlessHeap::SlotAllocator::release(type::uint32 index) -> void
+{
+    freeSlots.push_back(index);
+}
+
+auto BindlessHeap::write(type::uint32 binding, type::uint32 index, VkDescriptorType descriptorType,
+                         const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo) -> void
+{
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = binding;
+    // Slot in the array being written
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = descriptorType;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = bufferInfo;
+    descriptorWrite.pImageInfo = imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+auto BindlessHeap::registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) -> type::uint32
+{
+    type::uint32 index = storageBufferSlots.acquire();
+    VkDescriptorBufferInfo bufferInfo = {buffer, offset, range};
+    write(STORAGE_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+    return index;
+}
+
+auto BindlessHeap::registerSampledImage(VkImageView view, VkImageLayout layout) -> type::uint32
+{
+    type::uint32 index = sampledImageSlots.acquire();
+    VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, view, layout};
+    write(SAMPLED_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, nullptr, &imageInfo);
+    return index;
+}
+
+auto BindlessHeap::registerSampler(VkSampler sampler) -> type::uint32
+{
+    type::uint32 index = samplerSlots.acquire();
+    VkDescriptorImageInfo imageInfo = {sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED};
+    write(SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, nullptr, &imageInfo);
+    return index;
+}
+
+auto BindlessHeap::releaseStorageBuffer(type::uint32 index) -> void
+{
+    storageBufferSlots.release(index);
+}
+
+auto BindlessHeap::releaseSampledImage(type::uint32 index) -> void
+{
+    sampledImageSlots.release(index);
+}
+
+auto BindlessHeap::releaseSampler(type::uint32 index) -> void
+{
+    samplerSlots.release(index);
+}
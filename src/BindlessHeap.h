@@ -0,0 +1,98 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_BINDLESSHEAP_H
+#define VULKANTUTORIAL_BINDLESSHEAP_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Push constants handed to every draw in bindless mode
+ *
+ * Must match the push_constant block in the *_bindless shaders
+ */
+struct BindlessDrawIndices
+{
+    // Index into the storage buffer array holding the MVP matrices
+    type::uint32 mvpIndex;
+    // Index into the sampled image and sampler arrays
+    type::uint32 textureIndex;
+    type::uint32 samplerIndex;
+    // Index into the storage buffer array holding the world matrices of every scene node
+    type::uint32 transformIndex;
+};
+
+/**
+ * One big descriptor set holding every resource the renderer knows about
+ *
+ * Resources live in large update-after-bind arrays and are referred to by index,
+ * so the set is bound once per command buffer instead of once per draw. Needs
+ * VK_EXT_descriptor_indexing (core in Vulkan 1.2).
+ */
+class BindlessHeap
+{
+public:
+    static constexpr type::uint32 STORAGE_BUFFER_BINDING = 0;
+    static constexpr type::uint32 SAMPLED_IMAGE_BINDING = 1;
+    static constexpr type::uint32 SAMPLER_BINDING = 2;
+
+    // Requested array sizes. These get clamped to what the device allows
+    struct Capacity
+    {
+        type::uint32 storageBuffers = 16384;
+        type::uint32 sampledImages = 16384;
+        type::uint32 samplers = 256;
+    };
+
+    // Check that the device supports the descriptor indexing features the heap needs
+    static auto isSupported(VkPhysicalDevice device) -> bool;
+    // Features to chain into VkDeviceCreateInfo::pNext when creating the device
+    static auto requiredFeatures() -> VkPhysicalDeviceDescriptorIndexingFeaturesEXT;
+
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device) -> void;
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, Capacity capacity) -> void;
+    auto cleanup() -> void;
+
+    // Write a resource into a free slot and return its index
+    auto registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) -> type::uint32;
+    auto registerSampledImage(VkImageView view, VkImageLayout layout) -> type::uint32;
+    auto registerSampler(VkSampler sampler) -> type::uint32;
+    // Return a slot to the free list. The caller must make sure the GPU is done with it
+    auto releaseStorageBuffer(type::uint32 index) -> void;
+    auto releaseSampledImage(type::uint32 index) -> void;
+    auto releaseSampler(type::uint32 index) -> void;
+
+    inline auto getLayout() const -> VkDescriptorSetLayout { return layout; }
+    inline auto getSet() const -> VkDescriptorSet { return set; }
+
+private:
+    // Hands out array slots, reusing released ones first
+    struct SlotAllocator
+    {
+        type::uint32 capacity = 0;
+        type::uint32 next = 0;
+        std::vector<type::uint32> freeSlots;
+
+        auto acquire() -> type::uint32;
+        auto release(type::uint32 index) -> void;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    SlotAllocator storageBufferSlots;
+    SlotAllocator sampledImageSlots;
+    SlotAllocator samplerSlots;
+
+    auto write(type::uint32 binding, type::uint32 index, VkDescriptorType descriptorType,
+               const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo) -> void;
+};
+
+#endif //VULKANTUTORIAL_BINDLESSHEAP_H
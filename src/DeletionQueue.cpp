@@ -0,0 +1,154 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include "DeletionQueue.h"
+
+auto DeletionQueue::init(VkDevice device, MemoryTracker& memoryTracker) -> void
+{
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    lastSubmitted = 0;
+}
+
+auto DeletionQueue::cleanup() -> void
+{
+    flush();
+}
+
+auto DeletionQueue::frameSubmitted(type::uint64 frame) -> void
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lastSubmitted = frame;
+}
+
+auto DeletionQueue::collect(type::uint64 completedFrame) -> void
+{
+    // Destroyed outside the lock, since deleters may well retire something else
+    std::deque<Entry> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while(!entries.empty() && entries.front().frame <= completedFrame)
+        {
+            finished.push_back(std::move(entries.front()));
+            entries.pop_front();
+        }
+    }
+    for(Entry& entry : finished)
+    {
+        destroy(entry);
+    }
+}
+
+auto DeletionQueue::flush() -> void
+{
+    // Deleters can retire more, which then has to go too
+    while(true)
+    {
+        std::deque<Entry> finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.swap(entries);
+        }
+        if(finished.empty())
+        {
+            return;
+        }
+        for(Entry& entry : finished)
+        {
+            destroy(entry);
+        }
+    }
+}
+
+/**
+ * Retiring
+ */
+auto DeletionQueue::destroyBuffer(VkBuffer buffer) -> void
+{
+    push(Kind::Buffer, buffer);
+}
+
+auto DeletionQueue::destroyImage(VkImage image) -> void
+{
+    push(Kind::Image, image);
+}
+
+auto DeletionQueue::destroyImageView(VkImageView view) -> void
+{
+    push(Kind::ImageView, view);
+}
+
+auto DeletionQueue::freeMemory(VkDeviceMemory memory) -> void
+{
+    push(Kind::Memory, memory);
+}
+
+auto DeletionQueue::destroyPipeline(VkPipeline pipeline) -> void
+{
+    push(Kind::Pipeline, pipeline);
+}
+
+auto DeletionQueue::destroyPipelineLayout(VkPipelineLayout layout) -> void
+{
+    push(Kind::PipelineLayout, layout);
+}
+
+auto DeletionQueue::destroyRenderPass(VkRenderPass renderPass) -> void
+{
+    push(Kind::RenderPass, renderPass);
+}
+
+auto DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer) -> void
+{
+    push(Kind::Framebuffer, framebuffer);
+}
+
+auto DeletionQueue::destroySwapchain(VkSwapchainKHR swapchain) -> void
+{
+    push(Kind::Swapchain, swapchain);
+}
+
+auto DeletionQueue::retire(std::function<void()> deleter) -> void
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back({lastSubmitted, Kind::Function, 0, std::move(deleter)});
+}
+
+auto DeletionQueue::destroy(Entry& entry) -> void
+{
+    switch(entry.kind)
+    {
+        case Kind::Buffer:
+            vkDestroyBuffer(device, reinterpret_cast<VkBuffer>(entry.handle), nullptr);
+            break;
+        case Kind::Image:
+            vkDestroyImage(device, reinterpret_cast<VkImage>(entry.handle), nullptr);
+            break;
+        case Kind::ImageView:
+            vkDestroyImageView(device, reinterpret_cast<VkImageView>(entry.handle), nullptr);
+            break;
+        case Kind::Memory:
+            memoryTracker->free(reinterpret_cast<VkDeviceMemory>(entry.handle));
+            break;
+        case Kind::Pipeline:
+            vkDestroyPipeline(device, reinterpret_cast<VkPipeline>(entry.handle), nullptr);
+            break;
+        case Kind::PipelineLayout:
+            vkDestroyPipelineLayout(device, reinterpret_cast<VkPipelineLayout>(entry.handle), nullptr);
+            break;
+        case Kind::RenderPass:
+            vkDestroyRenderPass(device, reinterpret_cast<VkRenderPass>(entry.handle), nullptr);
+            break;
+        case Kind::Framebuffer:
+            vkDestroyFramebuffer(device, reinterpret_cast<VkFramebuffer>(entry.handle), nullptr);
+            break;
+        case Kind::Swapchain:
+            vkDestroySwapchainKHR(device, reinterpret_cast<VkSwapchainKHR>(entry.handle), nullptr);
+            break;
+        case Kind::Function:
+            entry.deleter();
+            break;
+    }
+}
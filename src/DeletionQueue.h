@@ -0,0 +1,106 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_DELETIONQUEUE_H
+#define VULKANTUTORIAL_DELETIONQUEUE_H
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "types.h"
+#include "MemoryTracker.h"
+
+/**
+ * Destroys GPU resources once no frame that could be using them is still in flight
+ *
+ * Frames are numbered in the order they're submitted. Anything retired here is
+ * tagged with the number of the last frame submitted so far, which is the last
+ * one that could have recorded it, and is destroyed once that frame's fence has
+ * been waited on. That's at most MAX_FRAMES_IN_FLIGHT frames later, instead of
+ * idling the whole device to destroy something right away.
+ *
+ * Resources have to be retired after the last command buffer using them was
+ * submitted and before anything new records them, which is how replacing a
+ * resource naturally goes. Within a frame they're destroyed in the order they
+ * were retired, so views go in before their images.
+ *
+ * Safe to retire from any thread.
+ */
+class DeletionQueue
+{
+public:
+    auto init(VkDevice device, MemoryTracker& memoryTracker) -> void;
+    // Destroys everything still queued. The GPU has to be idle
+    auto cleanup() -> void;
+
+    // A frame with this number was just submitted. Numbers have to go up
+    auto frameSubmitted(type::uint64 frame) -> void;
+    // Destroy what was retired by frames up to and including this one, which the GPU is done with
+    auto collect(type::uint64 completedFrame) -> void;
+    // Destroy everything. The GPU has to be idle
+    auto flush() -> void;
+
+    auto destroyBuffer(VkBuffer buffer) -> void;
+    auto destroyImage(VkImage image) -> void;
+    auto destroyImageView(VkImageView view) -> void;
+    // Goes back through the memory tracker
+    auto freeMemory(VkDeviceMemory memory) -> void;
+    auto destroyPipeline(VkPipeline pipeline) -> void;
+    auto destroyPipelineLayout(VkPipelineLayout layout) -> void;
+    auto destroyRenderPass(VkRenderPass renderPass) -> void;
+    auto destroyFramebuffer(VkFramebuffer framebuffer) -> void;
+    auto destroySwapchain(VkSwapchainKHR swapchain) -> void;
+    // Anything else, like handing slots or pools back to whoever owns them
+    auto retire(std::function<void()> deleter) -> void;
+
+private:
+    enum class Kind : type::uint8
+    {
+        Buffer,
+        Image,
+        ImageView,
+        Memory,
+        Pipeline,
+        PipelineLayout,
+        RenderPass,
+        Framebuffer,
+        Swapchain,
+        Function
+    };
+
+    struct Entry
+    {
+        type::uint64 frame;
+        Kind kind;
+        // Non-dispatchable handles are 64 bit whether they're pointers or not
+        type::uint64 handle;
+        // Only for Function, so the rest don't allocate
+        std::function<void()> deleter;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+
+    std::mutex mutex;
+    type::uint64 lastSubmitted = 0;
+    // In the order they were retired, so frame numbers only go up from front to back
+    std::deque<Entry> entries;
+
+    template<typename Handle>
+    auto push(Kind kind, Handle handle) -> void
+    {
+        if(handle == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back({lastSubmitted, kind, reinterpret_cast<type::uint64>(handle), {}});
+    }
+    auto destroy(Entry& entry) -> void;
+};
+
+#endif //VULKANTUTORIAL_DELETIONQUEUE_H
@@ -0,0 +1,315 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <stdexcept>
+#include "DescriptorAllocator.h"
+#include "Hash.h"
+
+/**
+ * Descriptor Allocator
+ */
+auto DescriptorAllocator::init(VkDevice device, type::uint32 setsPerPool) -> void
+{
+    // Overload instead of a default argument, as PoolSizes isn't complete until the end of the class
+    init(device, setsPerPool, PoolSizes());
+}
+
+auto DescriptorAllocator::init(VkDevice device, type::uint32 setsPerPool, PoolSizes poolSizes) -> void
+{
+    this->device = device;
+    this->setsPerPool = setsPerPool;
+    this->poolSizes = std::move(poolSizes);
+}
+
+auto DescriptorAllocator::createPool(type::uint32 maxSets) -> VkDescriptorPool
+{
+    std::vector<VkDescriptorPoolSize> sizes;
+    sizes.reserve(poolSizes.sizes.size());
+    for(const auto& [descriptorType, ratio] : poolSizes.sizes)
+    {
+        sizes.push_back({descriptorType, std::max(1u, static_cast<type::uint32>(ratio * maxSets))});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    // No FREE_DESCRIPTOR_SET_BIT, sets are only ever released by resetting the whole pool
+        // which lets the driver use a simple linear allocator
+    poolInfo.flags = 0;
+    poolInfo.maxSets = maxSets;
+    poolInfo.poolSizeCount = static_cast<type::uint32>(sizes.size());
+    poolInfo.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Descriptor pool creation failed");
+    }
+    return pool;
+}
+
+auto DescriptorAllocator::grabPool() -> VkDescriptorPool
+{
+    if(!freePools.empty())
+    {
+        VkDescriptorPool pool = freePools.back();
+        freePools.pop_back();
+        return pool;
+    }
+
+    // Each new pool in the chain is bigger than the last so that
+        // a heavy scene settles on a handful of pools
+    VkDescriptorPool pool = createPool(setsPerPool);
+    setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+auto DescriptorAllocator::allocate(VkDescriptorSetLayout layout) -> VkDescriptorSet
+{
+    if(currentPool == VK_NULL_HANDLE)
+    {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        // Current pool is full, so chain on another one and try again
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    }
+
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Descriptor set allocation failed");
+    }
+    return set;
+}
+
+auto DescriptorAllocator::resetPools() -> void
+{
+    for(VkDescriptorPool pool : usedPools)
+    {
+        vkResetDescriptorPool(device, pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+auto DescriptorAllocator::retirePools() -> std::vector<VkDescriptorPool>
+{
+    std::vector<VkDescriptorPool> pools;
+    pools.swap(usedPools);
+    currentPool = VK_NULL_HANDLE;
+    return pools;
+}
+
+auto DescriptorAllocator::recyclePools(const std::vector<VkDescriptorPool>& pools) -> void
+{
+    for(VkDescriptorPool pool : pools)
+    {
+        vkResetDescriptorPool(device, pool, 0);
+        freePools.push_back(pool);
+    }
+}
+
+auto DescriptorAllocator::cleanup() -> void
+{
+    for(VkDescriptorPool pool : usedPools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    for(VkDescriptorPool pool : freePools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    usedPools.clear();
+    freePools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+/**
+ * Descriptor Set Cache
+ */
+namespace
+{
+    enum class InfoKind { Buffer, Image, TexelBuffer };
+
+    auto infoKind(VkDescriptorType descriptorType) -> InfoKind
+    {
+        switch(descriptorType)
+        {
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+                return InfoKind::Buffer;
+            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                return InfoKind::TexelBuffer;
+            default:
+                return InfoKind::Image;
+        }
+    }
+}
+
+auto DescriptorSetCache::init(VkDevice device, DescriptorAllocator* allocator) -> void
+{
+    this->device = device;
+    this->allocator = allocator;
+}
+
+auto DescriptorSetCache::registerLayout(VkDescriptorSetLayout layout,
+                                        const std::vector<VkDescriptorSetLayoutBinding>& bindings) -> void
+{
+    LayoutEntry entry = {};
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    templateEntries.reserve(bindings.size());
+
+    for(const auto& binding : bindings)
+    {
+        VkDescriptorUpdateTemplateEntry templateEntry = {};
+        templateEntry.dstBinding = binding.binding;
+        templateEntry.dstArrayElement = 0;
+        templateEntry.descriptorCount = binding.descriptorCount;
+        templateEntry.descriptorType = binding.descriptorType;
+        // Where in the info array the descriptors for this binding start
+        templateEntry.offset = entry.types.size() * sizeof(DescriptorInfo);
+        templateEntry.stride = sizeof(DescriptorInfo);
+        templateEntries.push_back(templateEntry);
+
+        entry.types.insert(entry.types.end(), binding.descriptorCount, binding.descriptorType);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo = {};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<type::uint32>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = layout;
+
+    if(vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &entry.updateTemplate) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Descriptor update template creation failed");
+    }
+
+    layouts[layout] = std::move(entry);
+}
+
+auto DescriptorSetCache::hashInfos(VkDescriptorSetLayout layout, const LayoutEntry& entry,
+                                   const std::vector<DescriptorInfo>& infos) -> type::uint64
+{
+    type::uint64 result = hash::combine(hash::fnvOffset, layout);
+    for(type::size i = 0; i < infos.size(); ++i)
+    {
+        // Hash member by member so union and struct padding never leak into the key
+        switch(infoKind(entry.types[i]))
+        {
+            case InfoKind::Buffer:
+                result = hash::combine(result, infos[i].buffer.buffer);
+                result = hash::combine(result, infos[i].buffer.offset);
+                result = hash::combine(result, infos[i].buffer.range);
+                break;
+            case InfoKind::Image:
+                result = hash::combine(result, infos[i].image.sampler);
+                result = hash::combine(result, infos[i].image.imageView);
+                result = hash::combine(result, infos[i].image.imageLayout);
+                break;
+            case InfoKind::TexelBuffer:
+                result = hash::combine(result, infos[i].texelBufferView);
+                break;
+        }
+    }
+    return result;
+}
+
+auto DescriptorSetCache::equalInfos(const LayoutEntry& entry, const std::vector<DescriptorInfo>& a,
+                                    const std::vector<DescriptorInfo>& b) -> bool
+{
+    for(type::size i = 0; i < a.size(); ++i)
+    {
+        switch(infoKind(entry.types[i]))
+        {
+            case InfoKind::Buffer:
+                if(a[i].buffer.buffer != b[i].buffer.buffer || a[i].buffer.offset != b[i].buffer.offset
+                   || a[i].buffer.range != b[i].buffer.range)
+                {
+                    return false;
+                }
+                break;
+            case InfoKind::Image:
+                if(a[i].image.sampler != b[i].image.sampler || a[i].image.imageView != b[i].image.imageView
+                   || a[i].image.imageLayout != b[i].image.imageLayout)
+                {
+                    return false;
+                }
+                break;
+            case InfoKind::TexelBuffer:
+                if(a[i].texelBufferView != b[i].texelBufferView)
+                {
+                    return false;
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+auto DescriptorSetCache::getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorInfo>& infos) -> VkDescriptorSet
+{
+    auto layoutIt = layouts.find(layout);
+    if(layoutIt == layouts.end())
+    {
+        throw std::runtime_error("Descriptor set layout was not registered with the cache");
+    }
+    const LayoutEntry& entry = layoutIt->second;
+    if(infos.size() != entry.types.size())
+    {
+        throw std::runtime_error("Descriptor info count does not match the layout");
+    }
+
+    type::uint64 key = hashInfos(layout, entry, infos);
+    auto& bucket = sets[key];
+    for(const auto& cached : bucket)
+    {
+        if(cached.layout == layout && equalInfos(entry, cached.infos, infos))
+        {
+            return cached.set;
+        }
+    }
+
+    // Cache miss, allocate a new set and write every descriptor with a single call
+    VkDescriptorSet set = allocator->allocate(layout);
+    vkUpdateDescriptorSetWithTemplate(device, set, entry.updateTemplate, infos.data());
+
+    bucket.push_back({layout, infos, set});
+    return set;
+}
+
+auto DescriptorSetCache::clear() -> void
+{
+    sets.clear();
+}
+
+auto DescriptorSetCache::cleanup() -> void
+{
+    for(auto& [layout, entry] : layouts)
+    {
+        vkDestroyDescriptorUpdateTemplate(device, entry.updateTemplate, nullptr);
+    }
+    layouts.clear();
+    sets.clear();
+}
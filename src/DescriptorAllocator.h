@@ -0,0 +1,144 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_DESCRIPTORALLOCATOR_H
+#define VULKANTUTORIAL_DESCRIPTORALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Hands out descriptor sets from a chain of descriptor pools
+ *
+ * When the current pool runs dry a new (larger) one is created and chained on
+ * instead of failing. Pools are never freed individually, resetPools() hands all
+ * of them back with vkResetDescriptorPool so per-frame allocators can recycle
+ * everything they allocated in one call.
+ */
+class DescriptorAllocator
+{
+public:
+    // How many descriptors of each type to reserve per set in a pool
+    struct PoolSizes
+    {
+        std::vector<std::pair<VkDescriptorType, float>> sizes =
+                {
+                        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+                        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+                        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+                        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+                        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+                        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+                        {VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f},
+                        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f}
+                };
+    };
+
+    // Upper bound on how large a single chained pool can grow
+    static constexpr type::uint32 MAX_SETS_PER_POOL = 4096;
+
+    auto init(VkDevice device, type::uint32 setsPerPool = 64) -> void;
+    auto init(VkDevice device, type::uint32 setsPerPool, PoolSizes poolSizes) -> void;
+    auto allocate(VkDescriptorSetLayout layout) -> VkDescriptorSet;
+    // Reset every pool in one go. All sets allocated from this allocator become invalid
+    auto resetPools() -> void;
+    // Stop allocating from the pools in use, without resetting them, so their sets stay valid while
+        // frames in flight use them. New sets come from other pools until they're handed back
+    auto retirePools() -> std::vector<VkDescriptorPool>;
+    // Reset retired pools and make them available again
+    auto recyclePools(const std::vector<VkDescriptorPool>& pools) -> void;
+    auto cleanup() -> void;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    PoolSizes poolSizes;
+    // Size of the next pool that gets created
+    type::uint32 setsPerPool = 0;
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    // Pools that have been allocated from since the last reset
+    std::vector<VkDescriptorPool> usedPools;
+    // Pools that have been reset and are ready to reuse
+    std::vector<VkDescriptorPool> freePools;
+
+    auto createPool(type::uint32 maxSets) -> VkDescriptorPool;
+    // Get a free pool, creating a new one if there are none to reuse
+    auto grabPool() -> VkDescriptorPool;
+};
+
+/**
+ * A single descriptor as it is laid out for a descriptor update template
+ *
+ * Every binding in a registered layout takes descriptorCount consecutive entries
+ */
+union DescriptorInfo
+{
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+    VkBufferView texelBufferView;
+
+    static auto fromBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) -> DescriptorInfo
+    {
+        DescriptorInfo info = {};
+        info.buffer = {buffer, offset, range};
+        return info;
+    }
+
+    static auto fromImage(VkSampler sampler, VkImageView view, VkImageLayout layout) -> DescriptorInfo
+    {
+        DescriptorInfo info = {};
+        info.image = {sampler, view, layout};
+        return info;
+    }
+};
+
+/**
+ * Caches descriptor sets by a hash of the resources bound to them
+ *
+ * Asking for the same layout + resources twice hands back the set written the
+ * first time. Misses are allocated from the given allocator and written through
+ * a descriptor update template that is created once per layout.
+ */
+class DescriptorSetCache
+{
+public:
+    auto init(VkDevice device, DescriptorAllocator* allocator) -> void;
+    // Create the update template for a layout. Must be called before getSet is used with it
+    auto registerLayout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings) -> void;
+    // Fetch the set holding these descriptors, allocating and writing it on a miss
+    auto getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorInfo>& infos) -> VkDescriptorSet;
+    // Forget all cached sets. Call this whenever the backing allocator is reset
+    auto clear() -> void;
+    auto cleanup() -> void;
+
+private:
+    struct LayoutEntry
+    {
+        VkDescriptorUpdateTemplate updateTemplate;
+        // Type of every descriptor entry, used to know which union member to hash and compare
+        std::vector<VkDescriptorType> types;
+    };
+
+    struct CachedSet
+    {
+        VkDescriptorSetLayout layout;
+        std::vector<DescriptorInfo> infos;
+        VkDescriptorSet set;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    DescriptorAllocator* allocator = nullptr;
+    std::unordered_map<VkDescriptorSetLayout, LayoutEntry> layouts;
+    // Sets bucketed by hash. Buckets only hold more than one set on a collision
+    std::unordered_map<type::uint64, std::vector<CachedSet>> sets;
+
+    static auto hashInfos(VkDescriptorSetLayout layout, const LayoutEntry& entry, const std::vector<DescriptorInfo>& infos) -> type::uint64;
+    static auto equalInfos(const LayoutEntry& entry, const std::vector<DescriptorInfo>& a, const std::vector<DescriptorInfo>& b) -> bool;
+};
+
+#endif //VULKANTUTORIAL_DESCRIPTORALLOCATOR_H
@@ -0,0 +1,141 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "DynamicResolution.h"
+
+auto DynamicResolution::isSupported(VkPhysicalDevice physicalDevice, type::uint32 queueFamily, VkFormat format) -> bool
+{
+    type::uint32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    // No valid bits means the queue can't write timestamps at all
+    if(queueFamily >= queueFamilyCount || queueFamilies[queueFamily].timestampValidBits == 0)
+    {
+        return false;
+    }
+
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & required) == required;
+}
+
+auto DynamicResolution::init(VkPhysicalDevice physicalDevice, VkDevice device, type::uint32 queueFamily,
+                             type::uint32 framesInFlight, Config config) -> void
+{
+    this->device = device;
+    this->config = config;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    timestampPeriod = props.limits.timestampPeriod;
+    type::uint32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    type::uint32 validBits = queueFamilies[queueFamily].timestampValidBits;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = framesInFlight * 2;
+    if(vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Timestamp query pool creation failed");
+    }
+
+    pending.assign(framesInFlight, false);
+    frameScales.assign(framesInFlight, config.maxScale);
+    scale = config.maxScale;
+    averageMilliseconds = 0.0f;
+}
+
+auto DynamicResolution::cleanup() -> void
+{
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+}
+
+auto DynamicResolution::begin(VkCommandBuffer commandBuffer, type::uint32 frame) -> void
+{
+    vkCmdResetQueryPool(commandBuffer, queryPool, frame * 2, 2);
+    // Written once the swap chain image is available, which is waited on at this stage. Otherwise time
+        // spent waiting on the presentation engine would look like rendering
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, queryPool, frame * 2);
+}
+
+auto DynamicResolution::end(VkCommandBuffer commandBuffer, type::uint32 frame) -> void
+{
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frame * 2 + 1);
+    pending[frame] = true;
+    frameScales[frame] = getScale();
+}
+
+auto DynamicResolution::update(type::uint32 frame) -> void
+{
+    if(!pending[frame])
+    {
+        return;
+    }
+    // The fence has signaled, so the results are there unless something went wrong. Then the frame is just skipped
+    type::uint64 timestamps[2];
+    VkResult result = vkGetQueryPoolResults(device, queryPool, frame * 2, 2, sizeof(timestamps), timestamps,
+            sizeof(type::uint64), VK_QUERY_RESULT_64_BIT);
+    pending[frame] = false;
+    if(result != VK_SUCCESS)
+    {
+        return;
+    }
+
+    float current = getScale();
+    // Measured at a different scale, so it says nothing about the current one
+    if(frameScales[frame] != current)
+    {
+        return;
+    }
+    float milliseconds = static_cast<float>((timestamps[1] - timestamps[0]) & timestampMask) * timestampPeriod / 1000000.0f;
+    float average = getGpuMilliseconds();
+    average = average == 0.0f ? milliseconds : average + (milliseconds - average) * config.smoothing;
+
+    // Time goes with the pixel count, which goes with the square of the scale
+    float budget = config.targetMilliseconds * config.headroom;
+    float ideal = std::clamp(current * std::sqrt(budget / std::max(average, 0.001f)), config.minScale, config.maxScale);
+    if(std::abs(ideal - current) > config.deadband)
+    {
+        // What the average would have been at the new scale, so it doesn't start over
+        average *= (ideal * ideal) / (current * current);
+        scale.store(ideal, std::memory_order_relaxed);
+    }
+    averageMilliseconds.store(average, std::memory_order_relaxed);
+}
+
+auto DynamicResolution::getExtent(VkExtent2D full) const -> VkExtent2D
+{
+    float current = getScale();
+    return {
+            std::max(static_cast<type::uint32>(std::lround(full.width * current)), 1u),
+            std::max(static_cast<type::uint32>(std::lround(full.height * current)), 1u)
+    };
+}
+
+auto DynamicResolution::recordUpscale(VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent,
+                                      VkImage target, VkExtent2D targetExtent) -> void
+{
+    VkImageBlit blit = {};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = {static_cast<type::int32>(sourceExtent.width), static_cast<type::int32>(sourceExtent.height), 1};
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.layerCount = 1;
+    blit.dstOffsets[1] = {static_cast<type::int32>(targetExtent.width), static_cast<type::int32>(targetExtent.height), 1};
+    vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+}
@@ -0,0 +1,93 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_DYNAMICRESOLUTION_H
+#define VULKANTUTORIAL_DYNAMICRESOLUTION_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Scales the resolution the scene is rendered at to keep the GPU inside a frame budget
+ *
+ * Each frame's GPU time is measured with a pair of timestamp queries written at
+ * the start and end of its command buffer. The results are read back once the
+ * frame's fence has signaled, which the renderer waits on before reusing the
+ * frame anyway, so reading them never stalls.
+ *
+ * The controller keeps a running average of the measured time and, since the
+ * cost of shading goes with the number of pixels, moves the scale by the square
+ * root of how far the average is from the target. Frames recorded before the
+ * last change are ignored, and changes smaller than the deadband are skipped,
+ * so the scale settles instead of hunting back and forth.
+ *
+ * The scene is rendered into the top left corner of a full size target and
+ * blitted up to the swap chain image with linear filtering, so changing the
+ * scale never recreates anything.
+ */
+class DynamicResolution
+{
+public:
+    struct Config
+    {
+        // Frame time to stay under
+        float targetMilliseconds = 1000.0f / 60.0f;
+        // Fraction of the target aimed for, which leaves room for spikes
+        float headroom = 0.9f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        // Weight of the newest measurement in the running average
+        float smoothing = 0.2f;
+        // Smallest change of the scale worth making
+        float deadband = 0.02f;
+    };
+
+    // Whether the queue can write timestamps and images of the format can be blitted with linear filtering
+    static auto isSupported(VkPhysicalDevice physicalDevice, type::uint32 queueFamily, VkFormat format) -> bool;
+
+    // Timestamps are written on the given queue family
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, type::uint32 queueFamily, type::uint32 framesInFlight,
+              Config config) -> void;
+    auto cleanup() -> void;
+
+    // Bracket the frame's GPU work. Both have to be recorded outside a render pass
+    auto begin(VkCommandBuffer commandBuffer, type::uint32 frame) -> void;
+    auto end(VkCommandBuffer commandBuffer, type::uint32 frame) -> void;
+    // Read back the time of the frame last recorded with this index and adjust the scale. That
+        // frame's fence has to have signaled
+    auto update(type::uint32 frame) -> void;
+
+    // Extent to render at for the given full resolution, never less than a pixel
+    auto getExtent(VkExtent2D full) const -> VkExtent2D;
+    inline auto getScale() const -> float { return scale.load(std::memory_order_relaxed); }
+    inline auto getGpuMilliseconds() const -> float { return averageMilliseconds.load(std::memory_order_relaxed); }
+
+    // Stretch the rendered corner of source over the whole of target. Source has to be in
+        // TRANSFER_SRC_OPTIMAL and target in TRANSFER_DST_OPTIMAL
+    static auto recordUpscale(VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent,
+                              VkImage target, VkExtent2D targetExtent) -> void;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    Config config;
+    // Two queries per frame in flight, start and end
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    // Nanoseconds per tick
+    float timestampPeriod = 1.0f;
+    // Bits of the timestamps that are valid, the rest are garbage
+    type::uint64 timestampMask = ~0ull;
+    // Whether the frame has timestamps waiting to be read, and the scale it was recorded with
+    std::vector<bool> pending;
+    std::vector<float> frameScales;
+
+    // Read by the main thread for the window title
+    std::atomic<float> scale = 1.0f;
+    std::atomic<float> averageMilliseconds = 0.0f;
+};
+
+#endif //VULKANTUTORIAL_DYNAMICRESOLUTION_H
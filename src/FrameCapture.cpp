@@ -0,0 +1,699 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+#include "FrameCapture.h"
+#include "Simd.h"
+
+namespace
+{
+    // BT.601 weights in 8.8 fixed point. Full range, which is what the C420jpeg Y4M tag means
+    constexpr int LUMA_R = 77;
+    constexpr int LUMA_G = 150;
+    constexpr int LUMA_B = 29;
+
+    /**
+     * Pixel Conversion
+     */
+    // Copy pixels into RGBA order. Alpha is forced to opaque, since whatever ends up
+        // in the swap chain's alpha channel isn't meant to be seen
+    auto toOpaqueRgba(const type::uint8* src, type::uint8* dst, type::size count, bool bgra) -> void
+    {
+        type::size i = 0;
+#if defined(SIMD_AVX2)
+        {
+            const __m256i swap = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                  2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+            for(; i + 8 <= count; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+                if(bgra)
+                {
+                    v = _mm256_shuffle_epi8(v, swap);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_or_si256(v, alpha));
+            }
+        }
+#endif
+#if defined(SIMD_SSE2)
+        {
+            // No byte shuffle without SSSE3. Red and blue are masked out and swapped by shifting within each pixel
+            const __m128i redBlue = _mm_set1_epi32(0x00FF00FF);
+            const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            for(; i + 4 <= count; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                if(bgra)
+                {
+                    __m128i rb = _mm_and_si128(v, redBlue);
+                    rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+                    v = _mm_or_si128(rb, _mm_and_si128(v, greenAlpha));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(v, alpha));
+            }
+        }
+#endif
+        for(; i < count; ++i)
+        {
+            const type::uint8* p = src + i * 4;
+            type::uint8* q = dst + i * 4;
+            q[0] = bgra ? p[2] : p[0];
+            q[1] = p[1];
+            q[2] = bgra ? p[0] : p[2];
+            q[3] = 255;
+        }
+    }
+
+#if defined(SIMD_SSE2)
+    // Luma of four pixels as 32 bit integers, not yet rounded or scaled down
+    inline auto luma4(__m128i pixels, __m128i weights) -> __m128i
+    {
+        // Widened to 16 bits, two pixels per register. The multiply-add leaves wR*R + wG*G and wB*B
+            // next to each other, and adding the upper half of each 64 bit lane sums the two
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+        lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+        hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+        // Each pixel's sum is in the even lanes
+        lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));
+        hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));
+        return _mm_unpacklo_epi64(lo, hi);
+    }
+#endif
+
+    auto toLuma(const type::uint8* src, type::uint8* dst, type::size count, bool bgra) -> void
+    {
+        // The weights follow the byte order instead of the pixels getting swizzled
+        const int first = bgra ? LUMA_B : LUMA_R;
+        const int third = bgra ? LUMA_R : LUMA_B;
+        type::size i = 0;
+#if defined(SIMD_SSE2)
+        const __m128i weights = _mm_setr_epi16(first, LUMA_G, third, 0, first, LUMA_G, third, 0);
+        const __m128i round = _mm_set1_epi32(128);
+        for(; i + 8 <= count; i += 8)
+        {
+            __m128i a = luma4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4)), weights);
+            __m128i b = luma4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + 16)), weights);
+            a = _mm_srli_epi32(_mm_add_epi32(a, round), 8);
+            b = _mm_srli_epi32(_mm_add_epi32(b, round), 8);
+            // The weights add up to 256, so nothing is out of range
+            __m128i words = _mm_packs_epi32(a, b);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+        }
+#endif
+        for(; i < count; ++i)
+        {
+            const type::uint8* p = src + i * 4;
+            dst[i] = static_cast<type::uint8>((first * p[0] + LUMA_G * p[1] + third * p[2] + 128) >> 8);
+        }
+    }
+
+    // Blue and red difference planes at half resolution in both directions, from the average of each 2x2 block
+    auto toChroma(const type::uint8* src, type::uint32 width, type::uint32 height, bool bgra,
+                  type::uint8* cb, type::uint8* cr) -> void
+    {
+        const int redOffset = bgra ? 2 : 0;
+        const int blueOffset = bgra ? 0 : 2;
+        type::uint32 chromaWidth = (width + 1) / 2;
+        type::uint32 chromaHeight = (height + 1) / 2;
+        for(type::uint32 y = 0; y < chromaHeight; ++y)
+        {
+            // The last row and column stand in for their missing neighbours when the size is odd
+            const type::uint8* row0 = src + static_cast<type::size>(y * 2) * width * 4;
+            const type::uint8* row1 = src + static_cast<type::size>(std::min(y * 2 + 1, height - 1)) * width * 4;
+            for(type::uint32 x = 0; x < chromaWidth; ++x)
+            {
+                type::size left = static_cast<type::size>(x * 2) * 4;
+                type::size right = static_cast<type::size>(std::min(x * 2 + 1, width - 1)) * 4;
+                auto average = [&](int offset)
+                {
+                    return (row0[left + offset] + row0[right + offset] + row1[left + offset] + row1[right + offset] + 2) >> 2;
+                };
+                int r = average(redOffset);
+                int g = average(1);
+                int b = average(blueOffset);
+                type::size i = static_cast<type::size>(y) * chromaWidth + x;
+                cb[i] = static_cast<type::uint8>(std::clamp(128 + ((-43 * r - 85 * g + 128 * b + 128) >> 8), 0, 255));
+                cr[i] = static_cast<type::uint8>(std::clamp(128 + ((128 * r - 107 * g - 21 * b + 128) >> 8), 0, 255));
+            }
+        }
+    }
+
+    /**
+     * PNG Encoding
+     */
+    // Slice by 8, so the checksum doesn't end up slower than the disk
+    auto crcTables() -> const std::array<std::array<type::uint32, 256>, 8>&
+    {
+        static const auto tables = []
+        {
+            std::array<std::array<type::uint32, 256>, 8> t = {};
+            for(type::uint32 n = 0; n < 256; ++n)
+            {
+                type::uint32 c = n;
+                for(int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[0][n] = c;
+            }
+            for(type::uint32 n = 0; n < 256; ++n)
+            {
+                for(type::size k = 1; k < 8; ++k)
+                {
+                    t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xFF];
+                }
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    // Continues a CRC started with 0
+    auto crc32(type::uint32 crc, const type::uint8* data, type::size size) -> type::uint32
+    {
+        const auto& t = crcTables();
+        crc = ~crc;
+        while(size >= 8)
+        {
+            type::uint32 lo = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | static_cast<type::uint32>(data[3]) << 24);
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                  t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+            data += 8;
+            size -= 8;
+        }
+        while(size-- > 0)
+        {
+            crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    auto adler32(const type::uint8* data, type::size size) -> type::uint32
+    {
+        type::uint64 a = 1;
+        type::uint64 b = 0;
+        while(size > 0)
+        {
+            // Most bytes that can be summed before b could overflow 32 bits. A multiple of 16
+            type::size block = std::min<type::size>(size, 5552);
+            size -= block;
+            type::size i = 0;
+#if defined(SIMD_SSE2)
+            // 16 bytes at a time. Every byte adds itself to a, and to b once for each byte from it to the end.
+                // That's its position from the end within the 16, plus 16 for every group of 16 still to come,
+                // which is what summing up a's running total before each group counts
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i weightsLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+            const __m128i weightsHi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+            __m128i sums = zero;
+            __m128i runningSums = zero;
+            __m128i weighted = zero;
+            type::size groups = block / 16;
+            for(; i < groups * 16; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                runningSums = _mm_add_epi32(runningSums, sums);
+                sums = _mm_add_epi32(sums, _mm_sad_epu8(v, zero));
+                weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weightsLo));
+                weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weightsHi));
+            }
+            auto total = [](__m128i v) -> type::uint64
+            {
+                alignas(16) type::uint32 lanes[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+                return static_cast<type::uint64>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            };
+            b += a * i + 16 * total(runningSums) + total(weighted);
+            a += total(sums);
+#endif
+            for(; i < block; ++i)
+            {
+                a += data[i];
+                b += a;
+            }
+            data += block;
+            a %= 65521;
+            b %= 65521;
+        }
+        return static_cast<type::uint32>(b << 16 | a);
+    }
+
+    inline auto putBigEndian(type::uint8* p, type::uint32 value) -> void
+    {
+        p[0] = static_cast<type::uint8>(value >> 24);
+        p[1] = static_cast<type::uint8>(value >> 16);
+        p[2] = static_cast<type::uint8>(value >> 8);
+        p[3] = static_cast<type::uint8>(value);
+    }
+
+    // Chunk whose data is a short head followed by a longer body, so the body can be written from where it is
+    auto writeChunk(std::ofstream& file, const char* chunkType, const type::uint8* head, type::size headSize,
+                    const type::uint8* body = nullptr, type::size bodySize = 0) -> void
+    {
+        type::uint8 header[8];
+        putBigEndian(header, static_cast<type::uint32>(headSize + bodySize));
+        std::copy(chunkType, chunkType + 4, header + 4);
+        type::uint32 crc = crc32(0, header + 4, 4);
+        crc = crc32(crc, head, headSize);
+        crc = crc32(crc, body, bodySize);
+        type::uint8 footer[4];
+        putBigEndian(footer, crc);
+
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(head), static_cast<std::streamsize>(headSize));
+        file.write(reinterpret_cast<const char*>(body), static_cast<std::streamsize>(bodySize));
+        file.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+    }
+
+    // Zero padded so the files sort in order
+    auto padded(type::uint32 value, type::size digits) -> std::string
+    {
+        std::string text = std::to_string(value);
+        return std::string(digits > text.size() ? digits - text.size() : 0, '0') + text;
+    }
+}
+
+auto FrameCapture::init(VkDevice device, MemoryTracker& memoryTracker, Config config) -> void
+{
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->config = config;
+
+    slots = std::make_unique<Slot[]>(config.bufferCount);
+    stopWriter = false;
+    writer = std::thread(&FrameCapture::writerMain, this);
+}
+
+auto FrameCapture::cleanup() -> void
+{
+    // The GPU is idle, so every copy still pending is done and goes out with the rest
+    stop();
+    handOverFinished();
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopWriter = true;
+    }
+    writerSignal.notify_all();
+    writer.join();
+    closeOutput();
+
+    for(type::uint32 i = 0; i < config.bufferCount; ++i)
+    {
+        destroySlotBuffer(slots[i]);
+    }
+    slots.reset();
+    pendingCopies.clear();
+}
+
+auto FrameCapture::supportsFormat(VkFormat format) -> bool
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+           format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+auto FrameCapture::start() -> void
+{
+    if(capturing)
+    {
+        return;
+    }
+    std::filesystem::create_directories(config.directory);
+    ++sequence;
+    nextFrame = 0;
+    capturing = true;
+}
+
+auto FrameCapture::stop() -> void
+{
+    if(!capturing)
+    {
+        return;
+    }
+    capturing = false;
+    // Closed once the sequence's last copies have reached the writer
+    pendingCopies.push_back({NO_SLOT, sequence});
+}
+
+auto FrameCapture::record(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, VkFormat format, VkFence fence) -> void
+{
+    if(!capturing)
+    {
+        return;
+    }
+
+    type::uint32 index = NO_SLOT;
+    for(type::uint32 i = 0; i < config.bufferCount; ++i)
+    {
+        // Acquire pairs with the writer freeing the slot, so it's done reading the old frame
+        if(slots[i].state.load(std::memory_order_acquire) == SlotState::Free)
+        {
+            index = i;
+            break;
+        }
+    }
+    // The writer is behind. Dropping the frame beats stalling the renderer on the disk
+    if(index == NO_SLOT)
+    {
+        framesDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = slots[index];
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    // Buffers only ever grow, so after the first few frames of a size nothing is allocated anymore
+    if(slot.size < size)
+    {
+        destroySlotBuffer(slot);
+        createSlotBuffer(slot, size);
+    }
+    slot.fence = fence;
+    slot.extent = extent;
+    slot.bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    slot.sequence = sequence;
+    slot.frame = nextFrame++;
+    slot.state.store(SlotState::Copying, std::memory_order_relaxed);
+    pendingCopies.push_back({index, sequence});
+
+    // Tightly packed rows
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    // Waiting on the fence doesn't make the copy visible to the CPU by itself
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot.buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+auto FrameCapture::poll() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if(!writerError.empty())
+        {
+            throw std::runtime_error("Frame capture failed: " + writerError);
+        }
+    }
+    handOverFinished();
+}
+
+auto FrameCapture::handOverFinished() -> void
+{
+    while(!pendingCopies.empty())
+    {
+        WriteRequest request = pendingCopies.front();
+        if(request.slot != NO_SLOT)
+        {
+            Slot& slot = slots[request.slot];
+            if(vkGetFenceStatus(device, slot.fence) != VK_SUCCESS)
+            {
+                break;
+            }
+            if(!slot.coherent)
+            {
+                VkMappedMemoryRange range = {};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = slot.memory;
+                range.offset = 0;
+                range.size = VK_WHOLE_SIZE;
+                vkInvalidateMappedMemoryRanges(device, 1, &range);
+            }
+            // The fence may be reset and reused as soon as this returns
+            slot.fence = VK_NULL_HANDLE;
+            slot.state.store(SlotState::Writing, std::memory_order_relaxed);
+        }
+        pendingCopies.pop_front();
+        queueWrite(request);
+    }
+}
+
+/**
+ * Writer Thread
+ */
+auto FrameCapture::queueWrite(WriteRequest request) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writeRequests.push_back(request);
+    }
+    writerSignal.notify_one();
+}
+
+auto FrameCapture::writerMain() -> void
+{
+    bool failed = false;
+    while(true)
+    {
+        WriteRequest request;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerSignal.wait(lock, [this] { return stopWriter || !writeRequests.empty(); });
+            // Everything already queued is still written before stopping
+            if(writeRequests.empty())
+            {
+                return;
+            }
+            request = writeRequests.front();
+            writeRequests.pop_front();
+        }
+
+        if(request.slot == NO_SLOT)
+        {
+            if(output.is_open() && outputSequence == request.sequence)
+            {
+                closeOutput();
+            }
+            continue;
+        }
+
+        Slot& slot = slots[request.slot];
+        // After a failure frames are only thrown away, until poll brings the error to the render thread
+        if(!failed)
+        {
+            try
+            {
+                writeFrame(slot);
+                framesWritten.fetch_add(1, std::memory_order_relaxed);
+            }
+            catch(const std::exception& e)
+            {
+                failed = true;
+                closeOutput();
+                std::lock_guard<std::mutex> lock(writerMutex);
+                writerError = e.what();
+            }
+        }
+        // Release so the render thread only reuses the buffer once the frame has been read out of it
+        slot.state.store(SlotState::Free, std::memory_order_release);
+    }
+}
+
+auto FrameCapture::writeFrame(const Slot& slot) -> void
+{
+    switch(config.format)
+    {
+        case Format::Raw:
+            writeRaw(slot);
+            break;
+        case Format::Y4M:
+            writeY4M(slot);
+            break;
+        case Format::Png:
+            writePng(slot);
+            break;
+    }
+    if(output.is_open() && !output)
+    {
+        throw std::runtime_error("Failed to write captured frame");
+    }
+}
+
+auto FrameCapture::writeRaw(const Slot& slot) -> void
+{
+    openOutput(slot, "_" + std::to_string(slot.extent.width) + "x" + std::to_string(slot.extent.height) + ".rgba");
+
+    type::size pixelCount = static_cast<type::size>(slot.extent.width) * slot.extent.height;
+    pixels.resize(pixelCount * 4);
+    toOpaqueRgba(slot.mapped, pixels.data(), pixelCount, slot.bgra);
+    output.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+}
+
+auto FrameCapture::writeY4M(const Slot& slot) -> void
+{
+    if(openOutput(slot, ".y4m"))
+    {
+        std::string header = "YUV4MPEG2 W" + std::to_string(slot.extent.width) + " H" + std::to_string(slot.extent.height)
+                + " F" + std::to_string(config.frameRate) + ":1 Ip A1:1 C420jpeg\n";
+        output.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+
+    type::uint32 width = slot.extent.width;
+    type::uint32 height = slot.extent.height;
+    type::size lumaSize = static_cast<type::size>(width) * height;
+    type::size chromaSize = static_cast<type::size>((width + 1) / 2) * ((height + 1) / 2);
+    planes.resize(lumaSize + chromaSize * 2);
+    toLuma(slot.mapped, planes.data(), lumaSize, slot.bgra);
+    toChroma(slot.mapped, width, height, slot.bgra, planes.data() + lumaSize, planes.data() + lumaSize + chromaSize);
+
+    static constexpr char frameHeader[] = "FRAME\n";
+    output.write(frameHeader, sizeof(frameHeader) - 1);
+    output.write(reinterpret_cast<const char*>(planes.data()), static_cast<std::streamsize>(planes.size()));
+}
+
+auto FrameCapture::writePng(const Slot& slot) -> void
+{
+    type::uint32 width = slot.extent.width;
+    type::uint32 height = slot.extent.height;
+    type::size rowSize = static_cast<type::size>(width) * 4;
+
+    // Every row starts with its filter type. 0 leaves the row as is
+    pixels.resize((rowSize + 1) * height);
+    for(type::uint32 y = 0; y < height; ++y)
+    {
+        type::uint8* row = pixels.data() + (rowSize + 1) * y;
+        row[0] = 0;
+        toOpaqueRgba(slot.mapped + rowSize * y, row + 1, width, slot.bgra);
+    }
+
+    std::string path = outputPath(slot.sequence, "_" + padded(slot.frame, 6) + ".png");
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    static constexpr type::uint8 signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    // 8 bits per channel RGBA, default compression and filtering, not interlaced
+    type::uint8 header[13] = {};
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;
+    header[9] = 6;
+    writeChunk(file, "IHDR", header, sizeof(header));
+
+    // The image data is a zlib stream of stored deflate blocks. Compressing would cost far more time than
+        // a frame has, so PNG only trades disk space for files any viewer can open. The stream can be split
+        // across IDAT chunks anywhere, so every block gets its own chunk and is written straight from the rows
+    static constexpr type::uint8 zlibHeader[] = {0x78, 0x01};
+    writeChunk(file, "IDAT", zlibHeader, sizeof(zlibHeader));
+    constexpr type::size maxBlock = 65535;
+    for(type::size offset = 0; offset < pixels.size(); offset += maxBlock)
+    {
+        auto blockSize = static_cast<type::uint16>(std::min(maxBlock, pixels.size() - offset));
+        bool last = offset + blockSize == pixels.size();
+        type::uint8 blockHeader[5] = {
+                static_cast<type::uint8>(last ? 1 : 0),
+                static_cast<type::uint8>(blockSize & 0xFF), static_cast<type::uint8>(blockSize >> 8),
+                static_cast<type::uint8>(~blockSize & 0xFF), static_cast<type::uint8>((~blockSize >> 8) & 0xFF)
+        };
+        writeChunk(file, "IDAT", blockHeader, sizeof(blockHeader), pixels.data() + offset, blockSize);
+    }
+    type::uint8 checksum[4];
+    putBigEndian(checksum, adler32(pixels.data(), pixels.size()));
+    writeChunk(file, "IDAT", checksum, sizeof(checksum));
+    writeChunk(file, "IEND", nullptr, 0);
+
+    if(!file)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+auto FrameCapture::openOutput(const Slot& slot, const std::string& extension) -> bool
+{
+    bool sameSequence = output.is_open() && outputSequence == slot.sequence;
+    if(sameSequence && outputExtent.width == slot.extent.width && outputExtent.height == slot.extent.height)
+    {
+        return false;
+    }
+
+    closeOutput();
+    outputPart = sameSequence ? outputPart + 1 : 0;
+    outputSequence = slot.sequence;
+    outputExtent = slot.extent;
+
+    std::string path = outputPath(slot.sequence, (outputPart > 0 ? "_" + std::to_string(outputPart) : "") + extension);
+    output.open(path, std::ios::binary | std::ios::trunc);
+    if(!output)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    return true;
+}
+
+auto FrameCapture::closeOutput() -> void
+{
+    if(output.is_open())
+    {
+        output.close();
+    }
+    output.clear();
+}
+
+auto FrameCapture::outputPath(type::uint32 sequence, const std::string& suffix) const -> std::string
+{
+    return config.directory + "/capture" + padded(sequence, 3) + suffix;
+}
+
+/**
+ * Readback Buffers
+ */
+auto FrameCapture::createSlotBuffer(Slot& slot, VkDeviceSize size) -> void
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkMemoryPropertyFlags properties = memoryTracker->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            VK_MEMORY_PROPERTY_HOST_CACHED_BIT, MemoryTracker::Category::Readback, slot.buffer, slot.memory);
+
+    // Stays mapped for as long as the buffer lives
+    void* data;
+    vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &data);
+    slot.mapped = static_cast<const type::uint8*>(data);
+    slot.coherent = properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    slot.size = size;
+}
+
+auto FrameCapture::destroySlotBuffer(Slot& slot) -> void
+{
+    if(slot.buffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkUnmapMemory(device, slot.memory);
+    vkDestroyBuffer(device, slot.buffer, nullptr);
+    memoryTracker->free(slot.memory);
+    slot.buffer = VK_NULL_HANDLE;
+    slot.memory = VK_NULL_HANDLE;
+    slot.mapped = nullptr;
+    slot.size = 0;
+}
@@ -0,0 +1,174 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_FRAMECAPTURE_H
+#define VULKANTUTORIAL_FRAMECAPTURE_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "MemoryTracker.h"
+
+/**
+ * Copies rendered frames back from the GPU and streams them to disk
+ *
+ * Each captured frame is copied into one of a ring of host visible readback
+ * buffers, as part of the frame's own command buffer. Nothing ever waits on the
+ * copy: the buffer is only handed on once the fence of the submission it went
+ * out with has signaled, which the renderer is waiting on anyway before reusing
+ * the frame. A writer thread then converts the pixels straight out of the mapped
+ * buffer and writes them out, and the buffer goes back into the ring.
+ *
+ * When the writer falls behind and every buffer is taken, frames are dropped
+ * instead of stalling the renderer. The dropped count says whether the disk or
+ * the format is keeping up.
+ */
+class FrameCapture
+{
+public:
+    enum class Format
+    {
+        // Tightly packed RGBA8 frames back to back in a single file per sequence
+        Raw,
+        // YUV 4:2:0 video, which most encoders and players take as is
+        Y4M,
+        // One uncompressed PNG per frame
+        Png
+    };
+
+    struct Config
+    {
+        Format format = Format::Y4M;
+        // Created if it doesn't exist
+        std::string directory = "capture";
+        // Frames that can be on their way from the GPU to disk at once. More than that are dropped
+        type::uint32 bufferCount = 4;
+        // Only written into Y4M headers. Frames are stored as they were rendered either way
+        type::uint32 frameRate = 60;
+    };
+
+    auto init(VkDevice device, MemoryTracker& memoryTracker, Config config) -> void;
+    // The GPU has to be idle. Frames already copied are still written out
+    auto cleanup() -> void;
+
+    // Whether images in the given format can be captured
+    static auto supportsFormat(VkFormat format) -> bool;
+
+    // Each start begins a new sequence of files
+    auto start() -> void;
+    auto stop() -> void;
+    inline auto isCapturing() const -> bool { return capturing.load(std::memory_order_relaxed); }
+
+    // Record copying the image, which has to be in TRANSFER_SRC_OPTIMAL, into a free readback buffer.
+        // The command buffer has to be submitted with the given fence. Does nothing unless capturing
+    auto record(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, VkFormat format, VkFence fence) -> void;
+    // Call once per frame, after waiting on the frame's fence and before resetting it.
+        // Hands the copies that are done over to the writer thread
+    auto poll() -> void;
+
+    // Safe to call from any thread
+    inline auto getFramesWritten() const -> type::uint64 { return framesWritten.load(std::memory_order_relaxed); }
+    inline auto getFramesDropped() const -> type::uint64 { return framesDropped.load(std::memory_order_relaxed); }
+
+private:
+    enum class SlotState : type::uint8
+    {
+        Free,
+        // Copy recorded, waiting on its fence
+        Copying,
+        // Queued for or being written by the writer thread
+        Writing
+    };
+
+    // Readback buffer and the frame in it
+    struct Slot
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        const type::uint8* mapped = nullptr;
+        // Non-coherent memory has to be invalidated before the CPU reads it
+        bool coherent = false;
+        // Only the render thread moves a slot out of Free, and only the writer moves it back
+        std::atomic<SlotState> state = SlotState::Free;
+        VkFence fence = VK_NULL_HANDLE;
+        VkExtent2D extent = {0, 0};
+        // Blue and red are swapped
+        bool bgra = false;
+        type::uint32 sequence = 0;
+        type::uint32 frame = 0;
+    };
+
+    // Work for the writer thread
+    struct WriteRequest
+    {
+        // NO_SLOT closes the sequence's files instead
+        type::uint32 slot;
+        type::uint32 sequence;
+    };
+    static constexpr type::uint32 NO_SLOT = type::uint32_max;
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    Config config;
+    std::unique_ptr<Slot[]> slots;
+
+    /* Render Thread State */
+    std::atomic<bool> capturing = false;
+    // Numbered from 1
+    type::uint32 sequence = 0;
+    type::uint32 nextFrame = 0;
+    // Copies waiting on their fences, plus the ends of sequences, in the order they were recorded.
+        // Submissions finish in order, so only the front ever has to be checked
+    std::deque<WriteRequest> pendingCopies;
+    std::atomic<type::uint64> framesWritten = 0;
+    std::atomic<type::uint64> framesDropped = 0;
+    // Queue everything at the front of pendingCopies that the GPU is done with
+    auto handOverFinished() -> void;
+
+    /* Writer Thread */
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writerSignal;
+    std::deque<WriteRequest> writeRequests;
+    bool stopWriter = false;
+    // Writer thread exceptions are rethrown from poll
+    std::string writerError;
+    auto writerMain() -> void;
+    auto queueWrite(WriteRequest request) -> void;
+
+    /* Writer Thread State */
+    std::ofstream output;
+    // Sequence and extent of the open file. Raw and Y4M files can't change size, so a resize starts a new part
+    type::uint32 outputSequence = 0;
+    VkExtent2D outputExtent = {0, 0};
+    type::uint32 outputPart = 0;
+    // Reused between frames so the writer doesn't allocate
+    std::vector<type::uint8> pixels;
+    std::vector<type::uint8> planes;
+    auto writeFrame(const Slot& slot) -> void;
+    auto writeRaw(const Slot& slot) -> void;
+    auto writeY4M(const Slot& slot) -> void;
+    auto writePng(const Slot& slot) -> void;
+    // Open the sequence's file for a frame, unless it's already open at the frame's size. True if a new file was opened
+    auto openOutput(const Slot& slot, const std::string& extension) -> bool;
+    auto closeOutput() -> void;
+    auto outputPath(type::uint32 sequence, const std::string& suffix) const -> std::string;
+
+    // Host visible, and cached if there is such memory, since the CPU reads every byte
+    auto createSlotBuffer(Slot& slot, VkDeviceSize size) -> void;
+    auto destroySlotBuffer(Slot& slot) -> void;
+};
+
+#endif //VULKANTUTORIAL_FRAMECAPTURE_H
@@ -0,0 +1,166 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <iterator>
+#include <stdexcept>
+#include "GeometryPool.h"
+
+/**
+ * Range Allocator
+ */
+auto RangeAllocator::init(type::uint32 capacity) -> void
+{
+    ranges.clear();
+    if(capacity > 0)
+    {
+        ranges[0] = capacity;
+    }
+    freeCount = capacity;
+}
+
+auto RangeAllocator::allocate(type::uint32 size) -> type::uint32
+{
+    if(size == 0)
+    {
+        return 0;
+    }
+    for(auto it = ranges.begin(); it != ranges.end(); ++it)
+    {
+        if(it->second < size)
+        {
+            continue;
+        }
+        // Taken off the front, so what's left keeps its place in the order
+        type::uint32 offset = it->first;
+        type::uint32 remaining = it->second - size;
+        ranges.erase(it);
+        if(remaining > 0)
+        {
+            ranges[offset + size] = remaining;
+        }
+        freeCount -= size;
+        return offset;
+    }
+    return INVALID;
+}
+
+auto RangeAllocator::free(type::uint32 offset, type::uint32 size) -> void
+{
+    if(size == 0)
+    {
+        return;
+    }
+    freeCount += size;
+    auto next = ranges.lower_bound(offset);
+    // Merge into the range before if it ends where this one starts
+    if(next != ranges.begin())
+    {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            ranges.erase(previous);
+        }
+    }
+    // And swallow the range after if this one ends where it starts
+    if(next != ranges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        ranges.erase(next);
+    }
+    ranges[offset] = size;
+}
+
+/**
+ * Geometry Pool
+ */
+auto GeometryPool::init(VkDevice device, MemoryTracker& memoryTracker, Config config) -> void
+{
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->config = config;
+
+    // Only ever written by copies, so they can live where the CPU can't see them
+    memoryTracker.createBuffer(config.vertexStride * config.vertexCapacity,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            MemoryTracker::Category::Vertex, vertexBuffer, vertexMemory);
+    memoryTracker.createBuffer(sizeof(Index) * config.indexCapacity,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            MemoryTracker::Category::Index, indexBuffer, indexMemory);
+    vertexRanges.init(config.vertexCapacity);
+    indexRanges.init(config.indexCapacity);
+}
+
+auto GeometryPool::cleanup() -> void
+{
+    vkDestroyBuffer(device, indexBuffer, nullptr);
+    memoryTracker->free(indexMemory);
+    vkDestroyBuffer(device, vertexBuffer, nullptr);
+    memoryTracker->free(vertexMemory);
+    indexBuffer = VK_NULL_HANDLE;
+    vertexBuffer = VK_NULL_HANDLE;
+}
+
+auto GeometryPool::allocate(type::uint32 vertexCount, type::uint32 indexCount) -> Allocation
+{
+    type::uint32 vertexOffset = vertexRanges.allocate(vertexCount);
+    if(vertexOffset == RangeAllocator::INVALID)
+    {
+        throw std::runtime_error("Geometry pool is out of room for vertices");
+    }
+    type::uint32 firstIndex = indexRanges.allocate(indexCount);
+    if(firstIndex == RangeAllocator::INVALID)
+    {
+        vertexRanges.free(vertexOffset, vertexCount);
+        throw std::runtime_error("Geometry pool is out of room for indices");
+    }
+    return {static_cast<type::int32>(vertexOffset), vertexCount, firstIndex, indexCount};
+}
+
+auto GeometryPool::free(const Allocation& allocation) -> void
+{
+    vertexRanges.free(static_cast<type::uint32>(allocation.vertexOffset), allocation.vertexCount);
+    indexRanges.free(allocation.firstIndex, allocation.indexCount);
+}
+
+auto GeometryPool::recordUpload(VkCommandBuffer commandBuffer, VkBuffer source, const std::vector<Upload>& uploads) -> void
+{
+    std::vector<VkBufferCopy> vertexRegions;
+    std::vector<VkBufferCopy> indexRegions;
+    for(const auto& upload : uploads)
+    {
+        const Allocation& allocation = upload.allocation;
+        if(allocation.vertexCount > 0)
+        {
+            vertexRegions.push_back({upload.vertexSource,
+                    static_cast<VkDeviceSize>(allocation.vertexOffset) * config.vertexStride,
+                    allocation.vertexCount * config.vertexStride});
+        }
+        if(allocation.indexCount > 0)
+        {
+            indexRegions.push_back({upload.indexSource, allocation.firstIndex * sizeof(Index),
+                    allocation.indexCount * sizeof(Index)});
+        }
+    }
+    if(!vertexRegions.empty())
+    {
+        vkCmdCopyBuffer(commandBuffer, source, vertexBuffer, static_cast<type::uint32>(vertexRegions.size()),
+                vertexRegions.data());
+    }
+    if(!indexRegions.empty())
+    {
+        vkCmdCopyBuffer(commandBuffer, source, indexBuffer, static_cast<type::uint32>(indexRegions.size()),
+                indexRegions.data());
+    }
+}
+
+auto GeometryPool::bind(VkCommandBuffer commandBuffer) -> void
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, INDEX_TYPE);
+}
+
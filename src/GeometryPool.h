@@ -0,0 +1,113 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_GEOMETRYPOOL_H
+#define VULKANTUTORIAL_GEOMETRYPOOL_H
+
+#include <vulkan/vulkan.h>
+#include <map>
+#include <vector>
+
+#include "types.h"
+#include "MemoryTracker.h"
+
+/**
+ * Hands out ranges of a fixed capacity, first fit
+ *
+ * Free ranges are kept sorted by where they start, and a freed range is merged
+ * with the free ranges on either side of it, so the space doesn't splinter as
+ * ranges come and go.
+ */
+class RangeAllocator
+{
+public:
+    static constexpr type::uint32 INVALID = ~0u;
+
+    auto init(type::uint32 capacity) -> void;
+    // Start of a free range of this size, or INVALID if there's none
+    auto allocate(type::uint32 size) -> type::uint32;
+    // The range has to be one handed out by allocate
+    auto free(type::uint32 offset, type::uint32 size) -> void;
+    inline auto getFree() const -> type::uint32 { return freeCount; }
+
+private:
+    // Size of each free range, by its start
+    std::map<type::uint32, type::uint32> ranges;
+    type::uint32 freeCount = 0;
+};
+
+/**
+ * Vertices and indices of every mesh, packed into one device local vertex buffer and one index buffer
+ *
+ * Each mesh gets a range of both, so the buffers are bound once for a whole pass
+ * and draws only differ in where they start: firstIndex picks its indices and
+ * vertexOffset is added to every index before the vertex is fetched. Since the
+ * offset is added after the index is read, 16 bit indices are enough for any one
+ * mesh while the pool as a whole can hold far more vertices than they could
+ * address. Every draw sharing the same buffers is also what lets them be merged
+ * into multi draw indirect calls.
+ */
+class GeometryPool
+{
+public:
+    using Index = type::uint16;
+    static constexpr VkIndexType INDEX_TYPE = VK_INDEX_TYPE_UINT16;
+
+    struct Config
+    {
+        // Size of one vertex in bytes
+        VkDeviceSize vertexStride = 0;
+        type::uint32 vertexCapacity = 1 << 16;
+        type::uint32 indexCapacity = 1 << 18;
+    };
+
+    // Where one mesh lives in the pool, in vertices and indices
+    struct Allocation
+    {
+        type::int32 vertexOffset = 0;
+        type::uint32 vertexCount = 0;
+        type::uint32 firstIndex = 0;
+        type::uint32 indexCount = 0;
+    };
+
+    // Copy of one mesh into its allocation, from byte offsets of the source buffer
+    struct Upload
+    {
+        Allocation allocation;
+        VkDeviceSize vertexSource;
+        VkDeviceSize indexSource;
+    };
+
+    auto init(VkDevice device, MemoryTracker& memoryTracker, Config config) -> void;
+    auto cleanup() -> void;
+
+    // Throws when either buffer has no room left
+    auto allocate(type::uint32 vertexCount, type::uint32 indexCount) -> Allocation;
+    // No frame in flight can still be drawing from it
+    auto free(const Allocation& allocation) -> void;
+
+    // Copy meshes into their allocations, all of them in one copy per buffer. The source needs TRANSFER_SRC
+        // usage. Draws reading them have to be behind a barrier on the transfer
+    auto recordUpload(VkCommandBuffer commandBuffer, VkBuffer source, const std::vector<Upload>& uploads) -> void;
+    // Bind both buffers for every draw that follows
+    auto bind(VkCommandBuffer commandBuffer) -> void;
+
+    inline auto getVertexBuffer() const -> VkBuffer { return vertexBuffer; }
+    inline auto getIndexBuffer() const -> VkBuffer { return indexBuffer; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    Config config;
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+};
+
+#endif //VULKANTUTORIAL_GEOMETRYPOOL_H
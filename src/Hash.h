@@ -0,0 +1,38 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_HASH_H
+#define VULKANTUTORIAL_HASH_H
+
+#include "types.h"
+
+namespace hash
+{
+    constexpr type::uint64 fnvOffset = 14695981039346656037ull;
+    constexpr type::uint64 fnvPrime = 1099511628211ull;
+
+    // FNV-1a over a block of bytes. Pass a previous result as the seed to chain blocks
+    inline auto fnv1a(const void* data, type::size size, type::uint64 seed = fnvOffset) -> type::uint64
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        type::uint64 result = seed;
+        for(type::size i = 0; i < size; ++i)
+        {
+            result ^= bytes[i];
+            result *= fnvPrime;
+        }
+        return result;
+    }
+
+    // Fold a trivially copyable value (handles, enums, integers) into a running hash
+        // Don't use this on structs with padding, hash their members instead
+    template<typename T>
+    inline auto combine(type::uint64 seed, const T& value) -> type::uint64
+    {
+        return fnv1a(&value, sizeof(T), seed);
+    }
+}
+
+#endif //VULKANTUTORIAL_HASH_H
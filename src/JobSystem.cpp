@@ -0,0 +1,352 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <stdexcept>
+#include "JobSystem.h"
+
+namespace
+{
+    // Worker the current thread is, if any
+    thread_local type::uint32 threadWorkerIndex = JobSystem::NOT_A_WORKER;
+
+    // Failed steal attempts before a worker gives up and sleeps
+    constexpr type::uint32 STEAL_ATTEMPTS = 64;
+}
+
+auto JobSystem::init(type::uint32 workerCount, type::uint32 attachedThreads) -> void
+{
+    if(workerCount == 0)
+    {
+        workerCount = std::thread::hardware_concurrency();
+    }
+    // The calling thread and the attached ones always get a worker, even if that's more than the hardware has
+    workerCount = std::max(workerCount, attachedThreads + 1);
+
+    workers.clear();
+    for(type::uint32 i = 0; i < workerCount; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>());
+        // Different seeds so workers don't all go after the same victim
+        workers.back()->random = 0x9E3779B9u * (i + 1);
+    }
+
+    stopping = false;
+    attachedCount = attachedThreads;
+    nextAttached = 0;
+    resetStats();
+    threadWorkerIndex = 0;
+    // Attached threads take the workers right after the calling thread's
+    for(type::uint32 i = 1 + attachedThreads; i < workerCount; ++i)
+    {
+        threads.emplace_back(&JobSystem::workerMain, this, i);
+    }
+}
+
+auto JobSystem::cleanup() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepSignal.notify_all();
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+    workers.clear();
+    threadWorkerIndex = NOT_A_WORKER;
+}
+
+auto JobSystem::attachThread() -> void
+{
+    type::uint32 attached = nextAttached.fetch_add(1);
+    if(attached >= attachedCount)
+    {
+        throw std::runtime_error("More threads attached to the job system than it was initialized for");
+    }
+    threadWorkerIndex = 1 + attached;
+}
+
+auto JobSystem::wait(Counter& counter) -> void
+{
+    type::uint32 workerIndex = currentWorker();
+    while(!counter.isDone())
+    {
+        Job* job = workerIndex != NOT_A_WORKER ? findJob(workerIndex) : nullptr;
+        if(job)
+        {
+            execute(workerIndex, job);
+        }
+        else
+        {
+            // Whatever is left is running on other workers
+            std::this_thread::yield();
+        }
+    }
+    // The last job decrements the counter while holding this lock. Taking it makes sure
+        // that job is done touching the counter before the caller is free to destroy it
+    std::lock_guard<std::mutex> lock(counter.waitingMutex);
+}
+
+auto JobSystem::currentWorker() -> type::uint32
+{
+    return threadWorkerIndex;
+}
+
+auto JobSystem::getStats() const -> std::vector<WorkerStats>
+{
+    double window = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - statsStart).count();
+    std::vector<WorkerStats> stats;
+    stats.reserve(workers.size());
+    for(const auto& worker : workers)
+    {
+        WorkerStats workerStats = {};
+        workerStats.utilization = window > 0.0 ? static_cast<float>(worker->busyNanoseconds.load() / window) : 0.0f;
+        workerStats.jobsRun = worker->jobsRun.load();
+        workerStats.jobsStolen = worker->jobsStolen.load();
+        stats.push_back(workerStats);
+    }
+    return stats;
+}
+
+auto JobSystem::resetStats() -> void
+{
+    for(auto& worker : workers)
+    {
+        worker->busyNanoseconds = 0;
+        worker->jobsRun = 0;
+        worker->jobsStolen = 0;
+    }
+    statsStart = std::chrono::steady_clock::now();
+}
+
+/**
+ * Chase-Lev Deque
+ */
+auto JobSystem::Deque::push(Job* job) -> bool
+{
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_acquire);
+    if(b - t >= static_cast<std::int64_t>(CAPACITY))
+    {
+        return false;
+    }
+    buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    // Publishes the job, and everything written into it, to thieves that see the new bottom
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+auto JobSystem::Deque::pop() -> Job*
+{
+    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    // Claim the bottom slot before looking at top, so a thief can't take it unnoticed
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+
+    if(t > b)
+    {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if(t == b)
+    {
+        // Last job, which a thief may be after too. Whoever moves top gets it
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+auto JobSystem::Deque::steal() -> Job*
+{
+    std::int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_acquire);
+    if(t >= b)
+    {
+        return nullptr;
+    }
+
+    Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    // Lost to the owner or another thief
+    if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+/**
+ * Scheduling
+ */
+auto JobSystem::allocateJob() -> Job*
+{
+    type::uint32 workerIndex = currentWorker();
+    if(workerIndex == NOT_A_WORKER)
+    {
+        throw std::runtime_error("Jobs can only be created from job system workers");
+    }
+    Worker& worker = *workers[workerIndex];
+    while(true)
+    {
+        // Usually the next slot is long done. Otherwise go around the ring once for one that is
+        for(type::uint32 i = 0; i < JOBS_PER_WORKER; ++i)
+        {
+            Job* job = &worker.jobs[worker.nextJob];
+            worker.nextJob = (worker.nextJob + 1) % JOBS_PER_WORKER;
+            // Acquire pairs with the release in execute, so the old closure is fully gone
+            if(!job->inUse.load(std::memory_order_acquire))
+            {
+                job->inUse.store(true, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        // Every slot is queued, running or held by a counter. Help out until one of them is done
+        if(Job* job = findJob(workerIndex))
+        {
+            execute(workerIndex, job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+auto JobSystem::push(Job* job) -> void
+{
+    type::uint32 workerIndex = currentWorker();
+    if(!workers[workerIndex]->deque.push(job))
+    {
+        // Deque is full, so there's plenty for the others to do already
+        execute(workerIndex, job);
+        return;
+    }
+
+    wakeEpoch.fetch_add(1);
+    if(sleepers.load() > 0)
+    {
+        // Taken so the notify can't land between a sleeper checking the epoch and waiting
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepSignal.notify_one();
+    }
+}
+
+auto JobSystem::findJob(type::uint32 workerIndex) -> Job*
+{
+    Worker& worker = *workers[workerIndex];
+    if(Job* job = worker.deque.pop())
+    {
+        return job;
+    }
+
+    auto workerCount = static_cast<type::uint32>(workers.size());
+    if(workerCount < 2)
+    {
+        return nullptr;
+    }
+    // Start at a random victim and go around once
+    worker.random ^= worker.random << 13;
+    worker.random ^= worker.random >> 17;
+    worker.random ^= worker.random << 5;
+    type::uint32 start = worker.random % workerCount;
+    for(type::uint32 i = 0; i < workerCount; ++i)
+    {
+        type::uint32 victim = (start + i) % workerCount;
+        if(victim == workerIndex)
+        {
+            continue;
+        }
+        if(Job* job = workers[victim]->deque.steal())
+        {
+            worker.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+auto JobSystem::execute(type::uint32 workerIndex, Job* job) -> void
+{
+    Worker& worker = *workers[workerIndex];
+    auto start = std::chrono::steady_clock::now();
+    ++worker.executeDepth;
+    job->invoke(*job);
+    --worker.executeDepth;
+    auto end = std::chrono::steady_clock::now();
+
+    if(worker.executeDepth == 0)
+    {
+        worker.busyNanoseconds.fetch_add(static_cast<type::uint64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()), std::memory_order_relaxed);
+    }
+    worker.jobsRun.fetch_add(1, std::memory_order_relaxed);
+
+    // Nothing reads the job after this, so its slot can go back to the worker that created it
+    Counter* counter = job->counter;
+    job->inUse.store(false, std::memory_order_release);
+    finish(counter);
+}
+
+auto JobSystem::finish(Counter* counter) -> void
+{
+    if(!counter)
+    {
+        return;
+    }
+
+    std::vector<Job*> ready;
+    {
+        // Decremented under the lock so runAfter can't add a job the moment after the last one finished
+        std::lock_guard<std::mutex> lock(counter->waitingMutex);
+        if(counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            ready.swap(counter->waiting);
+        }
+    }
+    for(Job* dependent : ready)
+    {
+        push(dependent);
+    }
+}
+
+auto JobSystem::workerMain(type::uint32 workerIndex) -> void
+{
+    threadWorkerIndex = workerIndex;
+    type::uint32 failedAttempts = 0;
+    while(!stopping.load(std::memory_order_relaxed))
+    {
+        type::uint32 epoch = wakeEpoch.load();
+        if(Job* job = findJob(workerIndex))
+        {
+            execute(workerIndex, job);
+            failedAttempts = 0;
+            continue;
+        }
+
+        if(++failedAttempts < STEAL_ATTEMPTS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nothing has been pushed since the epoch was read, so there's really nothing to do
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers.fetch_add(1);
+        sleepSignal.wait(lock, [&] { return stopping.load() || wakeEpoch.load() != epoch; });
+        sleepers.fetch_sub(1);
+        failedAttempts = 0;
+    }
+}
@@ -0,0 +1,245 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_JOBSYSTEM_H
+#define VULKANTUTORIAL_JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Work stealing job scheduler
+ *
+ * Every worker owns a Chase-Lev deque. Jobs a worker creates go on the bottom of
+ * its own deque and are popped back off the bottom, so related work stays on one
+ * core while it's still in cache. Workers that run dry steal from the top of a
+ * random other deque. Idle workers sleep until new jobs show up.
+ *
+ * The thread that calls init becomes worker 0 and runs jobs whenever it waits on
+ * a counter. Other threads with loops of their own can become workers the same
+ * way through attachThread. Jobs can only be created from worker threads, since
+ * each worker allocates them out of its own ring.
+ */
+class JobSystem
+{
+public:
+    // Closures bigger than this don't fit in a job. Capture by reference or pointer instead
+    static constexpr type::size JOB_STORAGE = 48;
+    // Jobs a worker can have created and not yet finished at once. Creating another one runs
+        // queued jobs until one of them is done and its slot is free again
+    static constexpr type::uint32 JOBS_PER_WORKER = 4096;
+
+    struct Job;
+
+    /**
+     * Number of unfinished jobs that were started with it
+     *
+     * Waiting on a counter runs other jobs in the meantime. Jobs started with
+     * runAfter are held by the counter and queued once it reaches zero.
+     */
+    class Counter
+    {
+    public:
+        inline auto isDone() const -> bool { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<type::uint32> pending = 0;
+        std::mutex waitingMutex;
+        std::vector<Job*> waiting;
+    };
+
+    struct Job
+    {
+        void (*invoke)(Job& job);
+        // Decremented once the job is done. Can be null
+        Counter* counter;
+        // Set from creation until the job is done, so the slot isn't handed out while queued or running
+        std::atomic<bool> inUse = false;
+        alignas(16) unsigned char storage[JOB_STORAGE];
+    };
+
+    // Time spent running jobs over some window, per worker
+    struct WorkerStats
+    {
+        // Fraction of the window spent running jobs
+        float utilization;
+        type::uint64 jobsRun;
+        type::uint64 jobsStolen;
+    };
+
+    // Zero workers means one per hardware thread, counting the calling thread. Of those, attachedThreads
+        // are left for threads that call attachThread instead of being started here
+    auto init(type::uint32 workerCount = 0, type::uint32 attachedThreads = 0) -> void;
+    // Attached threads have to be done with their jobs by now
+    auto cleanup() -> void;
+    // Make the calling thread one of the workers set aside in init
+    auto attachThread() -> void;
+
+    // Queue a job on the calling worker's deque
+    template<typename F>
+    auto run(F&& function, Counter* counter = nullptr) -> void
+    {
+        Job* job = createJob(std::forward<F>(function), counter);
+        push(job);
+    }
+
+    // Queue a job once the dependency's jobs are all done
+    template<typename F>
+    auto runAfter(Counter& dependency, F&& function, Counter* counter = nullptr) -> void
+    {
+        Job* job = createJob(std::forward<F>(function), counter);
+        {
+            std::lock_guard<std::mutex> lock(dependency.waitingMutex);
+            if(dependency.pending.load(std::memory_order_acquire) != 0)
+            {
+                dependency.waiting.push_back(job);
+                return;
+            }
+        }
+        push(job);
+    }
+
+    // Run jobs until the counter reaches zero
+    auto wait(Counter& counter) -> void;
+
+    // Call function(first, last) on chunks of [0, count) across the workers and wait for them all.
+        // Ranges no bigger than minChunk aren't worth splitting and run right on the calling thread
+    template<typename F>
+    auto parallelFor(type::uint32 count, type::uint32 minChunk, F&& function) -> void
+    {
+        if(count == 0)
+        {
+            return;
+        }
+        // A few chunks per worker so the stealing can even out uneven chunks
+        type::uint32 chunkCount = std::min((count + minChunk - 1) / std::max(minChunk, 1u), getWorkerCount() * 4);
+        if(chunkCount <= 1)
+        {
+            function(0u, count);
+            return;
+        }
+
+        type::uint32 chunkSize = (count + chunkCount - 1) / chunkCount;
+        Counter counter;
+        // The function outlives the jobs since this waits on them
+        auto* functionPtr = &function;
+        for(type::uint32 first = chunkSize; first < count; first += chunkSize)
+        {
+            type::uint32 last = std::min(first + chunkSize, count);
+            run([functionPtr, first, last] { (*functionPtr)(first, last); }, &counter);
+        }
+        // The first chunk runs here instead of sitting in the deque
+        function(0u, std::min(chunkSize, count));
+        wait(counter);
+    }
+
+    inline auto getWorkerCount() const -> type::uint32 { return static_cast<type::uint32>(workers.size()); }
+    // Index of the calling worker, or NOT_A_WORKER for threads the system doesn't own
+    static auto currentWorker() -> type::uint32;
+    static constexpr type::uint32 NOT_A_WORKER = type::uint32_max;
+
+    // Stats since the last reset. Meant to be polled every so often
+    auto getStats() const -> std::vector<WorkerStats>;
+    auto resetStats() -> void;
+
+private:
+    /**
+     * Chase-Lev work stealing deque of a fixed size
+     *
+     * The owning worker pushes and pops at the bottom without contention. Other
+     * workers steal from the top, and only race the owner for the last job.
+     */
+    class Deque
+    {
+    public:
+        static constexpr type::uint32 CAPACITY = JOBS_PER_WORKER;
+
+        // Owner only. False if the deque is full
+        auto push(Job* job) -> bool;
+        // Owner only
+        auto pop() -> Job*;
+        // Any thread
+        auto steal() -> Job*;
+
+    private:
+        std::atomic<std::int64_t> top = 0;
+        std::atomic<std::int64_t> bottom = 0;
+        std::unique_ptr<std::atomic<Job*>[]> buffer = std::make_unique<std::atomic<Job*>[]>(CAPACITY);
+    };
+
+    // Kept on their own cache lines so workers don't fight over each other's state
+    struct alignas(64) Worker
+    {
+        Deque deque;
+        // Jobs are allocated round robin, skipping slots still in use
+        std::unique_ptr<Job[]> jobs = std::make_unique<Job[]>(JOBS_PER_WORKER);
+        type::uint32 nextJob = 0;
+        // Jobs run inside other jobs, through wait or allocateJob. Only the outermost one counts as busy
+            // time, since the nested ones run within its time already. Owner only
+        type::uint32 executeDepth = 0;
+        type::uint32 random = 0;
+        std::atomic<type::uint64> busyNanoseconds = 0;
+        std::atomic<type::uint64> jobsRun = 0;
+        std::atomic<type::uint64> jobsStolen = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping = false;
+    type::uint32 attachedCount = 0;
+    std::atomic<type::uint32> nextAttached = 0;
+    std::chrono::steady_clock::time_point statsStart;
+
+    /* Sleeping */
+    std::mutex sleepMutex;
+    std::condition_variable sleepSignal;
+    std::atomic<type::uint32> sleepers = 0;
+    // Bumped on every push, so a worker about to sleep can tell it missed something
+    std::atomic<type::uint32> wakeEpoch = 0;
+
+    template<typename F>
+    auto createJob(F&& function, Counter* counter) -> Job*
+    {
+        using Function = std::decay_t<F>;
+        static_assert(sizeof(Function) <= JOB_STORAGE, "Job closure too big. Capture by reference instead");
+        static_assert(alignof(Function) <= 16, "Job closure over-aligned");
+
+        Job* job = allocateJob();
+        new (job->storage) Function(std::forward<F>(function));
+        job->invoke = [](Job& job)
+        {
+            Function& function = *std::launder(reinterpret_cast<Function*>(job.storage));
+            function();
+            function.~Function();
+        };
+        job->counter = counter;
+        if(counter)
+        {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    auto allocateJob() -> Job*;
+    auto push(Job* job) -> void;
+    // Own deque first, then steal
+    auto findJob(type::uint32 workerIndex) -> Job*;
+    auto execute(type::uint32 workerIndex, Job* job) -> void;
+    auto finish(Counter* counter) -> void;
+    auto workerMain(type::uint32 workerIndex) -> void;
+};
+
+#endif //VULKANTUTORIAL_JOBSYSTEM_H
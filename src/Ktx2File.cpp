@@ -0,0 +1,149 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "Ktx2File.h"
+#include "TextureFormats.h"
+
+namespace
+{
+    constexpr std::array<type::uint8, 12> KTX2_IDENTIFIER =
+            {
+                    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+            };
+
+    // Layout of the fixed part of the file, everything little endian
+    struct Header
+    {
+        type::uint8 identifier[12];
+        type::uint32 vkFormat;
+        type::uint32 typeSize;
+        type::uint32 pixelWidth;
+        type::uint32 pixelHeight;
+        type::uint32 pixelDepth;
+        type::uint32 layerCount;
+        type::uint32 faceCount;
+        type::uint32 levelCount;
+        type::uint32 supercompressionScheme;
+        // Index
+        type::uint32 dfdByteOffset;
+        type::uint32 dfdByteLength;
+        type::uint32 kvdByteOffset;
+        type::uint32 kvdByteLength;
+        type::uint64 sgdByteOffset;
+        type::uint64 sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header has to match the file layout");
+
+    struct LevelIndexEntry
+    {
+        type::uint64 byteOffset;
+        type::uint64 byteLength;
+        type::uint64 uncompressedByteLength;
+    };
+}
+
+auto Ktx2File::open(const std::string& path) -> Ktx2File
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        throw std::runtime_error("Failed to open texture " + path);
+    }
+    auto fileSize = static_cast<type::uint64>(file.tellg());
+    file.seekg(0);
+
+    Header header = {};
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+       || std::memcmp(header.identifier, KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0)
+    {
+        throw std::runtime_error(path + " is not a KTX2 file");
+    }
+
+    // VK_FORMAT_UNDEFINED means Basis Universal, which needs transcoding from scratch
+    if(header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0)
+    {
+        throw std::runtime_error(path + " uses supercompression, which isn't supported");
+    }
+    if(header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1
+       || header.pixelWidth == 0 || header.pixelHeight == 0)
+    {
+        throw std::runtime_error(path + " is not a single 2D texture");
+    }
+
+    Ktx2File ktx;
+    ktx.path = path;
+    ktx.format = static_cast<VkFormat>(header.vkFormat);
+    ktx.width = header.pixelWidth;
+    ktx.height = header.pixelHeight;
+    if(!texformat::blockInfo(ktx.format))
+    {
+        throw std::runtime_error(path + " has a format the texture loader doesn't know");
+    }
+
+    // A level count of 0 asks for the mips to be generated at load time, only the base level is in the file
+    type::uint32 levelCount = std::max(header.levelCount, 1u);
+    // The full chain halves the larger side down to 1, floor(log2(max(w, h))) + 1 levels. Checked before
+        // the index is sized from it, since it comes straight from the file
+    type::uint32 maxLevelCount = 1;
+    for(type::uint32 size = std::max(ktx.width, ktx.height); size > 1; size >>= 1)
+    {
+        ++maxLevelCount;
+    }
+    if(levelCount > maxLevelCount)
+    {
+        throw std::runtime_error(path + " has more mip levels than its size allows");
+    }
+    if(levelCount * sizeof(LevelIndexEntry) > fileSize - sizeof(Header))
+    {
+        throw std::runtime_error(path + " has a truncated level index");
+    }
+    std::vector<LevelIndexEntry> index(levelCount);
+    if(!file.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(LevelIndexEntry))))
+    {
+        throw std::runtime_error(path + " has a truncated level index");
+    }
+
+    ktx.levels.reserve(levelCount);
+    for(type::uint32 level = 0; level < levelCount; ++level)
+    {
+        const LevelIndexEntry& entry = index[level];
+        VkDeviceSize expected = texformat::imageSize(ktx.format, ktx.levelWidth(level), ktx.levelHeight(level));
+        // Offset first, so the length can be checked against what's left without overflowing
+        if(entry.byteOffset > fileSize || entry.byteLength > fileSize - entry.byteOffset || entry.byteLength != expected)
+        {
+            throw std::runtime_error(path + " has a malformed mip level");
+        }
+        ktx.levels.push_back({entry.byteOffset, entry.byteLength});
+    }
+    return ktx;
+}
+
+auto Ktx2File::readLevel(type::uint32 level, std::vector<type::uint8>& data) const -> void
+{
+    // Opened per read so any thread can read levels without sharing a stream
+    std::ifstream file(path, std::ios::binary);
+    const Level& entry = levels.at(level);
+    data.resize(entry.byteLength);
+    file.seekg(static_cast<std::streamoff>(entry.byteOffset));
+    if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(entry.byteLength)))
+    {
+        throw std::runtime_error("Failed to read mip level of " + path);
+    }
+}
+
+auto Ktx2File::levelWidth(type::uint32 level) const -> type::uint32
+{
+    return std::max(width >> level, 1u);
+}
+
+auto Ktx2File::levelHeight(type::uint32 level) const -> type::uint32
+{
+    return std::max(height >> level, 1u);
+}
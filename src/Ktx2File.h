@@ -0,0 +1,57 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_KTX2FILE_H
+#define VULKANTUTORIAL_KTX2FILE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Reader for KTX2 texture containers
+ *
+ * Only the header and level index are read when the file is opened, so mip
+ * levels can be read on demand and the large ones streamed in later. KTX2
+ * stores the Vulkan format directly, so block-compressed payloads can be
+ * copied into an image as they are.
+ *
+ * Supports single layer 2D textures without supercompression. Basis Universal
+ * and Zstandard payloads need their own decoders and are rejected.
+ */
+class Ktx2File
+{
+public:
+    struct Level
+    {
+        type::uint64 byteOffset;
+        type::uint64 byteLength;
+    };
+
+    // Throws if the file is missing, malformed or uses something unsupported
+    static auto open(const std::string& path) -> Ktx2File;
+
+    // Read one mip level, level 0 being the largest
+    auto readLevel(type::uint32 level, std::vector<type::uint8>& data) const -> void;
+    auto levelWidth(type::uint32 level) const -> type::uint32;
+    auto levelHeight(type::uint32 level) const -> type::uint32;
+
+    inline auto getFormat() const -> VkFormat { return format; }
+    inline auto getWidth() const -> type::uint32 { return width; }
+    inline auto getHeight() const -> type::uint32 { return height; }
+    inline auto getLevelCount() const -> type::uint32 { return static_cast<type::uint32>(levels.size()); }
+    inline auto getPath() const -> const std::string& { return path; }
+
+private:
+    std::string path;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    type::uint32 width = 0;
+    type::uint32 height = 0;
+    std::vector<Level> levels;
+};
+
+#endif //VULKANTUTORIAL_KTX2FILE_H
@@ -0,0 +1,338 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "MemoryTracker.h"
+
+namespace
+{
+    // Whole KiB below a MiB, MiB to one decimal above
+    auto formatBytes(VkDeviceSize bytes) -> std::string
+    {
+        constexpr VkDeviceSize MIB = 1024 * 1024;
+        if(bytes < MIB)
+        {
+            return std::to_string((bytes + 1023) / 1024) + " KiB";
+        }
+        VkDeviceSize tenths = (bytes * 10 + MIB / 2) / MIB;
+        return std::to_string(tenths / 10) + "." + std::to_string(tenths % 10) + " MiB";
+    }
+}
+
+auto MemoryTracker::categoryName(Category category) -> type::cstr
+{
+    switch(category)
+    {
+        case Category::Vertex: return "vertex";
+        case Category::Index: return "index";
+        case Category::Uniform: return "uniform";
+        case Category::Staging: return "staging";
+        case Category::Texture: return "texture";
+        case Category::RenderTarget: return "render target";
+        case Category::Readback: return "readback";
+        default: return "unknown";
+    }
+}
+
+auto MemoryTracker::isBudgetSupported(VkPhysicalDevice physicalDevice) -> bool
+{
+    type::uint32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+            [](const VkExtensionProperties& extension)
+            {
+                return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+            });
+}
+
+auto MemoryTracker::init(VkPhysicalDevice physicalDevice, VkDevice device, bool budgetEnabled) -> void
+{
+    init(physicalDevice, device, budgetEnabled, Config());
+}
+
+auto MemoryTracker::init(VkPhysicalDevice physicalDevice, VkDevice device, bool budgetEnabled, Config config) -> void
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->budgetEnabled = budgetEnabled;
+    this->config = config;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    heaps.assign(memoryProperties.memoryHeapCount, Heap());
+    categories = {};
+    allocations.clear();
+
+    deviceLocalHeap = 0;
+    VkDeviceSize largest = 0;
+    for(type::uint32 i = 0; i < memoryProperties.memoryHeapCount; ++i)
+    {
+        heaps[i].size = memoryProperties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        if(heaps[i].deviceLocal && heaps[i].size > largest)
+        {
+            largest = heaps[i].size;
+            deviceLocalHeap = i;
+        }
+    }
+    readBudgets();
+}
+
+auto MemoryTracker::cleanup() -> void
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!allocations.empty())
+    {
+        std::cerr << "Memory Tracker: " << allocations.size() << " allocations were never freed\n" << reportLocked() << std::flush;
+    }
+    allocations.clear();
+    heaps.clear();
+}
+
+/**
+ * Allocation
+ */
+auto MemoryTracker::allocate(const VkMemoryAllocateInfo& allocInfo, Category category, VkDeviceMemory& memory) -> VkResult
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    type::uint32 heapIndex = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+    Heap& heap = heaps[heapIndex];
+
+    // Warn once on the way up, so a heap sitting near its budget doesn't flood the log
+    if(!heap.warned && usage(heap) + allocInfo.allocationSize > threshold(heap))
+    {
+        heap.warned = true;
+        std::cerr << "Memory Tracker: heap " << heapIndex << " is nearly out of budget after a "
+                  << formatBytes(allocInfo.allocationSize) << " " << categoryName(category) << " allocation\n\t"
+                  << describeHeap(heapIndex) << std::endl;
+    }
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Memory Tracker: failed to allocate " << formatBytes(allocInfo.allocationSize) << " of "
+                  << categoryName(category) << " memory from heap " << heapIndex << "\n" << reportLocked() << std::flush;
+        return result;
+    }
+
+    allocations[memory] = {allocInfo.allocationSize, heapIndex, category};
+    heap.allocated += allocInfo.allocationSize;
+    heap.peakAllocated = std::max(heap.peakAllocated, heap.allocated);
+    CategoryStats& stats = categories[static_cast<type::size>(category)];
+    stats.bytes += allocInfo.allocationSize;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+    ++stats.allocations;
+    return result;
+}
+
+auto MemoryTracker::free(VkDeviceMemory memory) -> void
+{
+    if(memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = allocations.find(memory);
+        if(it != allocations.end())
+        {
+            heaps[it->second.heap].allocated -= it->second.size;
+            CategoryStats& stats = categories[static_cast<type::size>(it->second.category)];
+            stats.bytes -= it->second.size;
+            --stats.allocations;
+            allocations.erase(it);
+        }
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+auto MemoryTracker::findMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags properties) const -> std::optional<type::uint32>
+{
+    for(type::uint32 i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+auto MemoryTracker::chooseMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const -> type::uint32
+{
+    std::optional<type::uint32> memoryType = findMemoryType(typeFilter, required | preferred);
+    if(!memoryType)
+    {
+        memoryType = findMemoryType(typeFilter, required);
+    }
+    if(!memoryType)
+    {
+        throw std::runtime_error("Suitable memory type unavailable");
+    }
+    return memoryType.value();
+}
+
+auto MemoryTracker::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+                                 Category category, VkBuffer& buffer, VkDeviceMemory& memory) -> VkMemoryPropertyFlags
+{
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("Failed to create ") + categoryName(category) + " buffer");
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(device, buffer, &memReq);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = chooseMemoryType(memReq.memoryTypeBits, required, preferred);
+
+    // The failure itself is logged by allocate
+    if(allocate(allocInfo, category, memory) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        throw std::runtime_error(std::string("Memory allocation failed for ") + categoryName(category) + " buffer");
+    }
+
+    vkBindBufferMemory(device, buffer, memory, 0);
+    return getMemoryTypeFlags(allocInfo.memoryTypeIndex);
+}
+
+auto MemoryTracker::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Category category,
+                                 VkBuffer& buffer, VkDeviceMemory& memory) -> void
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createBuffer(bufferInfo, properties, 0, category, buffer, memory);
+}
+
+/**
+ * Budgets
+ */
+auto MemoryTracker::update() -> void
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    readBudgets();
+    for(Heap& heap : heaps)
+    {
+        // Ready to warn again once the heap has come back down
+        if(heap.warned && usage(heap) <= threshold(heap))
+        {
+            heap.warned = false;
+        }
+    }
+}
+
+auto MemoryTracker::readBudgets() -> void
+{
+    if(!budgetEnabled)
+    {
+        for(Heap& heap : heaps)
+        {
+            heap.budget = static_cast<VkDeviceSize>(static_cast<double>(heap.size) * config.fallbackBudget);
+        }
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+    for(type::size i = 0; i < heaps.size(); ++i)
+    {
+        // Budgets can be reported bigger than the heap, which isn't going to work out
+        heaps[i].budget = std::min(budgetProperties.heapBudget[i], heaps[i].size);
+        heaps[i].reportedUsage = budgetProperties.heapUsage[i];
+        heaps[i].allocatedAtReport = heaps[i].allocated;
+    }
+}
+
+auto MemoryTracker::usage(const Heap& heap) const -> VkDeviceSize
+{
+    if(!budgetEnabled)
+    {
+        return heap.allocated;
+    }
+    // Allocations since the last report haven't made it into the driver's number yet. Frees can
+        // take it below what was allocated at the time, but never below zero
+    type::int64 change = static_cast<type::int64>(heap.allocated) - static_cast<type::int64>(heap.allocatedAtReport);
+    return static_cast<VkDeviceSize>(std::max<type::int64>(static_cast<type::int64>(heap.reportedUsage) + change, 0));
+}
+
+auto MemoryTracker::threshold(const Heap& heap) const -> VkDeviceSize
+{
+    return static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * config.pressureThreshold);
+}
+
+/**
+ * Queries
+ */
+auto MemoryTracker::getHeapStats() const -> std::vector<HeapStats>
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<HeapStats> stats;
+    stats.reserve(heaps.size());
+    for(const Heap& heap : heaps)
+    {
+        stats.push_back({heap.size, heap.budget, usage(heap), heap.allocated, heap.peakAllocated, heap.deviceLocal});
+    }
+    return stats;
+}
+
+auto MemoryTracker::getCategoryStats(Category category) const -> CategoryStats
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return categories[static_cast<type::size>(category)];
+}
+
+auto MemoryTracker::getHeadroom(type::uint32 heap) const -> type::int64
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<type::int64>(threshold(heaps[heap])) - static_cast<type::int64>(usage(heaps[heap]));
+}
+
+auto MemoryTracker::report() const -> std::string
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return reportLocked();
+}
+
+auto MemoryTracker::describeHeap(type::uint32 heap) const -> std::string
+{
+    const Heap& h = heaps[heap];
+    return std::string(h.deviceLocal ? "device local" : "host") + " heap of " + formatBytes(h.size) + ": "
+            + formatBytes(usage(h)) + " used of " + formatBytes(h.budget) + " budget, "
+            + formatBytes(h.allocated) + " ours (peak " + formatBytes(h.peakAllocated) + ")";
+}
+
+auto MemoryTracker::reportLocked() const -> std::string
+{
+    std::string text;
+    for(type::uint32 i = 0; i < heaps.size(); ++i)
+    {
+        text += "\tHeap " + std::to_string(i) + ": " + describeHeap(i) + "\n";
+    }
+    for(type::size i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        const CategoryStats& stats = categories[i];
+        text += std::string("\t") + categoryName(static_cast<Category>(i)) + ": " + formatBytes(stats.bytes) + " in "
+                + std::to_string(stats.allocations) + " allocations (peak " + formatBytes(stats.peakBytes) + ")\n";
+    }
+    return text;
+}
@@ -0,0 +1,172 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_MEMORYTRACKER_H
+#define VULKANTUTORIAL_MEMORYTRACKER_H
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Every device memory allocation goes through here, tagged with what it's for
+ *
+ * Keeps live byte counts and high-water marks per category and per memory heap,
+ * and compares each heap against its budget. With VK_EXT_memory_budget the
+ * budget and usage come from the driver, so they account for other processes
+ * and for the driver's own allocations. Without it, a fixed fraction of the heap
+ * is assumed to be available and only our own allocations count as usage.
+ *
+ * Crossing the pressure threshold of a heap's budget logs a warning once, and
+ * shows up as negative headroom, which is the signal for whoever can give memory
+ * back (the texture streamer, so far) to start doing so. Failed allocations log
+ * the whole picture before the caller throws.
+ *
+ * Memory types are picked here too, and buffers can be created along with their
+ * memory, so that goes the same way for every subsystem.
+ *
+ * Safe to use from any thread.
+ */
+class MemoryTracker
+{
+public:
+    enum class Category : type::uint8
+    {
+        Vertex,
+        Index,
+        // Small buffers rewritten by the CPU every frame
+        Uniform,
+        Staging,
+        Texture,
+        // Attachments and other images the GPU renders to
+        RenderTarget,
+        // Buffers the GPU writes for the CPU to read back
+        Readback,
+        Count
+    };
+    static constexpr type::size CATEGORY_COUNT = static_cast<type::size>(Category::Count);
+    static auto categoryName(Category category) -> type::cstr;
+
+    struct Config
+    {
+        // Fraction of a heap's budget past which memory should start being given back
+        float pressureThreshold = 0.9f;
+        // Budget assumed without VK_EXT_memory_budget, as a fraction of the heap's size.
+            // The rest is left for the driver and other processes
+        float fallbackBudget = 0.8f;
+    };
+
+    struct HeapStats
+    {
+        VkDeviceSize size;
+        VkDeviceSize budget;
+        // Everything the process has in the heap if the driver reports it, otherwise our own allocations
+        VkDeviceSize usage;
+        // Our own allocations
+        VkDeviceSize allocated;
+        VkDeviceSize peakAllocated;
+        bool deviceLocal;
+    };
+
+    struct CategoryStats
+    {
+        VkDeviceSize bytes;
+        VkDeviceSize peakBytes;
+        type::uint32 allocations;
+    };
+
+    // Whether the device has VK_EXT_memory_budget. It has to be enabled on the device for init to use it
+    static auto isBudgetSupported(VkPhysicalDevice physicalDevice) -> bool;
+
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, bool budgetEnabled) -> void;
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, bool budgetEnabled, Config config) -> void;
+    // Everything should have been freed by now. Whatever wasn't is reported
+    auto cleanup() -> void;
+
+    // Same as vkAllocateMemory
+    auto allocate(const VkMemoryAllocateInfo& allocInfo, Category category, VkDeviceMemory& memory) -> VkResult;
+    // Same as vkFreeMemory. Null handles are ignored
+    auto free(VkDeviceMemory memory) -> void;
+
+    // First memory type allowed by typeFilter that has all of the properties
+    auto findMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags properties) const -> std::optional<type::uint32>;
+    // Memory type with the required properties, and the preferred ones as well if any type has them.
+        // Throws if none has the required ones
+    auto chooseMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const -> type::uint32;
+    inline auto getMemoryTypeFlags(type::uint32 memoryType) const -> VkMemoryPropertyFlags
+    {
+        return memoryProperties.memoryTypes[memoryType].propertyFlags;
+    }
+    // Buffer bound to an allocation of its own, picked like chooseMemoryType. Returns the properties
+        // of the memory it got. Throws if either can't be created
+    auto createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+                      Category category, VkBuffer& buffer, VkDeviceMemory& memory) -> VkMemoryPropertyFlags;
+    // Same for a buffer owned by one queue family at a time
+    auto createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Category category,
+                      VkBuffer& buffer, VkDeviceMemory& memory) -> void;
+
+    // Read the budgets from the driver again. Cheap, meant to be called once a frame
+    auto update() -> void;
+
+    auto getHeapStats() const -> std::vector<HeapStats>;
+    auto getCategoryStats(Category category) const -> CategoryStats;
+    // Biggest device local heap, which is where textures and render targets go
+    inline auto getDeviceLocalHeap() const -> type::uint32 { return deviceLocalHeap; }
+    // Bytes that can still be allocated from the heap before reaching the pressure threshold.
+        // Negative once past it, by how much should be given back
+    auto getHeadroom(type::uint32 heap) const -> type::int64;
+    // Every heap and category, one per line
+    auto report() const -> std::string;
+
+private:
+    struct Allocation
+    {
+        VkDeviceSize size;
+        type::uint32 heap;
+        Category category;
+    };
+
+    struct Heap
+    {
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;
+        bool deviceLocal = false;
+        // As reported by the driver at the last update, along with what we had allocated at the time.
+            // What was allocated since is added on top until the next update
+        VkDeviceSize reportedUsage = 0;
+        VkDeviceSize allocatedAtReport = 0;
+        VkDeviceSize allocated = 0;
+        VkDeviceSize peakAllocated = 0;
+        // Set when the pressure warning has been logged, until usage drops back below the threshold
+        bool warned = false;
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    Config config;
+    bool budgetEnabled = false;
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    type::uint32 deviceLocalHeap = 0;
+
+    mutable std::mutex mutex;
+    std::vector<Heap> heaps;
+    std::array<CategoryStats, CATEGORY_COUNT> categories = {};
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+
+    // Locked by the caller
+    auto usage(const Heap& heap) const -> VkDeviceSize;
+    auto threshold(const Heap& heap) const -> VkDeviceSize;
+    auto readBudgets() -> void;
+    auto describeHeap(type::uint32 heap) const -> std::string;
+    auto reportLocked() const -> std::string;
+};
+
+#endif //VULKANTUTORIAL_MEMORYTRACKER_H
@@ -0,0 +1,337 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "MeshCache.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // The line ending bytes catch files mangled by a text mode transfer, same as in KTX2
+    constexpr std::array<type::uint8, 8> IDENTIFIER =
+            {
+                    0xAB, 'V', 'T', 'M', 'E', 'S', 0x0D, 0x0A
+            };
+
+    struct Header
+    {
+        type::uint8 identifier[8];
+        type::uint32 version;
+        type::uint32 blobCount;
+        type::uint64 key;
+        // Including the padding at the end. Anything else means the file was cut short
+        type::uint64 fileSize;
+    };
+    static_assert(sizeof(Header) == 32, "Mesh cache header has to match the file layout");
+
+    struct TocEntry
+    {
+        type::uint32 id;
+        type::uint32 reserved;
+        type::uint64 offset;
+        type::uint64 size;
+    };
+    static_assert(sizeof(TocEntry) == 24, "Mesh cache table of contents has to match the file layout");
+
+    auto alignUp(type::uint64 value) -> type::uint64
+    {
+        return (value + MeshCache::ALIGNMENT - 1) & ~(MeshCache::ALIGNMENT - 1);
+    }
+
+    // Write zeros up to the given offset
+    auto padTo(std::ofstream& file, type::uint64 written, type::uint64 offset) -> void
+    {
+        static const std::array<char, MeshCache::ALIGNMENT> zeros = {};
+        file.write(zeros.data(), static_cast<std::streamsize>(offset - written));
+    }
+}
+
+auto MeshCache::isHostImportSupported(VkPhysicalDevice physicalDevice) -> bool
+{
+    type::uint32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+            [](const VkExtensionProperties& extension)
+            {
+                return strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0;
+            });
+}
+
+auto MeshCache::write(const std::string& path, type::uint64 key, const std::vector<Blob>& blobs) -> void
+{
+    std::filesystem::path target(path);
+    if(target.has_parent_path())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(target.parent_path(), error);
+    }
+
+    // Lay the blobs out behind the table of contents first, so the header knows the file size
+    std::vector<TocEntry> toc;
+    type::uint64 offset = alignUp(sizeof(Header) + blobs.size() * sizeof(TocEntry));
+    for(const Blob& blob : blobs)
+    {
+        toc.push_back({blob.id, 0, offset, blob.size});
+        offset = alignUp(offset + blob.size);
+    }
+
+    Header header = {};
+    std::memcpy(header.identifier, IDENTIFIER.data(), IDENTIFIER.size());
+    header.version = VERSION;
+    header.blobCount = static_cast<type::uint32>(blobs.size());
+    header.key = key;
+    header.fileSize = offset;
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+        {
+            throw std::runtime_error("Failed to create mesh cache " + temporaryPath);
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(TocEntry)));
+        type::uint64 written = sizeof(header) + toc.size() * sizeof(TocEntry);
+        for(type::size i = 0; i < blobs.size(); ++i)
+        {
+            padTo(file, written, toc[i].offset);
+            file.write(static_cast<const char*>(blobs[i].data), static_cast<std::streamsize>(blobs[i].size));
+            written = toc[i].offset + blobs[i].size;
+        }
+        padTo(file, written, header.fileSize);
+
+        if(!file.flush())
+        {
+            file.close();
+            std::filesystem::remove(temporaryPath);
+            throw std::runtime_error("Failed to write mesh cache " + temporaryPath);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, target, error);
+    if(error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        throw std::runtime_error("Failed to replace mesh cache " + path);
+    }
+}
+
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+auto MeshCache::open(const std::string& path, type::uint64 key) -> bool
+{
+    close();
+    if(!map(path))
+    {
+        return false;
+    }
+
+    Header header = {};
+    bool valid = mappedSize >= sizeof(Header);
+    if(valid)
+    {
+        std::memcpy(&header, mapping, sizeof(header));
+        valid = std::memcmp(header.identifier, IDENTIFIER.data(), IDENTIFIER.size()) == 0
+                && header.version == VERSION && header.key == key && header.fileSize == mappedSize
+                && header.blobCount <= (mappedSize - sizeof(Header)) / sizeof(TocEntry);
+    }
+
+    for(type::uint32 i = 0; valid && i < header.blobCount; ++i)
+    {
+        TocEntry entry = {};
+        std::memcpy(&entry, mapping + sizeof(Header) + i * sizeof(TocEntry), sizeof(entry));
+        valid = entry.offset % ALIGNMENT == 0 && entry.offset <= mappedSize && entry.size <= mappedSize - entry.offset;
+        entries.push_back({entry.id, entry.offset, entry.size});
+    }
+
+    if(!valid)
+    {
+        close();
+        return false;
+    }
+    this->path = path;
+    return true;
+}
+
+auto MeshCache::close() -> void
+{
+    if(mapping != nullptr)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+#else
+        munmap(const_cast<type::uint8*>(mapping), mappedSize);
+#endif
+    }
+    mapping = nullptr;
+    mappedSize = 0;
+    entries.clear();
+    path.clear();
+}
+
+auto MeshCache::find(type::uint32 id) const -> const Entry*
+{
+    auto entry = std::find_if(entries.begin(), entries.end(), [id](const Entry& e) { return e.id == id; });
+    return entry != entries.end() ? &*entry : nullptr;
+}
+
+auto MeshCache::importMapping(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker,
+                              VkBuffer& buffer, VkDeviceMemory& memory) const -> bool
+{
+    auto getHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT)
+            vkGetDeviceProcAddr(device, "vkGetMemoryHostPointerPropertiesEXT");
+    if(!isOpen() || getHostPointerProperties == nullptr)
+    {
+        return false;
+    }
+
+    // Mappings start on a page and the file is padded to ALIGNMENT, which covers what drivers usually ask for
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+    hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &hostProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    VkDeviceSize alignment = hostProperties.minImportedHostPointerAlignment;
+    if(alignment == 0 || reinterpret_cast<std::uintptr_t>(mapping) % alignment != 0 || mappedSize % alignment != 0)
+    {
+        return false;
+    }
+
+    // Some drivers only import memory they can pin for writing, which a read only file mapping isn't.
+        // They fail here and the blobs get copied instead. Nothing is ever written through the pointer
+    void* hostPointer = const_cast<type::uint8*>(mapping);
+    VkMemoryHostPointerPropertiesEXT pointerProperties = {};
+    pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if(getHostPointerProperties(device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, hostPointer,
+            &pointerProperties) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkExternalMemoryBufferCreateInfo externalInfo = {};
+    externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = &externalInfo;
+    bufferInfo.size = mappedSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(device, buffer, &memReq);
+    type::uint32 typeBits = memReq.memoryTypeBits & pointerProperties.memoryTypeBits;
+    if(typeBits == 0 || memReq.size > mappedSize)
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkImportMemoryHostPointerInfoEXT importInfo = {};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = hostPointer;
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &importInfo;
+    allocInfo.allocationSize = mappedSize;
+    allocInfo.memoryTypeIndex = static_cast<type::uint32>(std::countr_zero(typeBits));
+    if(memoryTracker.allocate(allocInfo, MemoryTracker::Category::Staging, memory) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    vkBindBufferMemory(device, buffer, memory, 0);
+    return true;
+}
+
+auto MeshCache::map(const std::string& path) -> bool
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size = {};
+    HANDLE fileMapping = nullptr;
+    if(GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    // The view keeps the file and the mapping object alive on its own
+    void* view = fileMapping != nullptr ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(fileMapping != nullptr)
+    {
+        CloseHandle(fileMapping);
+    }
+    CloseHandle(file);
+    if(view == nullptr)
+    {
+        return false;
+    }
+    mapping = static_cast<const type::uint8*>(view);
+    mappedSize = static_cast<type::uint64>(size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+    struct stat info = {};
+    void* view = MAP_FAILED;
+    if(fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        view = mmap(nullptr, static_cast<type::size>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    // The mapping keeps the file alive on its own
+    ::close(file);
+    if(view == MAP_FAILED)
+    {
+        return false;
+    }
+    // Everything in the file gets read straight away, so start reading it all in now
+    madvise(view, static_cast<type::size>(info.st_size), MADV_WILLNEED);
+    mapping = static_cast<const type::uint8*>(view);
+    mappedSize = static_cast<type::uint64>(info.st_size);
+#endif
+    return true;
+}
@@ -0,0 +1,100 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_MESHCACHE_H
+#define VULKANTUTORIAL_MESHCACHE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "MemoryTracker.h"
+
+/**
+ * Preprocessed geometry kept on disk so it doesn't have to be built again at every launch
+ *
+ * A cache file is a header, a table of contents and a list of blobs, each blob
+ * holding data exactly as it goes into a buffer. Blobs start on a page boundary
+ * and the file is padded out to one, so the file can be memory mapped and blobs
+ * copied straight out of the mapping, or the whole mapping imported as host
+ * memory with VK_EXT_external_memory_host and copied from by the GPU itself.
+ *
+ * Every file stores a key made by the caller from everything that went into
+ * building it. A file with a different key, or from another version of the
+ * format, doesn't open, which is the signal to build and write it again.
+ *
+ * Everything is little endian, like the hardware it runs on.
+ */
+class MeshCache
+{
+public:
+    // Bumped whenever the layout of the file changes, which makes every older file stale
+    static constexpr type::uint32 VERSION = 1;
+    // Blobs are aligned to this in the file, so they are in the mapping too
+    static constexpr type::uint64 ALIGNMENT = 4096;
+
+    // What a blob holds is up to the caller. Ids are four characters packed together, like "VERT"
+    static constexpr auto blobId(type::cstr name) -> type::uint32
+    {
+        return static_cast<type::uint32>(name[0]) | static_cast<type::uint32>(name[1]) << 8
+               | static_cast<type::uint32>(name[2]) << 16 | static_cast<type::uint32>(name[3]) << 24;
+    }
+
+    struct Blob
+    {
+        type::uint32 id;
+        const void* data;
+        type::uint64 size;
+    };
+
+    // Where a blob is in the file, and so in the mapping
+    struct Entry
+    {
+        type::uint32 id;
+        type::uint64 offset;
+        type::uint64 size;
+    };
+
+    // Whether the device has VK_EXT_external_memory_host. It has to be enabled on the device for importMapping to work
+    static auto isHostImportSupported(VkPhysicalDevice physicalDevice) -> bool;
+
+    // Write a cache file, creating its directory if needed. Goes through a temporary file that replaces the
+        // old one at the end, so a crash halfway through never leaves a broken file behind. Throws if it can't
+    static auto write(const std::string& path, type::uint64 key, const std::vector<Blob>& blobs) -> void;
+
+    MeshCache() = default;
+    ~MeshCache();
+    MeshCache(const MeshCache&) = delete;
+    auto operator=(const MeshCache&) -> MeshCache& = delete;
+
+    // Map a cache file. Returns false and stays closed if the file is missing, malformed, from another
+        // version or was built with a different key
+    auto open(const std::string& path, type::uint64 key) -> bool;
+    auto close() -> void;
+
+    // Null if the file has no such blob
+    auto find(type::uint32 id) const -> const Entry*;
+    inline auto data(const Entry& entry) const -> const type::uint8* { return mapping + entry.offset; }
+
+    // Make a transfer source buffer over the whole mapping, without copying anything. Returns false if the
+        // device can't import the mapping, in which case blobs have to be copied into a staging buffer instead.
+        // The buffer and memory have to be gone before the cache is closed
+    auto importMapping(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker,
+                       VkBuffer& buffer, VkDeviceMemory& memory) const -> bool;
+
+    inline auto isOpen() const -> bool { return mapping != nullptr; }
+
+private:
+    std::string path;
+    const type::uint8* mapping = nullptr;
+    type::uint64 mappedSize = 0;
+    std::vector<Entry> entries;
+
+    // Map the file read only. False if it can't be opened
+    auto map(const std::string& path) -> bool;
+};
+
+#endif //VULKANTUTORIAL_MESHCACHE_H
@@ -0,0 +1,445 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshLod.h"
+
+namespace
+{
+    // Upper triangle of the symmetric 4x4 matrix that sums squared distances to a set of planes
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+        double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+        double a22 = 0.0, a23 = 0.0;
+        double a33 = 0.0;
+
+        // Plane through the points p with dot(normal, p) + distance = 0. The normal has to be unit length
+        static auto fromPlane(const glm::dvec3& normal, double distance) -> Quadric
+        {
+            Quadric q;
+            q.a00 = normal.x * normal.x;
+            q.a01 = normal.x * normal.y;
+            q.a02 = normal.x * normal.z;
+            q.a03 = normal.x * distance;
+            q.a11 = normal.y * normal.y;
+            q.a12 = normal.y * normal.z;
+            q.a13 = normal.y * distance;
+            q.a22 = normal.z * normal.z;
+            q.a23 = normal.z * distance;
+            q.a33 = distance * distance;
+            return q;
+        }
+
+        auto operator+=(const Quadric& other) -> Quadric&
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            return *this;
+        }
+
+        // Summed squared distance from the point to every plane
+        auto evaluate(const glm::dvec3& p) const -> double
+        {
+            return a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+                    + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+                    + a22 * p.z * p.z + 2.0 * a23 * p.z
+                    + a33;
+        }
+    };
+
+    // Moves one vertex onto another, removing the triangles between them
+    struct Collapse
+    {
+        type::uint32 from;
+        type::uint32 to;
+        double cost;
+    };
+
+    // Positions compared bit for bit, with -0 folded into 0
+    struct PositionKey
+    {
+        type::uint32 bits[3];
+
+        auto operator==(const PositionKey& other) const -> bool
+        {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionKeyHash
+    {
+        auto operator()(const PositionKey& key) const -> type::size
+        {
+            return (static_cast<type::size>(key.bits[0]) * 73856093u) ^ (static_cast<type::size>(key.bits[1]) * 19349663u)
+                    ^ (static_cast<type::size>(key.bits[2]) * 83492791u);
+        }
+    };
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const std::vector<glm::vec3>& positions, const std::vector<type::uint32>& indices)
+                : positions(positions), triangles(indices)
+        {
+            weldPositions();
+            accumulateQuadrics();
+        }
+
+        // Collapse the cheapest edges until at most targetIndexCount indices are left, or the next
+            // collapse would cost more than maxCost
+        auto simplify(type::size targetIndexCount, double maxCost) -> void
+        {
+            std::vector<type::uint32> remap(positions.size());
+            std::vector<type::uint8> touched(positions.size());
+            std::vector<Collapse> collapses;
+            std::vector<type::uint32> adjacencyOffsets;
+            std::vector<type::uint32> adjacency;
+
+            // Each pass collapses a set of edges that don't share any triangles, so every
+                // decision in a pass is made against an up to date mesh
+            while(triangles.size() > targetIndexCount)
+            {
+                buildAdjacency(adjacencyOffsets, adjacency);
+
+                collapses.clear();
+                for(type::size i = 0; i < triangles.size(); i += 3)
+                {
+                    for(type::size corner = 0; corner < 3; ++corner)
+                    {
+                        type::uint32 a = triangles[i + corner];
+                        type::uint32 b = triangles[i + (corner + 1) % 3];
+                        addCollapse(a, b, maxCost, collapses);
+                        addCollapse(b, a, maxCost, collapses);
+                    }
+                }
+                if(collapses.empty())
+                {
+                    return;
+                }
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+                for(type::size i = 0; i < positions.size(); ++i)
+                {
+                    remap[i] = static_cast<type::uint32>(i);
+                }
+                std::fill(touched.begin(), touched.end(), 0);
+
+                type::size trianglesToRemove = (triangles.size() - targetIndexCount + 2) / 3;
+                type::size removed = 0;
+                for(const Collapse& collapse : collapses)
+                {
+                    if(removed >= trianglesToRemove)
+                    {
+                        break;
+                    }
+                    type::uint32 from = canonical[collapse.from];
+                    type::uint32 to = canonical[collapse.to];
+                    if(touched[from] || touched[to])
+                    {
+                        continue;
+                    }
+
+                    type::size removedByCollapse = 0;
+                    if(flipsTriangle(collapse, adjacencyOffsets, adjacency, removedByCollapse))
+                    {
+                        continue;
+                    }
+
+                    remap[collapse.from] = collapse.to;
+                    quadrics[to] += quadrics[from];
+                    maxCollapseCost = std::max(maxCollapseCost, collapse.cost);
+                    removed += removedByCollapse;
+
+                    // Everything around the collapse changed shape, so the rest waits for the next pass
+                    for(type::uint32 a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+                    {
+                        for(type::size corner = 0; corner < 3; ++corner)
+                        {
+                            touched[canonical[triangles[adjacency[a] * 3 + corner]]] = 1;
+                        }
+                    }
+                    touched[to] = 1;
+                }
+                if(removed == 0)
+                {
+                    return;
+                }
+
+                // Triangles that had both ends of a collapsed edge are now degenerate
+                type::size write = 0;
+                for(type::size i = 0; i < triangles.size(); i += 3)
+                {
+                    type::uint32 a = remap[triangles[i]];
+                    type::uint32 b = remap[triangles[i + 1]];
+                    type::uint32 c = remap[triangles[i + 2]];
+                    if(canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[c] == canonical[a])
+                    {
+                        continue;
+                    }
+                    triangles[write++] = a;
+                    triangles[write++] = b;
+                    triangles[write++] = c;
+                }
+                triangles.resize(write);
+            }
+        }
+
+        inline auto getIndices() const -> const std::vector<type::uint32>& { return triangles; }
+        inline auto getMaxCost() const -> double { return maxCollapseCost; }
+
+    private:
+        const std::vector<glm::vec3>& positions;
+        std::vector<type::uint32> triangles;
+        // First vertex with the same position. Quadrics and adjacency go by these
+        std::vector<type::uint32> canonical;
+        // Seam vertices, which are never collapsed
+        std::vector<type::uint8> locked;
+        std::vector<Quadric> quadrics;
+        double maxCollapseCost = 0.0;
+
+        auto weldPositions() -> void
+        {
+            canonical.resize(positions.size());
+            std::unordered_map<PositionKey, type::uint32, PositionKeyHash> firstAt;
+            for(type::size i = 0; i < positions.size(); ++i)
+            {
+                PositionKey key;
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    float value = positions[i][axis] + 0.0f;
+                    std::memcpy(&key.bits[axis], &value, sizeof(float));
+                }
+                canonical[i] = firstAt.emplace(key, static_cast<type::uint32>(i)).first->second;
+            }
+
+            // Only vertices the mesh actually uses count towards a seam
+            std::vector<type::uint8> used(positions.size());
+            for(type::uint32 index : triangles)
+            {
+                used[index] = 1;
+            }
+            std::vector<type::uint32> copies(positions.size());
+            for(type::size i = 0; i < positions.size(); ++i)
+            {
+                copies[canonical[i]] += used[i];
+            }
+            locked.resize(positions.size());
+            for(type::size i = 0; i < positions.size(); ++i)
+            {
+                locked[i] = copies[canonical[i]] > 1;
+            }
+        }
+
+        auto accumulateQuadrics() -> void
+        {
+            quadrics.resize(positions.size());
+
+            // Open edges only have a triangle on one side
+            std::unordered_map<type::uint64, type::uint32> edgeUses;
+            auto edgeKey = [this](type::uint32 a, type::uint32 b)
+            {
+                type::uint64 ca = canonical[a];
+                type::uint64 cb = canonical[b];
+                return ca < cb ? (ca << 32) | cb : (cb << 32) | ca;
+            };
+            for(type::size i = 0; i < triangles.size(); i += 3)
+            {
+                for(type::size corner = 0; corner < 3; ++corner)
+                {
+                    ++edgeUses[edgeKey(triangles[i + corner], triangles[i + (corner + 1) % 3])];
+                }
+            }
+
+            for(type::size i = 0; i < triangles.size(); i += 3)
+            {
+                glm::dvec3 p[3] = {positions[triangles[i]], positions[triangles[i + 1]], positions[triangles[i + 2]]};
+                glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                double length = glm::length(normal);
+                if(length == 0.0)
+                {
+                    continue;
+                }
+                normal /= length;
+
+                Quadric face = Quadric::fromPlane(normal, -glm::dot(normal, p[0]));
+                for(type::size corner = 0; corner < 3; ++corner)
+                {
+                    quadrics[canonical[triangles[i + corner]]] += face;
+                }
+
+                // A plane along the edge and at right angles to the triangle, so moving
+                    // the outline in or out costs as much as moving the surface would
+                for(type::size corner = 0; corner < 3; ++corner)
+                {
+                    type::uint32 a = triangles[i + corner];
+                    type::uint32 b = triangles[i + (corner + 1) % 3];
+                    if(edgeUses[edgeKey(a, b)] != 1)
+                    {
+                        continue;
+                    }
+                    glm::dvec3 edge = p[(corner + 1) % 3] - p[corner];
+                    glm::dvec3 edgeNormal = glm::cross(edge, normal);
+                    double edgeLength = glm::length(edgeNormal);
+                    if(edgeLength == 0.0)
+                    {
+                        continue;
+                    }
+                    edgeNormal /= edgeLength;
+                    Quadric border = Quadric::fromPlane(edgeNormal, -glm::dot(edgeNormal, p[corner]));
+                    quadrics[canonical[a]] += border;
+                    quadrics[canonical[b]] += border;
+                }
+            }
+        }
+
+        // Triangles around each welded vertex, as offsets into one list
+        auto buildAdjacency(std::vector<type::uint32>& offsets, std::vector<type::uint32>& adjacency) const -> void
+        {
+            offsets.assign(positions.size() + 1, 0);
+            for(type::uint32 index : triangles)
+            {
+                ++offsets[canonical[index] + 1];
+            }
+            for(type::size i = 1; i < offsets.size(); ++i)
+            {
+                offsets[i] += offsets[i - 1];
+            }
+            adjacency.resize(triangles.size());
+            std::vector<type::uint32> fill(offsets.begin(), offsets.end() - 1);
+            for(type::size i = 0; i < triangles.size(); ++i)
+            {
+                adjacency[fill[canonical[triangles[i]]]++] = static_cast<type::uint32>(i / 3);
+            }
+        }
+
+        auto addCollapse(type::uint32 from, type::uint32 to, double maxCost, std::vector<Collapse>& collapses) const -> void
+        {
+            if(locked[from])
+            {
+                return;
+            }
+            Quadric q = quadrics[canonical[from]];
+            q += quadrics[canonical[to]];
+            double cost = std::max(q.evaluate(positions[to]), 0.0);
+            if(cost <= maxCost)
+            {
+                collapses.push_back({from, to, cost});
+            }
+        }
+
+        // Whether a triangle that survives the collapse would turn over. Counts the ones that don't survive
+        auto flipsTriangle(const Collapse& collapse, const std::vector<type::uint32>& offsets,
+                           const std::vector<type::uint32>& adjacency, type::size& removedCount) const -> bool
+        {
+            type::uint32 from = canonical[collapse.from];
+            type::uint32 to = canonical[collapse.to];
+            removedCount = 0;
+            for(type::uint32 a = offsets[from]; a < offsets[from + 1]; ++a)
+            {
+                const type::uint32* triangle = &triangles[adjacency[a] * 3];
+                if(canonical[triangle[0]] == to || canonical[triangle[1]] == to || canonical[triangle[2]] == to)
+                {
+                    ++removedCount;
+                    continue;
+                }
+
+                glm::vec3 p[3];
+                glm::vec3 moved[3];
+                for(int corner = 0; corner < 3; ++corner)
+                {
+                    p[corner] = positions[triangle[corner]];
+                    moved[corner] = canonical[triangle[corner]] == from ? positions[collapse.to] : p[corner];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if(glm::dot(before, after) <= 0.0f)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+auto meshlod::generate(const std::vector<glm::vec3>& positions, const std::vector<type::uint32>& indices) -> std::vector<Level>
+{
+    return generate(positions, indices, Config());
+}
+
+auto meshlod::generate(const std::vector<glm::vec3>& positions, const std::vector<type::uint32>& indices, Config config) -> std::vector<Level>
+{
+    std::vector<Level> levels;
+    levels.push_back({indices, 0.0f});
+    if(indices.size() < 6 || config.maxLevels <= 1)
+    {
+        return levels;
+    }
+
+    // Errors are allowed relative to the size of the mesh, so scaling it doesn't change its levels
+    glm::vec3 lower = positions[indices[0]];
+    glm::vec3 upper = lower;
+    for(type::uint32 index : indices)
+    {
+        lower = glm::min(lower, positions[index]);
+        upper = glm::max(upper, positions[index]);
+    }
+    double maxError = config.maxRelativeError * 0.5 * glm::length(upper - lower);
+
+    Simplifier simplifier(positions, indices);
+    for(type::uint32 level = 1; level < config.maxLevels; ++level)
+    {
+        type::size previous = levels.back().indices.size();
+        auto target = static_cast<type::size>(static_cast<double>(previous / 3) * config.reduction) * 3;
+        simplifier.simplify(target, maxError * maxError);
+
+        // A level that barely saves anything isn't worth its index buffer space
+        const std::vector<type::uint32>& simplified = simplifier.getIndices();
+        if(simplified.empty() || simplified.size() * 10 > previous * 9)
+        {
+            break;
+        }
+        levels.push_back({simplified, static_cast<float>(std::sqrt(simplifier.getMaxCost()))});
+    }
+    return levels;
+}
+
+auto meshlod::select(const float* errors, type::uint32 levelCount, float pixelsPerUnit, type::uint32 current,
+                     float thresholdPixels, float hysteresis) -> type::uint32
+{
+    current = std::min(current, levelCount - 1);
+
+    // Errors only go up, so the last level under the threshold is the coarsest one
+    type::uint32 target = 0;
+    for(type::uint32 level = 1; level < levelCount; ++level)
+    {
+        if(errors[level] * pixelsPerUnit <= thresholdPixels)
+        {
+            target = level;
+        }
+    }
+    // The current level has become too coarse, which is fixed right away
+    if(target <= current)
+    {
+        return target;
+    }
+
+    type::uint32 level = current;
+    for(type::uint32 coarser = current + 1; coarser <= target; ++coarser)
+    {
+        if(errors[coarser] * pixelsPerUnit <= thresholdPixels * (1.0f - hysteresis))
+        {
+            level = coarser;
+        }
+    }
+    return level;
+}
@@ -0,0 +1,63 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_MESHLOD_H
+#define VULKANTUTORIAL_MESHLOD_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "types.h"
+
+/**
+ * Level of detail chains for triangle meshes, and picking a level to draw
+ *
+ * Levels are made by quadric error metric edge collapses. Every collapse moves
+ * a vertex onto one of its neighbours instead of to a new position, so all of
+ * the levels are index lists into the same vertex buffer. Each vertex carries
+ * the summed squared distance to the planes of the triangles it has taken over,
+ * so the error of a level is measured against the full detail mesh rather than
+ * the level before it. Open edges get planes of their own to keep outlines in
+ * place.
+ *
+ * Vertices sharing a position with a vertex that has other attributes sit on a
+ * seam, like a UV seam, and are never collapsed so the seam doesn't tear.
+ */
+namespace meshlod
+{
+    // Bumped whenever generate would give different levels for the same mesh, so cached levels get built again
+    constexpr type::uint32 VERSION = 1;
+
+    struct Level
+    {
+        std::vector<type::uint32> indices;
+        // Roughly how far the level's surface may be from the full detail mesh, in the mesh's own units
+        float error;
+    };
+
+    struct Config
+    {
+        // Including the full detail level
+        type::uint32 maxLevels = 4;
+        // Each level aims for this fraction of the triangles of the one before it
+        float reduction = 0.5f;
+        // No collapse may move the surface further than this fraction of the mesh's bounding radius
+        float maxRelativeError = 0.05f;
+    };
+
+    // Level 0 is the mesh as given. The chain ends early once the mesh can't be simplified any further
+    auto generate(const std::vector<glm::vec3>& positions, const std::vector<type::uint32>& indices) -> std::vector<Level>;
+    auto generate(const std::vector<glm::vec3>& positions, const std::vector<type::uint32>& indices, Config config) -> std::vector<Level>;
+
+    // Coarsest level whose error covers at most thresholdPixels on screen. Errors have to go up with the level
+        // and pixelsPerUnit is how many pixels a unit covers at the mesh's distance. Going coarser
+        // than the current level needs the error to be a fraction under the threshold, so meshes
+        // sitting right at a switching distance don't flicker between two levels
+    auto select(const float* errors, type::uint32 levelCount, float pixelsPerUnit, type::uint32 current,
+                float thresholdPixels, float hysteresis) -> type::uint32;
+}
+
+#endif //VULKANTUTORIAL_MESHLOD_H
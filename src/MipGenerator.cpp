@@ -0,0 +1,319 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include "MipGenerator.h"
+#include "Simd.h"
+#include "TextureFormats.h"
+
+namespace
+{
+    /**
+     * One RGBA pixel of floats, in an SSE register if there is one
+     */
+#ifdef SIMD_SSE2
+    using Vec4 = __m128;
+    inline auto load4(const float* p) -> Vec4 { return _mm_loadu_ps(p); }
+    inline auto store4(float* p, Vec4 v) -> void { _mm_storeu_ps(p, v); }
+    inline auto splat4(float f) -> Vec4 { return _mm_set1_ps(f); }
+    inline auto add4(Vec4 a, Vec4 b) -> Vec4 { return _mm_add_ps(a, b); }
+    inline auto mul4(Vec4 a, Vec4 b) -> Vec4 { return _mm_mul_ps(a, b); }
+    inline auto clamp4(Vec4 v) -> Vec4 { return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+#else
+    struct Vec4 { float v[4]; };
+    inline auto load4(const float* p) -> Vec4 { return {{p[0], p[1], p[2], p[3]}}; }
+    inline auto store4(float* p, Vec4 a) -> void { std::memcpy(p, a.v, sizeof(a.v)); }
+    inline auto splat4(float f) -> Vec4 { return {{f, f, f, f}}; }
+    inline auto add4(Vec4 a, Vec4 b) -> Vec4 { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+    inline auto mul4(Vec4 a, Vec4 b) -> Vec4 { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+    inline auto clamp4(Vec4 a) -> Vec4
+    {
+        return {{std::clamp(a.v[0], 0.0f, 1.0f), std::clamp(a.v[1], 0.0f, 1.0f),
+                 std::clamp(a.v[2], 0.0f, 1.0f), std::clamp(a.v[3], 0.0f, 1.0f)}};
+    }
+#endif
+
+    // Level as linear RGBA floats, 4 per pixel
+    struct FloatImage
+    {
+        type::uint32 width;
+        type::uint32 height;
+        std::vector<float> pixels;
+
+        inline auto pixel(type::uint32 x, type::uint32 y) const -> const float* { return &pixels[(static_cast<type::size>(y) * width + x) * 4]; }
+        inline auto pixel(type::uint32 x, type::uint32 y) -> float* { return &pixels[(static_cast<type::size>(y) * width + x) * 4]; }
+    };
+
+    // Resolution of the linear to sRGB table. Close to 1 LSB at the dark end, where the curve is steepest
+    constexpr type::uint32 SRGB_TABLE_SIZE = 4096;
+
+    struct SrgbTables
+    {
+        std::array<float, 256> toLinear;
+        std::array<type::uint8, SRGB_TABLE_SIZE> fromLinear;
+    };
+
+    auto srgbTables() -> const SrgbTables&
+    {
+        static const SrgbTables tables = []
+        {
+            SrgbTables t = {};
+            for(type::uint32 i = 0; i < 256; ++i)
+            {
+                float c = i / 255.0f;
+                t.toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for(type::uint32 i = 0; i < SRGB_TABLE_SIZE; ++i)
+            {
+                float l = i / static_cast<float>(SRGB_TABLE_SIZE - 1);
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                t.fromLinear[i] = static_cast<type::uint8>(std::lround(c * 255.0f));
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    auto toFloat(bool srgb, type::uint32 width, type::uint32 height, const type::uint8* src) -> FloatImage
+    {
+        const SrgbTables& tables = srgbTables();
+        FloatImage image = {width, height, std::vector<float>(static_cast<type::size>(width) * height * 4)};
+        for(type::size i = 0; i < image.pixels.size(); ++i)
+        {
+            // Alpha is always linear
+            bool color = (i & 3) != 3;
+            image.pixels[i] = srgb && color ? tables.toLinear[src[i]] : src[i] / 255.0f;
+        }
+        return image;
+    }
+
+    auto toBytes(bool srgb, const FloatImage& image) -> std::vector<type::uint8>
+    {
+        const SrgbTables& tables = srgbTables();
+        std::vector<type::uint8> bytes(image.pixels.size());
+        // Color channels scale to the table index in sRGB formats, alpha always to 0-255
+        const float srgbScale[4] = {SRGB_TABLE_SIZE - 1.0f, SRGB_TABLE_SIZE - 1.0f, SRGB_TABLE_SIZE - 1.0f, 255.0f};
+        Vec4 scale = srgb ? load4(srgbScale) : splat4(255.0f);
+        float scaled[4];
+        for(type::size i = 0; i < image.pixels.size(); i += 4)
+        {
+            // Kaiser lobes can overshoot, so clamp before quantizing
+            store4(scaled, add4(mul4(clamp4(load4(&image.pixels[i])), scale), splat4(0.5f)));
+            for(type::uint32 c = 0; c < 3; ++c)
+            {
+                auto value = static_cast<type::uint32>(scaled[c]);
+                bytes[i + c] = srgb ? tables.fromLinear[value] : static_cast<type::uint8>(value);
+            }
+            bytes[i + 3] = static_cast<type::uint8>(scaled[3]);
+        }
+        return bytes;
+    }
+
+    auto halfSize(type::uint32 size) -> type::uint32
+    {
+        return std::max(size / 2, 1u);
+    }
+
+    /**
+     * Box filter
+     */
+
+    auto boxDownsample(const FloatImage& src) -> FloatImage
+    {
+        FloatImage dst = {halfSize(src.width), halfSize(src.height), {}};
+        dst.pixels.resize(static_cast<type::size>(dst.width) * dst.height * 4);
+
+        for(type::uint32 y = 0; y < dst.height; ++y)
+        {
+            // Clamped so 1 pixel tall sources average with themselves
+            type::uint32 y0 = std::min(2 * y, src.height - 1);
+            type::uint32 y1 = std::min(2 * y + 1, src.height - 1);
+            type::uint32 x = 0;
+#ifdef SIMD_AVX2
+            // Two destination pixels from four source pixels per row
+            const __m256 quarter = _mm256_set1_ps(0.25f);
+            for(; x + 1 < dst.width && 2 * x + 3 < src.width; x += 2)
+            {
+                __m256 s01 = _mm256_add_ps(_mm256_loadu_ps(src.pixel(2 * x, y0)), _mm256_loadu_ps(src.pixel(2 * x, y1)));
+                __m256 s23 = _mm256_add_ps(_mm256_loadu_ps(src.pixel(2 * x + 2, y0)), _mm256_loadu_ps(src.pixel(2 * x + 2, y1)));
+                // Pair up the left and right halves of each 2x2 block
+                __m256 left = _mm256_permute2f128_ps(s01, s23, 0x20);
+                __m256 right = _mm256_permute2f128_ps(s01, s23, 0x31);
+                _mm256_storeu_ps(dst.pixel(x, y), _mm256_mul_ps(_mm256_add_ps(left, right), quarter));
+            }
+#endif
+            const Vec4 quarter4 = splat4(0.25f);
+            for(; x < dst.width; ++x)
+            {
+                type::uint32 x0 = std::min(2 * x, src.width - 1);
+                type::uint32 x1 = std::min(2 * x + 1, src.width - 1);
+                Vec4 sum = add4(add4(load4(src.pixel(x0, y0)), load4(src.pixel(x1, y0))),
+                                add4(load4(src.pixel(x0, y1)), load4(src.pixel(x1, y1))));
+                store4(dst.pixel(x, y), mul4(sum, quarter4));
+            }
+        }
+        return dst;
+    }
+
+    /**
+     * Kaiser filter
+     */
+
+    constexpr type::uint32 KAISER_TAPS = 8;
+    // Window shape. Higher is smoother with less ringing, lower is sharper
+    constexpr float KAISER_BETA = 4.0f;
+
+    // Zeroth order modified Bessel function of the first kind
+    auto besselI0(float x) -> float
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for(type::uint32 k = 1; k < 20; ++k)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Every destination pixel sits between source pixels 2x and 2x+1, so all of them share one set of taps,
+        // over source pixels 2x-3 to 2x+4
+    auto kaiserWeights() -> const std::array<float, KAISER_TAPS>&
+    {
+        static const std::array<float, KAISER_TAPS> weights = []
+        {
+            constexpr float pi = 3.14159265358979f;
+            constexpr float radius = KAISER_TAPS / 4.0f;
+            std::array<float, KAISER_TAPS> w = {};
+            float total = 0.0f;
+            for(type::uint32 k = 0; k < KAISER_TAPS; ++k)
+            {
+                // Distance from the destination pixel center, in destination pixels
+                float d = (static_cast<float>(k) - (KAISER_TAPS / 2.0f - 0.5f)) / 2.0f;
+                float sinc = std::sin(pi * d) / (pi * d);
+                float ratio = d / radius;
+                w[k] = sinc * besselI0(KAISER_BETA * std::sqrt(1.0f - ratio * ratio)) / besselI0(KAISER_BETA);
+                total += w[k];
+            }
+            for(float& weight : w)
+            {
+                weight /= total;
+            }
+            return w;
+        }();
+        return weights;
+    }
+
+    auto tapIndex(type::uint32 dst, type::uint32 tap, type::uint32 srcSize) -> type::uint32
+    {
+        auto index = static_cast<std::int64_t>(2 * dst) - static_cast<std::int64_t>(KAISER_TAPS / 2 - 1) + tap;
+        return static_cast<type::uint32>(std::clamp<std::int64_t>(index, 0, srcSize - 1));
+    }
+
+    auto kaiserDownsample(const FloatImage& src) -> FloatImage
+    {
+        const std::array<float, KAISER_TAPS>& weights = kaiserWeights();
+
+        // Horizontal pass, one pixel at a time
+        FloatImage tmp = {halfSize(src.width), src.height, {}};
+        tmp.pixels.resize(static_cast<type::size>(tmp.width) * tmp.height * 4);
+        for(type::uint32 y = 0; y < tmp.height; ++y)
+        {
+            for(type::uint32 x = 0; x < tmp.width; ++x)
+            {
+                Vec4 sum = splat4(0.0f);
+                for(type::uint32 k = 0; k < KAISER_TAPS; ++k)
+                {
+                    sum = add4(sum, mul4(splat4(weights[k]), load4(src.pixel(tapIndex(x, k, src.width), y))));
+                }
+                store4(tmp.pixel(x, y), sum);
+            }
+        }
+
+        // Vertical pass, whole rows at a time since neighbouring floats share weights
+        FloatImage dst = {tmp.width, halfSize(src.height), {}};
+        dst.pixels.resize(static_cast<type::size>(dst.width) * dst.height * 4);
+        type::size rowFloats = static_cast<type::size>(dst.width) * 4;
+        for(type::uint32 y = 0; y < dst.height; ++y)
+        {
+            float* out = dst.pixel(0, y);
+            std::array<const float*, KAISER_TAPS> rows = {};
+            for(type::uint32 k = 0; k < KAISER_TAPS; ++k)
+            {
+                rows[k] = tmp.pixel(0, tapIndex(y, k, tmp.height));
+            }
+
+            type::size i = 0;
+#ifdef SIMD_AVX2
+            for(; i + 8 <= rowFloats; i += 8)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for(type::uint32 k = 0; k < KAISER_TAPS; ++k)
+                {
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+                }
+                _mm256_storeu_ps(out + i, sum);
+            }
+#endif
+            // Rows are whole pixels, so this always lines up on 4 floats
+            for(; i < rowFloats; i += 4)
+            {
+                Vec4 sum = splat4(0.0f);
+                for(type::uint32 k = 0; k < KAISER_TAPS; ++k)
+                {
+                    sum = add4(sum, mul4(splat4(weights[k]), load4(rows[k] + i)));
+                }
+                store4(out + i, sum);
+            }
+        }
+        return dst;
+    }
+}
+
+auto mipgen::canGenerate(VkFormat format) -> bool
+{
+    switch(format)
+    {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+auto mipgen::levelCount(type::uint32 width, type::uint32 height) -> type::uint32
+{
+    type::uint32 count = 1;
+    for(type::uint32 size = std::max(width, height); size > 1; size /= 2)
+    {
+        ++count;
+    }
+    return count;
+}
+
+auto mipgen::generate(VkFormat format, type::uint32 width, type::uint32 height, const type::uint8* level0,
+                      Filter filter) -> std::vector<std::vector<type::uint8>>
+{
+    bool srgb = texformat::isSrgb(format);
+    type::uint32 count = levelCount(width, height);
+
+    std::vector<std::vector<type::uint8>> levels;
+    levels.reserve(count);
+    levels.emplace_back(level0, level0 + static_cast<type::size>(width) * height * 4);
+
+    FloatImage current = toFloat(srgb, width, height, level0);
+    for(type::uint32 level = 1; level < count; ++level)
+    {
+        current = filter == Filter::Kaiser ? kaiserDownsample(current) : boxDownsample(current);
+        levels.push_back(toBytes(srgb, current));
+    }
+    return levels;
+}
@@ -0,0 +1,42 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_MIPGENERATOR_H
+#define VULKANTUTORIAL_MIPGENERATOR_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * CPU mip chain generation, for formats the GPU can't blit with linear filtering
+ *
+ * Works in linear floating point, one RGBA pixel per SSE register (two per AVX2
+ * register when built with AVX2), so sRGB textures are converted to linear before
+ * filtering and back afterwards. Each level is filtered from the float version of
+ * the level above it rather than the quantized one, so rounding doesn't build up
+ * down the chain.
+ */
+namespace mipgen
+{
+    enum class Filter
+    {
+        // 2x2 average. Cheap, slightly blurry
+        Box,
+        // Kaiser windowed sinc over 8x8 source pixels. Sharper, can ring a little on hard edges
+        Kaiser
+    };
+
+    // 8 bit RGBA/BGRA formats, UNORM or sRGB
+    auto canGenerate(VkFormat format) -> bool;
+    // Length of the full chain down to 1x1
+    auto levelCount(type::uint32 width, type::uint32 height) -> type::uint32;
+    // Build every level of the chain. The first entry is a copy of level 0
+    auto generate(VkFormat format, type::uint32 width, type::uint32 height, const type::uint8* level0,
+                  Filter filter = Filter::Box) -> std::vector<std::vector<type::uint8>>;
+}
+
+#endif //VULKANTUTORIAL_MIPGENERATOR_H
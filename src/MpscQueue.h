@@ -0,0 +1,100 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_MPSCQUEUE_H
+#define VULKANTUTORIAL_MPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+
+#include "types.h"
+
+/**
+ * Fixed size lock free queue from any number of producer threads to one consumer thread
+ *
+ * A ring where every slot carries a sequence number saying whose turn it is.
+ * Producers claim a position by moving the shared tail forward with a CAS, fill
+ * the slot and then publish it through its sequence number, so a slow producer
+ * only holds up the consumer at its own slot and never the other producers.
+ * Pushing into a full queue fails instead of waiting, like SpscQueue.
+ */
+template<typename T, type::uint32 Capacity>
+class MpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Queue capacity has to be a power of two");
+
+public:
+    MpscQueue()
+    {
+        for(type::uint32 i = 0; i < Capacity; ++i)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. False if the queue is full
+    auto push(const T& value) -> bool
+    {
+        type::uint32 position = tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        while(true)
+        {
+            slot = &slots[position & (Capacity - 1)];
+            type::uint32 sequence = slot->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<type::int32>(sequence - position);
+            if(lag == 0)
+            {
+                // Free for this position. Claim it unless another producer got there first
+                if(tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(lag < 0)
+            {
+                // Still holds the value from a lap ago, which the consumer hasn't taken yet
+                return false;
+            }
+            else
+            {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = value;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False if the queue is empty, or the next value is still being written
+    auto pop(T& value) -> bool
+    {
+        Slot& slot = slots[head & (Capacity - 1)];
+        if(slot.sequence.load(std::memory_order_acquire) != head + 1)
+        {
+            return false;
+        }
+        value = slot.value;
+        // Free for the producer one lap ahead
+        slot.sequence.store(head + Capacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        // Position the slot can be written at, or one past the position whose value it holds
+        std::atomic<type::uint32> sequence;
+        T value;
+    };
+
+    std::array<Slot, Capacity> slots;
+    // Producers contend on the tail, so it gets its own cache line away from the consumer's head.
+        // Indices wrap around freely, only their difference matters
+    alignas(64) std::atomic<type::uint32> tail = 0;
+    alignas(64) type::uint32 head = 0;
+};
+
+#endif //VULKANTUTORIAL_MPSCQUEUE_H
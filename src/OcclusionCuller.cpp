@@ -0,0 +1,547 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "OcclusionCuller.h"
+#include "DescriptorAllocator.h"
+#include "ShaderModule.h"
+
+namespace
+{
+    constexpr VkDeviceSize DRAW_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+
+    // Largest power of two no bigger than the value
+    auto floorPowerOfTwo(type::uint32 value) -> type::uint32
+    {
+        type::uint32 power = 1;
+        while(power * 2 <= value)
+        {
+            power *= 2;
+        }
+        return power;
+    }
+}
+
+auto OcclusionCuller::isSupported(VkPhysicalDevice physicalDevice) -> bool
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    return features.drawIndirectFirstInstance;
+}
+
+auto OcclusionCuller::init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker,
+                           DeletionQueue& deletionQueue, DescriptorSetCache* setCache, Config config) -> void
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->deletionQueue = &deletionQueue;
+    this->setCache = setCache;
+    this->config = config;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    maxDrawIndirectCount = config.multiDrawIndirect ? properties.limits.maxDrawIndirectCount : 1;
+
+    constexpr VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    frames.resize(config.framesInFlight);
+    for(auto& frame : frames)
+    {
+        memoryTracker.createBuffer(static_cast<VkDeviceSize>(config.capacity) * sizeof(Object), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                hostMemory, MemoryTracker::Category::Uniform, frame.objects, frame.objectMemory);
+        memoryTracker.createBuffer(sizeof(Stats), VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostMemory, MemoryTracker::Category::Readback,
+                frame.stats, frame.statsMemory);
+        // Both stay mapped for as long as they live
+        void* data;
+        vkMapMemory(device, frame.objectMemory, 0, VK_WHOLE_SIZE, 0, &data);
+        frame.objectsMapped = static_cast<Object*>(data);
+        vkMapMemory(device, frame.statsMemory, 0, VK_WHOLE_SIZE, 0, &data);
+        frame.statsMapped = static_cast<Stats*>(data);
+    }
+
+    VkDeviceSize drawSize = static_cast<VkDeviceSize>(config.capacity) * DRAW_STRIDE;
+    memoryTracker.createBuffer(static_cast<VkDeviceSize>(config.capacity) * sizeof(type::uint32),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            MemoryTracker::Category::Vertex, visibility, visibilityMemory);
+    memoryTracker.createBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTracker::Category::Vertex, earlyDraws, earlyDrawMemory);
+    memoryTracker.createBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTracker::Category::Vertex, lateDraws, lateDrawMemory);
+    memoryTracker.createBuffer(sizeof(Stats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+            | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTracker::Category::Vertex,
+            counters, counterMemory);
+    visibilityCleared = false;
+
+    // Only ever read with texelFetch, but combined image samplers need one anyway
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if(vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Depth pyramid sampler creation failed");
+    }
+
+    createLayouts();
+    cullPipeline = createComputePipeline("shaders/occlusion_cull.comp.spv", cullLayout);
+    reducePipeline = createComputePipeline("shaders/depth_pyramid.comp.spv", reduceLayout);
+    if(config.depthSamples == VK_SAMPLE_COUNT_1_BIT)
+    {
+        depthReducePipeline = createComputePipeline("shaders/depth_pyramid.comp.spv", reduceLayout);
+    }
+    else
+    {
+        // Multisampled depth takes the farthest of every sample
+        VkSpecializationMapEntry entry = {0, 0, sizeof(type::int32)};
+        type::int32 sampleCount = static_cast<type::int32>(config.depthSamples);
+        VkSpecializationInfo specialization = {1, &entry, sizeof(sampleCount), &sampleCount};
+        depthReducePipeline = createComputePipeline("shaders/depth_pyramid_ms.comp.spv", reduceLayout, &specialization);
+    }
+}
+
+auto OcclusionCuller::cleanup() -> void
+{
+    destroyPyramid();
+
+    vkDestroyPipeline(device, depthReducePipeline, nullptr);
+    vkDestroyPipeline(device, reducePipeline, nullptr);
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    depthReducePipeline = VK_NULL_HANDLE;
+    reducePipeline = VK_NULL_HANDLE;
+    cullPipeline = VK_NULL_HANDLE;
+    vkDestroyPipelineLayout(device, reduceLayout, nullptr);
+    vkDestroyPipelineLayout(device, cullLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, reduceSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+    reduceLayout = VK_NULL_HANDLE;
+    cullLayout = VK_NULL_HANDLE;
+    reduceSetLayout = VK_NULL_HANDLE;
+    cullSetLayout = VK_NULL_HANDLE;
+    vkDestroySampler(device, sampler, nullptr);
+    sampler = VK_NULL_HANDLE;
+
+    vkDestroyBuffer(device, counters, nullptr);
+    memoryTracker->free(counterMemory);
+    vkDestroyBuffer(device, lateDraws, nullptr);
+    memoryTracker->free(lateDrawMemory);
+    vkDestroyBuffer(device, earlyDraws, nullptr);
+    memoryTracker->free(earlyDrawMemory);
+    vkDestroyBuffer(device, visibility, nullptr);
+    memoryTracker->free(visibilityMemory);
+    counters = lateDraws = earlyDraws = visibility = VK_NULL_HANDLE;
+    for(auto& frame : frames)
+    {
+        vkUnmapMemory(device, frame.statsMemory);
+        vkUnmapMemory(device, frame.objectMemory);
+        vkDestroyBuffer(device, frame.stats, nullptr);
+        memoryTracker->free(frame.statsMemory);
+        vkDestroyBuffer(device, frame.objects, nullptr);
+        memoryTracker->free(frame.objectMemory);
+    }
+    frames.clear();
+}
+
+auto OcclusionCuller::resize(VkExtent2D extent) -> void
+{
+    if(pyramid != VK_NULL_HANDLE)
+    {
+        deletionQueue->destroyImageView(pyramidView);
+        for(VkImageView view : levelViews)
+        {
+            deletionQueue->destroyImageView(view);
+        }
+        deletionQueue->destroyImage(pyramid);
+        deletionQueue->freeMemory(pyramidMemory);
+        pyramidView = VK_NULL_HANDLE;
+        levelViews.clear();
+        pyramid = VK_NULL_HANDLE;
+        pyramidMemory = VK_NULL_HANDLE;
+    }
+
+    // Halving a power of two always lands on whole texels, so every level covers exactly four of the one before
+    pyramidExtent = {floorPowerOfTwo(extent.width), floorPowerOfTwo(extent.height)};
+    pyramidLevels = 1;
+    while((pyramidExtent.width >> pyramidLevels) > 0 || (pyramidExtent.height >> pyramidLevels) > 0)
+    {
+        ++pyramidLevels;
+    }
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = {pyramidExtent.width, pyramidExtent.height, 1};
+    imageInfo.mipLevels = pyramidLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if(vkCreateImage(device, &imageInfo, nullptr, &pyramid) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Depth pyramid creation failed");
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(device, pyramid, &memReq);
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryTracker->chooseMemoryType(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(memoryTracker->allocate(allocInfo, MemoryTracker::Category::RenderTarget, pyramidMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Depth pyramid memory allocation failed");
+    }
+    vkBindImageMemory(device, pyramid, pyramidMemory, 0);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = pyramidLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if(vkCreateImageView(device, &viewInfo, nullptr, &pyramidView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Depth pyramid view creation failed");
+    }
+    levelViews.resize(pyramidLevels);
+    for(type::uint32 level = 0; level < pyramidLevels; ++level)
+    {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        if(vkCreateImageView(device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Depth pyramid view creation failed");
+        }
+    }
+}
+
+auto OcclusionCuller::destroyPyramid() -> void
+{
+    for(VkImageView view : levelViews)
+    {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    levelViews.clear();
+    vkDestroyImageView(device, pyramidView, nullptr);
+    vkDestroyImage(device, pyramid, nullptr);
+    if(pyramidMemory != VK_NULL_HANDLE)
+    {
+        memoryTracker->free(pyramidMemory);
+    }
+    pyramidView = VK_NULL_HANDLE;
+    pyramid = VK_NULL_HANDLE;
+    pyramidMemory = VK_NULL_HANDLE;
+}
+
+/**
+ * Culling
+ */
+auto OcclusionCuller::setObjects(type::uint32 frame, const std::vector<Object>& objects) -> void
+{
+    if(objects.size() > config.capacity)
+    {
+        throw std::runtime_error("More objects to cull than the occlusion culler has room for");
+    }
+    FrameBuffers& buffers = frames[frame];
+    std::memcpy(buffers.objectsMapped, objects.data(), objects.size() * sizeof(Object));
+    buffers.objectCount = static_cast<type::uint32>(objects.size());
+}
+
+auto OcclusionCuller::recordEarlyCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms) -> void
+{
+    // Last frame's draws, copies and culls are done with the buffers before they're rewritten
+    barrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    // The pyramid is bound in both phases, so it has to be in its layout before the first one. Every level is
+        // rewritten by the second, so whatever last frame left is discarded
+    VkImageMemoryBarrier pyramidBarrier = {};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.image = pyramid;
+    pyramidBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+
+    if(!visibilityCleared)
+    {
+        vkCmdFillBuffer(commandBuffer, visibility, 0, VK_WHOLE_SIZE, 0);
+        visibilityCleared = true;
+    }
+    vkCmdFillBuffer(commandBuffer, counters, 0, VK_WHOLE_SIZE, 0);
+    barrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    dispatchCull(commandBuffer, frame, camera, transforms, false);
+
+    // The late phase reads the same visibility to know what was already drawn
+    barrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+auto OcclusionCuller::recordLateCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms,
+                                     VkImageView depthView, VkExtent2D depthExtent) -> void
+{
+    // Depth into the first level, then each level into the next
+    glm::ivec2 sourceSize(static_cast<type::int32>(depthExtent.width), static_cast<type::int32>(depthExtent.height));
+    for(type::uint32 level = 0; level < pyramidLevels; ++level)
+    {
+        VkDescriptorSet set;
+        if(level == 0)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, depthReducePipeline);
+            set = setCache->getSet(reduceSetLayout,
+                    {
+                            DescriptorInfo::fromImage(sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+                            DescriptorInfo::fromImage(VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL)
+                    });
+        }
+        else
+        {
+            barrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            if(level == 1)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline);
+            }
+            set = setCache->getSet(reduceSetLayout,
+                    {
+                            DescriptorInfo::fromImage(sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL),
+                            DescriptorInfo::fromImage(VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL)
+                    });
+        }
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduceLayout, 0, 1, &set, 0, nullptr);
+
+        glm::ivec2 targetSize(static_cast<type::int32>(std::max(pyramidExtent.width >> level, 1u)),
+                static_cast<type::int32>(std::max(pyramidExtent.height >> level, 1u)));
+        ReduceConstants constants = {sourceSize, targetSize};
+        vkCmdPushConstants(commandBuffer, reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (targetSize.x + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE,
+                (targetSize.y + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, 1);
+        sourceSize = targetSize;
+    }
+    barrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    dispatchCull(commandBuffer, frame, camera, transforms, true);
+
+    barrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+    // Read back once the frame's fence signals, so nothing waits on it
+    VkBufferCopy copy = {0, 0, sizeof(Stats)};
+    vkCmdCopyBuffer(commandBuffer, counters, frames[frame].stats, 1, &copy);
+    barrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    frames[frame].statsPending = true;
+}
+
+auto OcclusionCuller::dispatchCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms,
+                                   bool late) -> void
+{
+    const FrameBuffers& buffers = frames[frame];
+    // The pyramid is only sampled by the late phase, but it's there in both so they can share a set
+    VkDescriptorSet set = setCache->getSet(cullSetLayout,
+            {
+                    DescriptorInfo::fromBuffer(camera, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(transforms, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(buffers.objects, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(visibility, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(earlyDraws, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(lateDraws, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(counters, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromImage(sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL)
+            });
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &set, 0, nullptr);
+
+    CullConstants constants = {};
+    constants.objectCount = buffers.objectCount;
+    constants.late = late ? 1 : 0;
+    constants.pyramidWidth = pyramidExtent.width;
+    constants.pyramidHeight = pyramidExtent.height;
+    constants.pyramidLevels = pyramidLevels;
+    vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    if(buffers.objectCount > 0)
+    {
+        vkCmdDispatch(commandBuffer, (buffers.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    }
+}
+
+auto OcclusionCuller::drawEarly(VkCommandBuffer commandBuffer, type::uint32 first, type::uint32 count) -> void
+{
+    draw(commandBuffer, earlyDraws, first, count);
+}
+
+auto OcclusionCuller::drawLate(VkCommandBuffer commandBuffer, type::uint32 first, type::uint32 count) -> void
+{
+    draw(commandBuffer, lateDraws, first, count);
+}
+
+auto OcclusionCuller::draw(VkCommandBuffer commandBuffer, VkBuffer buffer, type::uint32 first, type::uint32 count) -> void
+{
+    // Culled objects are draws of zero instances, which cost next to nothing to skip
+    while(count > 0)
+    {
+        type::uint32 batch = std::min(count, maxDrawIndirectCount);
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, first * DRAW_STRIDE, batch, static_cast<type::uint32>(DRAW_STRIDE));
+        first += batch;
+        count -= batch;
+    }
+}
+
+auto OcclusionCuller::update(type::uint32 frame) -> void
+{
+    FrameBuffers& buffers = frames[frame];
+    if(!buffers.statsPending)
+    {
+        return;
+    }
+    Stats stats = *buffers.statsMapped;
+    buffers.statsPending = false;
+    frustumCulled.store(stats.frustumCulled, std::memory_order_relaxed);
+    occluded.store(stats.occluded, std::memory_order_relaxed);
+    drawnEarly.store(stats.drawnEarly, std::memory_order_relaxed);
+    drawnLate.store(stats.drawnLate, std::memory_order_relaxed);
+}
+
+auto OcclusionCuller::getStats() const -> Stats
+{
+    return {frustumCulled.load(std::memory_order_relaxed), occluded.load(std::memory_order_relaxed),
+            drawnEarly.load(std::memory_order_relaxed), drawnLate.load(std::memory_order_relaxed)};
+}
+
+auto OcclusionCuller::barrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                              VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> void
+{
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+/**
+ * Resource Creation
+ */
+auto OcclusionCuller::createLayouts() -> void
+{
+    // Camera, transforms, objects, visibility, early draws, late draws, counters, pyramid
+    std::vector<VkDescriptorSetLayoutBinding> cullBindings(8);
+    for(type::uint32 i = 0; i < cullBindings.size(); ++i)
+    {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    cullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullBindings[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    // Source depth or level, target level
+    std::vector<VkDescriptorSetLayoutBinding> reduceBindings(2);
+    for(type::uint32 i = 0; i < reduceBindings.size(); ++i)
+    {
+        reduceBindings[i].binding = i;
+        reduceBindings[i].descriptorCount = 1;
+        reduceBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    reduceBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    reduceBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<type::uint32>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Occlusion culling descriptor set layout creation failed");
+    }
+    setCache->registerLayout(cullSetLayout, cullBindings);
+
+    layoutInfo.bindingCount = static_cast<type::uint32>(reduceBindings.size());
+    layoutInfo.pBindings = reduceBindings.data();
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &reduceSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Occlusion culling descriptor set layout creation failed");
+    }
+    setCache->registerLayout(reduceSetLayout, reduceBindings);
+
+    VkPushConstantRange cullRange = {};
+    cullRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullRange.offset = 0;
+    cullRange.size = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &cullRange;
+    if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Occlusion culling pipeline layout creation failed");
+    }
+
+    VkPushConstantRange reduceRange = {};
+    reduceRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    reduceRange.offset = 0;
+    reduceRange.size = sizeof(ReduceConstants);
+
+    pipelineLayoutInfo.pSetLayouts = &reduceSetLayout;
+    pipelineLayoutInfo.pPushConstantRanges = &reduceRange;
+    if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &reduceLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Occlusion culling pipeline layout creation failed");
+    }
+}
+
+auto OcclusionCuller::createComputePipeline(const std::string& fileName, VkPipelineLayout layout,
+                                            const VkSpecializationInfo* specialization) -> VkPipeline
+{
+    VkShaderModule shaderModule = shader::loadModule(device, fileName);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = specialization;
+    pipelineInfo.layout = layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Occlusion culling pipeline creation failed");
+    }
+
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+    return pipeline;
+}
+
@@ -0,0 +1,210 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_OCCLUSIONCULLER_H
+#define VULKANTUTORIAL_OCCLUSIONCULLER_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "types.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+
+class DescriptorSetCache;
+
+/**
+ * Two phase occlusion culling against a hierarchical depth buffer, done entirely on the GPU
+ *
+ * The objects that were visible last frame are drawn first, depth only, since
+ * they're likely to still be visible and to hide most of everything else. The
+ * depth they leave behind is reduced into a pyramid, each level holding the
+ * farthest depth of the 2x2 texels below it. Every object in the frustum is
+ * then tested against the pyramid: its bounding sphere is projected to a
+ * screen rectangle, a level is picked where that rectangle covers at most 2x2
+ * texels, and the object is hidden if its nearest point is behind all of them.
+ * Whatever passes is drawn, including the objects that only became visible this
+ * frame, and is remembered as visible for the next frame.
+ *
+ * Both phases write one indirect draw per object, in the order the objects
+ * were given in, with an instance count of zero for the ones that are culled.
+ * The draws stay in their sorted order and can be issued in ranges sharing a
+ * pipeline, and the CPU never needs to know what was culled. How many were is
+ * counted on the GPU and read back once the frame's fence has signaled.
+ */
+class OcclusionCuller
+{
+public:
+    struct Config
+    {
+        // Most objects that can be culled in one frame
+        type::uint32 capacity = 1024;
+        type::uint32 framesInFlight = 2;
+        // Sample count of the depth buffer the pyramid is built from
+        VkSampleCountFlagBits depthSamples = VK_SAMPLE_COUNT_1_BIT;
+        // Whether the device has multiDrawIndirect turned on. Otherwise draws are issued one at a time
+        bool multiDrawIndirect = false;
+    };
+
+    // One object as the culling shader reads it. Must match occlusion_cull.comp
+    struct Object
+    {
+        // xyz object space center, w radius of the bounding sphere
+        glm::vec4 sphere;
+        type::uint32 indexCount;
+        type::uint32 firstIndex;
+        // Scene node holding the world matrix. Also the draw's first instance, which the shaders use to find it
+        type::uint32 node;
+        // Slot of the object's visibility, which has to stay the same however the objects are ordered
+        type::uint32 id;
+        // Where the object's vertices are in the shared vertex buffer
+        type::int32 vertexOffset;
+        // Arrays of structs holding a vec4 are laid out in multiples of 16 bytes
+        type::uint32 padding[3] = {};
+    };
+
+    // Counted on the GPU as the phases run. Must match occlusion_cull.comp
+    struct Stats
+    {
+        type::uint32 frustumCulled;
+        type::uint32 occluded;
+        // Visible last frame and drawn in the first phase
+        type::uint32 drawnEarly;
+        // Found visible by testing against the pyramid
+        type::uint32 drawnLate;
+    };
+
+    // Indirect draws have to be able to start at an instance other than zero
+    static auto isSupported(VkPhysicalDevice physicalDevice) -> bool;
+
+    // Sets come from the given cache, which may be cleared at any time
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker, DeletionQueue& deletionQueue,
+              DescriptorSetCache* setCache, Config config) -> void;
+    auto cleanup() -> void;
+    // Size the pyramid for a depth buffer of this extent. The old one is retired, so frames in flight can finish with it
+    auto resize(VkExtent2D extent) -> void;
+
+    // Objects to cull in the frame with this index. Their order is the order of the indirect draws
+    auto setObjects(type::uint32 frame, const std::vector<Object>& objects) -> void;
+    // Build the first phase's draws from last frame's visibility. Goes before the render pass drawing them.
+        // Camera is a uniform buffer with the view and projection matrices, transforms a storage buffer
+        // with a world matrix per scene node
+    auto recordEarlyCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms) -> void;
+    // Build the pyramid from the first phase's depth and test every object against it. The depth has to be
+        // in SHADER_READ_ONLY_OPTIMAL, and only its top left corner of the given extent is used
+    auto recordLateCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms,
+                        VkImageView depthView, VkExtent2D depthExtent) -> void;
+    // Issue a range of either phase's draws inside a render pass, with the index buffer and pipeline already bound
+    auto drawEarly(VkCommandBuffer commandBuffer, type::uint32 first, type::uint32 count) -> void;
+    auto drawLate(VkCommandBuffer commandBuffer, type::uint32 first, type::uint32 count) -> void;
+
+    // Read back the counts of the frame last recorded with this index. That frame's fence has to have signaled
+    auto update(type::uint32 frame) -> void;
+    // Read by the main thread, so each count is only consistent with itself
+    auto getStats() const -> Stats;
+
+private:
+    // Must match local_size_x in occlusion_cull.comp
+    static constexpr type::uint32 WORKGROUP_SIZE = 64;
+    // Must match local_size_x and local_size_y in the depth pyramid shaders
+    static constexpr type::uint32 PYRAMID_WORKGROUP_SIZE = 8;
+
+    // Must match the push_constant block in occlusion_cull.comp
+    struct CullConstants
+    {
+        type::uint32 objectCount;
+        // 0 for the first phase, 1 for the second
+        type::uint32 late;
+        // Extent of the pyramid's first level
+        type::uint32 pyramidWidth;
+        type::uint32 pyramidHeight;
+        type::uint32 pyramidLevels;
+    };
+
+    // Must match the push_constant blocks in the depth pyramid shaders
+    struct ReduceConstants
+    {
+        glm::ivec2 sourceSize;
+        glm::ivec2 targetSize;
+    };
+
+    struct FrameBuffers
+    {
+        // Written by the CPU
+        VkBuffer objects = VK_NULL_HANDLE;
+        VkDeviceMemory objectMemory = VK_NULL_HANDLE;
+        Object* objectsMapped = nullptr;
+        type::uint32 objectCount = 0;
+        // Read back by the CPU
+        VkBuffer stats = VK_NULL_HANDLE;
+        VkDeviceMemory statsMemory = VK_NULL_HANDLE;
+        Stats* statsMapped = nullptr;
+        bool statsPending = false;
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+    DescriptorSetCache* setCache = nullptr;
+    Config config;
+    type::uint32 maxDrawIndirectCount = 1;
+
+    std::vector<FrameBuffers> frames;
+    // Whether each object was visible at the end of last frame, by id
+    VkBuffer visibility = VK_NULL_HANDLE;
+    VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+    // Starts out as garbage and is zeroed by the first cull, so everything is tested in the second phase
+    bool visibilityCleared = false;
+    VkBuffer earlyDraws = VK_NULL_HANDLE;
+    VkDeviceMemory earlyDrawMemory = VK_NULL_HANDLE;
+    VkBuffer lateDraws = VK_NULL_HANDLE;
+    VkDeviceMemory lateDrawMemory = VK_NULL_HANDLE;
+    VkBuffer counters = VK_NULL_HANDLE;
+    VkDeviceMemory counterMemory = VK_NULL_HANDLE;
+
+    // Farthest depth pyramid. Its first level is the largest power of two that fits in the depth buffer
+    VkImage pyramid = VK_NULL_HANDLE;
+    VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+    VkExtent2D pyramidExtent = {0, 0};
+    type::uint32 pyramidLevels = 0;
+    // Every level, for sampling in the cull
+    VkImageView pyramidView = VK_NULL_HANDLE;
+    // One level each, for building the pyramid
+    std::vector<VkImageView> levelViews;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout cullLayout = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    VkDescriptorSetLayout reduceSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout reduceLayout = VK_NULL_HANDLE;
+    // Reduces the depth buffer into the first level, then each level into the next
+    VkPipeline depthReducePipeline = VK_NULL_HANDLE;
+    VkPipeline reducePipeline = VK_NULL_HANDLE;
+
+    std::atomic<type::uint32> frustumCulled = 0;
+    std::atomic<type::uint32> occluded = 0;
+    std::atomic<type::uint32> drawnEarly = 0;
+    std::atomic<type::uint32> drawnLate = 0;
+
+    // Everything written so far finishes before the given stages touch the buffers
+    static auto barrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                        VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> void;
+
+    auto draw(VkCommandBuffer commandBuffer, VkBuffer buffer, type::uint32 first, type::uint32 count) -> void;
+    auto dispatchCull(VkCommandBuffer commandBuffer, type::uint32 frame, VkBuffer camera, VkBuffer transforms, bool late) -> void;
+    auto destroyPyramid() -> void;
+
+    auto createLayouts() -> void;
+    auto createComputePipeline(const std::string& fileName, VkPipelineLayout layout,
+                               const VkSpecializationInfo* specialization = nullptr) -> VkPipeline;
+};
+
+#endif //VULKANTUTORIAL_OCCLUSIONCULLER_H
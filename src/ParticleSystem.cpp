@@ -0,0 +1,441 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "ParticleSystem.h"
+#include "DescriptorAllocator.h"
+#include "ShaderModule.h"
+
+auto ParticleSystem::init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker,
+                          DescriptorSetCache* setCache, Config config) -> void
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->setCache = setCache;
+    this->config = config;
+    separateComputeQueue = config.computeFamily.has_value() && config.computeFamily.value() != config.graphicsFamily;
+
+    // The simulation is dispatched with a workgroup per WORKGROUP_SIZE particles
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if(config.capacity == 0 || (config.capacity - 1) / WORKGROUP_SIZE >= properties.limits.maxComputeWorkGroupCount[0])
+    {
+        throw std::runtime_error("Particle capacity needs more workgroups than a dispatch can have");
+    }
+
+    for(auto& buffer : buffers)
+    {
+        createBuffer(static_cast<VkDeviceSize>(config.capacity) * sizeof(Particle), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                buffer.particles, buffer.particleMemory);
+        createBuffer(sizeof(State), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer.state, buffer.stateMemory);
+    }
+    current = 0;
+    stateCleared = false;
+    emitRemainder = 0.0f;
+    frameSeed = 0;
+
+    createLayouts();
+    simulatePipeline = createComputePipeline("shaders/particle_simulate.comp.spv");
+    emitPipeline = createComputePipeline("shaders/particle_emit.comp.spv");
+    finishPipeline = createComputePipeline("shaders/particle_finish.comp.spv");
+}
+
+auto ParticleSystem::cleanup() -> void
+{
+    destroyPipelines();
+    vkDestroyPipeline(device, finishPipeline, nullptr);
+    vkDestroyPipeline(device, emitPipeline, nullptr);
+    vkDestroyPipeline(device, simulatePipeline, nullptr);
+    finishPipeline = VK_NULL_HANDLE;
+    emitPipeline = VK_NULL_HANDLE;
+    simulatePipeline = VK_NULL_HANDLE;
+
+    vkDestroyPipelineLayout(device, drawLayout, nullptr);
+    vkDestroyPipelineLayout(device, simulationLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, drawSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, simulationSetLayout, nullptr);
+    drawLayout = VK_NULL_HANDLE;
+    simulationLayout = VK_NULL_HANDLE;
+    drawSetLayout = VK_NULL_HANDLE;
+    simulationSetLayout = VK_NULL_HANDLE;
+
+    for(auto& buffer : buffers)
+    {
+        vkDestroyBuffer(device, buffer.state, nullptr);
+        memoryTracker->free(buffer.stateMemory);
+        vkDestroyBuffer(device, buffer.particles, nullptr);
+        memoryTracker->free(buffer.particleMemory);
+        buffer = {};
+    }
+}
+
+auto ParticleSystem::createPipelines(VkRenderPass renderPass, type::uint32 subpass, VkSampleCountFlagBits samples) -> void
+{
+    VkShaderModule vertShaderModule = shader::loadModule(device, "shaders/particle.vert.spv");
+    VkShaderModule fragShaderModule = shader::loadModule(device, "shaders/particle.frag.spv");
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    // The vertex shader pulls the particles out of the storage buffer itself
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are set when recording, so the pipeline doesn't depend on the extent
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    // Billboards always face the camera
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = samples;
+    multisampling.minSampleShading = 1.0f;
+
+    // Hidden behind the scene's geometry, but additive blending doesn't care about the
+        // order particles are drawn in, so they don't write depth or need sorting
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.maxDepthBounds = 1.0f;
+
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blendAttachment.blendEnable = VK_TRUE;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &blendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = drawLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &drawPipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle pipeline creation failed");
+    }
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+}
+
+auto ParticleSystem::destroyPipelines() -> void
+{
+    if(drawPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(device, drawPipeline, nullptr);
+        drawPipeline = VK_NULL_HANDLE;
+    }
+}
+
+auto ParticleSystem::retirePipelines(DeletionQueue& deletionQueue) -> void
+{
+    deletionQueue.destroyPipeline(drawPipeline);
+    drawPipeline = VK_NULL_HANDLE;
+}
+
+/**
+ * Simulation
+ */
+auto ParticleSystem::update(float deltaSeconds) -> void
+{
+    pendingDelta = deltaSeconds;
+    float emit = config.emitRate * deltaSeconds + emitRemainder;
+    // Anything past the capacity would be thrown away by the emit shader anyway
+    emit = std::min(emit, static_cast<float>(config.capacity));
+    pendingEmit = static_cast<type::uint32>(emit);
+    emitRemainder = emit - static_cast<float>(pendingEmit);
+}
+
+auto ParticleSystem::recordSimulation(VkCommandBuffer commandBuffer) -> void
+{
+    const ParticleBuffer& source = buffers[current];
+    current ^= 1;
+    const ParticleBuffer& target = buffers[current];
+
+    if(!stateCleared)
+    {
+        // Zero particles, and indirect commands that draw and dispatch nothing
+        for(const auto& buffer : buffers)
+        {
+            vkCmdFillBuffer(commandBuffer, buffer.state, 0, sizeof(State), 0);
+        }
+        stateCleared = true;
+    }
+
+    // The previous simulation wrote the source, and the draws reading the target belong to the
+        // frame whose fence was waited on before this was recorded
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdFillBuffer(commandBuffer, target.state, offsetof(State, count), sizeof(type::uint32), 0);
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    VkDescriptorSet set = setCache->getSet(simulationSetLayout,
+            {
+                    DescriptorInfo::fromBuffer(source.particles, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(target.particles, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(source.state, 0, VK_WHOLE_SIZE),
+                    DescriptorInfo::fromBuffer(target.state, 0, VK_WHOLE_SIZE)
+            });
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulationLayout, 0, 1, &set, 0, nullptr);
+
+    SimulationConstants constants = {};
+    constants.deltaTime = pendingDelta;
+    constants.emitCount = pendingEmit;
+    constants.seed = ++frameSeed;
+    constants.capacity = config.capacity;
+    constants.emitter = glm::vec4(config.emitterPosition, config.emitSpeed);
+    constants.minLifetime = config.minLifetime;
+    constants.maxLifetime = config.maxLifetime;
+    vkCmdPushConstants(commandBuffer, simulationLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+    // Survivors first, sized by the dispatch the previous simulation left in the source's state
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+    vkCmdDispatchIndirect(commandBuffer, source.state, offsetof(State, dispatch));
+
+    if(pendingEmit > 0)
+    {
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+        vkCmdDispatch(commandBuffer, (pendingEmit + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    }
+
+    // Clamp the count and turn it into the draw and the next simulation's dispatch
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, finishPipeline);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    // A compute queue can't wait on graphics stages. The semaphore the draw waits on covers it there
+    if(!separateComputeQueue)
+    {
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                DRAW_WAIT_STAGES, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    pendingDelta = 0.0f;
+    pendingEmit = 0;
+}
+
+auto ParticleSystem::recordDraw(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent) -> void
+{
+    if(!stateCleared)
+    {
+        return;
+    }
+    const ParticleBuffer& buffer = buffers[current];
+
+    VkViewport viewport = {};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // A view space offset only moves x and y in clip space, by the projection's scale
+    DrawConstants constants = {};
+    constants.viewProj = proj * view;
+    constants.billboardScale = {config.particleSize * proj[0][0], config.particleSize * proj[1][1]};
+    vkCmdPushConstants(commandBuffer, drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+    VkDescriptorSet set = setCache->getSet(drawSetLayout, {DescriptorInfo::fromBuffer(buffer.particles, 0, VK_WHOLE_SIZE)});
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawLayout, 0, 1, &set, 0, nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+
+    // Six vertices per live particle, counted on the GPU
+    vkCmdDrawIndirect(commandBuffer, buffer.state, offsetof(State, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+auto ParticleSystem::computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                                    VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> void
+{
+    // Both buffers are involved every time, so a global barrier says it in one go
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+/**
+ * Resource Creation
+ */
+auto ParticleSystem::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory) -> void
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    // Concurrent sharing costs less than transferring ownership back and forth every frame
+    type::uint32 queueFamilies[] = {config.graphicsFamily, config.computeFamily.value_or(config.graphicsFamily)};
+    if(separateComputeQueue)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
+    }
+    else
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    memoryTracker->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, MemoryTracker::Category::Vertex, buffer, memory);
+}
+
+auto ParticleSystem::createLayouts() -> void
+{
+    // Source particles, target particles, source state, target state
+    std::vector<VkDescriptorSetLayoutBinding> simulationBindings(4);
+    for(type::uint32 i = 0; i < simulationBindings.size(); ++i)
+    {
+        simulationBindings[i].binding = i;
+        simulationBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        simulationBindings[i].descriptorCount = 1;
+        simulationBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutBinding particleBinding = {};
+    particleBinding.binding = 0;
+    particleBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    particleBinding.descriptorCount = 1;
+    particleBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<type::uint32>(simulationBindings.size());
+    layoutInfo.pBindings = simulationBindings.data();
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &simulationSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle descriptor set layout creation failed");
+    }
+    setCache->registerLayout(simulationSetLayout, simulationBindings);
+
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &particleBinding;
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &drawSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle descriptor set layout creation failed");
+    }
+    setCache->registerLayout(drawSetLayout, {particleBinding});
+
+    VkPushConstantRange simulationRange = {};
+    simulationRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    simulationRange.offset = 0;
+    simulationRange.size = sizeof(SimulationConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &simulationSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &simulationRange;
+    if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &simulationLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle pipeline layout creation failed");
+    }
+
+    VkPushConstantRange drawRange = {};
+    drawRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    drawRange.offset = 0;
+    drawRange.size = sizeof(DrawConstants);
+
+    pipelineLayoutInfo.pSetLayouts = &drawSetLayout;
+    pipelineLayoutInfo.pPushConstantRanges = &drawRange;
+    if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &drawLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle pipeline layout creation failed");
+    }
+}
+
+auto ParticleSystem::createComputePipeline(const std::string& fileName) -> VkPipeline
+{
+    VkShaderModule shaderModule = shader::loadModule(device, fileName);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = simulationLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Particle compute pipeline creation failed");
+    }
+
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+    return pipeline;
+}
+
@@ -0,0 +1,176 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_PARTICLESYSTEM_H
+#define VULKANTUTORIAL_PARTICLESYSTEM_H
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <optional>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "types.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+
+class DescriptorSetCache;
+
+/**
+ * Particles that are emitted, simulated and drawn without ever coming back to the CPU
+ *
+ * Particle state lives in two device local storage buffers. Every frame a compute
+ * pass reads the live particles out of one, ages and moves them, and appends the
+ * survivors to the other, which compacts them as it goes. New particles are then
+ * appended behind the survivors. The buffers swap roles every frame.
+ *
+ * Each buffer has a small state block next to it holding its live count, along
+ * with an indirect draw and an indirect dispatch built from that count on the GPU.
+ * The next frame's simulation is dispatched from one and the particles are drawn
+ * from the other, so the CPU never needs to know how many particles there are.
+ *
+ * The simulation can be recorded for a separate compute queue. The buffers are
+ * then shared between both queue families and the draw has to wait on a
+ * semaphore signalled by the compute submission instead of a barrier.
+ */
+class ParticleSystem
+{
+public:
+    struct Config
+    {
+        // Most particles alive at once. Emission stops while the buffers are full
+        type::uint32 capacity = 1 << 20;
+        // Particles emitted per simulated second
+        float emitRate = 200000.0f;
+        // Seconds a particle lives for, picked at random between the two
+        float minLifetime = 2.0f;
+        float maxLifetime = 5.0f;
+        glm::vec3 emitterPosition = {0.0f, 0.0f, 0.0f};
+        // Initial speed along the emitter's cone, which points up the z axis
+        float emitSpeed = 2.5f;
+        // World space size of a particle's billboard
+        float particleSize = 0.01f;
+        // Family of the queue the particles are drawn on, and of the one the simulation is
+            // submitted to if that's a different one
+        type::uint32 graphicsFamily = 0;
+        std::optional<type::uint32> computeFamily;
+    };
+
+    // Sets come from the given cache, which may be cleared at any time
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker,
+              DescriptorSetCache* setCache, Config config) -> void;
+    auto cleanup() -> void;
+    // The draw pipeline depends on the render pass, so it's recreated with the swap chain
+    auto createPipelines(VkRenderPass renderPass, type::uint32 subpass, VkSampleCountFlagBits samples) -> void;
+    auto destroyPipelines() -> void;
+    // Same, but for when frames still in flight may be drawing with it
+    auto retirePipelines(DeletionQueue& deletionQueue) -> void;
+
+    // Advance the simulation by this much on the next recordSimulation. Works out how many particles to emit
+    auto update(float deltaSeconds) -> void;
+    // Swap the buffers and record the emit, simulate and compact dispatches. Goes on the compute queue
+        // when there is a separate one, otherwise before the render pass drawing the particles
+    auto recordSimulation(VkCommandBuffer commandBuffer) -> void;
+    // Draw whatever the last recorded simulation left alive, inside a render pass compatible with
+        // the one given to createPipelines
+    auto recordDraw(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent) -> void;
+
+    // Where a submission drawing the particles has to wait for the compute queue's semaphore
+    static constexpr VkPipelineStageFlags DRAW_WAIT_STAGES =
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+    inline auto usesComputeQueue() const -> bool { return separateComputeQueue; }
+
+private:
+    // Must match local_size_x in the particle compute shaders
+    static constexpr type::uint32 WORKGROUP_SIZE = 256;
+
+    // One particle as it is laid out in the storage buffers. Must match the shaders
+    struct Particle
+    {
+        // xyz position, w seconds left to live
+        glm::vec4 position;
+        // xyz velocity, w seconds the particle lived for in total
+        glm::vec4 velocity;
+    };
+
+    // Live count of a particle buffer and the indirect commands built from it. Must match the shaders
+    struct State
+    {
+        VkDrawIndirectCommand draw;
+        VkDispatchIndirectCommand dispatch;
+        type::uint32 count;
+    };
+
+    // Shared by the three compute shaders. Must match their push_constant blocks
+    struct SimulationConstants
+    {
+        float deltaTime;
+        type::uint32 emitCount;
+        type::uint32 seed;
+        type::uint32 capacity;
+        // xyz position, w speed
+        glm::vec4 emitter;
+        float minLifetime;
+        float maxLifetime;
+    };
+
+    // Must match the push_constant block in particle.vert
+    struct DrawConstants
+    {
+        glm::mat4 viewProj;
+        // Clip space extent of a billboard before the perspective divide
+        glm::vec2 billboardScale;
+    };
+
+    struct ParticleBuffer
+    {
+        VkBuffer particles = VK_NULL_HANDLE;
+        VkDeviceMemory particleMemory = VK_NULL_HANDLE;
+        VkBuffer state = VK_NULL_HANDLE;
+        VkDeviceMemory stateMemory = VK_NULL_HANDLE;
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    DescriptorSetCache* setCache = nullptr;
+    Config config;
+    bool separateComputeQueue = false;
+
+    std::array<ParticleBuffer, 2> buffers;
+    // Buffer the last recorded simulation wrote to, which is the one that gets drawn
+    type::uint32 current = 0;
+    // State blocks start out as garbage and are zeroed by the first simulation
+    bool stateCleared = false;
+
+    float pendingDelta = 0.0f;
+    type::uint32 pendingEmit = 0;
+    // Fractions of a particle left over from earlier updates
+    float emitRemainder = 0.0f;
+    type::uint32 frameSeed = 0;
+
+    VkDescriptorSetLayout simulationSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout simulationLayout = VK_NULL_HANDLE;
+    VkPipeline simulatePipeline = VK_NULL_HANDLE;
+    VkPipeline emitPipeline = VK_NULL_HANDLE;
+    VkPipeline finishPipeline = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout drawSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout drawLayout = VK_NULL_HANDLE;
+    VkPipeline drawPipeline = VK_NULL_HANDLE;
+
+    // Everything written so far finishes before the given stages touch the particles
+    static auto computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                               VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> void;
+
+    // Shared with the compute queue family, if that's a different one
+    auto createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory) -> void;
+    auto createLayouts() -> void;
+    auto createComputePipeline(const std::string& fileName) -> VkPipeline;
+};
+
+#endif //VULKANTUTORIAL_PARTICLESYSTEM_H
@@ -0,0 +1,340 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <cstring>
+#include <stdexcept>
+#include "PipelineVariants.h"
+#include "Hash.h"
+#include "ShaderModule.h"
+
+namespace
+{
+    constexpr VkPipelineCreateFlags DERIVATIVE_FLAGS = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT | VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+
+    // Only used on handles, enums, numbers and Vulkan structs without padding or pointers
+    template<typename T>
+    auto append(std::vector<type::uint8>& state, const T& value) -> void
+    {
+        auto bytes = reinterpret_cast<const type::uint8*>(&value);
+        state.insert(state.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    auto appendArray(std::vector<type::uint8>& state, const T* values, type::uint32 count) -> void
+    {
+        append(state, count);
+        if(values != nullptr)
+        {
+            auto bytes = reinterpret_cast<const type::uint8*>(values);
+            state.insert(state.end(), bytes, bytes + count * sizeof(T));
+        }
+    }
+
+    // Pointed to state that is left out is marked, so it can't be mistaken for state that is there
+    auto appendPresent(std::vector<type::uint8>& state, const void* pointer) -> bool
+    {
+        append(state, static_cast<type::uint8>(pointer != nullptr));
+        return pointer != nullptr;
+    }
+
+    // Extension structs could change the pipeline without changing its state
+    auto rejectExtensions(const void* pNext) -> void
+    {
+        if(pNext != nullptr)
+        {
+            throw std::runtime_error("Pipeline variants can't be made from create infos with extension structs");
+        }
+    }
+}
+
+/**
+ * Specialization
+ */
+auto PipelineVariants::Specialization::set(type::uint32 constantId, type::uint32 value) -> Specialization&
+{
+    set(constantId, &value, sizeof(value));
+    return *this;
+}
+
+auto PipelineVariants::Specialization::set(type::uint32 constantId, float value) -> Specialization&
+{
+    set(constantId, &value, sizeof(value));
+    return *this;
+}
+
+auto PipelineVariants::Specialization::getInfo() -> const VkSpecializationInfo*
+{
+    if(entries.empty())
+    {
+        return nullptr;
+    }
+    // Filled in here instead of in set, since the vectors may have moved since
+    info.mapEntryCount = static_cast<type::uint32>(entries.size());
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size();
+    info.pData = data.data();
+    return &info;
+}
+
+auto PipelineVariants::Specialization::set(type::uint32 constantId, const void* value, type::size size) -> void
+{
+    for(const auto& entry : entries)
+    {
+        if(entry.constantID == constantId)
+        {
+            std::memcpy(data.data() + entry.offset, value, size);
+            return;
+        }
+    }
+
+    VkSpecializationMapEntry entry = {};
+    entry.constantID = constantId;
+    entry.offset = static_cast<type::uint32>(data.size());
+    entry.size = size;
+    entries.push_back(entry);
+    data.resize(data.size() + size);
+    std::memcpy(data.data() + entry.offset, value, size);
+}
+
+/**
+ * Variants
+ */
+auto PipelineVariants::init(VkDevice device) -> void
+{
+    this->device = device;
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if(vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+}
+
+auto PipelineVariants::cleanup() -> void
+{
+    for(auto& bucket : variants)
+    {
+        for(auto& variant : bucket.second)
+        {
+            vkDestroyPipeline(device, variant.pipeline, nullptr);
+        }
+    }
+    variants.clear();
+    variantCount = 0;
+    base = VK_NULL_HANDLE;
+    for(const auto& module : moduleHashes)
+    {
+        vkDestroyShaderModule(device, module.first, nullptr);
+    }
+    moduleHashes.clear();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+auto PipelineVariants::loadModule(const std::string& fileName) -> VkShaderModule
+{
+    std::vector<char> code = shader::readFile(fileName);
+    VkShaderModule module = shader::createModule(device, code);
+    moduleHashes[module] = hash::fnv1a(code.data(), code.size());
+    return module;
+}
+
+auto PipelineVariants::destroyModule(VkShaderModule module) -> void
+{
+    moduleHashes.erase(module);
+    vkDestroyShaderModule(device, module, nullptr);
+}
+
+auto PipelineVariants::get(const VkGraphicsPipelineCreateInfo& createInfo) -> VkPipeline
+{
+    std::vector<type::uint8> state;
+    flatten(createInfo, state);
+    std::vector<Variant>& bucket = variants[hash::fnv1a(state.data(), state.size())];
+    for(const auto& variant : bucket)
+    {
+        if(variant.state == state)
+        {
+            return variant.pipeline;
+        }
+    }
+
+    VkGraphicsPipelineCreateInfo variantInfo = createInfo;
+    variantInfo.flags &= ~DERIVATIVE_FLAGS;
+    if(base == VK_NULL_HANDLE)
+    {
+        variantInfo.flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+        variantInfo.basePipelineHandle = VK_NULL_HANDLE;
+    }
+    else
+    {
+        variantInfo.flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+        variantInfo.basePipelineHandle = base;
+    }
+    variantInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(device, pipelineCache, 1, &variantInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Pipeline variant creation failed");
+    }
+    if(base == VK_NULL_HANDLE)
+    {
+        base = pipeline;
+    }
+    bucket.push_back({std::move(state), pipeline});
+    ++variantCount;
+    return pipeline;
+}
+
+auto PipelineVariants::retire(DeletionQueue& deletionQueue) -> void
+{
+    for(auto& bucket : variants)
+    {
+        for(auto& variant : bucket.second)
+        {
+            deletionQueue.destroyPipeline(variant.pipeline);
+        }
+    }
+    variants.clear();
+    variantCount = 0;
+    base = VK_NULL_HANDLE;
+}
+
+auto PipelineVariants::flatten(const VkGraphicsPipelineCreateInfo& createInfo, std::vector<type::uint8>& state) const -> void
+{
+    rejectExtensions(createInfo.pNext);
+    // Which pipeline is the base is decided in get, so it isn't part of a variant's state
+    append(state, createInfo.flags & ~DERIVATIVE_FLAGS);
+
+    append(state, createInfo.stageCount);
+    for(type::uint32 i = 0; i < createInfo.stageCount; ++i)
+    {
+        const VkPipelineShaderStageCreateInfo& stage = createInfo.pStages[i];
+        rejectExtensions(stage.pNext);
+        append(state, stage.flags);
+        append(state, stage.stage);
+        auto module = moduleHashes.find(stage.module);
+        if(module == moduleHashes.end())
+        {
+            throw std::runtime_error("Pipeline variant shader modules have to come from loadModule");
+        }
+        append(state, module->second);
+        appendArray(state, stage.pName, static_cast<type::uint32>(std::strlen(stage.pName)));
+        if(appendPresent(state, stage.pSpecializationInfo))
+        {
+            const VkSpecializationInfo& specialization = *stage.pSpecializationInfo;
+            appendArray(state, specialization.pMapEntries, specialization.mapEntryCount);
+            appendArray(state, static_cast<const type::uint8*>(specialization.pData),
+                    static_cast<type::uint32>(specialization.dataSize));
+        }
+    }
+
+    if(appendPresent(state, createInfo.pVertexInputState))
+    {
+        const VkPipelineVertexInputStateCreateInfo& vertexInput = *createInfo.pVertexInputState;
+        rejectExtensions(vertexInput.pNext);
+        append(state, vertexInput.flags);
+        appendArray(state, vertexInput.pVertexBindingDescriptions, vertexInput.vertexBindingDescriptionCount);
+        appendArray(state, vertexInput.pVertexAttributeDescriptions, vertexInput.vertexAttributeDescriptionCount);
+    }
+
+    if(appendPresent(state, createInfo.pInputAssemblyState))
+    {
+        const VkPipelineInputAssemblyStateCreateInfo& inputAssembly = *createInfo.pInputAssemblyState;
+        rejectExtensions(inputAssembly.pNext);
+        append(state, inputAssembly.flags);
+        append(state, inputAssembly.topology);
+        append(state, inputAssembly.primitiveRestartEnable);
+    }
+
+    if(appendPresent(state, createInfo.pTessellationState))
+    {
+        const VkPipelineTessellationStateCreateInfo& tessellation = *createInfo.pTessellationState;
+        rejectExtensions(tessellation.pNext);
+        append(state, tessellation.flags);
+        append(state, tessellation.patchControlPoints);
+    }
+
+    if(appendPresent(state, createInfo.pViewportState))
+    {
+        const VkPipelineViewportStateCreateInfo& viewport = *createInfo.pViewportState;
+        rejectExtensions(viewport.pNext);
+        append(state, viewport.flags);
+        // Null with dynamic viewports and scissors, and then only the counts matter
+        appendArray(state, viewport.pViewports, viewport.viewportCount);
+        appendArray(state, viewport.pScissors, viewport.scissorCount);
+    }
+
+    if(appendPresent(state, createInfo.pRasterizationState))
+    {
+        const VkPipelineRasterizationStateCreateInfo& rasterizer = *createInfo.pRasterizationState;
+        rejectExtensions(rasterizer.pNext);
+        append(state, rasterizer.flags);
+        append(state, rasterizer.depthClampEnable);
+        append(state, rasterizer.rasterizerDiscardEnable);
+        append(state, rasterizer.polygonMode);
+        append(state, rasterizer.cullMode);
+        append(state, rasterizer.frontFace);
+        append(state, rasterizer.depthBiasEnable);
+        append(state, rasterizer.depthBiasConstantFactor);
+        append(state, rasterizer.depthBiasClamp);
+        append(state, rasterizer.depthBiasSlopeFactor);
+        append(state, rasterizer.lineWidth);
+    }
+
+    if(appendPresent(state, createInfo.pMultisampleState))
+    {
+        const VkPipelineMultisampleStateCreateInfo& multisampling = *createInfo.pMultisampleState;
+        rejectExtensions(multisampling.pNext);
+        append(state, multisampling.flags);
+        append(state, multisampling.rasterizationSamples);
+        append(state, multisampling.sampleShadingEnable);
+        append(state, multisampling.minSampleShading);
+        // One mask word per 32 samples
+        appendArray(state, multisampling.pSampleMask, (static_cast<type::uint32>(multisampling.rasterizationSamples) + 31) / 32);
+        append(state, multisampling.alphaToCoverageEnable);
+        append(state, multisampling.alphaToOneEnable);
+    }
+
+    if(appendPresent(state, createInfo.pDepthStencilState))
+    {
+        const VkPipelineDepthStencilStateCreateInfo& depthStencil = *createInfo.pDepthStencilState;
+        rejectExtensions(depthStencil.pNext);
+        append(state, depthStencil.flags);
+        append(state, depthStencil.depthTestEnable);
+        append(state, depthStencil.depthWriteEnable);
+        append(state, depthStencil.depthCompareOp);
+        append(state, depthStencil.depthBoundsTestEnable);
+        append(state, depthStencil.stencilTestEnable);
+        append(state, depthStencil.front);
+        append(state, depthStencil.back);
+        append(state, depthStencil.minDepthBounds);
+        append(state, depthStencil.maxDepthBounds);
+    }
+
+    if(appendPresent(state, createInfo.pColorBlendState))
+    {
+        const VkPipelineColorBlendStateCreateInfo& colorBlending = *createInfo.pColorBlendState;
+        rejectExtensions(colorBlending.pNext);
+        append(state, colorBlending.flags);
+        append(state, colorBlending.logicOpEnable);
+        append(state, colorBlending.logicOp);
+        appendArray(state, colorBlending.pAttachments, colorBlending.attachmentCount);
+        append(state, colorBlending.blendConstants);
+    }
+
+    if(appendPresent(state, createInfo.pDynamicState))
+    {
+        const VkPipelineDynamicStateCreateInfo& dynamicState = *createInfo.pDynamicState;
+        rejectExtensions(dynamicState.pNext);
+        append(state, dynamicState.flags);
+        appendArray(state, dynamicState.pDynamicStates, dynamicState.dynamicStateCount);
+    }
+
+    append(state, createInfo.layout);
+    append(state, createInfo.renderPass);
+    append(state, createInfo.subpass);
+}
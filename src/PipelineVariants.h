@@ -0,0 +1,95 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_PIPELINEVARIANTS_H
+#define VULKANTUTORIAL_PIPELINEVARIANTS_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+#include "DeletionQueue.h"
+
+/**
+ * Graphics pipelines that differ in a few details, created as derivatives of one base pipeline
+ *
+ * Feature toggles are specialization constants, so each variant has the
+ * features it doesn't use compiled out instead of branching on them at
+ * runtime. The first pipeline asked for becomes the base, created with
+ * ALLOW_DERIVATIVES, and every later one is created as its derivative. All of
+ * them go through one pipeline cache so the driver can reuse what it already
+ * compiled for the others.
+ *
+ * Every create info is flattened into a byte string holding its whole state,
+ * specialization data included, and pipelines are looked up by its hash. Asking
+ * for the same state twice hands back the pipeline made the first time.
+ * Extension structs in pNext chains aren't part of the state and are rejected.
+ *
+ * Shader stages are part of the state through a hash of their SPIR-V, not their
+ * module handle, since the handle of a destroyed module can come back for a
+ * module with different code. Their modules have to come from loadModule.
+ */
+class PipelineVariants
+{
+public:
+    // Values for the specialization constants of one shader stage
+    class Specialization
+    {
+    public:
+        // Bools in the shader are VkBool32, so 0 or 1
+        auto set(type::uint32 constantId, type::uint32 value) -> Specialization&;
+        auto set(type::uint32 constantId, float value) -> Specialization&;
+        // Points into this object, so it has to stay alive until the pipeline is created. Null if nothing was set
+        auto getInfo() -> const VkSpecializationInfo*;
+
+    private:
+        std::vector<VkSpecializationMapEntry> entries;
+        std::vector<type::uint8> data;
+        VkSpecializationInfo info = {};
+
+        auto set(type::uint32 constantId, const void* value, type::size size) -> void;
+    };
+
+    auto init(VkDevice device) -> void;
+    // Destroys whatever wasn't retired. The GPU has to be idle
+    auto cleanup() -> void;
+
+    // Shader module that get knows the code of. Throws if the file can't be read
+    auto loadModule(const std::string& fileName) -> VkShaderModule;
+    // Once no more pipelines will be made from it
+    auto destroyModule(VkShaderModule module) -> void;
+
+    // Pipeline with exactly this state, created on a miss. The base and derivative fields of
+        // the create info are ignored, they're filled in here
+    auto get(const VkGraphicsPipelineCreateInfo& createInfo) -> VkPipeline;
+    // Forget every pipeline, handing them to the deletion queue. The next one asked for becomes the new base
+    auto retire(DeletionQueue& deletionQueue) -> void;
+
+    inline auto getBase() const -> VkPipeline { return base; }
+    inline auto getVariantCount() const -> type::size { return variantCount; }
+
+private:
+    struct Variant
+    {
+        std::vector<type::uint8> state;
+        VkPipeline pipeline;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    VkPipeline base = VK_NULL_HANDLE;
+    // Variants bucketed by the hash of their state. Buckets only hold more than one on a collision
+    std::unordered_map<type::uint64, std::vector<Variant>> variants;
+    type::size variantCount = 0;
+    // SPIR-V hash of every module from loadModule that's still alive
+    std::unordered_map<VkShaderModule, type::uint64> moduleHashes;
+
+    // Append everything that affects the created pipeline
+    auto flatten(const VkGraphicsPipelineCreateInfo& createInfo, std::vector<type::uint8>& state) const -> void;
+};
+
+#endif //VULKANTUTORIAL_PIPELINEVARIANTS_H
@@ -0,0 +1,1216 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <stdexcept>
+#include "RenderGraph.h"
+#include "Hash.h"
+
+namespace
+{
+    // Only writes need to be made available, so read bits are dropped from source access masks
+    constexpr VkAccessFlags WRITE_ACCESS_MASK =
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+            | VK_ACCESS_SHADER_WRITE_BIT
+            | VK_ACCESS_TRANSFER_WRITE_BIT;
+}
+
+/**
+ * Pass Builder
+ */
+auto RenderGraph::PassBuilder::writeColor(ResourceHandle image, std::optional<VkClearColorValue> clear) -> void
+{
+    std::optional<VkClearValue> clearValue;
+    if(clear)
+    {
+        VkClearValue value = {};
+        value.color = clear.value();
+        clearValue = value;
+    }
+    graph.addAccess(pass, {image, AccessType::ColorWrite, 0, clearValue, 0});
+}
+
+auto RenderGraph::PassBuilder::writeDepth(ResourceHandle image, std::optional<VkClearDepthStencilValue> clear) -> void
+{
+    std::optional<VkClearValue> clearValue;
+    if(clear)
+    {
+        VkClearValue value = {};
+        value.depthStencil = clear.value();
+        clearValue = value;
+    }
+    graph.addAccess(pass, {image, AccessType::DepthWrite, 0, clearValue, 0});
+}
+
+auto RenderGraph::PassBuilder::readDepth(ResourceHandle image) -> void
+{
+    graph.addAccess(pass, {image, AccessType::DepthRead, 0, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::resolve(ResourceHandle source, ResourceHandle target) -> void
+{
+    graph.addAccess(pass, {target, AccessType::ResolveWrite, 0, std::nullopt, source});
+}
+
+auto RenderGraph::PassBuilder::readInputAttachment(ResourceHandle image) -> void
+{
+    graph.addAccess(pass, {image, AccessType::InputAttachmentRead, 0, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::sample(ResourceHandle image, VkPipelineStageFlags stages) -> void
+{
+    graph.addAccess(pass, {image, AccessType::SampledRead, stages, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::readStorage(ResourceHandle image, VkPipelineStageFlags stages) -> void
+{
+    graph.addAccess(pass, {image, AccessType::StorageRead, stages, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::writeStorage(ResourceHandle image, VkPipelineStageFlags stages) -> void
+{
+    graph.addAccess(pass, {image, AccessType::StorageWrite, stages, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::copyFrom(ResourceHandle image) -> void
+{
+    graph.addAccess(pass, {image, AccessType::TransferRead, 0, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::copyTo(ResourceHandle image) -> void
+{
+    graph.addAccess(pass, {image, AccessType::TransferWrite, 0, std::nullopt, 0});
+}
+
+auto RenderGraph::PassBuilder::keepAlive() -> void
+{
+    graph.passes[pass].keepAlive = true;
+}
+
+/**
+ * Graph Declaration
+ */
+auto RenderGraph::init(VkDevice device, MemoryTracker& memoryTracker, DeletionQueue& deletionQueue) -> void
+{
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->deletionQueue = &deletionQueue;
+}
+
+auto RenderGraph::setCommandPool(VkCommandPool commandPool, type::uint32 framesInFlight) -> void
+{
+    this->commandPool = commandPool;
+    this->framesInFlight = framesInFlight;
+}
+
+auto RenderGraph::importImage(const std::string& name, ImageDesc desc, std::vector<VkImage> images,
+                              std::vector<VkImageView> views, VkImageLayout finalLayout) -> ResourceHandle
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.finalLayout = finalLayout;
+    resource.images = std::move(images);
+    resource.views = std::move(views);
+    resources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+auto RenderGraph::createImage(const std::string& name, ImageDesc desc) -> ResourceHandle
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = false;
+    resource.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+auto RenderGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, RecordFunc record) -> PassHandle
+{
+    Pass pass = {};
+    pass.name = name;
+    pass.record = std::move(record);
+    passes.push_back(std::move(pass));
+
+    PassHandle handle = static_cast<PassHandle>(passes.size() - 1);
+    PassBuilder builder(*this, handle);
+    setup(builder);
+    return handle;
+}
+
+auto RenderGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, std::vector<Segment> segments) -> PassHandle
+{
+    PassHandle handle = addPass(name, setup, RecordFunc());
+    for(auto& segment : segments)
+    {
+        passes[handle].segments.push_back({std::move(segment), {}});
+    }
+    return handle;
+}
+
+auto RenderGraph::addAccess(PassHandle pass, Access access) -> void
+{
+    if(access.resource >= resources.size())
+    {
+        throw std::runtime_error("Render graph pass '" + passes[pass].name + "' uses an unknown resource");
+    }
+    passes[pass].accesses.push_back(access);
+}
+
+auto RenderGraph::describe(const Access& access) -> AccessInfo
+{
+    switch(access.type)
+    {
+        case AccessType::ColorWrite:
+            return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true};
+        case AccessType::DepthWrite:
+            return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true};
+        case AccessType::DepthRead:
+            return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, true};
+        case AccessType::ResolveWrite:
+            return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true};
+        case AccessType::InputAttachmentRead:
+            return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                    VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, false, true};
+        case AccessType::SampledRead:
+            return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, access.stages, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_USAGE_SAMPLED_BIT, false, false};
+        case AccessType::StorageRead:
+            return {VK_IMAGE_LAYOUT_GENERAL, access.stages, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_USAGE_STORAGE_BIT, false, false};
+        case AccessType::StorageWrite:
+            return {VK_IMAGE_LAYOUT_GENERAL, access.stages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_IMAGE_USAGE_STORAGE_BIT, true, false};
+        case AccessType::TransferRead:
+            return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, false};
+        case AccessType::TransferWrite:
+            return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, false};
+    }
+    throw std::runtime_error("Unknown render graph access type");
+}
+
+auto RenderGraph::needsPreviousContents(const Access& access) -> bool
+{
+    switch(access.type)
+    {
+        // Cleared attachments and resolve targets are overwritten entirely
+        case AccessType::ColorWrite:
+        case AccessType::DepthWrite:
+            return !access.clear.has_value();
+        case AccessType::ResolveWrite:
+            return false;
+        // Storage and transfer writes might only touch part of the image
+        default:
+            return true;
+    }
+}
+
+auto RenderGraph::hasStencil(VkFormat format) -> bool
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT
+           || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_S8_UINT;
+}
+
+/**
+ * Compilation
+ */
+auto RenderGraph::compile() -> void
+{
+    cullPasses();
+    buildGroups();
+    createImages();
+    buildBarriers();
+    for(auto& group : groups)
+    {
+        if(group.raster)
+        {
+            buildRenderPass(group);
+        }
+    }
+}
+
+auto RenderGraph::cullPasses() -> void
+{
+    // Walk backwards from the imported images, which are what leaves the graph.
+        // A pass survives if it writes something a surviving pass (or the outside world) needs
+    std::vector<bool> needed(resources.size(), false);
+    for(type::size i = 0; i < resources.size(); ++i)
+    {
+        needed[i] = resources[i].imported;
+    }
+
+    for(type::size p = passes.size(); p-- > 0;)
+    {
+        Pass& pass = passes[p];
+        pass.live = pass.keepAlive || std::any_of(pass.accesses.begin(), pass.accesses.end(),
+                [&](const Access& access) { return describe(access).write && needed[access.resource]; });
+        if(!pass.live) continue;
+
+        // A write that replaces the whole image ends the lifetime of whatever was there before
+        for(const auto& access : pass.accesses)
+        {
+            if(describe(access).write && !needsPreviousContents(access))
+            {
+                needed[access.resource] = false;
+            }
+        }
+        for(const auto& access : pass.accesses)
+        {
+            if(needsPreviousContents(access))
+            {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+auto RenderGraph::buildGroups() -> void
+{
+    groups.clear();
+    for(PassHandle p = 0; p < passes.size(); ++p)
+    {
+        Pass& pass = passes[p];
+        if(!pass.live) continue;
+
+        bool raster = false;
+        VkExtent2D extent = {0, 0};
+        for(const auto& access : pass.accesses)
+        {
+            if(!describe(access).attachment) continue;
+            VkExtent2D attachmentExtent = resources[access.resource].desc.extent;
+            if(raster && (attachmentExtent.width != extent.width || attachmentExtent.height != extent.height))
+            {
+                throw std::runtime_error("Render graph pass '" + pass.name + "' has attachments of different sizes");
+            }
+            raster = true;
+            extent = attachmentExtent;
+        }
+
+        // Merge into the previous render pass if it renders to the same area and nothing in
+            // this pass needs a pipeline barrier against something written in that render pass
+        bool merge = false;
+        if(raster && !groups.empty() && groups.back().raster
+           && groups.back().extent.width == extent.width && groups.back().extent.height == extent.height)
+        {
+            merge = true;
+            for(const auto& access : pass.accesses)
+            {
+                bool attachment = describe(access).attachment;
+                for(PassHandle other : groups.back().passes)
+                {
+                    for(const auto& otherAccess : passes[other].accesses)
+                    {
+                        if(otherAccess.resource == access.resource && (!attachment || !describe(otherAccess).attachment))
+                        {
+                            merge = false;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(!merge)
+        {
+            Group group = {};
+            group.raster = raster;
+            group.extent = extent;
+            groups.push_back(std::move(group));
+        }
+        pass.group = groups.size() - 1;
+        pass.subpass = static_cast<type::uint32>(groups.back().passes.size());
+        groups.back().passes.push_back(p);
+    }
+}
+
+auto RenderGraph::createImages() -> void
+{
+    variantCount = 1;
+    for(auto& resource : resources)
+    {
+        resource.usage = 0;
+        if(resource.imported)
+        {
+            variantCount = std::max(variantCount, static_cast<type::uint32>(resource.images.size()));
+        }
+
+        bool depth = resource.desc.format == VK_FORMAT_D16_UNORM || resource.desc.format == VK_FORMAT_D32_SFLOAT
+                     || resource.desc.format == VK_FORMAT_X8_D24_UNORM_PACK32 || hasStencil(resource.desc.format);
+        resource.aspect = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
+    // Usage and lifetime of every resource, in group order
+    std::vector<bool> used(resources.size(), false);
+    for(type::size g = 0; g < groups.size(); ++g)
+    {
+        for(PassHandle p : groups[g].passes)
+        {
+            for(const auto& access : passes[p].accesses)
+            {
+                Resource& resource = resources[access.resource];
+                AccessInfo info = describe(access);
+                resource.usage |= info.usage;
+                if(!used[access.resource])
+                {
+                    resource.firstGroup = g;
+                    resource.waitStages = 0;
+                    resource.waitAccess = 0;
+                }
+                resource.lastGroup = g;
+                // Everything that touches the image this frame has to be done before the next frame reuses it
+                resource.waitStages |= info.stages;
+                resource.waitAccess |= info.access & WRITE_ACCESS_MASK;
+                used[access.resource] = true;
+            }
+        }
+    }
+
+    /* Create Images */
+    std::vector<VkMemoryRequirements> memReqs(resources.size());
+    std::vector<ResourceHandle> aliasable;
+    for(ResourceHandle r = 0; r < resources.size(); ++r)
+    {
+        Resource& resource = resources[r];
+        if(resource.imported)
+        {
+            // The swap chain acquire semaphore is waited on at the color attachment output stage
+            resource.waitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            resource.waitAccess = 0;
+            continue;
+        }
+        // Nothing live touches it, so there is no need for the image at all
+        if(!used[r]) continue;
+
+        // Attachments that only live inside a single render pass never need to reach memory
+        constexpr VkImageUsageFlags transientUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        bool transient = resource.firstGroup == resource.lastGroup && (resource.usage & ~transientUsage) == 0;
+        if(transient)
+        {
+            resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.usage;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkImage image;
+        if(vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Render graph image '" + resource.name + "' creation failed");
+        }
+        resource.images = {image};
+        vkGetImageMemoryRequirements(device, image, &memReqs[r]);
+
+        // Lazily allocated memory gets its own allocation, which on tilers is never actually backed
+        std::optional<type::uint32> lazyType;
+        if(transient)
+        {
+            lazyType = memoryTracker->findMemoryType(memReqs[r].memoryTypeBits,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        }
+        if(lazyType)
+        {
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = memReqs[r].size;
+            allocInfo.memoryTypeIndex = lazyType.value();
+            if(memoryTracker->allocate(allocInfo, MemoryTracker::Category::RenderTarget, resource.dedicatedMemory) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Render graph image '" + resource.name + "' memory allocation failed");
+            }
+            vkBindImageMemory(device, image, resource.dedicatedMemory, 0);
+        }
+        else
+        {
+            aliasable.push_back(r);
+        }
+    }
+
+    /* Alias Memory */
+    // Biggest images first, each one going into the first block that is free
+        // for its whole lifetime and has a compatible memory type
+    std::sort(aliasable.begin(), aliasable.end(), [&memReqs](ResourceHandle a, ResourceHandle b)
+    {
+        return memReqs[a].size > memReqs[b].size;
+    });
+
+    memoryBlocks.clear();
+    for(ResourceHandle r : aliasable)
+    {
+        Resource& resource = resources[r];
+        std::optional<type::size> chosen;
+        for(type::size b = 0; b < memoryBlocks.size() && !chosen; ++b)
+        {
+            MemoryBlock& block = memoryBlocks[b];
+            type::uint32 sharedTypes = block.memoryTypeBits & memReqs[r].memoryTypeBits;
+            if(!memoryTracker->findMemoryType(sharedTypes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) continue;
+
+            bool overlaps = std::any_of(block.resources.begin(), block.resources.end(), [&](ResourceHandle other)
+            {
+                return resources[other].firstGroup <= resource.lastGroup && resource.firstGroup <= resources[other].lastGroup;
+            });
+            if(!overlaps)
+            {
+                chosen = b;
+            }
+        }
+
+        if(!chosen)
+        {
+            memoryBlocks.emplace_back();
+            chosen = memoryBlocks.size() - 1;
+        }
+
+        MemoryBlock& block = memoryBlocks[chosen.value()];
+        block.size = std::max(block.size, memReqs[r].size);
+        block.memoryTypeBits &= memReqs[r].memoryTypeBits;
+        block.resources.push_back(r);
+        resource.memoryBlock = chosen;
+    }
+
+    for(auto& block : memoryBlocks)
+    {
+        std::optional<type::uint32> memoryType = memoryTracker->findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = memoryType.value();
+        if(memoryTracker->allocate(allocInfo, MemoryTracker::Category::RenderTarget, block.memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Render graph memory block allocation failed");
+        }
+
+        // Every image sharing the block has to wait on all of the others from the previous frame,
+            // and on the ones that used the memory earlier in this frame
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        for(ResourceHandle r : block.resources)
+        {
+            stages |= resources[r].waitStages;
+            access |= resources[r].waitAccess;
+        }
+        for(ResourceHandle r : block.resources)
+        {
+            resources[r].waitStages = stages;
+            resources[r].waitAccess = access;
+            // All images in a block start at the beginning of it
+            vkBindImageMemory(device, resources[r].images[0], block.memory, 0);
+        }
+    }
+
+    /* Create Views */
+    for(auto& resource : resources)
+    {
+        if(resource.imported || resource.images.empty()) continue;
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.images[0];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.desc.format;
+        viewInfo.components.r =
+        viewInfo.components.g =
+        viewInfo.components.b =
+        viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.subresourceRange.aspectMask = resource.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if(vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Render graph image view '" + resource.name + "' creation failed");
+        }
+        resource.views = {view};
+    }
+}
+
+auto RenderGraph::buildBarriers() -> void
+{
+    // Replay every access in execution order, tracking what each image last went through.
+        // Attachment accesses inside a render pass become subpass dependencies, everything
+        // else becomes a pipeline barrier issued before the group, but only when it conflicts
+    struct State
+    {
+        VkImageLayout layout;
+        // Stages and access of the last write, or of the previous frame at the start
+        VkPipelineStageFlags writeStages;
+        VkAccessFlags writeAccess;
+        // Stages that have read the image since the last write
+        VkPipelineStageFlags readStages;
+    };
+
+    std::vector<State> states(resources.size());
+    for(type::size r = 0; r < resources.size(); ++r)
+    {
+        // Graph images don't keep their contents between frames
+        states[r] = {VK_IMAGE_LAYOUT_UNDEFINED, resources[r].waitStages, resources[r].waitAccess, 0};
+    }
+
+    auto addDependency = [](Group& group, type::uint32 src, type::uint32 dst, VkPipelineStageFlags srcStages,
+                            VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        if(srcStages == 0)
+        {
+            srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        for(auto& dependency : group.dependencies)
+        {
+            if(dependency.srcSubpass == src && dependency.dstSubpass == dst)
+            {
+                dependency.srcStageMask |= srcStages;
+                dependency.srcAccessMask |= srcAccess;
+                dependency.dstStageMask |= dstStages;
+                dependency.dstAccessMask |= dstAccess;
+                return;
+            }
+        }
+        VkSubpassDependency dependency = {};
+        dependency.srcSubpass = src;
+        dependency.dstSubpass = dst;
+        dependency.srcStageMask = srcStages;
+        dependency.srcAccessMask = srcAccess;
+        dependency.dstStageMask = dstStages;
+        dependency.dstAccessMask = dstAccess;
+        // Between subpasses every pixel only depends on the same pixel
+        dependency.dependencyFlags = src == VK_SUBPASS_EXTERNAL ? 0 : VK_DEPENDENCY_BY_REGION_BIT;
+        group.dependencies.push_back(dependency);
+    };
+
+    for(auto& group : groups)
+    {
+        group.barriers.clear();
+        group.dependencies.clear();
+        group.entryLayouts.clear();
+        // Last subpass of this group that touched each attachment
+        std::vector<std::optional<std::pair<type::uint32, AccessInfo>>> lastInGroup(resources.size());
+
+        for(PassHandle p : group.passes)
+        {
+            type::uint32 subpass = passes[p].subpass;
+            for(const auto& access : passes[p].accesses)
+            {
+                AccessInfo info = describe(access);
+                State& state = states[access.resource];
+                bool layoutChange = state.layout != info.layout;
+
+                if(group.raster && info.attachment)
+                {
+                    auto& previous = lastInGroup[access.resource];
+                    if(previous)
+                    {
+                        const AccessInfo& prevInfo = previous->second;
+                        if(prevInfo.write || info.write || prevInfo.layout != info.layout)
+                        {
+                            addDependency(group, previous->first, subpass, prevInfo.stages,
+                                    prevInfo.access & WRITE_ACCESS_MASK, info.stages, info.access);
+                        }
+                    }
+                    else
+                    {
+                        // First use in this render pass, the render pass transitions it from here
+                        group.entryLayouts.push_back({access.resource, state.layout});
+                        VkPipelineStageFlags srcStages = state.writeStages;
+                        if(info.write || layoutChange)
+                        {
+                            srcStages |= state.readStages;
+                        }
+                        addDependency(group, VK_SUBPASS_EXTERNAL, subpass, srcStages, state.writeAccess,
+                                info.stages, info.access);
+                    }
+                    previous = std::make_pair(subpass, info);
+                }
+                else
+                {
+                    // Reads in the same layout only need a barrier if their stages haven't
+                        // already been made to wait on the last write
+                    bool needed = info.write || layoutChange || (info.stages & ~state.readStages) != 0;
+                    if(needed)
+                    {
+                        Barrier barrier = {};
+                        barrier.resource = access.resource;
+                        barrier.oldLayout = state.layout;
+                        barrier.newLayout = info.layout;
+                        barrier.srcStages = state.writeStages | ((info.write || layoutChange) ? state.readStages : 0);
+                        barrier.srcAccess = state.writeAccess;
+                        barrier.dstStages = info.stages;
+                        barrier.dstAccess = info.access;
+                        group.barriers.push_back(barrier);
+                    }
+                }
+
+                if(info.write)
+                {
+                    state.writeStages = info.stages;
+                    state.writeAccess = info.access & WRITE_ACCESS_MASK;
+                    state.readStages = 0;
+                }
+                else if(layoutChange)
+                {
+                    // The transition acts as a write that later readers have to chain off of
+                    state.writeStages |= info.stages;
+                    state.readStages = info.stages;
+                }
+                else
+                {
+                    state.readStages |= info.stages;
+                }
+                state.layout = info.layout;
+            }
+        }
+    }
+
+    // Hand imported images back in the layout they were asked to end up in
+    finalBarriers.clear();
+    for(ResourceHandle r = 0; r < resources.size(); ++r)
+    {
+        const Resource& resource = resources[r];
+        const State& state = states[r];
+        if(!resource.imported || state.layout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+
+        // Render passes already transition attachments into their final layout
+        bool lastUseIsAttachment = false;
+        for(const auto& group : groups)
+        {
+            for(PassHandle p : group.passes)
+            {
+                for(const auto& access : passes[p].accesses)
+                {
+                    if(access.resource == r)
+                    {
+                        lastUseIsAttachment = group.raster && describe(access).attachment;
+                    }
+                }
+            }
+        }
+
+        if(!lastUseIsAttachment && state.layout != resource.finalLayout)
+        {
+            finalBarriers.push_back({r, state.layout, resource.finalLayout, state.writeStages | state.readStages,
+                                     state.writeAccess, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0});
+        }
+    }
+}
+
+auto RenderGraph::buildRenderPass(Group& group) -> void
+{
+    type::size groupIndex = static_cast<type::size>(&group - groups.data());
+
+    // Attachments in order of first use
+    std::vector<ResourceHandle> attachmentResources;
+    std::vector<type::uint32> attachmentIndex(resources.size(), VK_ATTACHMENT_UNUSED);
+    for(PassHandle p : group.passes)
+    {
+        for(const auto& access : passes[p].accesses)
+        {
+            if(describe(access).attachment && attachmentIndex[access.resource] == VK_ATTACHMENT_UNUSED)
+            {
+                attachmentIndex[access.resource] = static_cast<type::uint32>(attachmentResources.size());
+                attachmentResources.push_back(access.resource);
+            }
+        }
+    }
+
+    /* Attachment Descriptions */
+    std::vector<VkAttachmentDescription> attachments(attachmentResources.size());
+    group.clearValues.assign(attachmentResources.size(), VkClearValue{});
+    for(type::size a = 0; a < attachmentResources.size(); ++a)
+    {
+        ResourceHandle r = attachmentResources[a];
+        const Resource& resource = resources[r];
+
+        // First and last access of this attachment in the group
+        const Access* first = nullptr;
+        const Access* last = nullptr;
+        for(PassHandle p : group.passes)
+        {
+            for(const auto& access : passes[p].accesses)
+            {
+                if(access.resource != r) continue;
+                if(!first) first = &access;
+                last = &access;
+            }
+        }
+
+        VkImageLayout entryLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        for(const auto& [entryResource, layout] : group.entryLayouts)
+        {
+            if(entryResource == r) entryLayout = layout;
+        }
+
+        bool usedBefore = resource.firstGroup < groupIndex;
+        bool usedAfter = resource.lastGroup > groupIndex;
+
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        if(first->clear)
+        {
+            loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            group.clearValues[a] = first->clear.value();
+        }
+        else if(usedBefore && needsPreviousContents(*first))
+        {
+            loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        }
+        // Only write back what someone is going to look at
+        VkAttachmentStoreOp storeOp = (usedAfter || resource.imported)
+                ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+        VkAttachmentDescription& description = attachments[a];
+        description.format = resource.desc.format;
+        description.samples = resource.desc.samples;
+        description.loadOp = loadOp;
+        description.storeOp = storeOp;
+        description.stencilLoadOp = hasStencil(resource.desc.format) ? loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = hasStencil(resource.desc.format) ? storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // Contents that are about to be replaced don't need a real transition
+        description.initialLayout = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? entryLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+        description.finalLayout = (resource.imported && !usedAfter) ? resource.finalLayout : describe(*last).layout;
+    }
+
+    /* Subpasses */
+    struct SubpassRefs
+    {
+        std::vector<VkAttachmentReference> colors;
+        std::vector<VkAttachmentReference> resolves;
+        std::vector<VkAttachmentReference> inputs;
+        std::vector<type::uint32> preserves;
+        std::optional<VkAttachmentReference> depth;
+        bool hasResolve = false;
+    };
+    std::vector<SubpassRefs> refs(group.passes.size());
+
+    for(type::size s = 0; s < group.passes.size(); ++s)
+    {
+        const Pass& pass = passes[group.passes[s]];
+        SubpassRefs& subpassRefs = refs[s];
+        std::vector<ResourceHandle> colorResources;
+        for(const auto& access : pass.accesses)
+        {
+            VkAttachmentReference ref = {attachmentIndex[access.resource], describe(access).layout};
+            switch(access.type)
+            {
+                case AccessType::ColorWrite:
+                    subpassRefs.colors.push_back(ref);
+                    subpassRefs.resolves.push_back({VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+                    colorResources.push_back(access.resource);
+                    break;
+                case AccessType::DepthWrite:
+                case AccessType::DepthRead:
+                    subpassRefs.depth = ref;
+                    break;
+                case AccessType::InputAttachmentRead:
+                    subpassRefs.inputs.push_back(ref);
+                    break;
+                default:
+                    break;
+            }
+        }
+        // Resolves line up with the color attachment they resolve
+        for(const auto& access : pass.accesses)
+        {
+            if(access.type != AccessType::ResolveWrite) continue;
+            auto it = std::find(colorResources.begin(), colorResources.end(), access.resolveSource);
+            if(it == colorResources.end())
+            {
+                throw std::runtime_error("Render graph pass '" + pass.name + "' resolves an image it doesn't write");
+            }
+            subpassRefs.resolves[it - colorResources.begin()] = {attachmentIndex[access.resource], describe(access).layout};
+            subpassRefs.hasResolve = true;
+        }
+    }
+
+    // Attachments skipped by a subpass between two that use them have to be preserved
+    for(type::size a = 0; a < attachmentResources.size(); ++a)
+    {
+        std::vector<bool> usedIn(group.passes.size(), false);
+        for(type::size s = 0; s < group.passes.size(); ++s)
+        {
+            for(const auto& access : passes[group.passes[s]].accesses)
+            {
+                if(access.resource == attachmentResources[a] && describe(access).attachment) usedIn[s] = true;
+            }
+        }
+        auto firstUse = std::find(usedIn.begin(), usedIn.end(), true) - usedIn.begin();
+        auto lastUse = usedIn.rend() - std::find(usedIn.rbegin(), usedIn.rend(), true) - 1;
+        for(auto s = firstUse + 1; s < lastUse; ++s)
+        {
+            if(!usedIn[s]) refs[s].preserves.push_back(static_cast<type::uint32>(a));
+        }
+    }
+
+    std::vector<VkSubpassDescription> subpasses(group.passes.size());
+    for(type::size s = 0; s < group.passes.size(); ++s)
+    {
+        VkSubpassDescription& subpass = subpasses[s];
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<type::uint32>(refs[s].colors.size());
+        subpass.pColorAttachments = refs[s].colors.data();
+        subpass.pResolveAttachments = refs[s].hasResolve ? refs[s].resolves.data() : nullptr;
+        subpass.inputAttachmentCount = static_cast<type::uint32>(refs[s].inputs.size());
+        subpass.pInputAttachments = refs[s].inputs.data();
+        subpass.pDepthStencilAttachment = refs[s].depth ? &refs[s].depth.value() : nullptr;
+        subpass.preserveAttachmentCount = static_cast<type::uint32>(refs[s].preserves.size());
+        subpass.pPreserveAttachments = refs[s].preserves.data();
+    }
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<type::uint32>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = static_cast<type::uint32>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<type::uint32>(group.dependencies.size());
+    renderPassInfo.pDependencies = group.dependencies.data();
+
+    if(vkCreateRenderPass(device, &renderPassInfo, nullptr, &group.renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Render graph render pass creation failed");
+    }
+
+    /* Framebuffers */
+    // Only groups touching an imported image need one framebuffer per variant
+    bool hasImported = std::any_of(attachmentResources.begin(), attachmentResources.end(),
+            [this](ResourceHandle r) { return resources[r].imported; });
+    type::uint32 framebufferCount = hasImported ? variantCount : 1;
+    group.framebuffers.resize(framebufferCount);
+
+    for(type::uint32 v = 0; v < framebufferCount; ++v)
+    {
+        std::vector<VkImageView> views;
+        views.reserve(attachmentResources.size());
+        for(ResourceHandle r : attachmentResources)
+        {
+            views.push_back(getImageView(r, v));
+        }
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = group.renderPass;
+        framebufferInfo.attachmentCount = static_cast<type::uint32>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = group.extent.width;
+        framebufferInfo.height = group.extent.height;
+        framebufferInfo.layers = 1;
+
+        if(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &group.framebuffers[v]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Render graph framebuffer creation failed");
+        }
+    }
+}
+
+/**
+ * Execution
+ */
+auto RenderGraph::barrierAspect(const Resource& resource) const -> VkImageAspectFlags
+{
+    // Barriers on combined depth/stencil images have to cover both aspects
+    if(hasStencil(resource.desc.format))
+    {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return resource.aspect;
+}
+
+auto RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers, type::uint32 variant) -> void
+{
+    if(barriers.empty()) return;
+
+    // Everything goes into a single barrier call
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(barriers.size());
+    for(const auto& barrier : barriers)
+    {
+        VkImageMemoryBarrier imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = getImage(barrier.resource, variant);
+        imageBarrier.subresourceRange.aspectMask = barrierAspect(resources[barrier.resource]);
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageBarrier);
+
+        srcStages |= barrier.srcStages;
+        dstStages |= barrier.dstStages;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+            srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages,
+            0, 0, nullptr, 0, nullptr,
+            static_cast<type::uint32>(imageBarriers.size()), imageBarriers.data());
+}
+
+auto RenderGraph::execute(VkCommandBuffer commandBuffer, type::uint32 variant) -> void
+{
+    ++executions;
+    for(const auto& group : groups)
+    {
+        recordBarriers(commandBuffer, group.barriers, variant);
+
+        if(!group.raster)
+        {
+            recordPass(commandBuffer, passes[group.passes.front()], VK_NULL_HANDLE, 0, VK_NULL_HANDLE, variant);
+            continue;
+        }
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = group.renderPass;
+        VkFramebuffer framebuffer = group.framebuffers[variant % group.framebuffers.size()];
+        renderPassInfo.framebuffer = framebuffer;
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = group.extent;
+        renderPassInfo.clearValueCount = static_cast<type::uint32>(group.clearValues.size());
+        renderPassInfo.pClearValues = group.clearValues.data();
+
+        // A subpass either records its commands inline or only executes secondary command buffers
+        auto contents = [this](PassHandle pass)
+        {
+            return passes[pass].segments.empty() ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+        };
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents(group.passes.front()));
+        for(type::size s = 0; s < group.passes.size(); ++s)
+        {
+            if(s > 0)
+            {
+                vkCmdNextSubpass(commandBuffer, contents(group.passes[s]));
+            }
+            recordPass(commandBuffer, passes[group.passes[s]], group.renderPass, static_cast<type::uint32>(s), framebuffer, variant);
+        }
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    recordBarriers(commandBuffer, finalBarriers, variant);
+}
+
+auto RenderGraph::recordPass(VkCommandBuffer commandBuffer, Pass& pass, VkRenderPass renderPass, type::uint32 subpass,
+                             VkFramebuffer framebuffer, type::uint32 variant) -> void
+{
+    if(pass.segments.empty())
+    {
+        pass.record(commandBuffer, variant);
+        return;
+    }
+
+    std::vector<VkCommandBuffer> secondaries;
+    secondaries.reserve(pass.segments.size());
+    for(auto& cached : pass.segments)
+    {
+        secondaries.push_back(recordSegment(cached, renderPass, subpass, framebuffer, variant));
+    }
+    vkCmdExecuteCommands(commandBuffer, static_cast<type::uint32>(secondaries.size()), secondaries.data());
+}
+
+auto RenderGraph::recordSegment(CachedSegment& cached, VkRenderPass renderPass, type::uint32 subpass,
+                                VkFramebuffer framebuffer, type::uint32 variant) -> VkCommandBuffer
+{
+    if(commandPool == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("Passes made of segments need a command pool to record into");
+    }
+    // Room to keep a recording for every variant, on top of the ones frames in flight may still be executing
+    if(cached.recordings.empty())
+    {
+        cached.recordings.resize(framesInFlight + variantCount);
+    }
+
+    std::optional<type::uint64> key;
+    if(cached.segment.key)
+    {
+        // Recordings also depend on the render pass instance they were made for
+        type::uint64 fullKey = hash::combine(cached.segment.key(variant), variant);
+        fullKey = hash::combine(fullKey, renderPass);
+        fullKey = hash::combine(fullKey, subpass);
+        key = hash::combine(fullKey, framebuffer);
+        for(auto& recording : cached.recordings)
+        {
+            if(recording.key == key)
+            {
+                recording.lastUsed = executions;
+                return recording.commandBuffer;
+            }
+        }
+    }
+
+    // Only the frames in flight before this one can still be executing a recording, and each of them
+        // used at most one. There are more recordings than that, so the least recently used one is free
+    Recording& recording = *std::min_element(cached.recordings.begin(), cached.recordings.end(),
+            [](const Recording& a, const Recording& b) { return a.lastUsed < b.lastUsed; });
+    if(recording.commandBuffer == VK_NULL_HANDLE)
+    {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(device, &allocateInfo, &recording.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Secondary command buffer allocation failed");
+        }
+    }
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = subpass;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // Replayed by later frames while earlier ones may still be executing it
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    if(renderPass != VK_NULL_HANDLE)
+    {
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // Beginning resets the buffer, since the pool allows it
+    if(vkBeginCommandBuffer(recording.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Secondary command buffer recording failed to start");
+    }
+    cached.segment.record(recording.commandBuffer, variant);
+    if(vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Secondary command buffer recording failed");
+    }
+
+    // Segments without a key never match, so they're recorded every time
+    recording.key = key;
+    recording.lastUsed = executions;
+    return recording.commandBuffer;
+}
+
+auto RenderGraph::reset() -> void
+{
+    // Frames in flight may still be executing the recordings
+    std::vector<VkCommandBuffer> recorded;
+    for(auto& pass : passes)
+    {
+        for(auto& cached : pass.segments)
+        {
+            for(auto& recording : cached.recordings)
+            {
+                if(recording.commandBuffer != VK_NULL_HANDLE)
+                {
+                    recorded.push_back(recording.commandBuffer);
+                }
+            }
+        }
+    }
+    if(!recorded.empty())
+    {
+        VkDevice device = this->device;
+        VkCommandPool commandPool = this->commandPool;
+        deletionQueue->retire([device, commandPool, recorded]()
+        {
+            vkFreeCommandBuffers(device, commandPool, static_cast<type::uint32>(recorded.size()), recorded.data());
+        });
+    }
+
+    for(auto& group : groups)
+    {
+        for(VkFramebuffer framebuffer : group.framebuffers)
+        {
+            deletionQueue->destroyFramebuffer(framebuffer);
+        }
+        deletionQueue->destroyRenderPass(group.renderPass);
+    }
+
+    for(auto& resource : resources)
+    {
+        // Imported images belong to someone else
+        if(resource.imported) continue;
+        for(VkImageView view : resource.views)
+        {
+            deletionQueue->destroyImageView(view);
+        }
+        for(VkImage image : resource.images)
+        {
+            deletionQueue->destroyImage(image);
+        }
+        deletionQueue->freeMemory(resource.dedicatedMemory);
+    }
+
+    for(auto& block : memoryBlocks)
+    {
+        deletionQueue->freeMemory(block.memory);
+    }
+
+    groups.clear();
+    memoryBlocks.clear();
+    finalBarriers.clear();
+    resources.clear();
+    passes.clear();
+    variantCount = 1;
+}
+
+/**
+ * Queries
+ */
+auto RenderGraph::isCulled(PassHandle pass) const -> bool
+{
+    return !passes[pass].live;
+}
+
+auto RenderGraph::getRenderPass(PassHandle pass) const -> VkRenderPass
+{
+    return groups[passes[pass].group].renderPass;
+}
+
+auto RenderGraph::getSubpass(PassHandle pass) const -> type::uint32
+{
+    return passes[pass].subpass;
+}
+
+auto RenderGraph::getImage(ResourceHandle resource, type::uint32 variant) const -> VkImage
+{
+    const auto& images = resources[resource].images;
+    return images.empty() ? VK_NULL_HANDLE : images[variant % images.size()];
+}
+
+auto RenderGraph::getImageView(ResourceHandle resource, type::uint32 variant) const -> VkImageView
+{
+    const auto& views = resources[resource].views;
+    return views.empty() ? VK_NULL_HANDLE : views[variant % views.size()];
+}
@@ -0,0 +1,282 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_RENDERGRAPH_H
+#define VULKANTUTORIAL_RENDERGRAPH_H
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+
+/**
+ * Describes a frame as a list of passes and the images they read and write
+ *
+ * compile() works out everything that would otherwise be written by hand:
+ *  - passes whose results are never used are culled
+ *  - consecutive raster passes with matching extents are merged into subpasses
+ *    of a single render pass, with load/store ops and subpass dependencies
+ *    derived from how each attachment is used before and after
+ *  - layout transitions and pipeline barriers are inserted only where an
+ *    access actually conflicts with the previous one
+ *  - transient images whose lifetimes don't overlap share memory
+ *
+ * Images owned by the graph don't keep their contents between frames.
+ * Imported images (like the swap chain) can have one variant per swap chain
+ * image, picked when the graph is executed.
+ *
+ * Passes can be split into segments that are recorded into secondary command
+ * buffers. A segment with a key is only recorded again when its key changes,
+ * otherwise the last recording with that key is replayed, so passes that draw
+ * the same thing frame after frame cost next to nothing to record.
+ */
+class RenderGraph
+{
+public:
+    using ResourceHandle = type::uint32;
+    using PassHandle = type::uint32;
+    // Records the pass. Gets the variant index the graph is executed with
+    using RecordFunc = std::function<void(VkCommandBuffer commandBuffer, type::uint32 variant)>;
+    // Sums up everything a segment's recording depends on. Gets the same variant index
+    using KeyFunc = std::function<type::uint64(type::uint32 variant)>;
+
+    // Part of a pass, recorded into a secondary command buffer of its own. Segments without a
+        // key are recorded again every time
+    struct Segment
+    {
+        RecordFunc record;
+        KeyFunc key;
+    };
+
+    struct ImageDesc
+    {
+        VkFormat format;
+        VkExtent2D extent;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    };
+
+    enum class AccessType
+    {
+        ColorWrite,
+        DepthWrite,
+        DepthRead,
+        ResolveWrite,
+        InputAttachmentRead,
+        SampledRead,
+        StorageRead,
+        StorageWrite,
+        TransferRead,
+        TransferWrite
+    };
+
+    // Declares what a pass touches. Handed to the setup function given to addPass
+    class PassBuilder
+    {
+    public:
+        // Attachments
+        auto writeColor(ResourceHandle image, std::optional<VkClearColorValue> clear = std::nullopt) -> void;
+        auto writeDepth(ResourceHandle image, std::optional<VkClearDepthStencilValue> clear = std::nullopt) -> void;
+        auto readDepth(ResourceHandle image) -> void;
+        // Resolve a multisampled color attachment of this pass into target at the end of the subpass
+        auto resolve(ResourceHandle source, ResourceHandle target) -> void;
+        auto readInputAttachment(ResourceHandle image) -> void;
+        // Shader and transfer accesses. These get pipeline barriers instead of subpass dependencies
+        auto sample(ResourceHandle image, VkPipelineStageFlags stages) -> void;
+        auto readStorage(ResourceHandle image, VkPipelineStageFlags stages) -> void;
+        auto writeStorage(ResourceHandle image, VkPipelineStageFlags stages) -> void;
+        auto copyFrom(ResourceHandle image) -> void;
+        auto copyTo(ResourceHandle image) -> void;
+        // Keep the pass even if nothing in the graph uses what it writes
+        auto keepAlive() -> void;
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, PassHandle pass) : graph(graph), pass(pass) {}
+        RenderGraph& graph;
+        PassHandle pass;
+    };
+
+    // Graph images are counted as render targets in the memory tracker. What compile creates
+        // goes through the deletion queue when the graph is reset
+    auto init(VkDevice device, MemoryTracker& memoryTracker, DeletionQueue& deletionQueue) -> void;
+    // Pool the secondary command buffers of segmented passes come from. It has to allow resetting buffers one
+        // by one, and is kept through reset. Recordings are never overwritten while a frame in flight may use them
+    auto setCommandPool(VkCommandPool commandPool, type::uint32 framesInFlight) -> void;
+
+    // Bring in images owned elsewhere. Contents are discarded on first use and the
+        // image is left in finalLayout. The first access waits on the color attachment
+        // output stage, which is where the swap chain acquire semaphore is waited on
+    auto importImage(const std::string& name, ImageDesc desc, std::vector<VkImage> images,
+                     std::vector<VkImageView> views, VkImageLayout finalLayout) -> ResourceHandle;
+    // Image owned by the graph. Usage and memory are worked out in compile
+    auto createImage(const std::string& name, ImageDesc desc) -> ResourceHandle;
+    auto addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, RecordFunc record) -> PassHandle;
+    // Pass recorded through secondary command buffers, executed in order
+    auto addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, std::vector<Segment> segments) -> PassHandle;
+
+    auto compile() -> void;
+    // Has to be called once per frame, since recordings are kept from being overwritten by counting the calls
+    auto execute(VkCommandBuffer commandBuffer, type::uint32 variant) -> void;
+    // Retire everything created by compile and forget all passes and resources. Frames
+        // already submitted can keep executing the old graph
+    auto reset() -> void;
+
+    // Only valid after compile
+    auto isCulled(PassHandle pass) const -> bool;
+    auto getRenderPass(PassHandle pass) const -> VkRenderPass;
+    auto getSubpass(PassHandle pass) const -> type::uint32;
+    auto getImage(ResourceHandle resource, type::uint32 variant = 0) const -> VkImage;
+    auto getImageView(ResourceHandle resource, type::uint32 variant = 0) const -> VkImageView;
+
+private:
+    // Layout, stages and access mask an access needs
+    struct AccessInfo
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageUsageFlags usage;
+        bool write;
+        bool attachment;
+    };
+
+    struct Access
+    {
+        ResourceHandle resource;
+        AccessType type;
+        VkPipelineStageFlags stages;
+        std::optional<VkClearValue> clear;
+        // Only for ResolveWrite, the color attachment being resolved
+        ResourceHandle resolveSource;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        ImageDesc desc;
+        bool imported;
+        VkImageLayout finalLayout;
+        std::vector<VkImage> images;
+        std::vector<VkImageView> views;
+        // Filled in by compile
+        VkImageUsageFlags usage = 0;
+        VkImageAspectFlags aspect = 0;
+        VkDeviceMemory dedicatedMemory = VK_NULL_HANDLE;
+        // Index into memoryBlocks when the image shares memory with others
+        std::optional<type::size> memoryBlock;
+        type::size firstGroup = 0;
+        type::size lastGroup = 0;
+        // Scope the first access of a frame has to wait for
+        VkPipelineStageFlags waitStages = 0;
+        VkAccessFlags waitAccess = 0;
+    };
+
+    struct Recording
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::optional<type::uint64> key;
+        // Execution it was last used in. The oldest gets recorded over first
+        type::uint64 lastUsed = 0;
+    };
+
+    struct CachedSegment
+    {
+        Segment segment;
+        std::vector<Recording> recordings;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::vector<Access> accesses;
+        RecordFunc record;
+        // Recorded through these instead of record when there are any
+        std::vector<CachedSegment> segments;
+        bool keepAlive = false;
+        // Filled in by compile
+        bool live = false;
+        type::size group = 0;
+        type::uint32 subpass = 0;
+    };
+
+    struct Barrier
+    {
+        ResourceHandle resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkPipelineStageFlags srcStages;
+        VkAccessFlags srcAccess;
+        VkPipelineStageFlags dstStages;
+        VkAccessFlags dstAccess;
+    };
+
+    // One render pass worth of merged passes, or a single pass recorded outside a render pass
+    struct Group
+    {
+        std::vector<PassHandle> passes;
+        bool raster = false;
+        VkExtent2D extent = {0, 0};
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        // One framebuffer per variant of the imported images
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkClearValue> clearValues;
+        // Issued before the group starts
+        std::vector<Barrier> barriers;
+        std::vector<VkSubpassDependency> dependencies;
+        // Layout each attachment is in when the render pass begins
+        std::vector<std::pair<ResourceHandle, VkImageLayout>> entryLayouts;
+    };
+
+    // Memory shared by images whose lifetimes don't overlap
+    struct MemoryBlock
+    {
+        VkDeviceSize size = 0;
+        type::uint32 memoryTypeBits = ~0u;
+        std::vector<ResourceHandle> resources;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Group> groups;
+    std::vector<MemoryBlock> memoryBlocks;
+    // Transitions imported images into their final layout after the last group
+    std::vector<Barrier> finalBarriers;
+    type::uint32 variantCount = 1;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    type::uint32 framesInFlight = 1;
+    type::uint64 executions = 0;
+
+    static auto describe(const Access& access) -> AccessInfo;
+    static auto needsPreviousContents(const Access& access) -> bool;
+    static auto hasStencil(VkFormat format) -> bool;
+    auto addAccess(PassHandle pass, Access access) -> void;
+
+    auto cullPasses() -> void;
+    auto buildGroups() -> void;
+    auto createImages() -> void;
+    auto buildRenderPass(Group& group) -> void;
+    auto buildBarriers() -> void;
+    auto barrierAspect(const Resource& resource) const -> VkImageAspectFlags;
+    auto recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers, type::uint32 variant) -> void;
+    // Record a pass into the given command buffer, either directly or by executing its segments
+    auto recordPass(VkCommandBuffer commandBuffer, Pass& pass, VkRenderPass renderPass, type::uint32 subpass,
+                    VkFramebuffer framebuffer, type::uint32 variant) -> void;
+    // Recording of the segment for this key, made now if there isn't one
+    auto recordSegment(CachedSegment& cached, VkRenderPass renderPass, type::uint32 subpass,
+                       VkFramebuffer framebuffer, type::uint32 variant) -> VkCommandBuffer;
+};
+
+#endif //VULKANTUTORIAL_RENDERGRAPH_H
@@ -0,0 +1,335 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "Simd.h"
+
+namespace
+{
+    /**
+     * Column major 4x4 matrix held in registers while it's being computed
+     *
+     * Stores come in two flavors: regular ones for the CPU side copy, and
+     * non-temporal ones for mapped GPU memory, which skip the cache since the
+     * CPU never reads the matrices back from there.
+     */
+#if defined(SIMD_AVX2)
+    // Two columns per register
+    struct Mat4 { __m256 c01, c23; };
+    constexpr std::uintptr_t STREAM_ALIGNMENT = 32;
+
+    inline auto multiply(const float* a, const float* b) -> Mat4
+    {
+        // Column k of a in both halves, so one register produces two result columns
+        __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+        __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+        __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+        __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+        auto columns = [&](__m256 b) -> __m256
+        {
+            // Splat each element of a column of b across its half
+            __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, 0x00));
+            r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(b, b, 0x55)));
+            r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(b, b, 0xAA)));
+            return _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(b, b, 0xFF)));
+        };
+        return {columns(_mm256_loadu_ps(b)), columns(_mm256_loadu_ps(b + 8))};
+    }
+    inline auto store(float* p, const Mat4& m) -> void { _mm256_storeu_ps(p, m.c01); _mm256_storeu_ps(p + 8, m.c23); }
+    inline auto stream(float* p, const Mat4& m) -> void { _mm256_stream_ps(p, m.c01); _mm256_stream_ps(p + 8, m.c23); }
+    inline auto streamFence() -> void { _mm_sfence(); }
+#elif defined(SIMD_SSE2)
+    struct Mat4 { __m128 c[4]; };
+    constexpr std::uintptr_t STREAM_ALIGNMENT = 16;
+
+    inline auto multiply(const float* a, const float* b) -> Mat4
+    {
+        __m128 a0 = _mm_loadu_ps(a);
+        __m128 a1 = _mm_loadu_ps(a + 4);
+        __m128 a2 = _mm_loadu_ps(a + 8);
+        __m128 a3 = _mm_loadu_ps(a + 12);
+        Mat4 m;
+        for(int j = 0; j < 4; ++j)
+        {
+            // Column j of the result is a's columns weighted by column j of b
+            __m128 bj = _mm_loadu_ps(b + j * 4);
+            __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(1, 1, 1, 1))));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(2, 2, 2, 2))));
+            m.c[j] = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(3, 3, 3, 3))));
+        }
+        return m;
+    }
+    inline auto store(float* p, const Mat4& m) -> void
+    {
+        for(int j = 0; j < 4; ++j)
+        {
+            _mm_storeu_ps(p + j * 4, m.c[j]);
+        }
+    }
+    inline auto stream(float* p, const Mat4& m) -> void
+    {
+        for(int j = 0; j < 4; ++j)
+        {
+            _mm_stream_ps(p + j * 4, m.c[j]);
+        }
+    }
+    inline auto streamFence() -> void { _mm_sfence(); }
+#else
+    struct Mat4 { float m[16]; };
+    constexpr std::uintptr_t STREAM_ALIGNMENT = 1;
+
+    inline auto multiply(const float* a, const float* b) -> Mat4
+    {
+        Mat4 r;
+        for(int j = 0; j < 4; ++j)
+        {
+            for(int i = 0; i < 4; ++i)
+            {
+                r.m[j * 4 + i] = a[i] * b[j * 4] + a[4 + i] * b[j * 4 + 1] + a[8 + i] * b[j * 4 + 2] + a[12 + i] * b[j * 4 + 3];
+            }
+        }
+        return r;
+    }
+    inline auto store(float* p, const Mat4& m) -> void { std::memcpy(p, m.m, sizeof(m.m)); }
+    inline auto stream(float* p, const Mat4& m) -> void { std::memcpy(p, m.m, sizeof(m.m)); }
+    inline auto streamFence() -> void {}
+#endif
+
+    inline auto floats(glm::mat4& m) -> float* { return &m[0][0]; }
+    inline auto floats(const glm::mat4& m) -> const float* { return &m[0][0]; }
+
+    // Below this many changed nodes, sorting them into levels and waking workers costs more than it saves
+    constexpr type::size PARALLEL_THRESHOLD = 4096;
+    // Nodes per job. A few hundred matrix products are enough to make the job overhead disappear
+    constexpr type::uint32 PARALLEL_CHUNK = 512;
+}
+
+auto SceneGraph::reserve(type::size nodeCount) -> void
+{
+    parents.reserve(nodeCount);
+    locals.reserve(nodeCount);
+    worlds.reserve(nodeCount);
+    dirty.reserve(nodeCount);
+    depths.reserve(nodeCount);
+}
+
+auto SceneGraph::createNode(NodeHandle parent) -> NodeHandle
+{
+    return createNode(parent, glm::mat4(1.0f));
+}
+
+auto SceneGraph::createNode(NodeHandle parent, const glm::mat4& local) -> NodeHandle
+{
+    if(parent != NO_PARENT && parent >= parents.size())
+    {
+        throw std::runtime_error("Scene node parented to a node that doesn't exist");
+    }
+
+    auto node = static_cast<NodeHandle>(parents.size());
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    dirty.push_back(0);
+    depths.push_back(parent == NO_PARENT ? 0 : depths[parent] + 1);
+    // Targets haven't seen the node yet, so it has to go out with the next update either way
+    markDirty(node);
+    return node;
+}
+
+auto SceneGraph::setLocal(NodeHandle node, const glm::mat4& local) -> void
+{
+    locals[node] = local;
+    markDirty(node);
+}
+
+auto SceneGraph::markDirty(NodeHandle node) -> void
+{
+    dirty[node] = 1;
+    if(firstDirty == NONE_DIRTY || node < firstDirty)
+    {
+        firstDirty = node;
+    }
+}
+
+auto SceneGraph::setTargetCount(type::uint32 count) -> void
+{
+    targets.clear();
+    targets.resize(count);
+}
+
+auto SceneGraph::update(type::uint32 target, glm::mat4* targetWorlds) -> void
+{
+    Target& current = targets.at(target);
+    auto nodeCount = static_cast<NodeHandle>(parents.size());
+    // A target getting a full copy below doesn't need the recomputed matrices written twice
+    bool writeDirect = !current.full;
+    bool streamable = reinterpret_cast<std::uintptr_t>(targetWorlds) % STREAM_ALIGNMENT == 0;
+
+    changed.clear();
+    if(firstDirty != NONE_DIRTY)
+    {
+        // Parents come first, so by the time a node is reached its parent's dirty flag is final
+        for(NodeHandle i = firstDirty; i < nodeCount; ++i)
+        {
+            if(!dirty[i])
+            {
+                NodeHandle parent = parents[i];
+                if(parent == NO_PARENT || !dirty[parent])
+                {
+                    continue;
+                }
+                dirty[i] = 1;
+            }
+            changed.push_back(i);
+        }
+
+        glm::mat4* direct = writeDirect ? targetWorlds : nullptr;
+        if(jobSystem && changed.size() >= PARALLEL_THRESHOLD)
+        {
+            computeWorldsParallel(direct, streamable);
+        }
+        else
+        {
+            // Already in parent before child order
+            computeWorlds(changed.data(), changed.size(), direct, streamable);
+        }
+
+        for(NodeHandle node : changed)
+        {
+            dirty[node] = 0;
+        }
+        firstDirty = NONE_DIRTY;
+    }
+
+    // Catch the target up on what changed while the other targets were being updated
+    if(current.full)
+    {
+        std::memcpy(targetWorlds, worlds.data(), worlds.size() * sizeof(glm::mat4));
+        current.full = false;
+    }
+    else
+    {
+        for(NodeHandle node : current.pending)
+        {
+            targetWorlds[node] = worlds[node];
+            current.queued[node] = 0;
+        }
+    }
+    current.pending.clear();
+
+    queueChanged(target);
+}
+
+auto SceneGraph::computeWorlds(const NodeHandle* nodes, type::size count, glm::mat4* targetWorlds, bool streamable) -> void
+{
+    for(type::size n = 0; n < count; ++n)
+    {
+        NodeHandle i = nodes[n];
+        NodeHandle parent = parents[i];
+        if(parent == NO_PARENT)
+        {
+            worlds[i] = locals[i];
+            if(targetWorlds)
+            {
+                targetWorlds[i] = locals[i];
+            }
+            continue;
+        }
+
+        Mat4 world = multiply(floats(worlds[parent]), floats(locals[i]));
+        store(floats(worlds[i]), world);
+        if(targetWorlds)
+        {
+            if(streamable)
+            {
+                stream(floats(targetWorlds[i]), world);
+            }
+            else
+            {
+                store(floats(targetWorlds[i]), world);
+            }
+        }
+    }
+    // Non-temporal stores are only ordered by a fence on the thread that made them
+    streamFence();
+}
+
+auto SceneGraph::computeWorldsParallel(glm::mat4* targetWorlds, bool streamable) -> void
+{
+    // Counting sort by depth. Stable, so each level stays in index order and is walked front to back
+    levelStarts.assign(1, 0);
+    for(NodeHandle node : changed)
+    {
+        type::uint32 depth = depths[node];
+        if(depth + 2 > levelStarts.size())
+        {
+            levelStarts.resize(depth + 2, 0);
+        }
+        ++levelStarts[depth + 1];
+    }
+    for(type::size level = 1; level < levelStarts.size(); ++level)
+    {
+        levelStarts[level] += levelStarts[level - 1];
+    }
+
+    levelOrder.resize(changed.size());
+    std::vector<type::uint32> cursor(levelStarts.begin(), levelStarts.end() - 1);
+    for(NodeHandle node : changed)
+    {
+        levelOrder[cursor[depths[node]]++] = node;
+    }
+
+    // Each level only reads the worlds of the level above, which parallelFor has finished by the time it returns
+    for(type::size level = 0; level + 1 < levelStarts.size(); ++level)
+    {
+        const NodeHandle* nodes = levelOrder.data() + levelStarts[level];
+        type::uint32 count = levelStarts[level + 1] - levelStarts[level];
+        jobSystem->parallelFor(count, PARALLEL_CHUNK, [&](type::uint32 first, type::uint32 last)
+        {
+            computeWorlds(nodes + first, last - first, targetWorlds, streamable);
+        });
+    }
+}
+
+auto SceneGraph::queueChanged(type::uint32 updatedTarget) -> void
+{
+    if(changed.empty())
+    {
+        return;
+    }
+
+    for(type::uint32 t = 0; t < targets.size(); ++t)
+    {
+        Target& other = targets[t];
+        if(t == updatedTarget || other.full)
+        {
+            continue;
+        }
+
+        other.queued.resize(parents.size(), 0);
+        for(NodeHandle node : changed)
+        {
+            if(!other.queued[node])
+            {
+                other.queued[node] = 1;
+                other.pending.push_back(node);
+            }
+        }
+
+        // Past this point a straight copy of everything is cheaper than the scattered writes
+        if(other.pending.size() > parents.size() / 4)
+        {
+            other.full = true;
+            other.pending.clear();
+            std::fill(other.queued.begin(), other.queued.end(), 0);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_SCENEGRAPH_H
+#define VULKANTUTORIAL_SCENEGRAPH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "types.h"
+
+class JobSystem;
+
+/**
+ * Transform hierarchy stored as parallel arrays, one entry per node
+ *
+ * A node can only be parented to a node that already exists, so parents always
+ * come before their children and the arrays stay topologically sorted. Updating
+ * is then a single forward pass: dirtiness is inherited from the parent, which
+ * has already been visited, and only dirty nodes get their world matrix
+ * recomputed. The pass starts at the first dirty node, so a mostly static scene
+ * costs next to nothing.
+ *
+ * World matrices are mirrored into any number of targets, usually a mapped GPU
+ * buffer per swap chain image. Each target remembers which nodes changed since
+ * it was last written, so it only receives those.
+ *
+ * With a job system set, big updates are spread across the workers one depth
+ * level at a time. Nodes on the same level never depend on each other, so each
+ * level is a plain parallel loop once the level above it is done.
+ */
+class SceneGraph
+{
+public:
+    using NodeHandle = type::uint32;
+    static constexpr NodeHandle NO_PARENT = type::uint32_max;
+
+    auto reserve(type::size nodeCount) -> void;
+    auto createNode(NodeHandle parent = NO_PARENT) -> NodeHandle;
+    auto createNode(NodeHandle parent, const glm::mat4& local) -> NodeHandle;
+    auto setLocal(NodeHandle node, const glm::mat4& local) -> void;
+
+    inline auto getLocal(NodeHandle node) const -> const glm::mat4& { return locals[node]; }
+    // As of the last update
+    inline auto getWorld(NodeHandle node) const -> const glm::mat4& { return worlds[node]; }
+    inline auto getParent(NodeHandle node) const -> NodeHandle { return parents[node]; }
+    inline auto getNodeCount() const -> type::size { return parents.size(); }
+    // Nodes recomputed by the last update
+    inline auto getUpdatedCount() const -> type::size { return changed.size(); }
+    inline auto getUpdated() const -> const std::vector<NodeHandle>& { return changed; }
+
+    // Forget all targets and start over with count of them, each needing a full write
+    auto setTargetCount(type::uint32 count) -> void;
+    // Recompute the dirty world matrices and bring the target's copy up to date. The target
+        // needs room for getNodeCount() matrices. Recomputed matrices are written straight
+        // into it, without ever being read back, so it can be write-combined GPU memory
+    auto update(type::uint32 target, glm::mat4* targetWorlds) -> void;
+
+    // Null to go back to updating on the calling thread. Updates have to be run from a worker
+    inline auto setJobSystem(JobSystem* jobs) -> void { jobSystem = jobs; }
+
+private:
+    static constexpr NodeHandle NONE_DIRTY = type::uint32_max;
+
+    struct Target
+    {
+        // Nodes that changed since this target was last written
+        std::vector<NodeHandle> pending;
+        // One flag per node, so nothing is queued twice
+        std::vector<type::uint8> queued;
+        // Rewrite everything instead. Set when too much changed for the list to be worth it
+        bool full = true;
+    };
+
+    std::vector<NodeHandle> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<type::uint8> dirty;
+    // Roots are 0
+    std::vector<type::uint32> depths;
+    // Lowest index with its dirty flag set, where the update pass starts
+    NodeHandle firstDirty = NONE_DIRTY;
+    // Nodes recomputed by the last update
+    std::vector<NodeHandle> changed;
+
+    std::vector<Target> targets;
+
+    JobSystem* jobSystem = nullptr;
+    // Changed nodes sorted by depth, and where each level starts in it
+    std::vector<NodeHandle> levelOrder;
+    std::vector<type::uint32> levelStarts;
+
+    auto markDirty(NodeHandle node) -> void;
+    // Queue the nodes just recomputed on every target except the one that already has them
+    auto queueChanged(type::uint32 updatedTarget) -> void;
+    // Compute the world matrices of the given nodes, whose parents have to be up to date already
+    auto computeWorlds(const NodeHandle* nodes, type::size count, glm::mat4* targetWorlds, bool streamable) -> void;
+    auto computeWorldsParallel(glm::mat4* targetWorlds, bool streamable) -> void;
+};
+
+#endif //VULKANTUTORIAL_SCENEGRAPH_H
@@ -0,0 +1,46 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <fstream>
+#include <stdexcept>
+#include "ShaderModule.h"
+
+auto shader::readFile(const std::string& fileName) -> std::vector<char>
+{
+    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+    if(!file.is_open())
+    {
+        throw std::runtime_error("Failed to open " + fileName);
+    }
+
+    std::vector<char> code(static_cast<type::size>(file.tellg()));
+    file.seekg(0);
+    if(!file.read(code.data(), static_cast<std::streamsize>(code.size())))
+    {
+        throw std::runtime_error("Failed to read " + fileName);
+    }
+    return code;
+}
+
+auto shader::createModule(VkDevice device, const std::vector<char>& code) -> VkShaderModule
+{
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    // Vector class already ensures data alignment requirements
+    createInfo.pCode = reinterpret_cast<const type::uint32*>(code.data());
+
+    VkShaderModule shaderModule;
+    if(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shader module");
+    }
+    return shaderModule;
+}
+
+auto shader::loadModule(VkDevice device, const std::string& fileName) -> VkShaderModule
+{
+    return createModule(device, readFile(fileName));
+}
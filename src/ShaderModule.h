@@ -0,0 +1,27 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_SHADERMODULE_H
+#define VULKANTUTORIAL_SHADERMODULE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Loading SPIR-V from disk into shader modules
+ */
+namespace shader
+{
+    // Whole file. Throws if it can't be read
+    auto readFile(const std::string& fileName) -> std::vector<char>;
+    auto createModule(VkDevice device, const std::vector<char>& code) -> VkShaderModule;
+    // Read the file and create a module from it
+    auto loadModule(VkDevice device, const std::string& fileName) -> VkShaderModule;
+}
+
+#endif //VULKANTUTORIAL_SHADERMODULE_H
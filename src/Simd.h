@@ -0,0 +1,20 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_SIMD_H
+#define VULKANTUTORIAL_SIMD_H
+
+// Which SIMD paths the build can use. x86-64 always has SSE2. AVX2 has to be turned
+    // on at compile time (-mavx2, /arch:AVX2, or ENABLE_AVX2 in CMake)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#endif //VULKANTUTORIAL_SIMD_H
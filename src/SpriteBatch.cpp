@@ -0,0 +1,564 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+#include "SpriteBatch.h"
+#include "DescriptorAllocator.h"
+#include "BindlessHeap.h"
+#include "JobSystem.h"
+#include "ShaderModule.h"
+
+namespace
+{
+    // Sprites per job when the vertex writes are split across workers
+    constexpr type::uint32 WRITE_CHUNK = 2048;
+}
+
+auto SpriteBatch::init(VkDevice device, MemoryTracker& memoryTracker, VkQueue queue, VkCommandPool commandPool,
+                       Config config, DescriptorSetCache* setCache, BindlessHeap* bindlessHeap) -> void
+{
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->config = config;
+    this->setCache = setCache;
+    this->bindlessHeap = bindlessHeap;
+
+    createLayouts();
+    createIndexBuffer(queue, commandPool);
+
+    frameBuffers.resize(config.framesInFlight);
+    for(auto& frame : frameBuffers)
+    {
+        createFrameBuffer(frame, config.initialCapacity);
+    }
+}
+
+auto SpriteBatch::cleanup() -> void
+{
+    destroyPipelines();
+
+    for(auto& frame : frameBuffers)
+    {
+        destroyFrameBuffer(frame);
+    }
+    frameBuffers.clear();
+
+    vkDestroyBuffer(device, indexBuffer, nullptr);
+    memoryTracker->free(indexBufferMemory);
+    indexBuffer = VK_NULL_HANDLE;
+    indexBufferMemory = VK_NULL_HANDLE;
+
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    pipelineLayout = VK_NULL_HANDLE;
+    if(setLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+        setLayout = VK_NULL_HANDLE;
+    }
+
+    textures.clear();
+    sprites.clear();
+    sortItems.clear();
+    runs.clear();
+}
+
+auto SpriteBatch::createPipelines(VkRenderPass renderPass, type::uint32 subpass, VkSampleCountFlagBits samples) -> void
+{
+    VkShaderModule vertShaderModule = shader::loadModule(device, "shaders/sprite.vert.spv");
+    VkShaderModule fragShaderModule = shader::loadModule(device, bindlessHeap ? "shaders/sprite_bindless.frag.spv" : "shaders/sprite.frag.spv");
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    auto bindingDesc = SpriteVertex::getBindingDescription();
+    auto attributeDescs = SpriteVertex::getAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<type::uint32>(attributeDescs.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescs.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are set when recording, so the pipelines don't depend on the extent
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    // Rotated and mirrored sprites flip their winding
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = samples;
+    multisampling.minSampleShading = 1.0f;
+
+    // Sprites go on top of whatever is in the pass, in the order they're sorted in
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_FALSE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+    depthStencil.maxDepthBounds = 1.0f;
+
+    // Indexed by BlendMode
+    std::array<VkPipelineColorBlendAttachmentState, 2> blendAttachments = {};
+    for(auto& attachment : blendAttachments)
+    {
+        attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        attachment.blendEnable = VK_TRUE;
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        attachment.colorBlendOp = VK_BLEND_OP_ADD;
+        attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+    blendAttachments[static_cast<type::size>(BlendMode::Alpha)].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachments[static_cast<type::size>(BlendMode::Additive)].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+
+    std::array<VkPipelineColorBlendStateCreateInfo, 2> colorBlending = {};
+    std::array<VkGraphicsPipelineCreateInfo, 2> pipelineInfos = {};
+    for(type::size i = 0; i < pipelineInfos.size(); ++i)
+    {
+        colorBlending[i].sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending[i].logicOpEnable = VK_FALSE;
+        colorBlending[i].attachmentCount = 1;
+        colorBlending[i].pAttachments = &blendAttachments[i];
+
+        pipelineInfos[i].sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfos[i].stageCount = 2;
+        pipelineInfos[i].pStages = shaderStages;
+        pipelineInfos[i].pVertexInputState = &vertexInputInfo;
+        pipelineInfos[i].pInputAssemblyState = &inputAssembly;
+        pipelineInfos[i].pViewportState = &viewportState;
+        pipelineInfos[i].pRasterizationState = &rasterizer;
+        pipelineInfos[i].pMultisampleState = &multisampling;
+        pipelineInfos[i].pDepthStencilState = &depthStencil;
+        pipelineInfos[i].pColorBlendState = &colorBlending[i];
+        pipelineInfos[i].pDynamicState = &dynamicState;
+        pipelineInfos[i].layout = pipelineLayout;
+        pipelineInfos[i].renderPass = renderPass;
+        pipelineInfos[i].subpass = subpass;
+        pipelineInfos[i].basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfos[i].basePipelineIndex = -1;
+    }
+
+    if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, static_cast<type::uint32>(pipelineInfos.size()),
+            pipelineInfos.data(), nullptr, pipelines.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Sprite pipeline creation failed");
+    }
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+}
+
+auto SpriteBatch::destroyPipelines() -> void
+{
+    for(auto& pipeline : pipelines)
+    {
+        if(pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(device, pipeline, nullptr);
+            pipeline = VK_NULL_HANDLE;
+        }
+    }
+}
+
+auto SpriteBatch::retirePipelines(DeletionQueue& deletionQueue) -> void
+{
+    for(auto& pipeline : pipelines)
+    {
+        deletionQueue.destroyPipeline(pipeline);
+        pipeline = VK_NULL_HANDLE;
+    }
+}
+
+auto SpriteBatch::setTexture(TextureId texture, VkImageView view, VkSampler sampler,
+                             type::uint32 bindlessIndex, type::uint32 samplerBindlessIndex) -> void
+{
+    if(texture >= textures.size())
+    {
+        textures.resize(static_cast<type::size>(texture) + 1);
+    }
+    TextureBinding& binding = textures[texture];
+    binding.view = view;
+    binding.sampler = sampler;
+    binding.bindlessIndices = (bindlessIndex & 0xFFFFFF) | (samplerBindlessIndex << 24);
+}
+
+/**
+ * Batching
+ */
+auto SpriteBatch::begin(type::uint32 frameIndex) -> void
+{
+    this->frameIndex = frameIndex;
+    sprites.clear();
+    sortItems.clear();
+    runs.clear();
+}
+
+auto SpriteBatch::draw(const Sprite& sprite, TextureId texture, BlendMode blend, type::uint8 layer) -> void
+{
+    if(texture >= textures.size())
+    {
+        throw std::runtime_error("Sprite drawn with a texture slot that was never set");
+    }
+
+    // Bindless sprites carry their texture in the vertices, so it doesn't need to split runs
+    type::uint32 key = makeKey(layer, blend, bindlessHeap ? 0 : texture);
+    sortItems.push_back((static_cast<type::uint64>(key) << 32) | static_cast<type::uint64>(sprites.size()));
+    sprites.push_back({sprite, texture});
+}
+
+auto SpriteBatch::end() -> void
+{
+    if(sprites.empty())
+    {
+        return;
+    }
+
+    sortByKey();
+
+    // The frame's fence has been waited on, so its buffer can be replaced
+    FrameBuffer& frame = frameBuffers[frameIndex];
+    if(sprites.size() > frame.capacity)
+    {
+        type::uint32 capacity = std::max(frame.capacity, 1u);
+        while(capacity < sprites.size())
+        {
+            capacity *= 2;
+        }
+        destroyFrameBuffer(frame);
+        createFrameBuffer(frame, capacity);
+    }
+
+    // Each range is written front to back without reading anything back, which is what
+        // write-combined memory wants
+    SpriteVertex* vertices = frame.mapped;
+    auto writeRange = [&](type::uint32 first, type::uint32 last)
+    {
+        for(type::uint32 i = first; i < last; ++i)
+        {
+            const QueuedSprite& queued = sprites[static_cast<type::uint32>(sortItems[i])];
+            writeQuad(vertices + i * 4, queued.sprite, textures[queued.texture].bindlessIndices);
+        }
+    };
+    auto count = static_cast<type::uint32>(sortItems.size());
+    if(jobSystem)
+    {
+        jobSystem->parallelFor(count, WRITE_CHUNK, writeRange);
+    }
+    else
+    {
+        writeRange(0, count);
+    }
+
+    // Only looks at the keys, so it's cheap enough to leave on this thread
+    for(type::uint32 i = 0; i < count; ++i)
+    {
+        type::uint32 key = static_cast<type::uint32>(sortItems[i] >> 32);
+        if(runs.empty() || runs.back().key != key || runs.back().quadCount == MAX_QUADS_PER_DRAW)
+        {
+            runs.push_back({key, i, 0});
+        }
+        ++runs.back().quadCount;
+    }
+}
+
+auto SpriteBatch::record(VkCommandBuffer commandBuffer, VkExtent2D extent) -> void
+{
+    if(runs.empty())
+    {
+        return;
+    }
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frameBuffers[frameIndex].buffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+    VkViewport viewport = {};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // Pixels to clip space. Vulkan's y axis already points down like the pixel rows do
+    Transform transform = {};
+    transform.scale = {2.0f / viewport.width, 2.0f / viewport.height};
+    transform.translate = {-1.0f, -1.0f};
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(transform), &transform);
+
+    if(bindlessHeap)
+    {
+        VkDescriptorSet heapSet = bindlessHeap->getSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &heapSet, 0, nullptr);
+    }
+
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkDescriptorSet boundSet = VK_NULL_HANDLE;
+    for(const auto& run : runs)
+    {
+        VkPipeline pipeline = pipelines[static_cast<type::size>(keyBlend(run.key))];
+        if(pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
+        if(!bindlessHeap)
+        {
+            // Looked up now rather than in end, so views swapped in after the sprites were queued are used
+            const TextureBinding& binding = textures[keyTexture(run.key)];
+            VkDescriptorSet set = setCache->getSet(setLayout,
+                    {DescriptorInfo::fromImage(binding.sampler, binding.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)});
+            if(set != boundSet)
+            {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &set, 0, nullptr);
+                boundSet = set;
+            }
+        }
+
+        // Every draw reads the same quad indices, offset to the run's first vertex
+        vkCmdDrawIndexed(commandBuffer, run.quadCount * 6, 1, 0, static_cast<type::int32>(run.firstQuad * 4), 0);
+    }
+}
+
+auto SpriteBatch::makeKey(type::uint8 layer, BlendMode blend, TextureId texture) -> type::uint32
+{
+    return (static_cast<type::uint32>(layer) << 24) | (static_cast<type::uint32>(blend) << 16) | texture;
+}
+
+auto SpriteBatch::sortByKey() -> void
+{
+    sortScratch.resize(sortItems.size());
+
+    // Items start out in submission order and every pass is stable, so sprites with
+        // the same key stay in the order they were drawn
+    for(type::uint32 shift = 32; shift < 64; shift += 8)
+    {
+        std::array<type::size, 256> offsets = {};
+        for(type::uint64 item : sortItems)
+        {
+            ++offsets[(item >> shift) & 0xFF];
+        }
+        // Every key has the same byte here, so the pass wouldn't move anything.
+            // Usually true for most of the bytes, since few layers and textures are in use
+        if(offsets[(sortItems[0] >> shift) & 0xFF] == sortItems.size())
+        {
+            continue;
+        }
+
+        type::size sum = 0;
+        for(auto& offset : offsets)
+        {
+            type::size count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for(type::uint64 item : sortItems)
+        {
+            sortScratch[offsets[(item >> shift) & 0xFF]++] = item;
+        }
+        sortItems.swap(sortScratch);
+    }
+}
+
+auto SpriteBatch::writeQuad(SpriteVertex* vertices, const Sprite& sprite, type::uint32 textureIndices) -> void
+{
+    // Half extents along the sprite's own axes
+    glm::vec2 half = sprite.size * 0.5f;
+    glm::vec2 axisX = {half.x, 0.0f};
+    glm::vec2 axisY = {0.0f, half.y};
+    if(sprite.rotation != 0.0f)
+    {
+        float c = std::cos(sprite.rotation);
+        float s = std::sin(sprite.rotation);
+        axisX = {c * half.x, s * half.x};
+        axisY = {-s * half.y, c * half.y};
+    }
+
+    type::uint32 color = glm::packUnorm4x8(sprite.color);
+    vertices[0] = {sprite.position - axisX - axisY, {sprite.uvMin.x, sprite.uvMin.y}, color, textureIndices};
+    vertices[1] = {sprite.position + axisX - axisY, {sprite.uvMax.x, sprite.uvMin.y}, color, textureIndices};
+    vertices[2] = {sprite.position + axisX + axisY, {sprite.uvMax.x, sprite.uvMax.y}, color, textureIndices};
+    vertices[3] = {sprite.position - axisX + axisY, {sprite.uvMin.x, sprite.uvMax.y}, color, textureIndices};
+}
+
+/**
+ * Resource Creation
+ */
+auto SpriteBatch::createFrameBuffer(FrameBuffer& frame, type::uint32 capacity) -> void
+{
+    // Device local memory the CPU can write to lets the GPU read the vertices without
+        // them crossing the bus every frame. Plain host memory is the fallback
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(capacity) * 4 * sizeof(SpriteVertex);
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    memoryTracker->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTracker::Category::Vertex, frame.buffer, frame.memory);
+
+    // Stays mapped for the buffer's whole life
+    void* data;
+    vkMapMemory(device, frame.memory, 0, VK_WHOLE_SIZE, 0, &data);
+    frame.mapped = static_cast<SpriteVertex*>(data);
+    frame.capacity = capacity;
+}
+
+auto SpriteBatch::destroyFrameBuffer(FrameBuffer& frame) -> void
+{
+    if(frame.buffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkUnmapMemory(device, frame.memory);
+    vkDestroyBuffer(device, frame.buffer, nullptr);
+    memoryTracker->free(frame.memory);
+    frame = {};
+}
+
+auto SpriteBatch::createIndexBuffer(VkQueue queue, VkCommandPool commandPool) -> void
+{
+    // Two triangles per quad, the same for every quad but offset by 4 vertices
+    std::vector<type::uint16> indices(MAX_QUADS_PER_DRAW * 6);
+    for(type::uint32 quad = 0; quad < MAX_QUADS_PER_DRAW; ++quad)
+    {
+        auto first = static_cast<type::uint16>(quad * 4);
+        type::uint16* quadIndices = &indices[quad * 6];
+        quadIndices[0] = first;
+        quadIndices[1] = first + 1;
+        quadIndices[2] = first + 2;
+        quadIndices[3] = first + 2;
+        quadIndices[4] = first + 3;
+        quadIndices[5] = first;
+    }
+    VkDeviceSize size = indices.size() * sizeof(type::uint16);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    VkMemoryPropertyFlags hostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    memoryTracker->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostFlags, MemoryTracker::Category::Staging,
+            stagingBuffer, stagingMemory);
+
+    void* data;
+    vkMapMemory(device, stagingMemory, 0, size, 0, &data);
+    memcpy(data, indices.data(), static_cast<type::size>(size));
+    vkUnmapMemory(device, stagingMemory);
+
+    memoryTracker->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTracker::Category::Index, indexBuffer, indexBufferMemory);
+
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkBufferCopy copyRegion = {};
+    copyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &copyRegion);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    // Only happens once at startup
+    vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    memoryTracker->free(stagingMemory);
+}
+
+auto SpriteBatch::createLayouts() -> void
+{
+    if(!bindlessHeap)
+    {
+        // A single texture per run, looked up through the set cache
+        VkDescriptorSetLayoutBinding samplerBinding = {};
+        samplerBinding.binding = 0;
+        samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerBinding.descriptorCount = 1;
+        samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &samplerBinding;
+
+        if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Sprite descriptor set layout creation failed");
+        }
+        setCache->registerLayout(setLayout, {samplerBinding});
+    }
+
+    VkDescriptorSetLayout layout = bindlessHeap ? bindlessHeap->getLayout() : setLayout;
+    VkPushConstantRange transformRange = {};
+    transformRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    transformRange.offset = 0;
+    transformRange.size = sizeof(Transform);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &layout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &transformRange;
+
+    if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Sprite pipeline layout creation failed");
+    }
+}
+
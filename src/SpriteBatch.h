@@ -0,0 +1,226 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_SPRITEBATCH_H
+#define VULKANTUTORIAL_SPRITEBATCH_H
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "types.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+
+class BindlessHeap;
+class DescriptorSetCache;
+class JobSystem;
+
+/**
+ * Corner of a sprite quad as it is written to the vertex buffer
+ */
+struct SpriteVertex
+{
+    // Framebuffer pixels, origin in the top left corner
+    glm::vec2 pos;
+    glm::vec2 texCoord;
+    // RGBA8, unpacked by the vertex fetch
+    type::uint32 color;
+    // Bindless texture index in the low 24 bits and sampler index in the high 8.
+        // Unused outside of bindless mode
+    type::uint32 textureIndices;
+
+    static auto getBindingDescription() -> VkVertexInputBindingDescription
+    {
+        VkVertexInputBindingDescription bindingDesc = {};
+        bindingDesc.binding = 0;
+        bindingDesc.stride = sizeof(SpriteVertex);
+        bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDesc;
+    }
+
+    static auto getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 4>
+    {
+        std::array<VkVertexInputAttributeDescription, 4> descs = {};
+        descs[0].binding = 0;
+        descs[0].location = 0;
+        descs[0].format = VK_FORMAT_R32G32_SFLOAT;
+        descs[0].offset = offsetof(SpriteVertex, pos);
+
+        descs[1].binding = 0;
+        descs[1].location = 1;
+        descs[1].format = VK_FORMAT_R32G32_SFLOAT;
+        descs[1].offset = offsetof(SpriteVertex, texCoord);
+
+        descs[2].binding = 0;
+        descs[2].location = 2;
+        descs[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+        descs[2].offset = offsetof(SpriteVertex, color);
+
+        descs[3].binding = 0;
+        descs[3].location = 3;
+        descs[3].format = VK_FORMAT_R32_UINT;
+        descs[3].offset = offsetof(SpriteVertex, textureIndices);
+        return descs;
+    }
+};
+
+/**
+ * Draws large numbers of textured 2D quads in as few draw calls as possible
+ *
+ * Sprites are queued between begin and end, then sorted by layer, blend mode and
+ * texture with a stable radix sort, so sprites sharing all three keep the order
+ * they were drawn in. The quads are written straight into a persistently mapped
+ * vertex buffer, one per frame in flight, and every run of sprites with the same
+ * key becomes a single indexed draw out of a static quad index buffer.
+ *
+ * In bindless mode the texture and sampler indices travel with each vertex, so
+ * sprites with different textures still share a draw and only layer and blend
+ * mode split runs.
+ */
+class SpriteBatch
+{
+public:
+    // Slot set up with setTexture. Kept small so it fits in the sort key
+    using TextureId = type::uint16;
+
+    enum class BlendMode : type::uint8
+    {
+        Alpha,
+        Additive
+    };
+
+    struct Sprite
+    {
+        // Center of the sprite in framebuffer pixels
+        glm::vec2 position;
+        glm::vec2 size;
+        glm::vec2 uvMin = {0.0f, 0.0f};
+        glm::vec2 uvMax = {1.0f, 1.0f};
+        glm::vec4 color = {1.0f, 1.0f, 1.0f, 1.0f};
+        // Radians, clockwise on screen
+        float rotation = 0.0f;
+    };
+
+    struct Config
+    {
+        type::uint32 framesInFlight = 2;
+        // Sprites each frame's vertex buffer starts out with room for. Buffers grow as needed
+        type::uint32 initialCapacity = 4096;
+    };
+
+    // Non-bindless sets come from the given cache. If a bindless heap is given, sprites
+        // pick their textures from it instead. The queue and pool are used for the initial upload
+    auto init(VkDevice device, MemoryTracker& memoryTracker, VkQueue queue, VkCommandPool commandPool,
+              Config config, DescriptorSetCache* setCache, BindlessHeap* bindlessHeap = nullptr) -> void;
+    auto cleanup() -> void;
+    // Pipelines depend on the render pass, so they're recreated with the swap chain
+    auto createPipelines(VkRenderPass renderPass, type::uint32 subpass, VkSampleCountFlagBits samples) -> void;
+    auto destroyPipelines() -> void;
+    // Same, but for when frames still in flight may be drawing with them
+    auto retirePipelines(DeletionQueue& deletionQueue) -> void;
+
+    // Point a texture slot at an image. Call again whenever the view changes
+    auto setTexture(TextureId texture, VkImageView view, VkSampler sampler,
+                    type::uint32 bindlessIndex, type::uint32 samplerBindlessIndex) -> void;
+
+    // Start queueing the sprites of a frame. The frame's fence must have been waited on
+    auto begin(type::uint32 frameIndex) -> void;
+    // Lower layers are drawn first
+    auto draw(const Sprite& sprite, TextureId texture, BlendMode blend = BlendMode::Alpha, type::uint8 layer = 0) -> void;
+    // Sort the queued sprites and write them to the frame's vertex buffer
+    auto end() -> void;
+    // Record the draws inside a render pass compatible with the one given to createPipelines
+    auto record(VkCommandBuffer commandBuffer, VkExtent2D extent) -> void;
+
+    // Spreads the vertex writes in end() across the workers. end() then has to be called from a worker
+    inline auto setJobSystem(JobSystem* jobs) -> void { jobSystem = jobs; }
+
+    inline auto getSpriteCount() const -> type::size { return sprites.size(); }
+    inline auto getDrawCount() const -> type::size { return runs.size(); }
+
+private:
+    // Quads one draw can address with 16 bit indices. Longer runs are split
+    static constexpr type::uint32 MAX_QUADS_PER_DRAW = 65536 / 4;
+
+    struct TextureBinding
+    {
+        VkImageView view = VK_NULL_HANDLE;
+        VkSampler sampler = VK_NULL_HANDLE;
+        type::uint32 bindlessIndices = 0;
+    };
+
+    struct QueuedSprite
+    {
+        Sprite sprite;
+        TextureId texture;
+    };
+
+    // Sprites sharing a key, drawn in one call
+    struct Run
+    {
+        type::uint32 key;
+        type::uint32 firstQuad;
+        type::uint32 quadCount;
+    };
+
+    // Persistently mapped vertex buffer for one frame in flight
+    struct FrameBuffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        SpriteVertex* mapped = nullptr;
+        type::uint32 capacity = 0;
+    };
+
+    // Maps pixels to clip space. Must match the push_constant block in sprite.vert
+    struct Transform
+    {
+        glm::vec2 scale;
+        glm::vec2 translate;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    Config config;
+    DescriptorSetCache* setCache = nullptr;
+    BindlessHeap* bindlessHeap = nullptr;
+    JobSystem* jobSystem = nullptr;
+
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    // One per blend mode
+    std::array<VkPipeline, 2> pipelines = {};
+
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+    std::vector<FrameBuffer> frameBuffers;
+    type::uint32 frameIndex = 0;
+
+    std::vector<TextureBinding> textures;
+    std::vector<QueuedSprite> sprites;
+    // (key << 32) | sprite index, and the scratch half of the radix sort
+    std::vector<type::uint64> sortItems;
+    std::vector<type::uint64> sortScratch;
+    std::vector<Run> runs;
+
+    static auto makeKey(type::uint8 layer, BlendMode blend, TextureId texture) -> type::uint32;
+    static inline auto keyBlend(type::uint32 key) -> BlendMode { return static_cast<BlendMode>((key >> 16) & 0xFF); }
+    static inline auto keyTexture(type::uint32 key) -> TextureId { return static_cast<TextureId>(key & 0xFFFF); }
+    // Stable LSD radix sort on the key half of the items, a byte at a time
+    auto sortByKey() -> void;
+    // Four corners of a sprite, in the order the quad indices expect
+    static auto writeQuad(SpriteVertex* vertices, const Sprite& sprite, type::uint32 textureIndices) -> void;
+
+    auto createFrameBuffer(FrameBuffer& frame, type::uint32 capacity) -> void;
+    auto destroyFrameBuffer(FrameBuffer& frame) -> void;
+    auto createIndexBuffer(VkQueue queue, VkCommandPool commandPool) -> void;
+    auto createLayouts() -> void;
+};
+
+#endif //VULKANTUTORIAL_SPRITEBATCH_H
@@ -0,0 +1,72 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_SPSCQUEUE_H
+#define VULKANTUTORIAL_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+
+#include "types.h"
+
+/**
+ * Fixed size lock free queue from one producer thread to one consumer thread
+ *
+ * A ring with a head only the consumer moves and a tail only the producer
+ * moves, each on its own cache line. Pushing into a full queue fails instead
+ * of waiting, so the producer never blocks on a slow consumer.
+ */
+template<typename T, type::uint32 Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Queue capacity has to be a power of two");
+
+public:
+    // Producer only. False if the queue is full
+    auto push(const T& value) -> bool
+    {
+        type::uint32 tail = this->tail.load(std::memory_order_relaxed);
+        if(tail - cachedHead == Capacity)
+        {
+            // Only go to the shared head once the stale copy says the queue is full
+            cachedHead = head.load(std::memory_order_acquire);
+            if(tail - cachedHead == Capacity)
+            {
+                return false;
+            }
+        }
+        slots[tail & (Capacity - 1)] = value;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False if the queue is empty
+    auto pop(T& value) -> bool
+    {
+        type::uint32 head = this->head.load(std::memory_order_relaxed);
+        if(head == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if(head == cachedTail)
+            {
+                return false;
+            }
+        }
+        value = slots[head & (Capacity - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots = {};
+    // Consumer side. Indices wrap around freely, only their difference matters
+    alignas(64) std::atomic<type::uint32> head = 0;
+    type::uint32 cachedTail = 0;
+    // Producer side
+    alignas(64) std::atomic<type::uint32> tail = 0;
+    type::uint32 cachedHead = 0;
+};
+
+#endif //VULKANTUTORIAL_SPSCQUEUE_H
@@ -0,0 +1,595 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include "TextureFormats.h"
+
+/**
+ * Format Information
+ */
+auto texformat::blockInfo(VkFormat format) -> std::optional<BlockInfo>
+{
+    switch(format)
+    {
+        case VK_FORMAT_R8_UNORM:
+            return BlockInfo{1, 1, 1};
+        case VK_FORMAT_R8G8_UNORM:
+            return BlockInfo{1, 1, 2};
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return BlockInfo{1, 1, 4};
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return BlockInfo{1, 1, 8};
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return BlockInfo{1, 1, 16};
+
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            return BlockInfo{4, 4, 8};
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+            return BlockInfo{4, 4, 16};
+
+        // Every ASTC block is 128 bits no matter its footprint
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return BlockInfo{4, 4, 16};
+        case VK_FORMAT_ASTC_5x4_UNORM_BLOCK: case VK_FORMAT_ASTC_5x4_SRGB_BLOCK: return BlockInfo{5, 4, 16};
+        case VK_FORMAT_ASTC_5x5_UNORM_BLOCK: case VK_FORMAT_ASTC_5x5_SRGB_BLOCK: return BlockInfo{5, 5, 16};
+        case VK_FORMAT_ASTC_6x5_UNORM_BLOCK: case VK_FORMAT_ASTC_6x5_SRGB_BLOCK: return BlockInfo{6, 5, 16};
+        case VK_FORMAT_ASTC_6x6_UNORM_BLOCK: case VK_FORMAT_ASTC_6x6_SRGB_BLOCK: return BlockInfo{6, 6, 16};
+        case VK_FORMAT_ASTC_8x5_UNORM_BLOCK: case VK_FORMAT_ASTC_8x5_SRGB_BLOCK: return BlockInfo{8, 5, 16};
+        case VK_FORMAT_ASTC_8x6_UNORM_BLOCK: case VK_FORMAT_ASTC_8x6_SRGB_BLOCK: return BlockInfo{8, 6, 16};
+        case VK_FORMAT_ASTC_8x8_UNORM_BLOCK: case VK_FORMAT_ASTC_8x8_SRGB_BLOCK: return BlockInfo{8, 8, 16};
+        case VK_FORMAT_ASTC_10x5_UNORM_BLOCK: case VK_FORMAT_ASTC_10x5_SRGB_BLOCK: return BlockInfo{10, 5, 16};
+        case VK_FORMAT_ASTC_10x6_UNORM_BLOCK: case VK_FORMAT_ASTC_10x6_SRGB_BLOCK: return BlockInfo{10, 6, 16};
+        case VK_FORMAT_ASTC_10x8_UNORM_BLOCK: case VK_FORMAT_ASTC_10x8_SRGB_BLOCK: return BlockInfo{10, 8, 16};
+        case VK_FORMAT_ASTC_10x10_UNORM_BLOCK: case VK_FORMAT_ASTC_10x10_SRGB_BLOCK: return BlockInfo{10, 10, 16};
+        case VK_FORMAT_ASTC_12x10_UNORM_BLOCK: case VK_FORMAT_ASTC_12x10_SRGB_BLOCK: return BlockInfo{12, 10, 16};
+        case VK_FORMAT_ASTC_12x12_UNORM_BLOCK: case VK_FORMAT_ASTC_12x12_SRGB_BLOCK: return BlockInfo{12, 12, 16};
+
+        default:
+            return std::nullopt;
+    }
+}
+
+auto texformat::isCompressed(VkFormat format) -> bool
+{
+    auto info = blockInfo(format);
+    return info && (info->blockWidth > 1 || info->blockHeight > 1);
+}
+
+auto texformat::isSrgb(VkFormat format) -> bool
+{
+    switch(format)
+    {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+auto texformat::imageSize(VkFormat format, type::uint32 width, type::uint32 height) -> VkDeviceSize
+{
+    auto info = blockInfo(format);
+    if(!info)
+    {
+        throw std::runtime_error("Unsupported texture format");
+    }
+    VkDeviceSize blocksX = (width + info->blockWidth - 1) / info->blockWidth;
+    VkDeviceSize blocksY = (height + info->blockHeight - 1) / info->blockHeight;
+    return blocksX * blocksY * info->bytesPerBlock;
+}
+
+/**
+ * Fallback Decoding
+ */
+namespace
+{
+    // Decoded 4x4 block, row major RGBA8
+    using Block = std::array<type::uint8, 4 * 4 * 4>;
+
+    inline auto clampByte(int value) -> type::uint8
+    {
+        return static_cast<type::uint8>(std::clamp(value, 0, 255));
+    }
+
+    inline auto readLE16(const type::uint8* src) -> type::uint32
+    {
+        return src[0] | (src[1] << 8);
+    }
+
+    inline auto readLE32(const type::uint8* src) -> type::uint32
+    {
+        return src[0] | (src[1] << 8) | (src[2] << 16) | (static_cast<type::uint32>(src[3]) << 24);
+    }
+
+    /* BC */
+    // Color half shared by BC1, BC2 and BC3. Only BC1 can switch to the 3 color + transparent mode
+    auto decodeBc1Colors(const type::uint8* src, Block& out, bool allowTransparent) -> void
+    {
+        type::uint32 c0 = readLE16(src);
+        type::uint32 c1 = readLE16(src + 2);
+        type::uint32 indices = readLE32(src + 4);
+
+        // Expand 5:6:5 to 8 bits per channel by replicating the high bits into the low ones
+        auto expand = [](type::uint32 c, int* rgb)
+        {
+            int r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+            rgb[0] = (r << 3) | (r >> 2);
+            rgb[1] = (g << 2) | (g >> 4);
+            rgb[2] = (b << 3) | (b >> 2);
+        };
+
+        int palette[4][4];
+        expand(c0, palette[0]);
+        expand(c1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+        if(c0 > c1 || !allowTransparent)
+        {
+            for(int i = 0; i < 3; ++i)
+            {
+                palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+                palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+            }
+            palette[2][3] = palette[3][3] = 255;
+        }
+        else
+        {
+            for(int i = 0; i < 3; ++i)
+            {
+                palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+                palette[3][i] = 0;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = 0;
+        }
+
+        for(int pixel = 0; pixel < 16; ++pixel)
+        {
+            const int* color = palette[(indices >> (2 * pixel)) & 0x3];
+            for(int i = 0; i < 4; ++i)
+            {
+                out[pixel * 4 + i] = static_cast<type::uint8>(color[i]);
+            }
+        }
+    }
+
+    // BC3 alpha and BC4/BC5 channel block. Writes one channel of the output
+    auto decodeBc4Channel(const type::uint8* src, Block& out, int channel) -> void
+    {
+        int v0 = src[0], v1 = src[1];
+        int values[8] = {v0, v1};
+        if(v0 > v1)
+        {
+            for(int i = 1; i < 7; ++i)
+            {
+                values[i + 1] = ((7 - i) * v0 + i * v1) / 7;
+            }
+        }
+        else
+        {
+            for(int i = 1; i < 5; ++i)
+            {
+                values[i + 1] = ((5 - i) * v0 + i * v1) / 5;
+            }
+            values[6] = 0;
+            values[7] = 255;
+        }
+
+        // 48 bits of 3 bit indices
+        type::uint64 indices = 0;
+        for(int i = 0; i < 6; ++i)
+        {
+            indices |= static_cast<type::uint64>(src[2 + i]) << (8 * i);
+        }
+        for(int pixel = 0; pixel < 16; ++pixel)
+        {
+            out[pixel * 4 + channel] = static_cast<type::uint8>(values[(indices >> (3 * pixel)) & 0x7]);
+        }
+    }
+
+    /* ETC2 */
+    constexpr int etc1Modifiers[8][2] =
+            {
+                    {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+            };
+    constexpr int etc2Distances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+    constexpr int eacModifiers[16][8] =
+            {
+                    {-3, -6, -9, -15, 2, 5, 8, 14},
+                    {-3, -7, -10, -13, 2, 6, 9, 12},
+                    {-2, -5, -8, -13, 1, 4, 7, 12},
+                    {-2, -4, -6, -13, 1, 3, 5, 12},
+                    {-3, -6, -8, -12, 2, 5, 7, 11},
+                    {-3, -7, -9, -11, 2, 6, 8, 10},
+                    {-4, -7, -8, -11, 3, 6, 7, 10},
+                    {-3, -5, -8, -11, 2, 4, 7, 10},
+                    {-2, -6, -8, -10, 1, 5, 7, 9},
+                    {-2, -5, -8, -10, 1, 4, 7, 9},
+                    {-2, -4, -8, -10, 1, 3, 7, 9},
+                    {-2, -5, -7, -10, 1, 4, 6, 9},
+                    {-3, -4, -7, -10, 2, 3, 6, 9},
+                    {-1, -2, -3, -10, 0, 1, 2, 9},
+                    {-4, -6, -8, -9, 3, 5, 7, 8},
+                    {-3, -5, -7, -9, 2, 4, 6, 8}
+            };
+
+    inline auto extend4(int c) -> int { return (c << 4) | c; }
+    inline auto extend5(int c) -> int { return (c << 3) | (c >> 2); }
+    inline auto extend6(int c) -> int { return (c << 2) | (c >> 4); }
+    inline auto extend7(int c) -> int { return (c << 1) | (c >> 6); }
+
+    // ETC2 RGB block, optionally with punchthrough alpha. ETC blocks are big endian
+        // and their pixel indices run down columns, unlike BC
+    auto decodeEtc2Colors(const type::uint8* src, Block& out, bool punchthrough) -> void
+    {
+        // In punchthrough blocks the differential bit says whether the block is fully opaque,
+            // and individual mode doesn't exist
+        bool diffBit = src[3] & 0x2;
+        bool opaque = !punchthrough || diffBit;
+        type::uint32 msbs = (src[4] << 8) | src[5];
+        type::uint32 lsbs = (src[6] << 8) | src[7];
+
+        auto writePixel = [&out](int x, int y, int r, int g, int b, int a)
+        {
+            type::uint8* pixel = &out[(y * 4 + x) * 4];
+            pixel[0] = clampByte(r);
+            pixel[1] = clampByte(g);
+            pixel[2] = clampByte(b);
+            pixel[3] = clampByte(a);
+        };
+
+        int base[2][3];
+        if(!diffBit && !punchthrough)
+        {
+            /* Individual Mode */
+            for(int i = 0; i < 3; ++i)
+            {
+                base[0][i] = extend4(src[i] >> 4);
+                base[1][i] = extend4(src[i] & 0xF);
+            }
+        }
+        else
+        {
+            int r = src[0] >> 3, g = src[1] >> 3, b = src[2] >> 3;
+            // 3 bit two's complement deltas
+            int dr = ((src[0] & 0x7) ^ 0x4) - 0x4;
+            int dg = ((src[1] & 0x7) ^ 0x4) - 0x4;
+            int db = ((src[2] & 0x7) ^ 0x4) - 0x4;
+
+            // Overflowing a delta selects one of the ETC2-only modes
+            if(r + dr < 0 || r + dr > 31)
+            {
+                /* T Mode */
+                int paint[4][3];
+                int c0[3] = {extend4(((src[0] & 0x18) >> 1) | (src[0] & 0x3)), extend4(src[1] >> 4), extend4(src[1] & 0xF)};
+                int c1[3] = {extend4(src[2] >> 4), extend4(src[2] & 0xF), extend4(src[3] >> 4)};
+                int distance = etc2Distances[((src[3] >> 1) & 0x6) | (src[3] & 0x1)];
+                for(int i = 0; i < 3; ++i)
+                {
+                    paint[0][i] = c0[i];
+                    paint[1][i] = c1[i] + distance;
+                    paint[2][i] = c1[i];
+                    paint[3][i] = c1[i] - distance;
+                }
+                for(int x = 0; x < 4; ++x)
+                {
+                    for(int y = 0; y < 4; ++y)
+                    {
+                        int bit = x * 4 + y;
+                        int index = (((msbs >> bit) & 1) << 1) | ((lsbs >> bit) & 1);
+                        bool transparent = !opaque && index == 2;
+                        const int* c = paint[index];
+                        writePixel(x, y, transparent ? 0 : c[0], transparent ? 0 : c[1], transparent ? 0 : c[2], transparent ? 0 : 255);
+                    }
+                }
+                return;
+            }
+            if(g + dg < 0 || g + dg > 31)
+            {
+                /* H Mode */
+                int paint[4][3];
+                int r0 = (src[0] & 0x78) >> 3;
+                int g0 = ((src[0] & 0x07) << 1) | ((src[1] & 0x10) >> 4);
+                int b0 = (src[1] & 0x08) | ((src[1] & 0x03) << 1) | ((src[2] & 0x80) >> 7);
+                int r1 = (src[2] & 0x78) >> 3;
+                int g1 = ((src[2] & 0x07) << 1) | ((src[3] & 0x80) >> 7);
+                int b1 = (src[3] & 0x78) >> 3;
+                // The lowest distance bit is implied by which base color is bigger
+                int distanceIndex = (src[3] & 0x04) | ((src[3] & 0x01) << 1);
+                if(((r0 << 8) | (g0 << 4) | b0) >= ((r1 << 8) | (g1 << 4) | b1))
+                {
+                    distanceIndex |= 1;
+                }
+                int distance = etc2Distances[distanceIndex];
+                int c0[3] = {extend4(r0), extend4(g0), extend4(b0)};
+                int c1[3] = {extend4(r1), extend4(g1), extend4(b1)};
+                for(int i = 0; i < 3; ++i)
+                {
+                    paint[0][i] = c0[i] + distance;
+                    paint[1][i] = c0[i] - distance;
+                    paint[2][i] = c1[i] + distance;
+                    paint[3][i] = c1[i] - distance;
+                }
+                for(int x = 0; x < 4; ++x)
+                {
+                    for(int y = 0; y < 4; ++y)
+                    {
+                        int bit = x * 4 + y;
+                        int index = (((msbs >> bit) & 1) << 1) | ((lsbs >> bit) & 1);
+                        bool transparent = !opaque && index == 2;
+                        const int* c = paint[index];
+                        writePixel(x, y, transparent ? 0 : c[0], transparent ? 0 : c[1], transparent ? 0 : c[2], transparent ? 0 : 255);
+                    }
+                }
+                return;
+            }
+            if(b + db < 0 || b + db > 31)
+            {
+                /* Planar Mode */
+                // Three colors at the corners, interpolated across the block. Always opaque
+                int ro = extend6((src[0] & 0x7E) >> 1);
+                int go = extend7(((src[0] & 0x1) << 6) | ((src[1] & 0x7E) >> 1));
+                int bo = extend6(((src[1] & 0x1) << 5) | (src[2] & 0x18) | ((src[2] & 0x03) << 1) | ((src[3] & 0x80) >> 7));
+                int rh = extend6(((src[3] & 0x7C) >> 1) | (src[3] & 0x1));
+                int gh = extend7((src[4] & 0xFE) >> 1);
+                int bh = extend6(((src[4] & 0x1) << 5) | ((src[5] & 0xF8) >> 3));
+                int rv = extend6(((src[5] & 0x7) << 3) | ((src[6] & 0xE0) >> 5));
+                int gv = extend7(((src[6] & 0x1F) << 2) | ((src[7] & 0xC0) >> 6));
+                int bv = extend6(src[7] & 0x3F);
+                for(int y = 0; y < 4; ++y)
+                {
+                    for(int x = 0; x < 4; ++x)
+                    {
+                        writePixel(x, y,
+                                (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                                (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                                (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2,
+                                255);
+                    }
+                }
+                return;
+            }
+
+            /* Differential Mode */
+            base[0][0] = extend5(r);
+            base[0][1] = extend5(g);
+            base[0][2] = extend5(b);
+            base[1][0] = extend5(r + dr);
+            base[1][1] = extend5(g + dg);
+            base[1][2] = extend5(b + db);
+        }
+
+        // Individual and differential modes split the block in two halves with their own table
+        int tables[2] = {(src[3] >> 5) & 0x7, (src[3] >> 2) & 0x7};
+        bool flipped = src[3] & 0x1;
+        for(int x = 0; x < 4; ++x)
+        {
+            for(int y = 0; y < 4; ++y)
+            {
+                int half = flipped ? (y >= 2) : (x >= 2);
+                int bit = x * 4 + y;
+                int msb = (msbs >> bit) & 1;
+                int lsb = (lsbs >> bit) & 1;
+
+                int modifier = etc1Modifiers[tables[half]][lsb];
+                if(msb)
+                {
+                    modifier = -modifier;
+                }
+                if(!opaque)
+                {
+                    // Non-opaque punchthrough blocks use index 2 for transparent and index 0 for the base color
+                    if(msb && !lsb)
+                    {
+                        writePixel(x, y, 0, 0, 0, 0);
+                        continue;
+                    }
+                    if(!msb && !lsb)
+                    {
+                        modifier = 0;
+                    }
+                }
+                writePixel(x, y, base[half][0] + modifier, base[half][1] + modifier, base[half][2] + modifier, 255);
+            }
+        }
+    }
+
+    // 8 bit EAC block holding the alpha of ETC2 RGBA8
+    auto decodeEacAlpha(const type::uint8* src, Block& out) -> void
+    {
+        int base = src[0];
+        int multiplier = src[1] >> 4;
+        const int* modifiers = eacModifiers[src[1] & 0xF];
+
+        type::uint64 indices = 0;
+        for(int i = 2; i < 8; ++i)
+        {
+            indices = (indices << 8) | src[i];
+        }
+        for(int x = 0; x < 4; ++x)
+        {
+            for(int y = 0; y < 4; ++y)
+            {
+                int index = (indices >> (45 - 3 * (x * 4 + y))) & 0x7;
+                out[(y * 4 + x) * 4 + 3] = clampByte(base + modifiers[index] * multiplier);
+            }
+        }
+    }
+
+    auto decodeBlock(VkFormat format, const type::uint8* src, Block& out) -> void
+    {
+        switch(format)
+        {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                decodeBc1Colors(src, out, true);
+                // The RGB variant ignores the transparency of the 3 color mode
+                for(int pixel = 0; pixel < 16; ++pixel)
+                {
+                    out[pixel * 4 + 3] = 255;
+                }
+                break;
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                decodeBc1Colors(src, out, true);
+                break;
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+                decodeBc1Colors(src + 8, out, false);
+                // Explicit 4 bit alpha per pixel
+                for(int pixel = 0; pixel < 16; ++pixel)
+                {
+                    int alpha = (src[pixel / 2] >> (4 * (pixel % 2))) & 0xF;
+                    out[pixel * 4 + 3] = static_cast<type::uint8>(extend4(alpha));
+                }
+                break;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                decodeBc1Colors(src + 8, out, false);
+                decodeBc4Channel(src, out, 3);
+                break;
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                out.fill(0);
+                decodeBc4Channel(src, out, 0);
+                for(int pixel = 0; pixel < 16; ++pixel)
+                {
+                    out[pixel * 4 + 3] = 255;
+                }
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                out.fill(0);
+                decodeBc4Channel(src, out, 0);
+                decodeBc4Channel(src + 8, out, 1);
+                for(int pixel = 0; pixel < 16; ++pixel)
+                {
+                    out[pixel * 4 + 3] = 255;
+                }
+                break;
+            case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+                decodeEtc2Colors(src, out, false);
+                break;
+            case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+                decodeEtc2Colors(src, out, true);
+                break;
+            case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+                decodeEtc2Colors(src + 8, out, false);
+                decodeEacAlpha(src, out);
+                break;
+            default:
+                throw std::runtime_error("No fallback decoder for texture format");
+        }
+    }
+}
+
+auto texformat::canDecode(VkFormat format) -> bool
+{
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+auto texformat::decodedFormat(VkFormat format) -> VkFormat
+{
+    return isSrgb(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+auto texformat::decode(VkFormat format, type::uint32 width, type::uint32 height, const type::uint8* src, type::uint8* dst) -> void
+{
+    auto info = blockInfo(format);
+    if(!info || !canDecode(format))
+    {
+        throw std::runtime_error("No fallback decoder for texture format");
+    }
+
+    Block block;
+    for(type::uint32 by = 0; by < height; by += 4)
+    {
+        for(type::uint32 bx = 0; bx < width; bx += 4)
+        {
+            decodeBlock(format, src, block);
+            src += info->bytesPerBlock;
+
+            // Blocks hanging over the edge of the image are clipped
+            type::uint32 rows = std::min(4u, height - by);
+            type::uint32 cols = std::min(4u, width - bx);
+            for(type::uint32 y = 0; y < rows; ++y)
+            {
+                std::copy_n(&block[y * 16], cols * 4, dst + ((by + y) * width + bx) * 4);
+            }
+        }
+    }
+}
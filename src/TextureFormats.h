@@ -0,0 +1,46 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_TEXTUREFORMATS_H
+#define VULKANTUTORIAL_TEXTUREFORMATS_H
+
+#include <vulkan/vulkan.h>
+#include <optional>
+
+#include "types.h"
+
+/**
+ * Size information for the texture formats the renderer can load, and a CPU
+ * fallback that decodes block-compressed data into RGBA8 for devices that
+ * can't sample the compressed format directly.
+ *
+ * The fallback covers BC1-BC5 and ETC2/EAC, which is enough to cover both desktop
+ * content on mobile GPUs and mobile content on desktop GPUs. BC6H, BC7 and ASTC
+ * are passed through to the GPU only.
+ */
+namespace texformat
+{
+    struct BlockInfo
+    {
+        type::uint32 blockWidth;
+        type::uint32 blockHeight;
+        type::uint32 bytesPerBlock;
+    };
+
+    // Nothing for formats the texture loader doesn't know about
+    auto blockInfo(VkFormat format) -> std::optional<BlockInfo>;
+    auto isCompressed(VkFormat format) -> bool;
+    auto isSrgb(VkFormat format) -> bool;
+    // Bytes taken up by a width x height image. Partial blocks at the edges count as whole blocks
+    auto imageSize(VkFormat format, type::uint32 width, type::uint32 height) -> VkDeviceSize;
+
+    auto canDecode(VkFormat format) -> bool;
+    // RGBA8 format the fallback decodes into, keeping the sRGB-ness of the source
+    auto decodedFormat(VkFormat format) -> VkFormat;
+    // Decode a whole image into tightly packed RGBA8. dst must hold width * height * 4 bytes
+    auto decode(VkFormat format, type::uint32 width, type::uint32 height, const type::uint8* src, type::uint8* dst) -> void;
+}
+
+#endif //VULKANTUTORIAL_TEXTUREFORMATS_H
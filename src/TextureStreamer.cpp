@@ -0,0 +1,849 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "TextureStreamer.h"
+#include "TextureFormats.h"
+#include "BindlessHeap.h"
+
+namespace
+{
+    // Stages textures may be sampled from. Uploads synchronize against all of them
+    constexpr VkPipelineStageFlags SAMPLED_STAGES = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+            | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    // Staging offsets have to be a multiple of the texel block size, which is at most 16 bytes
+    constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    auto alignUp(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    auto mipExtent(VkExtent2D extent, type::uint32 mip) -> VkExtent3D
+    {
+        return {std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u), 1};
+    }
+}
+
+auto TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker, DeletionQueue& deletionQueue,
+                           VkQueue queue, type::uint32 queueFamily, const VkPhysicalDeviceFeatures& enabledFeatures, Config config,
+                           BindlessHeap* bindlessHeap) -> void
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->memoryTracker = &memoryTracker;
+    this->deletionQueue = &deletionQueue;
+    this->queue = queue;
+    this->enabledFeatures = enabledFeatures;
+    this->config = config;
+    this->bindlessHeap = bindlessHeap;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    // Upload command buffers are short lived and freed one by one
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture upload command pool");
+    }
+
+    createSampler();
+    if(bindlessHeap)
+    {
+        samplerBindlessIndex = bindlessHeap->registerSampler(sampler);
+    }
+
+    stopLoader = false;
+    for(type::uint32 i = 0; i < std::max(config.loaderThreads, 1u); ++i)
+    {
+        loaders.emplace_back(&TextureStreamer::loaderMain, this);
+    }
+}
+
+auto TextureStreamer::cleanup() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        stopLoader = true;
+    }
+    loaderSignal.notify_all();
+    for(std::thread& loader : loaders)
+    {
+        loader.join();
+    }
+    loaders.clear();
+    loadRequests.clear();
+    loadResults.clear();
+    pendingLoads = 0;
+
+    for(Upload& upload : uploads)
+    {
+        vkWaitForFences(device, 1, &upload.fence, VK_TRUE, type::uint64_max);
+        destroyResidentImage(upload.image);
+        vkDestroyBuffer(device, upload.stagingBuffer, nullptr);
+        memoryTracker->free(upload.stagingMemory);
+        vkDestroyFence(device, upload.fence, nullptr);
+    }
+    uploads.clear();
+
+    for(Texture& texture : textures)
+    {
+        destroyResidentImage(texture.resident);
+    }
+    textures.clear();
+
+    if(bindlessHeap)
+    {
+        bindlessHeap->releaseSampler(samplerBindlessIndex);
+    }
+    vkDestroySampler(device, sampler, nullptr);
+    // Frees every command buffer allocated from it
+    vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+/**
+ * Loading
+ */
+
+auto TextureStreamer::load(const std::string& path) -> TextureHandle
+{
+    Ktx2File file = Ktx2File::open(path);
+
+    Texture texture = {};
+    texture.format = file.getFormat();
+    if(!canSample(texture.format))
+    {
+        if(!texformat::canDecode(texture.format))
+        {
+            throw std::runtime_error(path + " has a format the device can't sample and that can't be decoded");
+        }
+        // Fall back to uncompressed, paying 4-8x the memory
+        texture.format = texformat::decodedFormat(texture.format);
+        texture.decode = true;
+    }
+    texture.extent = {file.getWidth(), file.getHeight()};
+    texture.levelCount = file.getLevelCount();
+
+    // The tail starts at the first level that fits in residentTailSize, or the last level if none does
+    type::uint32 tailMip = 0;
+    while(tailMip + 1 < texture.levelCount
+          && (file.levelWidth(tailMip) > config.residentTailSize || file.levelHeight(tailMip) > config.residentTailSize))
+    {
+        ++tailMip;
+    }
+
+    std::vector<std::vector<type::uint8>> levels = readLevels(file, tailMip, texture.levelCount, texture.decode);
+    texture.file = std::move(file);
+    return addTexture(std::move(texture), tailMip, levels);
+}
+
+auto TextureStreamer::createFromPixels(type::uint32 width, type::uint32 height, VkFormat format, const void* pixels) -> TextureHandle
+{
+    if(!canSample(format))
+    {
+        throw std::runtime_error("Texture format can't be sampled on this device");
+    }
+
+    Texture texture = {};
+    texture.format = format;
+    texture.extent = {width, height};
+    texture.levelCount = 1;
+
+    std::vector<std::vector<type::uint8>> levels(1);
+    levels[0].resize(texformat::imageSize(format, width, height));
+    std::memcpy(levels[0].data(), pixels, levels[0].size());
+    return addTexture(std::move(texture), 0, levels);
+}
+
+auto TextureStreamer::addTexture(Texture texture, type::uint32 firstMip, std::vector<std::vector<type::uint8>> levels) -> TextureHandle
+{
+    type::uint32 fullLevelCount = mipgen::levelCount(texture.extent.width, texture.extent.height);
+    bool blitMips = false;
+    bool generateMips = false;
+    if(texture.levelCount == 1 && fullLevelCount > 1)
+    {
+        // Blits filter sRGB formats in linear space, same as the CPU path
+        blitMips = canBlit(texture.format);
+        generateMips = !blitMips && mipgen::canGenerate(texture.format);
+        if(blitMips || generateMips)
+        {
+            texture.levelCount = fullLevelCount;
+        }
+    }
+
+    // Nothing is resident yet, so the upload doesn't copy from an older image
+    texture.residentMip = texture.levelCount;
+    auto handle = static_cast<TextureHandle>(textures.size());
+    textures.push_back(std::move(texture));
+    const Texture& added = textures.back();
+
+    // The initial upload is waited on right away so the texture can be sampled once this returns.
+        // Mips generated on the CPU come later, so only level 0 goes in for now
+    type::uint32 imageLevels = generateMips ? 1 : added.levelCount - firstMip;
+    Upload upload = startUpload(handle, firstMip, imageLevels, levels, blitMips);
+    vkWaitForFences(device, 1, &upload.fence, VK_TRUE, type::uint64_max);
+    finishUpload(upload);
+
+    if(generateMips)
+    {
+        LoadRequest request = {};
+        request.texture = handle;
+        request.mipSource = std::move(levels[0]);
+        request.format = added.format;
+        request.extent = added.extent;
+        queueLoad(std::move(request));
+        textures[handle].loading = true;
+        ++pendingLoads;
+    }
+    return handle;
+}
+
+auto TextureStreamer::requestMip(TextureHandle texture, type::uint32 mip) -> void
+{
+    Texture& tex = textures.at(texture);
+    tex.requestedMip = std::min(mip, tex.levelCount - 1);
+}
+
+auto TextureStreamer::readLevels(const Ktx2File& file, type::uint32 firstMip, type::uint32 endMip, bool decode)
+        -> std::vector<std::vector<type::uint8>>
+{
+    std::vector<std::vector<type::uint8>> levels(endMip - firstMip);
+    std::vector<type::uint8> encoded;
+    for(type::uint32 mip = firstMip; mip < endMip; ++mip)
+    {
+        std::vector<type::uint8>& level = levels[mip - firstMip];
+        if(!decode)
+        {
+            file.readLevel(mip, level);
+            continue;
+        }
+
+        file.readLevel(mip, encoded);
+        type::uint32 width = file.levelWidth(mip);
+        type::uint32 height = file.levelHeight(mip);
+        level.resize(static_cast<size_t>(width) * height * 4);
+        texformat::decode(file.getFormat(), width, height, encoded.data(), level.data());
+    }
+    return levels;
+}
+
+/**
+ * Streaming
+ */
+
+auto TextureStreamer::loaderMain() -> void
+{
+    while(true)
+    {
+        LoadRequest request;
+        {
+            std::unique_lock<std::mutex> lock(loaderMutex);
+            loaderSignal.wait(lock, [this] { return stopLoader || !loadRequests.empty(); });
+            if(stopLoader)
+            {
+                return;
+            }
+            request = std::move(loadRequests.front());
+            loadRequests.pop_front();
+        }
+
+        LoadResult result = {};
+        result.texture = request.texture;
+        result.firstMip = request.file ? request.firstMip : 0;
+        try
+        {
+            if(request.file)
+            {
+                result.levels = readLevels(*request.file, request.firstMip, request.endMip, request.decode);
+            }
+            else
+            {
+                result.levels = mipgen::generate(request.format, request.extent.width, request.extent.height,
+                        request.mipSource.data(), config.mipFilter);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            result.error = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(loaderMutex);
+            loadResults.push_back(std::move(result));
+        }
+        if(config.onLoaded)
+        {
+            config.onLoaded();
+        }
+    }
+}
+
+auto TextureStreamer::queueLoad(LoadRequest request) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loadRequests.push_back(std::move(request));
+    }
+    loaderSignal.notify_one();
+}
+
+auto TextureStreamer::update() -> bool
+{
+    bool changed = false;
+
+    // Swap in finished uploads
+    for(auto it = uploads.begin(); it != uploads.end();)
+    {
+        if(vkGetFenceStatus(device, it->fence) != VK_SUCCESS)
+        {
+            ++it;
+            continue;
+        }
+        finishUpload(*it);
+        --pendingLoads;
+        changed = true;
+        it = uploads.erase(it);
+    }
+
+    // Upload levels the loader threads finished reading or generating
+    std::vector<LoadResult> results;
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        results.swap(loadResults);
+    }
+    for(LoadResult& result : results)
+    {
+        if(!result.error.empty())
+        {
+            throw std::runtime_error(result.error);
+        }
+
+        Texture& texture = textures[result.texture];
+        // Reading took a while and other textures may have used up the budget since the request. The
+            // level is dropped but stays requested, so it's read again once the budget has room for it
+        if(residentBytes + imageSize(texture, result.firstMip) > budget())
+        {
+            texture.loading = false;
+            --pendingLoads;
+            continue;
+        }
+        uploads.push_back(startUpload(result.texture, result.firstMip, texture.levelCount - result.firstMip, result.levels, false));
+    }
+
+    evictOverBudget();
+
+    // Request the next level of textures that want more detail. Going one level at a time keeps
+        // the budget check accurate and lets every texture improve a bit before any gets huge.
+        // Levels dropped for the budget, evicted or never loaded, are picked up here once it has room
+    for(TextureHandle handle = 0; handle < textures.size() && pendingLoads < config.maxPendingLoads; ++handle)
+    {
+        Texture& texture = textures[handle];
+        if(texture.loading || !texture.file || texture.requestedMip >= texture.residentMip)
+        {
+            continue;
+        }
+
+        type::uint32 nextMip = texture.residentMip - 1;
+        // Old and new image are both alive until the old one retires
+        if(residentBytes + imageSize(texture, nextMip) > budget())
+        {
+            continue;
+        }
+
+        LoadRequest request = {};
+        request.texture = handle;
+        request.file = texture.file;
+        request.firstMip = nextMip;
+        request.endMip = texture.residentMip;
+        request.decode = texture.decode;
+        queueLoad(std::move(request));
+        texture.loading = true;
+        ++pendingLoads;
+    }
+
+    return changed;
+}
+
+auto TextureStreamer::evictOverBudget() -> void
+{
+    // Old images are on their way out already, and uploads in flight replace the image they were started from
+    VkDeviceSize settledBytes = 0;
+    for(const Texture& texture : textures)
+    {
+        settledBytes += texture.resident.size;
+    }
+    for(const Upload& upload : uploads)
+    {
+        settledBytes += upload.image.size - textures[upload.texture].resident.size;
+    }
+
+    while(settledBytes > budget())
+    {
+        // Largest texture that can still give up a level. Textures made from pixels can't stream the level back in
+        TextureHandle victim = type::uint32_max;
+        VkDeviceSize victimSize = 0;
+        for(TextureHandle handle = 0; handle < textures.size(); ++handle)
+        {
+            const Texture& texture = textures[handle];
+            VkExtent3D top = mipExtent(texture.extent, texture.residentMip);
+            if(texture.loading || !texture.file || std::max(top.width, top.height) <= config.residentTailSize)
+            {
+                continue;
+            }
+            if(texture.resident.size > victimSize)
+            {
+                victim = handle;
+                victimSize = texture.resident.size;
+            }
+        }
+        if(victim == type::uint32_max)
+        {
+            return;
+        }
+
+        // Same as streaming a level in, but the new image only takes over the levels below the top one
+        Texture& texture = textures[victim];
+        type::uint32 firstMip = texture.residentMip + 1;
+        Upload upload = startUpload(victim, firstMip, texture.levelCount - firstMip, {}, false);
+        settledBytes -= texture.resident.size - upload.image.size;
+        uploads.push_back(upload);
+        texture.loading = true;
+        ++pendingLoads;
+    }
+}
+
+auto TextureStreamer::startUpload(TextureHandle handle, type::uint32 firstMip, type::uint32 levelCount,
+                                  const std::vector<std::vector<type::uint8>>& levels, bool blitMips) -> Upload
+{
+    const Texture& texture = textures[handle];
+
+    Upload upload = {};
+    upload.texture = handle;
+    upload.firstMip = firstMip;
+    upload.image = createResidentImage(texture, firstMip, levelCount);
+
+    // Pack every new level into one staging buffer
+    std::vector<VkDeviceSize> offsets(levels.size());
+    VkDeviceSize stagingSize = 0;
+    for(size_t i = 0; i < levels.size(); ++i)
+    {
+        offsets[i] = stagingSize;
+        stagingSize = alignUp(stagingSize + levels[i].size(), STAGING_ALIGNMENT);
+    }
+    if(!levels.empty())
+    {
+        memoryTracker->createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTracker::Category::Staging,
+                upload.stagingBuffer, upload.stagingMemory);
+
+        void* data;
+        vkMapMemory(device, upload.stagingMemory, 0, stagingSize, 0, &data);
+        for(size_t i = 0; i < levels.size(); ++i)
+        {
+            std::memcpy(static_cast<type::uint8*>(data) + offsets[i], levels[i].data(), levels[i].size());
+        }
+        vkUnmapMemory(device, upload.stagingMemory);
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+    if(vkAllocateCommandBuffers(device, &allocInfo, &upload.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate texture upload command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // Whole new image becomes a copy destination, its old contents don't matter
+    barrier.image = upload.image.image;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<VkBufferImageCopy> regions(levels.size());
+    for(size_t i = 0; i < levels.size(); ++i)
+    {
+        VkBufferImageCopy& region = regions[i];
+        region.bufferOffset = offsets[i];
+        // Tightly packed
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        // Level 0 of the new image is firstMip of the full chain
+        region.imageSubresource.mipLevel = static_cast<type::uint32>(i);
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = mipExtent(texture.extent, firstMip + static_cast<type::uint32>(i));
+    }
+    if(!regions.empty())
+    {
+        vkCmdCopyBufferToImage(upload.commandBuffer, upload.stagingBuffer, upload.image.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<type::uint32>(regions.size()), regions.data());
+    }
+
+    // Carry the already resident levels the staging data doesn't cover over from the current image
+        // instead of reading them again
+    auto stagedEnd = firstMip + static_cast<type::uint32>(levels.size());
+    type::uint32 copyBegin = std::max(stagedEnd, texture.residentMip);
+    type::uint32 copyEnd = std::min(texture.residentMip + texture.resident.levelCount, firstMip + levelCount);
+    if(blitMips)
+    {
+        recordBlitChain(upload.commandBuffer, upload.image.image, mipExtent(texture.extent, firstMip),
+                static_cast<type::uint32>(levels.size()), levelCount);
+    }
+    else if(texture.resident.image != VK_NULL_HANDLE && copyBegin < copyEnd)
+    {
+        // Frames in flight keep sampling the current image, so it goes back to being read only afterwards
+        barrier.image = texture.resident.image;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(upload.commandBuffer, SAMPLED_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        std::vector<VkImageCopy> copies;
+        for(type::uint32 mip = copyBegin; mip < copyEnd; ++mip)
+        {
+            VkImageCopy copy = {};
+            copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy.srcSubresource.mipLevel = mip - texture.residentMip;
+            copy.srcSubresource.baseArrayLayer = 0;
+            copy.srcSubresource.layerCount = 1;
+            copy.srcOffset = {0, 0, 0};
+            copy.dstSubresource = copy.srcSubresource;
+            copy.dstSubresource.mipLevel = mip - firstMip;
+            copy.dstOffset = {0, 0, 0};
+            copy.extent = mipExtent(texture.extent, mip);
+            copies.push_back(copy);
+        }
+        vkCmdCopyImage(upload.commandBuffer, texture.resident.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                upload.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<type::uint32>(copies.size()), copies.data());
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, SAMPLED_STAGES,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // The blit chain leaves every level as a transfer source
+    barrier.image = upload.image.image;
+    barrier.oldLayout = blitMips ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, SAMPLED_STAGES,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkEndCommandBuffer(upload.commandBuffer);
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if(vkCreateFence(device, &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture upload fence");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &upload.commandBuffer;
+    if(vkQueueSubmit(queue, 1, &submitInfo, upload.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit texture upload");
+    }
+
+    return upload;
+}
+
+auto TextureStreamer::recordBlitChain(VkCommandBuffer commandBuffer, VkImage image, VkExtent3D extent,
+                                      type::uint32 firstLevel, type::uint32 levelCount) -> void
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    // Each level is filtered from the one above it once that one has been written
+    for(type::uint32 level = firstLevel; level < levelCount; ++level)
+    {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkExtent3D srcExtent = mipExtent({extent.width, extent.height}, level - 1);
+        VkExtent3D dstExtent = mipExtent({extent.width, extent.height}, level);
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1};
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {static_cast<int32_t>(dstExtent.width), static_cast<int32_t>(dstExtent.height), 1};
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+    }
+
+    // Last level was only written, bring it in line with the rest
+    barrier.subresourceRange.baseMipLevel = levelCount - 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+auto TextureStreamer::finishUpload(Upload& upload) -> void
+{
+    Texture& texture = textures[upload.texture];
+
+    if(bindlessHeap)
+    {
+        upload.image.bindlessIndex = bindlessHeap->registerSampledImage(upload.image.view,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // Frames recorded up to now still refer to the old image
+    if(texture.resident.image != VK_NULL_HANDLE)
+    {
+        ResidentImage old = texture.resident;
+        deletionQueue->retire([this, old]() mutable { destroyResidentImage(old); });
+    }
+    texture.resident = upload.image;
+    texture.residentMip = upload.firstMip;
+    texture.loading = false;
+
+    vkDestroyBuffer(device, upload.stagingBuffer, nullptr);
+    memoryTracker->free(upload.stagingMemory);
+    vkFreeCommandBuffers(device, commandPool, 1, &upload.commandBuffer);
+    vkDestroyFence(device, upload.fence, nullptr);
+}
+
+/**
+ * Queries
+ */
+
+auto TextureStreamer::getView(TextureHandle texture) const -> VkImageView
+{
+    return textures.at(texture).resident.view;
+}
+
+auto TextureStreamer::getBindlessIndex(TextureHandle texture) const -> type::uint32
+{
+    return textures.at(texture).resident.bindlessIndex;
+}
+
+auto TextureStreamer::getResidentMip(TextureHandle texture) const -> type::uint32
+{
+    return textures.at(texture).residentMip;
+}
+
+/**
+ * Helpers
+ */
+
+auto TextureStreamer::canSample(VkFormat format) -> bool
+{
+    // The device may list compressed formats whose feature wasn't turned on
+    if(format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !enabledFeatures.textureCompressionBC)
+    {
+        return false;
+    }
+    if(format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK && !enabledFeatures.textureCompressionETC2)
+    {
+        return false;
+    }
+    if(format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && !enabledFeatures.textureCompressionASTC_LDR)
+    {
+        return false;
+    }
+
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+            | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (props.optimalTilingFeatures & required) == required;
+}
+
+auto TextureStreamer::canBlit(VkFormat format) -> bool
+{
+    if(texformat::isCompressed(format))
+    {
+        return false;
+    }
+
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & required) == required;
+}
+
+auto TextureStreamer::createSampler() -> void
+{
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    if(enabledFeatures.samplerAnisotropy)
+    {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        samplerInfo.anisotropyEnable = VK_TRUE;
+        samplerInfo.maxAnisotropy = std::min(config.maxAnisotropy, props.limits.maxSamplerAnisotropy);
+    }
+    else
+    {
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+    }
+
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    // Views only cover the resident levels, so the sampler doesn't need to know how many there are
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if(vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture sampler");
+    }
+}
+
+auto TextureStreamer::imageSize(const Texture& texture, type::uint32 firstMip) const -> VkDeviceSize
+{
+    VkDeviceSize size = 0;
+    for(type::uint32 mip = firstMip; mip < texture.levelCount; ++mip)
+    {
+        VkExtent3D extent = mipExtent(texture.extent, mip);
+        size += texformat::imageSize(texture.format, extent.width, extent.height);
+    }
+    return size;
+}
+
+auto TextureStreamer::createResidentImage(const Texture& texture, type::uint32 firstMip, type::uint32 levelCount) -> ResidentImage
+{
+    ResidentImage resident = {};
+    resident.levelCount = levelCount;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = mipExtent(texture.extent, firstMip);
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = texture.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Transfer source so the next, more detailed image can copy the levels over
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if(vkCreateImage(device, &imageInfo, nullptr, &resident.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture image");
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(device, resident.image, &memReq);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryTracker->chooseMemoryType(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if(memoryTracker->allocate(allocInfo, MemoryTracker::Category::Texture, resident.memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Texture memory allocation failed");
+    }
+    vkBindImageMemory(device, resident.image, resident.memory, 0);
+    resident.size = memReq.size;
+    residentBytes += resident.size;
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = resident.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.format;
+    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if(vkCreateImageView(device, &viewInfo, nullptr, &resident.view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture image view");
+    }
+
+    return resident;
+}
+
+auto TextureStreamer::destroyResidentImage(ResidentImage& image) -> void
+{
+    if(image.image == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    if(bindlessHeap && image.bindlessIndex != NO_BINDLESS_INDEX)
+    {
+        bindlessHeap->releaseSampledImage(image.bindlessIndex);
+    }
+    vkDestroyImageView(device, image.view, nullptr);
+    vkDestroyImage(device, image.image, nullptr);
+    memoryTracker->free(image.memory);
+    residentBytes -= image.size;
+    image = {};
+}
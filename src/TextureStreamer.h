@@ -0,0 +1,236 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_TEXTURESTREAMER_H
+#define VULKANTUTORIAL_TEXTURESTREAMER_H
+
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "Ktx2File.h"
+#include "MipGenerator.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+
+class BindlessHeap;
+
+/**
+ * Owns every sampled texture and streams their mip levels in over time
+ *
+ * Loading a texture only uploads the small mips at the end of the chain, so there
+ * is something to sample right away. The larger mips are read (and decoded, if the
+ * device can't sample the stored format) on a loader thread, one level at a time,
+ * and uploaded into a new image that also takes over the mips already resident.
+ * The new image replaces the old one once the GPU is done with the upload, and the
+ * old one goes into the deletion queue until no frame in flight can be sampling it.
+ * The total size of all texture images is kept under a memory budget.
+ *
+ * The budget can be lowered at runtime, when device memory runs short. Textures
+ * are then dropped a mip level at a time, largest first, the same way they were
+ * streamed in: a smaller image takes over the remaining levels and replaces the
+ * current one. They stream back in once there is room again.
+ *
+ * Textures that come with a single level get the rest of their mip chain generated.
+ * Formats the GPU can blit with linear filtering are downsampled by a blit chain
+ * in the initial upload. Everything else is filtered on a loader thread and swapped
+ * in like a streamed level, while level 0 alone is sampled in the meantime.
+ *
+ * Images are always in SHADER_READ_ONLY_OPTIMAL when they can be sampled.
+ */
+class TextureStreamer
+{
+public:
+    using TextureHandle = type::uint32;
+
+    struct Config
+    {
+        // Device memory all texture images together may take up. Higher mips stop streaming short of it
+        VkDeviceSize memoryBudget = 256ull * 1024 * 1024;
+        // Mips no bigger than this are uploaded as soon as a texture is loaded
+        type::uint32 residentTailSize = 64;
+        // Mip levels that can be on their way from disk to the GPU at once
+        type::uint32 maxPendingLoads = 4;
+        // Upper limit for anisotropic filtering. Only used if the feature is enabled
+        float maxAnisotropy = 16.0f;
+        // Threads reading levels and generating mips
+        type::uint32 loaderThreads = 2;
+        // Used for mip chains generated on the CPU
+        mipgen::Filter mipFilter = mipgen::Filter::Box;
+        // Called on a loader thread whenever a level is ready for the next update. Lets a renderer
+            // that only draws on demand wake up to swap it in
+        std::function<void()> onLoaded;
+    };
+
+    // Uploads are submitted to the given queue. If a bindless heap is given, every texture
+        // and the sampler also get a slot in it
+    auto init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker& memoryTracker, DeletionQueue& deletionQueue,
+              VkQueue queue, type::uint32 queueFamily, const VkPhysicalDeviceFeatures& enabledFeatures, Config config,
+              BindlessHeap* bindlessHeap = nullptr) -> void;
+    auto cleanup() -> void;
+
+    // Load a KTX2 texture. Blocks until the low resolution mips are uploaded
+    auto load(const std::string& path) -> TextureHandle;
+    // Texture from tightly packed level 0 pixels in the given format. The mips are generated
+    auto createFromPixels(type::uint32 width, type::uint32 height, VkFormat format, const void* pixels) -> TextureHandle;
+    // Most detailed mip level the texture should stream in. Defaults to 0, the full resolution
+    auto requestMip(TextureHandle texture, type::uint32 mip) -> void;
+    // Tighter limit than the configured budget, for when device memory runs short. Textures
+        // over it get mip levels evicted in the next update
+    inline auto setMemoryLimit(VkDeviceSize limit) -> void { memoryLimit = limit; }
+
+    // Call once per frame, after waiting on the fence of the frame about to be recorded.
+        // Swaps in finished uploads and starts
+        // loading more mips while the budget allows, or evicting some if it's been exceeded.
+        // Returns true if any texture's view changed
+    auto update() -> bool;
+
+    auto getView(TextureHandle texture) const -> VkImageView;
+    inline auto getSampler() const -> VkSampler { return sampler; }
+    // Indices into the bindless heap's sampled image and sampler arrays
+    auto getBindlessIndex(TextureHandle texture) const -> type::uint32;
+    inline auto getSamplerBindlessIndex() const -> type::uint32 { return samplerBindlessIndex; }
+    // Most detailed mip level that can currently be sampled
+    auto getResidentMip(TextureHandle texture) const -> type::uint32;
+    inline auto getResidentBytes() const -> VkDeviceSize { return residentBytes; }
+    // Levels being read or uploaded. Those on the GPU only finish in an update, so keep calling it while there are any
+    inline auto getPendingLoads() const -> type::uint32 { return pendingLoads; }
+
+private:
+    // Images still being uploaded aren't in the bindless heap yet
+    static constexpr type::uint32 NO_BINDLESS_INDEX = type::uint32_max;
+
+    // Image holding the resident mips of a texture, starting at some level of the full chain
+    struct ResidentImage
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        type::uint32 levelCount = 0;
+        type::uint32 bindlessIndex = NO_BINDLESS_INDEX;
+    };
+
+    struct Texture
+    {
+        // Nothing for textures made from pixels, which can't stream
+        std::optional<Ktx2File> file;
+        // Format of the image, which differs from the file's when it gets decoded on the CPU
+        VkFormat format;
+        bool decode = false;
+        VkExtent2D extent;
+        type::uint32 levelCount;
+        ResidentImage resident;
+        // First level of the full chain held by the resident image
+        type::uint32 residentMip;
+        type::uint32 requestedMip = 0;
+        // A level is on its way from disk or to the GPU
+        bool loading = false;
+    };
+
+    // Work for the loader threads. Holds copies of everything needed so it never touches textures
+    struct LoadRequest
+    {
+        TextureHandle texture;
+        // Levels [firstMip, endMip) are read from here. Nothing when generating mips
+        std::optional<Ktx2File> file;
+        type::uint32 firstMip;
+        type::uint32 endMip;
+        bool decode;
+        // Level 0 to build the mip chain from, for textures that came without one
+        std::vector<type::uint8> mipSource;
+        VkFormat format;
+        VkExtent2D extent;
+    };
+
+    struct LoadResult
+    {
+        TextureHandle texture;
+        type::uint32 firstMip;
+        std::vector<std::vector<type::uint8>> levels;
+        // Loader thread exceptions are rethrown from update
+        std::string error;
+    };
+
+    struct Upload
+    {
+        TextureHandle texture;
+        type::uint32 firstMip;
+        ResidentImage image;
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingMemory;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    Config config;
+    BindlessHeap* bindlessHeap = nullptr;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    type::uint32 samplerBindlessIndex = 0;
+
+    std::vector<Texture> textures;
+    std::vector<Upload> uploads;
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize memoryLimit = type::uint64_max;
+    type::uint32 pendingLoads = 0;
+
+    /* Loader Threads */
+    std::vector<std::thread> loaders;
+    std::mutex loaderMutex;
+    std::condition_variable loaderSignal;
+    std::deque<LoadRequest> loadRequests;
+    std::vector<LoadResult> loadResults;
+    bool stopLoader = false;
+    auto loaderMain() -> void;
+    auto queueLoad(LoadRequest request) -> void;
+    // Read levels [firstMip, endMip) and decode them if needed
+    static auto readLevels(const Ktx2File& file, type::uint32 firstMip, type::uint32 endMip, bool decode)
+            -> std::vector<std::vector<type::uint8>>;
+
+    // Lower of the configured budget and the memory limit
+    inline auto budget() const -> VkDeviceSize { return std::min(config.memoryBudget, memoryLimit); }
+    // Drop the top mip of the largest textures until what will be resident once
+        // the uploads in flight finish fits in the budget again
+    auto evictOverBudget() -> void;
+
+    auto canSample(VkFormat format) -> bool;
+    // Whether the format can be downsampled with a linear filtered blit
+    auto canBlit(VkFormat format) -> bool;
+    auto createSampler() -> void;
+    // Size of the image holding levels [firstMip, levelCount) of a texture
+    auto imageSize(const Texture& texture, type::uint32 firstMip) const -> VkDeviceSize;
+    // Image for levels [firstMip, firstMip + levelCount) of a texture
+    auto createResidentImage(const Texture& texture, type::uint32 firstMip, type::uint32 levelCount) -> ResidentImage;
+    auto destroyResidentImage(ResidentImage& image) -> void;
+    // Record and submit the upload of a new image with levelCount levels starting at firstMip. The given
+        // levels come first. Any after them are blitted from the ones above if blitMips is set,
+        // otherwise copied over from the current image. Without any levels, nothing is staged
+    auto startUpload(TextureHandle handle, type::uint32 firstMip, type::uint32 levelCount,
+                     const std::vector<std::vector<type::uint8>>& levels, bool blitMips) -> Upload;
+    auto recordBlitChain(VkCommandBuffer commandBuffer, VkImage image, VkExtent3D extent,
+                         type::uint32 firstLevel, type::uint32 levelCount) -> void;
+    // Make the uploaded image the texture's resident one
+    auto finishUpload(Upload& upload) -> void;
+    // Upload the initial levels, generating the rest of the chain if the texture only has one
+    auto addTexture(Texture texture, type::uint32 firstMip, std::vector<std::vector<type::uint8>> levels) -> TextureHandle;
+};
+
+#endif //VULKANTUTORIAL_TEXTURESTREAMER_H
@@ -9,14 +9,18 @@
 #include <map>
 #include <set>
 #include <fstream>
+#include <string>
 #include "TriangleApp.h"
 #include "Vertex.h"
 #include "UBO.h"
+#include "Hash.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <chrono>
 
 auto TriangleApp::run() -> void
@@ -41,13 +45,83 @@ auto TriangleApp::initWindow() -> void
     window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Vulkan App", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
-
+    glfwSetWindowIconifyCallback(window, windowIconifyCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+    glfwSetKeyCallback(window, keyCallback);
+
+    // GLFW can only be asked from the main thread. The other threads start with this
+        // and follow along with resize events after
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    simulationWidth = framebufferWidth;
+    simulationHeight = framebufferHeight;
 }
 
 auto TriangleApp::framebufferResizeCallback(GLFWwindow *window, int width, int height) -> void
 {
     auto app = reinterpret_cast<TriangleApp*>(glfwGetWindowUserPointer(window));
-    app->framebufferResized = true;
+    WindowEvent event = {WindowEvent::Type::Resize};
+    event.width = width;
+    event.height = height;
+    app->postWindowEvent(event, true, true);
+}
+
+auto TriangleApp::windowIconifyCallback(GLFWwindow* window, int iconified) -> void
+{
+    auto app = reinterpret_cast<TriangleApp*>(glfwGetWindowUserPointer(window));
+    // The simulation has nothing to show while minimized either, so it stops too
+    app->postWindowEvent({iconified ? WindowEvent::Type::Minimize : WindowEvent::Type::Restore}, true, true);
+}
+
+auto TriangleApp::windowRefreshCallback(GLFWwindow* window) -> void
+{
+    // Nothing in the scene changed, so the last snapshot is drawn again
+    auto app = reinterpret_cast<TriangleApp*>(glfwGetWindowUserPointer(window));
+    app->postWindowEvent({WindowEvent::Type::Refresh}, false, true);
+}
+
+auto TriangleApp::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) -> void
+{
+    if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+    {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+        return;
+    }
+    auto app = reinterpret_cast<TriangleApp*>(glfwGetWindowUserPointer(window));
+    if(key == GLFW_KEY_V && action == GLFW_PRESS && enableValidationLayers)
+    {
+        // Errors only, then warnings, info and verbose too, then back to errors only
+        VkDebugUtilsMessageSeverityFlagsEXT severities = app->validationLog.getSeverities();
+        auto lowest = static_cast<VkDebugUtilsMessageSeverityFlagBitsEXT>(severities & (~severities + 1));
+        lowest = lowest <= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+                ? VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+                : static_cast<VkDebugUtilsMessageSeverityFlagBitsEXT>(lowest >> 4);
+        app->validationLog.setSeverities(ValidationLog::severitiesFrom(lowest));
+        return;
+    }
+    WindowEvent event = {WindowEvent::Type::Key};
+    event.key = key;
+    event.action = action;
+    // Capturing happens where the frames are drawn. Every other key is for the simulation
+    bool captureKey = key == GLFW_KEY_C;
+    app->postWindowEvent(event, !captureKey, captureKey);
+}
+
+/**
+ * Window Events
+ */
+auto TriangleApp::postWindowEvent(const WindowEvent& event, bool toSimulation, bool toRenderer) -> void
+{
+    // A full queue means that thread is badly stuck. Losing an event beats stalling the event loop on it
+    if(toSimulation)
+    {
+        simulationEvents.push(event);
+        wakeSimulationThread();
+    }
+    if(toRenderer)
+    {
+        renderEvents.push(event);
+        wakeRenderThread();
+    }
 }
 
 /**
@@ -57,6 +131,11 @@ auto TriangleApp::framebufferResizeCallback(GLFWwindow *window, int width, int h
  */
 auto TriangleApp::initVulkan() -> void
 {
+    // Before the instance, which reports through it from the start
+    if(enableValidationLayers)
+    {
+        validationLog.init();
+    }
     createInstance();
     setupDebugMessenger();
     createSurface();
@@ -64,18 +143,24 @@ auto TriangleApp::initVulkan() -> void
     createLogicalDevice();
     createSwapChain();
     createImageViews();
-    createRenderPass();
+    createRenderGraph();
+    createDescriptorAllocators();
     createDescriptorSetLayout();
     createGraphicsPipeline();
-    createFramebuffers();
     createCommandPool();
-    createVertexBuffer();
-    createIndexBuffer();
+    createGeometryBuffers();
+    createJobSystem();
+    createScene();
     createUniformBuffers();
-    createDescriptorPool();
+    createTextures();
+    createSpriteBatch();
+    createParticleSystem();
     createDescriptorSets();
     createCommandBuffers();
     createSyncObjects();
+    createDynamicResolution();
+    createOcclusionCuller();
+    createFrameCapture();
 }
 
 /**
@@ -141,7 +226,8 @@ auto TriangleApp::createInstance() -> void
     appInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(0, 0, 1);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 for descriptor update templates
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     // Specify instance info
     VkInstanceCreateInfo createInfo = {};
@@ -218,7 +304,8 @@ auto TriangleApp::debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSe
                                 const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData
 ) -> VKAPI_ATTR VkBool32 VKAPI_CALL
 {
-    std::cerr << "Validation Layer Debug: \n\t" << pCallbackData->pMessage << std::endl;
+    // Called on whichever thread made the Vulkan call, which shouldn't be kept waiting on stderr
+    static_cast<ValidationLog*>(pUserData)->submit(messageSeverity, messageType, pCallbackData);
 
     return VK_FALSE;
 }
@@ -227,15 +314,14 @@ auto TriangleApp::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateIn
 {
     createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    createInfo.messageSeverity =
-            VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
-            | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
-            | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // Everything is passed on, so the log's filters can be changed while running
+    createInfo.messageSeverity = ValidationLog::ALL_SEVERITIES;
     createInfo.messageType =
             VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
             | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
             | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
     createInfo.pfnUserCallback = debugCallback;
+    createInfo.pUserData = &validationLog;
 }
 
 auto TriangleApp::setupDebugMessenger() -> void
@@ -316,6 +402,12 @@ auto TriangleApp::ratePhysicalDevice(VkPhysicalDevice device) -> int
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+    // Descriptor update templates are core in 1.1
+    if(deviceProperties.apiVersion < VK_API_VERSION_1_1)
+    {
+        return 0;
+    }
+
     int score = 0;
 
     // Discrete GPU is highly preferred over integrated
@@ -358,6 +450,14 @@ auto TriangleApp::pickPhysicalDevice() -> void
     {
         throw std::runtime_error("GPU('s) found, but none are suitable");
     }
+
+    // Bindless is optional, so fall back to regular descriptor sets if it isn't supported
+    bindlessEnabled = requestBindless && BindlessHeap::isSupported(physicalDevice);
+    memoryBudgetEnabled = MemoryTracker::isBudgetSupported(physicalDevice);
+    hostImportEnabled = MeshCache::isHostImportSupported(physicalDevice);
+    occlusionCullingEnabled = enableOcclusionCulling && OcclusionCuller::isSupported(physicalDevice);
+    depthPrepassEnabled = enableDepthPrepass || occlusionCullingEnabled;
+    msaaSamples = getMaxUsableSampleCount();
 }
 
 auto TriangleApp::createLogicalDevice() -> void
@@ -372,6 +472,11 @@ auto TriangleApp::createLogicalDevice() -> void
                     indices.graphicsFamily.value(),
                     indices.presentFamily.value()
             };
+    asyncComputeEnabled = enableParticles && requestAsyncCompute && indices.computeFamily.has_value();
+    if(asyncComputeEnabled)
+    {
+        uniqueQueueFamililies.insert(indices.computeFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for(type::uint32 queueFamily : uniqueQueueFamililies)
@@ -384,16 +489,43 @@ auto TriangleApp::createLogicalDevice() -> void
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    /// This will be used later on
-    VkPhysicalDeviceFeatures deviceFeatures = {};
+    // Turn on the optional features the device has. Block-compressed formats the device
+        // can't sample get decoded on the CPU instead
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    enabledFeatures = {};
+    enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+    enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    enabledFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+    enabledFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+    // Culled draws are issued in batches when the device can, otherwise one indirect draw each
+    enabledFeatures.drawIndirectFirstInstance = occlusionCullingEnabled;
+    enabledFeatures.multiDrawIndirect = occlusionCullingEnabled && supportedFeatures.multiDrawIndirect;
+
+    std::vector<type::cstr> enabledExtensions = deviceExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = BindlessHeap::requiredFeatures();
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = static_cast<type::uint32>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<type::uint32>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.pEnabledFeatures = &enabledFeatures;
+    if(bindlessEnabled)
+    {
+        enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        // Extension features are enabled by chaining their struct in
+        createInfo.pNext = &indexingFeatures;
+    }
+    if(memoryBudgetEnabled)
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if(hostImportEnabled)
+    {
+        enabledExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+    createInfo.enabledExtensionCount = static_cast<type::uint32>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if(enableValidationLayers)
     {
@@ -414,6 +546,14 @@ auto TriangleApp::createLogicalDevice() -> void
     vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
     // Get handle for the presentation queue
     vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+    if(asyncComputeEnabled)
+    {
+        vkGetDeviceQueue(logicalDevice, indices.computeFamily.value(), 0, &computeQueue);
+    }
+
+    memoryTracker.init(physicalDevice, logicalDevice, memoryBudgetEnabled);
+    deletionQueue.init(logicalDevice, memoryTracker);
+    pipelineVariants.init(logicalDevice);
 }
 
 /**
@@ -456,6 +596,18 @@ auto TriangleApp::findQueueFamilies(VkPhysicalDevice device) -> TriangleApp::Que
         ++i;
     }
 
+    // A family that can't do graphics is usually backed by separate hardware queues,
+        // so work submitted to it runs alongside the graphics queue
+    for(type::uint32 family = 0; family < queueFamilyCount; ++family)
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -537,8 +689,8 @@ auto TriangleApp::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
         // Vulkan says that window manager allows custom resolution
     else
     {
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
+        int width = framebufferWidth;
+        int height = framebufferHeight;
         // Determine if vulkan's resolution or our custom resolution is the best fit
         VkExtent2D actualExtent =
                 {
@@ -589,6 +741,21 @@ auto TriangleApp::createSwapChain() -> void
     // the swap chain would be used for transferring an already
     // rendered-to image
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Captured frames are copied straight out of the swap chain images
+    captureSupported = enableFrameCapture && FrameCapture::supportsFormat(surfaceFormat.format) &&
+            (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    if(captureSupported)
+    {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    // The scaled scene is blitted into the swap chain images
+    dynamicResolutionEnabled = enableDynamicResolution
+            && DynamicResolution::isSupported(physicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(), surfaceFormat.format)
+            && (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    if(dynamicResolutionEnabled)
+    {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
 
     // Specify how to handle swap chain images across multiple queue families
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
@@ -627,12 +794,15 @@ auto TriangleApp::createSwapChain() -> void
     // For example, if the window is resized then a new swap chain need to
     // be entirely recreated and the handle to the old swap chain needs
     // to be stored here.
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    VkSwapchainKHR oldSwapChain = swapChain;
+    createInfo.oldSwapchain = oldSwapChain;
 
     if(vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
     {
         throw std::runtime_error("Swap chain creation failed");
     }
+    // Images already acquired from the old one are still presented from it
+    deletionQueue.destroySwapchain(oldSwapChain);
 
     vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
@@ -650,221 +820,406 @@ auto TriangleApp::createImageViews() -> void
 
     for(type::size i = 0; i < swapChainImages.size(); ++i)
     {
-        VkImageViewCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.image = swapChainImages[i];
-        // How image data should be interpreted
-        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        createInfo.format = swapChainImageFormat;
-        // Color channel swizzling. We'll leave as default
-        // Can be used for stuff like mapping all color
-        // channels to red for monochrome color
-        createInfo.components.r =
-        createInfo.components.g =
-        createInfo.components.b =
-        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        // Images purpose and which part of the image should be accessed
-        // For example, with stereographic 3D the swap chain would
-        // have multiple layers. Multiple image views for each image
-        // could be created to represent left eyes, accessed by
-        // different layers
-        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        createInfo.subresourceRange.baseMipLevel = 0;
-        createInfo.subresourceRange.levelCount = 1;
-        createInfo.subresourceRange.baseArrayLayer = 0;
-        createInfo.subresourceRange.layerCount = 1;
-
-        if(vkCreateImageView(logicalDevice, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Image view creation failed");
-        }
+        swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
     }
 }
 
 /** Cleanup swapchain */
 auto TriangleApp::cleanupSwapchain() -> void
 {
-    for(type::size i = 0; i < swapChainFramebuffers.size(); ++i)
+    // Everything here may still be in use by frames in flight, so it's all retired
+        // and destroyed once they're done instead of waiting for the device to idle.
+        // Framebuffers, render passes and the images the graph owns
+    renderGraph.reset();
+
+    pipelineVariants.retire(deletionQueue);
+    deletionQueue.destroyPipelineLayout(pipelineLayout);
+    spriteBatch.retirePipelines(deletionQueue);
+    if(enableParticles)
     {
-        vkDestroyFramebuffer(logicalDevice, swapChainFramebuffers[i], nullptr);
+        particleSystem.retirePipelines(deletionQueue);
     }
 
-    vkFreeCommandBuffers(logicalDevice, commandPool, static_cast<type::uint32>(commandBuffers.size()), commandBuffers.data());
-
-    vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
-    vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
-
     for(type::size i = 0; i < swapChainImageViews.size(); ++i)
     {
-        vkDestroyImageView(logicalDevice, swapChainImageViews[i], nullptr);
+        deletionQueue.destroyImageView(swapChainImageViews[i]);
     }
 
-    vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
-
     for(type::size i = 0; i < swapChainImages.size(); ++i)
     {
-        vkDestroyBuffer(logicalDevice, uniformBuffers[i], nullptr);
-        vkFreeMemory(logicalDevice, uniformBufferMemories[i], nullptr);
+        deletionQueue.destroyBuffer(uniformBuffers[i]);
+        deletionQueue.freeMemory(uniformBufferMemories[i]);
+
+        // Freeing the memory unmaps it
+        deletionQueue.destroyBuffer(transformBuffers[i]);
+        deletionQueue.freeMemory(transformBufferMemories[i]);
+    }
+    if(bindlessEnabled)
+    {
+        // Indices handed out again right away would be overwritten under frames still reading them
+        std::vector<type::uint32> indices = uniformBufferIndices;
+        indices.insert(indices.end(), transformBufferIndices.begin(), transformBufferIndices.end());
+        deletionQueue.retire([this, indices]()
+        {
+            for(type::uint32 index : indices)
+            {
+                bindlessHeap.releaseStorageBuffer(index);
+            }
+        });
+        uniformBufferIndices.clear();
+        transformBufferIndices.clear();
     }
-    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    // Sets referencing the old uniform buffers are dropped in bulk
+    retireDescriptorSets();
 }
 
 /** Recreate swap chain */
 auto TriangleApp::recreateSwapChain() -> void
 {
-    // Frame buffer size is 0 while window is minimizing,
-        // so wait until its not
-    int width, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
-    while(width == 0 || height == 0)
+    // Frame buffer size is 0 while window is minimized. Frames are skipped
+        // until it isn't, then this is tried again
+    if(framebufferWidth == 0 || framebufferHeight == 0)
     {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
+        swapChainStale = true;
+        return;
     }
-
-    // Make sure no resources are in use
-    vkDeviceWaitIdle(logicalDevice);
+    swapChainStale = false;
 
     cleanupSwapchain();
 
     createSwapChain();
     createImageViews();
-    createRenderPass();
+    createRenderGraph();
+    if(occlusionCullingEnabled)
+    {
+        occlusionCuller.resize(swapChainExtent);
+    }
     createGraphicsPipeline();
-    createFramebuffers();
+    spriteBatch.createPipelines(renderGraph.getRenderPass(spritePass), renderGraph.getSubpass(spritePass),
+            spritePass == mainPass ? msaaSamples : VK_SAMPLE_COUNT_1_BIT);
+    if(enableParticles)
+    {
+        particleSystem.createPipelines(renderGraph.getRenderPass(mainPass), renderGraph.getSubpass(mainPass), msaaSamples);
+    }
     createUniformBuffers();
-    createDescriptorPool();
     createDescriptorSets();
-    createCommandBuffers();
+    // The fences are for frames drawing to the old images
+    imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
 }
 
 /**
- * Render Pass Setup
+ * Image Creation
  */
-auto TriangleApp::createRenderPass() -> void
-{
-    VkAttachmentDescription colorAttachment = {};
-    // Format should match the swap chain format
-    colorAttachment.format = swapChainImageFormat;
-    // No multisampling yet, so 1 sample is fine
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    // What to do with data before and after rendering
-        // Applies to color and depth data
-    // We want to present a rendered triangle, so we're
-        // going to store
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    //** Stencil config is set by stencilLoadOp and stencilStoreOp
-        // but we're not doing anything with that for now so it can be
-        // left out
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    // Set pixel layout in memory for framebuffers and textures
-        // initialLayout is the layout of an image before render pass
-        // finalLayout is what to transition to after render pass
-    // These settings mean that we don't care about the layout
-        // the previous pixel layout and to just convert it.
-        // This means that there is no guarantee for the
-        // preservation of the original image, but we don't
-        // care about that anyway since we're just rendering
-        // then immediately discarding
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    /* Sub Passes */
-    //** Subpasses are post-rendering operations depending on the contents
-        // of the framebuffer contents. Used for post-processing. Grouping
-        // all of these sub passes into a group bundles into into a single
-        // render pass for better performance and memory efficiency
-
-    // Subpass attachment reference
-    VkAttachmentReference colorAttachmentRef = {};
-    // Index of attachment to reference from attachments desc. array
-    colorAttachmentRef.attachment = 0;
-    // Layout we want that attachment to have during a subpass with
-        // this reference.
-        // This attachment is for use as a color buffer, so we'll use
-        // the layout with best performance
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Subpass description
-    VkSubpassDescription subpass = {};
-    // Possibility of vulkan supporting compute pipelines in future,
-        // so we have to be explicit that this is for graphics
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    // Attach color attachment
-    subpass.colorAttachmentCount = 1;
-    // Index of this attachment is directly referenced in
-        // fragment shader by the layout(location = 0) out vec4 outColor;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    // Subpass dependencies
-    VkSubpassDependency dependency = {};
-    // Set dependency to implicit subpass before render
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    // Index of subpass that we depend on after render
-    dependency.dstSubpass = 0;
-    // Wait for swap chain to reading image before accessing by waiting for
-        // for the color attachment output
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    // Prevent transition from happening until reading and writing of color attachment
-        // is done
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if(vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Render Pass setup failed");
+auto TriangleApp::createImage(type::uint32 width, type::uint32 height, VkSampleCountFlagBits numSamples, VkFormat format,
+                              VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props,
+                              MemoryTracker::Category category, VkImage &image, VkDeviceMemory &imageMemory) -> void
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    // Optimal tiling lets the driver lay texels out however is fastest for the GPU
+    imageInfo.tiling = tiling;
+    // Contents are discarded on the first transition anyway
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = numSamples;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateImage(logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Image creation failed");
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(logicalDevice, image, &memReq);
+
+    // Lazily allocated memory only gets physical backing if the GPU actually needs it,
+        // which on tilers means transient attachments never leave tile memory
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryTracker.chooseMemoryType(memReq.memoryTypeBits,
+            props & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, props & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+    if(memoryTracker.allocate(allocInfo, category, imageMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Image memory allocation failed");
     }
+
+    vkBindImageMemory(logicalDevice, image, imageMemory, 0);
+}
+
+auto TriangleApp::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) -> VkImageView
+{
+    VkImageViewCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image = image;
+    // How image data should be interpreted
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = format;
+    // Color channel swizzling. We'll leave as default
+    // Can be used for stuff like mapping all color
+    // channels to red for monochrome color
+    createInfo.components.r =
+    createInfo.components.g =
+    createInfo.components.b =
+    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    // Images purpose and which part of the image should be accessed
+    // For example, with stereographic 3D the swap chain would
+    // have multiple layers. Multiple image views for each image
+    // could be created to represent left eyes, accessed by
+    // different layers
+    createInfo.subresourceRange.aspectMask = aspectFlags;
+    createInfo.subresourceRange.baseMipLevel = 0;
+    createInfo.subresourceRange.levelCount = 1;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if(vkCreateImageView(logicalDevice, &createInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Image view creation failed");
+    }
+    return imageView;
 }
 
 /**
- * Graphics Pipeline Creation
+ * Multisampling Setup
+ */
+auto TriangleApp::getMaxUsableSampleCount() -> VkSampleCountFlagBits
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    // Both color and depth have to support the sample count
+    VkSampleCountFlags counts = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+
+    // Walk down from the requested count to the first one supported
+    for(VkSampleCountFlags count = requestedMsaaSamples; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+    {
+        if(counts & count)
+        {
+            return static_cast<VkSampleCountFlagBits>(count);
+        }
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+/**
+ * Depth Buffer Creation
  */
-auto TriangleApp::readFile(const std::string& fileName, std::vector<char>& buffer) -> std::vector<char>
+auto TriangleApp::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling,
+                                      VkFormatFeatureFlags features) -> VkFormat
 {
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+    for(VkFormat format : candidates)
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
 
-    type::size fileSize = static_cast<type::size>(file.tellg());
-    buffer.resize(fileSize);
+        if(tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
+        {
+            return format;
+        }
+        else if(tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+        {
+            return format;
+        }
+    }
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    throw std::runtime_error("No supported format among candidates");
+}
 
-    return buffer;
+auto TriangleApp::findDepthFormat() -> VkFormat
+{
+    // Ordered by preference. Stencil isn't used, so a pure 32 bit depth format
+        // comes first and the packed depth/stencil formats are fallbacks.
+        // Occlusion culling builds its depth pyramid by sampling it
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if(occlusionCullingEnabled)
+    {
+        features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    }
+    return findSupportedFormat(
+            {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+            VK_IMAGE_TILING_OPTIMAL, features);
 }
 
-auto TriangleApp::createShaderModule(const std::vector<char> &code) -> VkShaderModule
+/**
+ * Render Graph Setup
+ */
+auto TriangleApp::createRenderGraph() -> void
 {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    // Vector class already ensures data alignment requirements
-    createInfo.pCode = reinterpret_cast<const type::uint32*>(code.data());
+    depthFormat = findDepthFormat();
+    renderGraph.init(logicalDevice, memoryTracker, deletionQueue);
+
+    // Swap chain images are owned by the swap chain and have to end up ready for presenting.
+        // The graph picks the one to render to from the variant it is executed with
+    RenderGraph::ResourceHandle backbuffer = renderGraph.importImage("Backbuffer",
+            {swapChainImageFormat, swapChainExtent, VK_SAMPLE_COUNT_1_BIT},
+            swapChainImages, swapChainImageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    // Depth never leaves the render pass unless it's culled against, so the graph can usually make it transient
+    RenderGraph::ResourceHandle depth = renderGraph.createImage("Depth", {depthFormat, swapChainExtent, msaaSamples});
+    // A scaled scene is rendered into the corner of a full size image and upscaled from there, so changing
+        // the scale doesn't need a new graph
+    RenderGraph::ResourceHandle scene = backbuffer;
+    if(dynamicResolutionEnabled)
+    {
+        scene = renderGraph.createImage("Scene Color", {swapChainImageFormat, swapChainExtent, VK_SAMPLE_COUNT_1_BIT});
+    }
+    // Without multisampling we render straight into the scene image,
+        // otherwise into a multisampled target that gets resolved into it
+    RenderGraph::ResourceHandle color = scene;
+    if(msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        color = renderGraph.createImage("MSAA Color", {swapChainImageFormat, swapChainExtent, msaaSamples});
+    }
+
+    // 1.0 is the far plane
+    const VkClearDepthStencilValue depthClear = {1.0f, 0};
+    const VkClearColorValue colorClear = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+    if(depthPrepassEnabled)
+    {
+        depthPrepassPass = renderGraph.addPass("Depth Prepass",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.writeDepth(depth, depthClear);
+                },
+                {
+                        {
+                                [this](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                                {
+                                    recordDepthPrepass(commandBuffer, imageIndex);
+                                },
+                                [this](type::uint32 imageIndex) { return opaqueDrawKey(imageIndex); }
+                        }
+                });
+    }
+
+    if(occlusionCullingEnabled)
+    {
+        // Splits the prepass and main pass into two render passes, with the pyramid built in between
+        occlusionCullPass = renderGraph.addPass("Occlusion Cull",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.sample(depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                    builder.keepAlive();
+                },
+                [this, depth](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                {
+                    occlusionCuller.recordLateCull(commandBuffer, static_cast<type::uint32>(currentFrame),
+                            uniformBuffers[imageIndex], transformBuffers[imageIndex], renderGraph.getImageView(depth),
+                            renderExtent);
+                });
+    }
+
+    mainPass = renderGraph.addPass("Main",
+            [&](RenderGraph::PassBuilder& builder)
+            {
+                builder.writeColor(color, colorClear);
+                // With the prepass depth is already final, so only test against it. The objects found
+                    // visible by the occlusion cull still have to add theirs
+                if(occlusionCullingEnabled)
+                {
+                    builder.writeDepth(depth);
+                }
+                else if(depthPrepassEnabled)
+                {
+                    builder.readDepth(depth);
+                }
+                else
+                {
+                    builder.writeDepth(depth, depthClear);
+                }
+                if(msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+                {
+                    builder.resolve(color, scene);
+                }
+            },
+            {
+                    // Unchanged from frame to frame unless objects move in the draw order or change level of detail
+                    {
+                            [this](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                            {
+                                recordMainPass(commandBuffer, imageIndex);
+                            },
+                            [this](type::uint32 imageIndex) { return opaqueDrawKey(imageIndex); }
+                    },
+                    {
+                            [this](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                            {
+                                recordOverlays(commandBuffer, imageIndex);
+                            },
+                            nullptr
+                    }
+            });
+    spritePass = mainPass;
+
+    if(dynamicResolutionEnabled)
+    {
+        renderGraph.addPass("Upscale",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.copyFrom(scene);
+                    builder.copyTo(backbuffer);
+                },
+                [this, scene](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                {
+                    DynamicResolution::recordUpscale(commandBuffer, renderGraph.getImage(scene), renderExtent,
+                            swapChainImages[imageIndex], swapChainExtent);
+                });
+        // Drawn over the upscaled image, so it stays sharp. Nothing is cleared, the scene is already there
+        spritePass = renderGraph.addPass("Sprites",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.writeColor(backbuffer);
+                },
+                [this](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                {
+                    spriteBatch.record(commandBuffer, swapChainExtent);
+                });
+    }
 
-    VkShaderModule shaderModule;
-    if(vkCreateShaderModule(logicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    if(captureSupported)
     {
-        throw std::runtime_error("Failed to create shader module");
+        // Nothing in the graph reads the copy, so the pass has to be kept alive. It's there even while
+            // not capturing, since a layout transition costs less than recompiling the graph on every toggle
+        capturePass = renderGraph.addPass("Capture",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.copyFrom(backbuffer);
+                    builder.keepAlive();
+                },
+                [this](VkCommandBuffer commandBuffer, type::uint32 imageIndex)
+                {
+                    frameCapture.record(commandBuffer, swapChainImages[imageIndex], swapChainExtent,
+                                        swapChainImageFormat, inFlightFences[currentFrame]);
+                });
     }
-    return shaderModule;
+
+    // The prepass and main pass render to the same area, so they end up as two subpasses of one render pass
+    renderGraph.compile();
 }
 
+/**
+ * Graphics Pipeline Creation
+ */
 /* Describe the layout for the uniform buffer */
 auto TriangleApp::createDescriptorSetLayout() -> void
 {
+    // The bindless heap brings its own layout covering every resource
+    if(bindlessEnabled)
+    {
+        bindlessHeap.init(physicalDevice, logicalDevice);
+        return;
+    }
+
     // Describe the binding in the shader that we want to link to
     VkDescriptorSetLayoutBinding uboLayoutBinding = {};
     uboLayoutBinding.binding = 0;
@@ -875,27 +1230,44 @@ auto TriangleApp::createDescriptorSetLayout() -> void
     // For if we're doing image sampling
     uboLayoutBinding.pImmutableSamplers = nullptr;
 
+    VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
+    samplerLayoutBinding.binding = 1;
+    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerLayoutBinding.descriptorCount = 1;
+    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    samplerLayoutBinding.pImmutableSamplers = nullptr;
+
+    // World matrices of every scene node, indexed by the draw's instance index
+    VkDescriptorSetLayoutBinding transformLayoutBinding = {};
+    transformLayoutBinding.binding = 2;
+    transformLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    transformLayoutBinding.descriptorCount = 1;
+    transformLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    transformLayoutBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, transformLayoutBinding};
     VkDescriptorSetLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = static_cast<type::uint32>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
 
     if(vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
     {
         throw std::runtime_error("Descriptor layout set creation failed");
     }
 
+    // Build the update template for this layout so sets can be written in one call
+    descriptorSetCache.registerLayout(descriptorSetLayout, {uboLayoutBinding, samplerLayoutBinding, transformLayoutBinding});
 }
 
 auto TriangleApp::createGraphicsPipeline() -> void
 {
     /* Load and create shaders */
-    std::vector<char> vertShaderCode, fragShaderCode;
-    readFile("shaders/triangle.vert.spv", vertShaderCode);
-    readFile("shaders/triangle.frag.spv", fragShaderCode);
-
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    // Bindless variants read the MVP and texture from the heap's arrays instead of a UBO and combined sampler
+    VkShaderModule vertShaderModule = pipelineVariants.loadModule(
+            bindlessEnabled ? "shaders/triangle_bindless.vert.spv" : "shaders/triangle.vert.spv");
+    VkShaderModule fragShaderModule = pipelineVariants.loadModule(
+            bindlessEnabled ? "shaders/triangle_bindless.frag.spv" : "shaders/triangle.frag.spv");
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -915,6 +1287,7 @@ auto TriangleApp::createGraphicsPipeline() -> void
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    // Set per variant when the pipelines are created below
     fragShaderStageInfo.pSpecializationInfo = nullptr;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
@@ -939,32 +1312,16 @@ auto TriangleApp::createGraphicsPipeline() -> void
 
     /* Setup pipeline viewport */
 
-    // Setup viewport
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
-    // Depth buffer range
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    // Specify scissor rectangle
-        // Scissor rectangle basically sets an area where any pixels outside of the bounds
-        // get filtered out and aren't rendered
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-
-    // Combine viewport and scissor
+    // The viewport and scissor follow the resolution scale, so they're set
+        // at draw time by setSceneViewport and only their counts go in here
         // Some graphics cards support multiple viewports and scissors, so that's
         // why the struct members reference and array
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
 
     /* Setup Rasterizer */
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
@@ -993,21 +1350,33 @@ auto TriangleApp::createGraphicsPipeline() -> void
     rasterizer.depthBiasSlopeFactor = 0.0f;
 
     /* Setup Multisampling */
-    // Using multisampling requires enabling a GPU feature
     VkPipelineMultisampleStateCreateInfo multisampling = {};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    // We're going to disable multisampling for now
+    // Sample shading would also run the fragment shader per sample,
+        // which costs a lot more and only helps with shader aliasing
     multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    // Must match the sample count of the render pass attachments
+    multisampling.rasterizationSamples = msaaSamples;
     multisampling.minSampleShading = 1.0f;
     multisampling.pSampleMask = nullptr;
     multisampling.alphaToCoverageEnable = VK_FALSE;
     multisampling.alphaToOneEnable = VK_FALSE;
 
     /* Depth and Stencil Testing */
-    /*
-     * None for now
-     */
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    // With a prepass depth is already final, so the color pass only needs to
+        // compare against it. LESS_OR_EQUAL lets the surfaces laid down by the
+        // prepass through while everything behind them gets rejected early.
+        // Occlusion culling's prepass only has last frame's visible objects, so the rest still write depth
+    depthStencil.depthWriteEnable = !depthPrepassEnabled || occlusionCullingEnabled ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = depthPrepassEnabled ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
+    // Only keep fragments that fall in a specific depth range
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+    depthStencil.stencilTestEnable = VK_FALSE;
 
     /* Color Blending */
     // ** Two types of color blending structs
@@ -1038,20 +1407,28 @@ auto TriangleApp::createGraphicsPipeline() -> void
     colorBlending.blendConstants[3] = 0.0f;
 
     /* Dynamic States */
-    /*
-     * None for now, but this would allow for stuff like dynamic viewport state that
-     * would be set at drawtime
-     */
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     /* Pipeline Layout */
     //** Pipeline layout is where uniform values in shaders are specified
         // so they can be used
+    VkDescriptorSetLayout setLayout = bindlessEnabled ? bindlessHeap.getLayout() : descriptorSetLayout;
+    // Bindless draws pick their resources through a few indices in push constants
+    VkPushConstantRange drawIndicesRange = {};
+    drawIndicesRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    drawIndicesRange.offset = 0;
+    drawIndicesRange.size = sizeof(BindlessDrawIndices);
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = bindlessEnabled ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = bindlessEnabled ? &drawIndicesRange : nullptr;
 
     if(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
     {
@@ -1067,59 +1444,60 @@ auto TriangleApp::createGraphicsPipeline() -> void
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // nullptr for now since we aren't using it
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // nullptr for now since we aren't using it
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    // Subpass index
-    pipelineInfo.subpass = 0;
+    // Render pass and subpass index the graph put the main pass in
+    pipelineInfo.renderPass = renderGraph.getRenderPass(mainPass);
+    pipelineInfo.subpass = renderGraph.getSubpass(mainPass);
     // These two settings for are if you're creating a new pipeline
         // based off an existing one. This allows for better efficiency
         // since you can create a new pipeline based off of an existing
-        // one with similar features
+        // one with similar features. The variants fill them in, deriving
+        // everything from the first pipeline they create
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    mainPipelines = {};
+    for(type::uint32 features : shaderVariants)
     {
-        throw std::runtime_error("Graphics Pipeline creation failed");
+        PipelineVariants::Specialization specialization;
+        for(type::uint32 feature = 0; feature < SHADER_FEATURE_COUNT; ++feature)
+        {
+            specialization.set(feature, (features >> feature) & 1u);
+        }
+        // Fragment stage comes second in shaderStages
+        shaderStages[1].pSpecializationInfo = specialization.getInfo();
+        mainPipelines[features] = pipelineVariants.get(pipelineInfo);
     }
 
-    // Cleanup shaders
-    vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
-    vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
-}
-
-/**
- * Swap Chain Framebuffers Creation
- */
-auto TriangleApp::createFramebuffers() -> void
-{
-    swapChainFramebuffers.resize(swapChainImageViews.size());
-
-    // Create framebuffers for each image view
-    for(type::size i = 0; i < swapChainImageViews.size(); ++i)
+    if(depthPrepassEnabled)
     {
-        VkImageView attachments[] =
-                {
-                    swapChainImageViews[i]
-                };
+        // Same geometry, but only the vertex stage and writing depth with no color output
+        VkPipelineDepthStencilStateCreateInfo prepassDepthStencil = depthStencil;
+        prepassDepthStencil.depthWriteEnable = VK_TRUE;
+        prepassDepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
 
-        VkFramebufferCreateInfo framebufferInfo = {};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
+        VkPipelineColorBlendStateCreateInfo prepassColorBlending = colorBlending;
+        prepassColorBlending.attachmentCount = 0;
+        prepassColorBlending.pAttachments = nullptr;
 
-        if(vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Framebuffer creation failed");
-        }
+        VkGraphicsPipelineCreateInfo prepassInfo = pipelineInfo;
+        // Vertex stage comes first in shaderStages
+        prepassInfo.stageCount = 1;
+        prepassInfo.pDepthStencilState = &prepassDepthStencil;
+        prepassInfo.pColorBlendState = &prepassColorBlending;
+        prepassInfo.renderPass = renderGraph.getRenderPass(depthPrepassPass);
+        prepassInfo.subpass = renderGraph.getSubpass(depthPrepassPass);
+
+        // The fragment stage is left out, so every feature combination shares this one
+        depthPrepassPipeline = pipelineVariants.get(prepassInfo);
     }
+
+    // Cleanup shaders
+    pipelineVariants.destroyModule(fragShaderModule);
+    pipelineVariants.destroyModule(vertShaderModule);
 }
 
 /**
@@ -1133,37 +1511,48 @@ auto TriangleApp::createCommandPool() -> void
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     // We're recording commands for drawing, so we use graphics family
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    // Optional flags for efficiency with reuse, but we're only recording
-        // the command buffers at the beginning of the program so we'll use none
-    poolInfo.flags = 0;
+    // Command buffers are re-recorded every frame, so they need to be resettable one by one
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
     {
         throw std::runtime_error("Command Pool creation failed");
     }
+    // The graph records its cached passes into secondary command buffers from here
+    renderGraph.setCommandPool(commandPool, MAX_FRAMES_IN_FLIGHT);
+
+    // Command buffers can only be submitted to queues of the family their pool was made for
+    if(asyncComputeEnabled)
+    {
+        poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily.value();
+        if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &computeCommandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Compute Command Pool creation failed");
+        }
+    }
 }
 
 /**
  * Vertex Buffer Creation
  */
-auto TriangleApp::findMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags properties) -> type::uint32
+auto TriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) -> void
 {
-    VkPhysicalDeviceMemoryProperties memProp;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProp);
-
-    // Check for memory type that satifies all requirements and return the index
-    for(type::uint32 i = 0; i < memProp.memoryTypeCount; ++i)
-    {
-        if((typeFilter & (1 << i)) && (memProp.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
-    }
+    copyBuffer(srcBuffer, dstBuffer, 0, size);
+}
 
-    throw std::runtime_error("Suitable memory type unavailable");
+auto TriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize srcOffset, VkDeviceSize size) -> void
+{
+    submitTransfer([&](VkCommandBuffer commandBuffer)
+    {
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = 0;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    });
 }
 
-auto TriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) -> void
+auto TriangleApp::submitTransfer(const std::function<void(VkCommandBuffer)>& record) -> void
 {
     // In the future, would be a good idea to create a command pool for short-term
         // buffers such as this
@@ -1182,13 +1571,7 @@ auto TriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSiz
     // Tell the driver that this command buffer will only be used once
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    VkBufferCopy copyRegion = {};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
+    record(commandBuffer);
     vkEndCommandBuffer(commandBuffer);
 
     // Submit the command buffer for execution
@@ -1204,99 +1587,45 @@ auto TriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSiz
     vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
 }
 
-auto TriangleApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props,
-                               VkBuffer &buffer, VkDeviceMemory &bufferMemory) -> void
-{
-    VkBufferCreateInfo bufferInfo = {};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    // Only one queue can own this buffer at a time
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create buffer");
-    }
-
-    VkMemoryRequirements memReq;
-    vkGetBufferMemoryRequirements(logicalDevice, buffer, &memReq);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, props);
-
-    // In real applications, vkAllocateMemory should not be called everytime a new buffer is created
-        // as there is a maximum number of allocations allowed.
-        // Allocating a large block and then using offsets for the buffers should be used instead
-    if(vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Buffer bufferMemory allocation failed");
-    }
-
-    // Last parameter is offset for this buffer in this bufferMemory section
-    vkBindBufferMemory(logicalDevice, buffer, bufferMemory, 0);
-}
-
-auto TriangleApp::createVertexBuffer() -> void
+auto TriangleApp::copyGeometry(VkBuffer source, VkDeviceSize vertexOffset, VkDeviceSize indexOffset,
+                               const std::vector<VertexRange>& vertexRanges) -> void
 {
-    //! Why a staging buffer is created to transfer data into the vertex buffer
+    //! Why the data goes through a separate buffer on its way into the vertex buffer
         // This allows the vertex buffer to only be accessible by the GPU as the
-        // staging buffer is the one that requires the flags to be accessible
+        // source buffer is the one that requires the flags to be accessible
         // by the CPU. This allows the driver to make memory optimizations
+    std::vector<GeometryPool::Upload> uploads;
+    for(type::size i = 0; i < opaqueDraws.size(); ++i)
+    {
+        DrawItem& draw = opaqueDraws[i];
+        // Each object gets a range of the pool holding the vertices it uses and every one of its levels
+        type::uint32 firstIndex = draw.lods[0].firstIndex;
+        type::uint32 endIndex = firstIndex;
+        for(type::uint32 level = 0; level < draw.lodCount; ++level)
+        {
+            firstIndex = std::min(firstIndex, draw.lods[level].firstIndex);
+            endIndex = std::max(endIndex, draw.lods[level].firstIndex + draw.lods[level].indexCount);
+        }
+        const VertexRange& vertexRange = vertexRanges[i];
+        GeometryPool::Allocation allocation = geometryPool.allocate(vertexRange.count, endIndex - firstIndex);
+        uploads.push_back({allocation, vertexOffset + vertexRange.first * sizeof(Vertex),
+                indexOffset + firstIndex * sizeof(GeometryPool::Index)});
+
+        // The indices still count from the first authored vertex, so the offset takes the object's first one back out
+        draw.vertexOffset = allocation.vertexOffset - static_cast<type::int32>(vertexRange.first);
+        for(type::uint32 level = 0; level < draw.lodCount; ++level)
+        {
+            draw.lods[level].firstIndex = draw.lods[level].firstIndex - firstIndex + allocation.firstIndex;
+        }
+        draw.indexCount = draw.lods[draw.lod].indexCount;
+        draw.firstIndex = draw.lods[draw.lod].firstIndex;
+    }
 
-    // Size of data to be contained in buffer
-    VkDeviceSize bufferSize = sizeof(vertices[0])*vertices.size();
-
-    /* Create Staging (Transfer) Buffer */
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    // Setup staging buffer as the source of copied data
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    /* Filling Staging Buffer */
-    void* data;
-    // Access region in memory defined by offset and size
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    // Copy the vertex data in the memory region
-    memcpy(data, vertices.data(), static_cast<type::size>(bufferSize));
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-    /* Create Vertex Buffer */
-    // Setup vertex buffer as destinaton of copied data
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            vertexBuffer, vertexBufferMemory);
-
-    // Copy the data from the staging buffer into the vertex buffer
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
-}
-
-auto TriangleApp::createIndexBuffer() -> void
-{
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), static_cast<type::size>(bufferSize));
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+    // Every object in one submission
+    submitTransfer([&](VkCommandBuffer commandBuffer)
+    {
+        geometryPool.recordUpload(commandBuffer, source, uploads);
+    });
 }
 
 auto TriangleApp::createUniformBuffers() -> void
@@ -1306,91 +1635,652 @@ auto TriangleApp::createUniformBuffers() -> void
     uniformBuffers.resize(swapChainImages.size());
     uniformBufferMemories.resize(swapChainImages.size());
 
+    // Bindless mode reads the matrices through the storage buffer array
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    if(bindlessEnabled)
+    {
+        usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    }
+
     for(type::size i = 0; i < swapChainImages.size(); ++i)
     {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        memoryTracker.createBuffer(bufferSize, usage,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTracker::Category::Uniform,
                 uniformBuffers[i], uniformBufferMemories[i]);
     }
+
+    // Sized for the scene as it is now. Every frame copies in what changed since the image was last drawn
+    VkDeviceSize transformBufferSize = std::max<VkDeviceSize>(sceneGraph.getNodeCount(), 1) * sizeof(glm::mat4);
+    transformBufferVersions.assign(swapChainImages.size(), NO_TRANSFORM_VERSION);
+    transformBuffers.resize(swapChainImages.size());
+    transformBufferMemories.resize(swapChainImages.size());
+    transformBufferMapped.resize(swapChainImages.size());
+    for(type::size i = 0; i < swapChainImages.size(); ++i)
+    {
+        memoryTracker.createBuffer(transformBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTracker::Category::Uniform,
+                transformBuffers[i], transformBufferMemories[i]);
+        void* data;
+        vkMapMemory(logicalDevice, transformBufferMemories[i], 0, transformBufferSize, 0, &data);
+        transformBufferMapped[i] = static_cast<glm::mat4*>(data);
+    }
 }
 
-auto TriangleApp::createDescriptorPool() -> void
+auto TriangleApp::createDescriptorAllocators() -> void
 {
-    // Which descriptor types are being used and how many
-    VkDescriptorPoolSize poolSize = {};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<type::uint32>(swapChainImages.size());
+    // Pools chain on as more sets are needed, so these are only starting sizes
+    DescriptorAllocator::PoolSizes uboPoolSizes;
+    uboPoolSizes.sizes = {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f}};
+    descriptorAllocator.init(logicalDevice, static_cast<type::uint32>(swapChainImages.size()), uboPoolSizes);
 
-    VkDescriptorPoolCreateInfo poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-    // Maximum amount of descriptor sets that can be allocated
-    poolInfo.maxSets = static_cast<type::uint32>(swapChainImages.size());
+    descriptorSetCache.init(logicalDevice, &descriptorAllocator);
+}
 
-    if(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Descriptor pool creation failed");
-    }
+auto TriangleApp::retireDescriptorSets() -> void
+{
+    // New sets come from fresh pools, the old ones are reset and reused once frames are done with them.
+        // Every set in the cache goes, including the particle and culling sets, which are fetched again when recorded
+    descriptorSetCache.clear();
+    std::vector<VkDescriptorPool> pools = descriptorAllocator.retirePools();
+    deletionQueue.retire([this, pools]()
+    {
+        descriptorAllocator.recyclePools(pools);
+    });
 }
 
 auto TriangleApp::createDescriptorSets() -> void
 {
-    std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    // Descriptor pool to allocate from
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<type::uint32>(swapChainImages.size());
-    allocInfo.pSetLayouts = layouts.data();
-
-    // Allocate a descriptor set for each swap chain image
-    descriptorSets.resize(swapChainImages.size());
-    if(vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+    // No per-image sets in bindless mode, just a slot in the heap for each uniform buffer
+    if(bindlessEnabled)
     {
-        throw std::runtime_error("Descriptor set allocation failed");
+        uniformBufferIndices.resize(swapChainImages.size());
+        transformBufferIndices.resize(swapChainImages.size());
+        for(type::size i = 0; i < swapChainImages.size(); ++i)
+        {
+            uniformBufferIndices[i] = bindlessHeap.registerStorageBuffer(uniformBuffers[i], 0, VK_WHOLE_SIZE);
+            transformBufferIndices[i] = bindlessHeap.registerStorageBuffer(transformBuffers[i], 0, VK_WHOLE_SIZE);
+        }
+        return;
     }
 
-    // Configure each descriptor
+    descriptorSets.resize(swapChainImages.size());
+
+    // Get a descriptor set for each swap chain image
+        // The cache only allocates and writes a new set for buffers it hasn't seen yet
     for(type::size i = 0; i < swapChainImages.size(); ++i)
     {
-        VkDescriptorBufferInfo bufferInfo = {};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        //bufferInfo.range = sizeof(UBO::MVP);
-        // VK_WHOLE_SIZE can be used instead since we're overwriting
+        // VK_WHOLE_SIZE can be used instead of sizeof(UBO::MVP) since we're overwriting
             // the whole buffer
-        bufferInfo.range = VK_WHOLE_SIZE;
-
-        VkWriteDescriptorSet descriptorWrite = {};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = descriptorSets[i];
-        // Binding index of the UBO in shader
-        descriptorWrite.dstBinding = 0;
-        // First index in array of descriptors being updated,
-            // but we're only updating one so this is 0
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        // Array (or single pointer) of descriptorCount structs
-            // that configure the descriptors
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        // Same but for descriptors for image data
-        descriptorWrite.pImageInfo = nullptr;
-        // Same but for descriptors for buffer views
-        descriptorWrite.pTexelBufferView = nullptr;
-
-        // Apply updates
-        vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+        descriptorSets[i] = descriptorSetCache.getSet(descriptorSetLayout,
+                {
+                        DescriptorInfo::fromBuffer(uniformBuffers[i], 0, VK_WHOLE_SIZE),
+                        DescriptorInfo::fromImage(textureStreamer.getSampler(), textureStreamer.getView(texture),
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+                        DescriptorInfo::fromBuffer(transformBuffers[i], 0, VK_WHOLE_SIZE)
+                });
+    }
+}
+
+/**
+ * Scene Graph
+ */
+auto TriangleApp::createScene() -> void
+{
+    sceneGraph.reserve(opaqueDraws.size() + 1);
+    spinnerNode = sceneGraph.createNode();
+    // Each quad hangs off the spinner, so they turn together
+    for(type::uint32 i = 0; i < opaqueDraws.size(); ++i)
+    {
+        opaqueDraws[i].node = sceneGraph.createNode(spinnerNode);
+        opaqueDraws[i].object = i;
+    }
+
+    // Each snapshot slot gets its own copy of the world matrices
+    for(type::uint32 i = 0; i < TripleBuffer<FrameSnapshot>::SLOT_COUNT; ++i)
+    {
+        snapshots.getSlot(i).worlds.resize(sceneGraph.getNodeCount());
+    }
+    sceneGraph.setTargetCount(TripleBuffer<FrameSnapshot>::SLOT_COUNT);
+    transformCopied.assign(sceneGraph.getNodeCount(), 0);
+}
+
+/**
+ * Texture Loading
+ */
+auto TriangleApp::createTextures() -> void
+{
+    TextureStreamer::Config config;
+    // The render thread may be asleep with nothing else to draw
+    config.onLoaded = [this] { wakeRenderThread(); };
+    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+    textureStreamer.init(physicalDevice, logicalDevice, memoryTracker, deletionQueue, graphicsQueue,
+            queueFamilyIndices.graphicsFamily.value(), enabledFeatures, config, bindlessEnabled ? &bindlessHeap : nullptr);
+
+    std::ifstream textureFile(TEXTURE_PATH);
+    if(textureFile.good())
+    {
+        texture = textureStreamer.load(TEXTURE_PATH);
+        return;
+    }
+
+    // No texture on disk, so make a checkerboard to have something to sample
+    constexpr type::uint32 size = 256;
+    constexpr type::uint32 squareSize = 32;
+    std::vector<type::uint8> pixels(size * size * 4);
+    for(type::uint32 y = 0; y < size; ++y)
+    {
+        for(type::uint32 x = 0; x < size; ++x)
+        {
+            type::uint8 value = ((x / squareSize + y / squareSize) % 2 == 0) ? 255 : 96;
+            type::uint8* pixel = &pixels[(y * size + x) * 4];
+            pixel[0] = value;
+            pixel[1] = value;
+            pixel[2] = value;
+            pixel[3] = 255;
+        }
+    }
+    texture = textureStreamer.createFromPixels(size, size, VK_FORMAT_R8G8B8A8_SRGB, pixels.data());
+}
+
+/**
+ * Sprite Overlay
+ */
+auto TriangleApp::createSpriteBatch() -> void
+{
+    SpriteBatch::Config config;
+    config.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    config.initialCapacity = overlaySpriteCount;
+    spriteBatch.init(logicalDevice, memoryTracker, graphicsQueue, commandPool, config,
+            &descriptorSetCache, bindlessEnabled ? &bindlessHeap : nullptr);
+    spriteBatch.createPipelines(renderGraph.getRenderPass(spritePass), renderGraph.getSubpass(spritePass),
+            spritePass == mainPass ? msaaSamples : VK_SAMPLE_COUNT_1_BIT);
+}
+
+auto TriangleApp::buildSpriteOverlay(std::vector<SpriteDraw>& sprites, float time) -> void
+{
+    sprites.clear();
+    // A slowly turning spiral of small quads around the edge of the window
+    glm::vec2 center = {simulationWidth * 0.5f, simulationHeight * 0.5f};
+    float maxRadius = glm::length(center);
+    for(type::uint32 i = 0; i < overlaySpriteCount; ++i)
+    {
+        float t = static_cast<float>(i) / overlaySpriteCount;
+        float angle = i * 2.39996f + time * 0.25f;
+        float radius = maxRadius * (0.55f + 0.45f * t);
+
+        SpriteBatch::Sprite sprite;
+        sprite.position = center + radius * glm::vec2(std::cos(angle), std::sin(angle));
+        sprite.size = glm::vec2(6.0f + 10.0f * t);
+        sprite.rotation = angle + time;
+        sprite.color = {0.5f + 0.5f * std::sin(angle), 0.5f + 0.5f * std::cos(angle * 0.5f), 1.0f - t, 0.75f};
+        // Every fourth sprite glows on top of the others
+        bool glow = i % 4 == 0;
+        sprites.push_back({sprite, 0, glow ? SpriteBatch::BlendMode::Additive : SpriteBatch::BlendMode::Alpha,
+                static_cast<type::uint8>(glow ? 1 : 0)});
     }
 }
 
+auto TriangleApp::drawSpriteOverlay() -> void
+{
+    // The streamed texture's view changes as mips come in
+    spriteBatch.setTexture(0, textureStreamer.getView(texture), textureStreamer.getSampler(),
+            textureStreamer.getBindlessIndex(texture), textureStreamer.getSamplerBindlessIndex());
+
+    spriteBatch.begin(static_cast<type::uint32>(currentFrame));
+    for(const auto& draw : renderSnapshot->sprites)
+    {
+        spriteBatch.draw(draw.sprite, draw.texture, draw.blend, draw.layer);
+    }
+    spriteBatch.end();
+}
+
+/**
+ * GPU Particles
+ */
+auto TriangleApp::createParticleSystem() -> void
+{
+    if(!enableParticles)
+    {
+        return;
+    }
+    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+    ParticleSystem::Config config;
+    // Up from the middle of the scene
+    config.emitterPosition = {0.0f, 0.0f, 0.0f};
+    config.graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+    if(asyncComputeEnabled)
+    {
+        config.computeFamily = queueFamilyIndices.computeFamily;
+    }
+    particleSystem.init(physicalDevice, logicalDevice, memoryTracker, &descriptorSetCache, config);
+    particleSystem.createPipelines(renderGraph.getRenderPass(mainPass), renderGraph.getSubpass(mainPass), msaaSamples);
+}
+
+auto TriangleApp::simulateParticles() -> void
+{
+    // Follows the snapshots' clock, so the particles pause along with the rest of the animation
+    float deltaSeconds = std::clamp(renderSnapshot->time - particleTime, 0.0f, 0.1f);
+    particleTime = renderSnapshot->time;
+    particleSystem.update(deltaSeconds);
+
+    // Otherwise recorded into the frame's command buffer, ahead of the render passes
+    if(!asyncComputeEnabled)
+    {
+        return;
+    }
+
+    VkCommandBuffer commandBuffer = computeCommandBuffers[currentFrame];
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Compute command buffer recording failed to start");
+    }
+    particleSystem.recordSimulation(commandBuffer);
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Compute command buffer recording failed");
+    }
+
+    // The graphics submission waits on the semaphore, and its fence covers this as well
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &computeFinishedSemaphores[currentFrame];
+    if(vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Compute command buffer submission failed");
+    }
+}
+
+/**
+ * Level of Detail
+ */
+auto TriangleApp::generateLods(std::vector<type::uint16>& indexData) -> void
+{
+    std::vector<glm::vec3> positions;
+    for(const auto& vertex : vertices)
+    {
+        positions.push_back(vertex.pos);
+    }
+
+    for(auto& draw : opaqueDraws)
+    {
+        std::vector<type::uint32> objectIndices(indices.begin() + draw.firstIndex,
+                indices.begin() + draw.firstIndex + draw.indexCount);
+        std::vector<meshlod::Level> levels = meshlod::generate(positions, objectIndices, lodConfig);
+
+        draw.lodCount = static_cast<type::uint32>(levels.size());
+        for(type::uint32 level = 0; level < draw.lodCount; ++level)
+        {
+            // Collapses only ever reuse existing vertices, so the indices still fit in 16 bits
+            draw.lods[level] = {static_cast<type::uint32>(levels[level].indices.size()),
+                    static_cast<type::uint32>(indexData.size()), levels[level].error};
+            for(type::uint32 index : levels[level].indices)
+            {
+                indexData.push_back(static_cast<type::uint16>(index));
+            }
+        }
+        draw.lod = 0;
+        draw.indexCount = draw.lods[0].indexCount;
+        draw.firstIndex = draw.lods[0].firstIndex;
+    }
+}
+
+auto TriangleApp::selectLods(const std::vector<glm::mat4>& worlds) -> void
+{
+    // Pixels covered by a unit at a distance of one along the view direction. Same projection the UBO uses
+    float pixelsPerUnit = static_cast<float>(std::max(simulationHeight, 1))
+            / (2.0f * std::tan(glm::radians(cameraFovDegrees) * 0.5f));
+    for(auto& draw : opaqueDraws)
+    {
+        const glm::mat4& world = worlds[draw.node];
+        // Errors are in object space, so they grow with the largest scale of the world matrix
+        float scale = 0.0f;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            scale = std::max(scale, std::sqrt(world[axis].x * world[axis].x + world[axis].y * world[axis].y
+                    + world[axis].z * world[axis].z));
+        }
+        glm::vec4 center = world * glm::vec4(draw.center, 1.0f);
+        float distance = std::max(glm::length(cameraEye - glm::vec3(center.x, center.y, center.z)), 0.001f);
+
+        float errors[MAX_LODS];
+        for(type::uint32 level = 0; level < draw.lodCount; ++level)
+        {
+            errors[level] = draw.lods[level].error * scale;
+        }
+        draw.lod = meshlod::select(errors, draw.lodCount, pixelsPerUnit / distance, draw.lod, lodErrorPixels, lodHysteresis);
+        draw.indexCount = draw.lods[draw.lod].indexCount;
+        draw.firstIndex = draw.lods[draw.lod].firstIndex;
+    }
+}
+
+/**
+ * Mesh Cache
+ */
+auto TriangleApp::meshCacheKey() -> type::uint64
+{
+    type::uint64 key = hash::fnv1a(vertices.data(), sizeof(vertices));
+    key = hash::fnv1a(indices.data(), sizeof(indices), key);
+    for(const auto& draw : opaqueDraws)
+    {
+        key = hash::combine(key, draw.indexCount);
+        key = hash::combine(key, draw.firstIndex);
+    }
+    key = hash::combine(key, meshlod::VERSION);
+    key = hash::combine(key, lodConfig.maxLevels);
+    key = hash::combine(key, lodConfig.reduction);
+    key = hash::combine(key, lodConfig.maxRelativeError);
+    return hash::combine(key, sizeof(LodRange));
+}
+
+auto TriangleApp::readMeshCache(const MeshCache& cache) -> bool
+{
+    const MeshCache::Entry* vertexBlob = cache.find(VERTEX_BLOB);
+    const MeshCache::Entry* indexBlob = cache.find(INDEX_BLOB);
+    const MeshCache::Entry* lodBlob = cache.find(LOD_BLOB);
+    using LodTable = decltype(DrawItem::lods);
+    if(vertexBlob == nullptr || indexBlob == nullptr || lodBlob == nullptr || vertexBlob->size % sizeof(Vertex) != 0
+       || lodBlob->size != opaqueDraws.size() * sizeof(LodTable))
+    {
+        return false;
+    }
+
+    // Everything is checked before any draw is touched, since building the cache again needs the draws as they were
+    std::vector<LodTable> tables(opaqueDraws.size());
+    std::memcpy(tables.data(), cache.data(*lodBlob), lodBlob->size);
+    type::uint64 indexCount = indexBlob->size / sizeof(type::uint16);
+    for(const LodTable& table : tables)
+    {
+        if(table[0].indexCount == 0)
+        {
+            return false;
+        }
+        for(const LodRange& range : table)
+        {
+            if(static_cast<type::uint64>(range.firstIndex) + range.indexCount > indexCount)
+            {
+                return false;
+            }
+        }
+    }
+
+    for(type::size i = 0; i < opaqueDraws.size(); ++i)
+    {
+        DrawItem& draw = opaqueDraws[i];
+        draw.lods = tables[i];
+        // Tables are zero filled past the last level
+        draw.lodCount = static_cast<type::uint32>(std::count_if(draw.lods.begin(), draw.lods.end(),
+                [](const LodRange& range) { return range.indexCount > 0; }));
+        draw.lod = 0;
+        draw.indexCount = draw.lods[0].indexCount;
+        draw.firstIndex = draw.lods[0].firstIndex;
+    }
+    return true;
+}
+
+auto TriangleApp::createGeometryBuffers() -> void
+{
+    // Bounding spheres and vertex ranges come from the authored ranges, before the levels replace them.
+        // Every level is a simplification of the same vertices, so both hold for all of them
+    std::vector<VertexRange> vertexRanges;
+    for(auto& draw : opaqueDraws)
+    {
+        draw.radius = 0.0f;
+        type::uint32 firstVertex = type::uint32_max;
+        type::uint32 lastVertex = 0;
+        for(type::uint32 i = draw.firstIndex; i < draw.firstIndex + draw.indexCount; ++i)
+        {
+            draw.radius = std::max(draw.radius, glm::length(vertices[indices[i]].pos - draw.center));
+            firstVertex = std::min<type::uint32>(firstVertex, indices[i]);
+            lastVertex = std::max<type::uint32>(lastVertex, indices[i]);
+        }
+        vertexRanges.push_back({firstVertex, lastVertex - firstVertex + 1});
+    }
+    geometryPool.init(logicalDevice, memoryTracker, geometryPoolConfig);
+
+    type::uint64 key = meshCacheKey();
+    MeshCache cache;
+    std::vector<type::uint16> indexData;
+    if(!cache.open(MESH_CACHE_PATH, key) || !readMeshCache(cache))
+    {
+        // Missing or stale, so build it again
+        cache.close();
+        generateLods(indexData);
+        std::vector<decltype(DrawItem::lods)> tables;
+        for(const auto& draw : opaqueDraws)
+        {
+            tables.push_back(draw.lods);
+        }
+        try
+        {
+            MeshCache::write(MESH_CACHE_PATH, key,
+                    {
+                            {VERTEX_BLOB, vertices.data(), sizeof(vertices)},
+                            {INDEX_BLOB, indexData.data(), indexData.size() * sizeof(type::uint16)},
+                            {LOD_BLOB, tables.data(), tables.size() * sizeof(tables[0])}
+                    });
+            cache.open(MESH_CACHE_PATH, key);
+        }
+        catch(const std::runtime_error& error)
+        {
+            // Not fatal, the geometry just gets built again at every launch
+            std::cerr << error.what() << std::endl;
+        }
+    }
+
+    // Straight from what was just built if the cache couldn't be written
+    const void* vertexData = vertices.data();
+    VkDeviceSize vertexSize = sizeof(vertices);
+    const void* indexSource = indexData.data();
+    VkDeviceSize indexSize = indexData.size() * sizeof(type::uint16);
+    if(cache.isOpen())
+    {
+        const MeshCache::Entry* vertexBlob = cache.find(VERTEX_BLOB);
+        const MeshCache::Entry* indexBlob = cache.find(INDEX_BLOB);
+        VkBuffer hostBuffer;
+        VkDeviceMemory hostMemory;
+        if(hostImportEnabled && cache.importMapping(physicalDevice, logicalDevice, memoryTracker, hostBuffer, hostMemory))
+        {
+            // The GPU reads the file's pages itself, so the CPU never touches the data
+            copyGeometry(hostBuffer, vertexBlob->offset, indexBlob->offset, vertexRanges);
+            vkDestroyBuffer(logicalDevice, hostBuffer, nullptr);
+            memoryTracker.free(hostMemory);
+            return;
+        }
+        vertexData = cache.data(*vertexBlob);
+        vertexSize = vertexBlob->size;
+        indexSource = cache.data(*indexBlob);
+        indexSize = indexBlob->size;
+    }
+
+    // Both go into one staging buffer, copied straight out of the mapping when there is one
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    memoryTracker.createBuffer(vertexSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTracker::Category::Staging,
+            stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, vertexSize + indexSize, 0, &data);
+    memcpy(data, vertexData, static_cast<type::size>(vertexSize));
+    memcpy(static_cast<type::uint8*>(data) + vertexSize, indexSource, static_cast<type::size>(indexSize));
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+    copyGeometry(stagingBuffer, 0, vertexSize, vertexRanges);
+
+    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+    memoryTracker.free(stagingBufferMemory);
+}
+
 /**
  * Command Buffer Allocation
  */
+auto TriangleApp::sortDrawsFrontToBack() -> void
+{
+    // Same view the UBO uses
+    glm::mat4 view = glm::lookAt(cameraEye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    auto viewDepth = [this, &view](const DrawItem& draw)
+    {
+        // Camera looks down -z in view space, so larger z means closer
+        return -(view * sceneGraph.getWorld(draw.node) * glm::vec4(draw.center, 1.0f)).z;
+    };
+
+    std::sort(opaqueDraws.begin(), opaqueDraws.end(), [&viewDepth](const DrawItem& a, const DrawItem& b)
+    {
+        return viewDepth(a) < viewDepth(b);
+    });
+}
+
+auto TriangleApp::bindDrawResources(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void
+{
+    // Every object's geometry is in the pool, so the buffers are bound once and draws pick their range
+    geometryPool.bind(commandBuffer);
+
+    if(bindlessEnabled)
+    {
+        // The heap is bound once and each draw refers to its resources by index
+        VkDescriptorSet heapSet = bindlessHeap.getSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout, 0, 1, &heapSet, 0, nullptr);
+
+        BindlessDrawIndices drawIndices = {};
+        drawIndices.mvpIndex = uniformBufferIndices[imageIndex];
+        drawIndices.textureIndex = textureStreamer.getBindlessIndex(texture);
+        drawIndices.samplerIndex = textureStreamer.getSamplerBindlessIndex();
+        drawIndices.transformIndex = transformBufferIndices[imageIndex];
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0, sizeof(drawIndices), &drawIndices);
+    }
+    else
+    {
+        // Bind the correct descriptor set for each swap chain image to the
+            // descriptors in the shader
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+    }
+}
+
+auto TriangleApp::setSceneViewport(VkCommandBuffer commandBuffer) -> void
+{
+    VkViewport viewport = {};
+    viewport.width = static_cast<float>(renderExtent.width);
+    viewport.height = static_cast<float>(renderExtent.height);
+    // Depth buffer range
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    // Anything outside of the scaled corner is never upscaled, so nothing is drawn there
+    VkRect2D scissor = {};
+    scissor.extent = renderExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+auto TriangleApp::recordDepthPrepass(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void
+{
+    setSceneViewport(commandBuffer);
+    bindDrawResources(commandBuffer, imageIndex);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassPipeline);
+    // Only what was visible last frame, in one go since every draw shares the pipeline
+    if(occlusionCullingEnabled)
+    {
+        occlusionCuller.drawEarly(commandBuffer, 0, static_cast<type::uint32>(renderSnapshot->opaqueDraws.size()));
+        return;
+    }
+    for(const auto& draw : renderSnapshot->opaqueDraws)
+    {
+        // The shaders use the instance index to look up the node's world matrix
+        vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, draw.node);
+    }
+}
+
+auto TriangleApp::recordMainPass(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void
+{
+    setSceneViewport(commandBuffer);
+    bindDrawResources(commandBuffer, imageIndex);
+    // Draw commands, nearest first. Each binds the pipeline for its shader features if it isn't bound already
+    const auto& draws = renderSnapshot->opaqueDraws;
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    type::uint32 first = 0;
+    for(type::uint32 i = 0; i < draws.size(); ++i)
+    {
+        VkPipeline pipeline = mainPipelines[draws[i].shaderFeatures];
+        if(pipeline != boundPipeline)
+        {
+            if(occlusionCullingEnabled && i > first)
+            {
+                occlusionCuller.drawLate(commandBuffer, first, i - first);
+            }
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            first = i;
+        }
+        // Culled draws are left in with no instances, so runs sharing a pipeline go out as one indirect draw
+        if(!occlusionCullingEnabled)
+        {
+            vkCmdDrawIndexed(commandBuffer, draws[i].indexCount, 1, draws[i].firstIndex, draws[i].vertexOffset,
+                    draws[i].node);
+        }
+    }
+    if(occlusionCullingEnabled && draws.size() > first)
+    {
+        occlusionCuller.drawLate(commandBuffer, first, static_cast<type::uint32>(draws.size()) - first);
+    }
+}
+
+auto TriangleApp::recordOverlays(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void
+{
+    // Tested against the opaque geometry's depth, so they come after it
+    if(enableParticles)
+    {
+        particleSystem.recordDraw(commandBuffer, frameCamera.view, frameCamera.proj, renderExtent);
+    }
+    // Overlay goes on top, blended over the scene. With the scene upscaled it has a pass of its own
+    if(spritePass == mainPass)
+    {
+        spriteBatch.record(commandBuffer, swapChainExtent);
+    }
+}
+
+auto TriangleApp::opaqueDrawKey(type::uint32 imageIndex) -> type::uint64
+{
+    // The world matrices are read from the transform buffers, so moving objects doesn't change the recording
+    type::uint64 key = hash::fnvOffset;
+    for(const auto& draw : renderSnapshot->opaqueDraws)
+    {
+        key = hash::combine(key, draw.indexCount);
+        key = hash::combine(key, draw.firstIndex);
+        key = hash::combine(key, draw.vertexOffset);
+        key = hash::combine(key, draw.node);
+        key = hash::combine(key, draw.shaderFeatures);
+    }
+    key = hash::combine(key, mainPipelines);
+    key = hash::combine(key, depthPrepassPipeline);
+    key = hash::combine(key, renderExtent.width);
+    key = hash::combine(key, renderExtent.height);
+    if(bindlessEnabled)
+    {
+        key = hash::combine(key, uniformBufferIndices[imageIndex]);
+        key = hash::combine(key, transformBufferIndices[imageIndex]);
+        key = hash::combine(key, textureStreamer.getBindlessIndex(texture));
+        return hash::combine(key, textureStreamer.getSamplerBindlessIndex());
+    }
+    return hash::combine(key, descriptorSets[imageIndex]);
+}
+
 auto TriangleApp::createCommandBuffers() -> void
 {
-    commandBuffers.resize(swapChainFramebuffers.size());
+    // One per frame in flight. Each is re-recorded when its frame comes around,
+        // so it always refers to the current texture views
+    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocateInfo = {};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1409,63 +2299,108 @@ auto TriangleApp::createCommandBuffers() -> void
         throw std::runtime_error("Command buffer allocation failed");
     }
 
-    /* Start command buffer recording */
-    for(type::size i = 0; i < commandBuffers.size(); ++i)
+    if(asyncComputeEnabled)
     {
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        // The flags are for how the command buffer that will be used. None of the options
-            // apply to what we're doing right now
-        beginInfo.flags = 0;
-        beginInfo.pInheritanceInfo = nullptr;
-
-        if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+        computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        allocateInfo.commandPool = computeCommandPool;
+        if(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, computeCommandBuffers.data()) != VK_SUCCESS)
         {
-            throw std::runtime_error("Command buffer recording failed to start");
+            throw std::runtime_error("Compute command buffer allocation failed");
         }
+    }
+}
 
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        // Use our framebuffer that we set up as a color attachment
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
-        // Set size of render area
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapChainExtent;
-        // Define the clear values for the color attachment load op
-            // (which as set to *_LOAD_OP_CLEAR
-        static constexpr VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        // Last parameter is to set that it is for the primary command buffer.
-            // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFER would be for commands
-            // executed from secondary command buffers
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        /* Begin basic drawing */
-        // Bind the pipeline that we want to use
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-        // Bind the vertex and index buffer(s)
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+auto TriangleApp::recordCommandBuffer(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // Recorded fresh for every submission
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
 
-        // Bind the correct descriptor set for each swap chain image to the
-            // descriptors in the shader
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
-        // Draw command
-        vkCmdDrawIndexed(commandBuffers[i], static_cast<type::uint32>(indices.size()), 1, 0, 0, 0);
-        vkCmdEndRenderPass(commandBuffers[i]);
-        if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Command buffer recording failed");
-        }
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Command buffer recording failed to start");
     }
 
+    // Without a separate compute queue the particles are simulated first, on this one
+    if(enableParticles && !asyncComputeEnabled)
+    {
+        particleSystem.recordSimulation(commandBuffer);
+    }
+
+    if(dynamicResolutionEnabled)
+    {
+        dynamicResolution.begin(commandBuffer, static_cast<type::uint32>(currentFrame));
+    }
+
+    // The first phase's draws have to be there before the prepass reads them
+    if(occlusionCullingEnabled)
+    {
+        occlusionCuller.recordEarlyCull(commandBuffer, static_cast<type::uint32>(currentFrame),
+                uniformBuffers[imageIndex], transformBuffers[imageIndex]);
+    }
+
+    // Render passes, barriers and the passes' own draws, targeting the acquired swap chain image
+    renderGraph.execute(commandBuffer, imageIndex);
+
+    if(dynamicResolutionEnabled)
+    {
+        dynamicResolution.end(commandBuffer, static_cast<type::uint32>(currentFrame));
+    }
+
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Command buffer recording failed");
+    }
+}
+
+/**
+ * Dynamic Resolution
+ */
+auto TriangleApp::createDynamicResolution() -> void
+{
+    if(!enableDynamicResolution)
+    {
+        return;
+    }
+    dynamicResolution.init(physicalDevice, logicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(),
+            MAX_FRAMES_IN_FLIGHT, dynamicResolutionConfig);
+}
+
+/**
+ * Occlusion Culling
+ */
+auto TriangleApp::createOcclusionCuller() -> void
+{
+    if(!occlusionCullingEnabled)
+    {
+        return;
+    }
+    OcclusionCuller::Config config;
+    config.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    // The pyramid is built from the multisampled depth directly, there's nothing resolved to build it from
+    config.depthSamples = msaaSamples;
+    config.multiDrawIndirect = enabledFeatures.multiDrawIndirect;
+    occlusionCuller.init(physicalDevice, logicalDevice, memoryTracker, deletionQueue, &descriptorSetCache, config);
+    occlusionCuller.resize(swapChainExtent);
+}
+
+/**
+ * Frame Capture
+ */
+auto TriangleApp::createFrameCapture() -> void
+{
+    if(!enableFrameCapture)
+    {
+        return;
+    }
+    FrameCapture::Config config;
+    config.format = CAPTURE_FORMAT;
+    config.directory = CAPTURE_DIRECTORY;
+    // Every frame in flight can be copying while the writer works on one frame and has the next one waiting
+    config.bufferCount = MAX_FRAMES_IN_FLIGHT + 2;
+    frameCapture.init(logicalDevice, memoryTracker, config);
 }
 
 /**
@@ -1475,6 +2410,7 @@ auto TriangleApp::createSyncObjects() -> void
 {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    computeFinishedSemaphores.resize(asyncComputeEnabled ? MAX_FRAMES_IN_FLIGHT : 0);
     inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
     imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
 
@@ -1497,6 +2433,13 @@ auto TriangleApp::createSyncObjects() -> void
             throw std::runtime_error("Semaphore creation failed");
         }
     }
+    for(auto& semaphore : computeFinishedSemaphores)
+    {
+        if(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Semaphore creation failed");
+        }
+    }
 }
 
 /**
@@ -1507,18 +2450,46 @@ auto TriangleApp::createSyncObjects() -> void
 
 auto TriangleApp::updateUniformBuffer(type::uint32 currImg) -> void
 {
-    // Timer for consistent geometry rotation
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currTime-startTime).count();
+    // This image may have last shown any older snapshot. It gets the nodes changed by every snapshot since
+        // then, or all of the matrices if that's further back than the history goes
+    const auto& worlds = renderSnapshot->worlds;
+    glm::mat4* target = transformBufferMapped[currImg];
+    type::uint64 version = renderSnapshot->version;
+    type::uint64 imageVersion = transformBufferVersions[currImg];
+    if(imageVersion == NO_TRANSFORM_VERSION || version - imageVersion > TRANSFORM_HISTORY)
+    {
+        std::memcpy(target, worlds.data(), worlds.size() * sizeof(glm::mat4));
+    }
+    else
+    {
+        for(type::uint64 v = imageVersion + 1; v <= version; ++v)
+        {
+            for(SceneGraph::NodeHandle node : renderSnapshot->changedNodes[v % TRANSFORM_HISTORY])
+            {
+                if(!transformCopied[node])
+                {
+                    transformCopied[node] = 1;
+                    target[node] = worlds[node];
+                }
+            }
+        }
+        for(type::uint64 v = imageVersion + 1; v <= version; ++v)
+        {
+            for(SceneGraph::NodeHandle node : renderSnapshot->changedNodes[v % TRANSFORM_HISTORY])
+            {
+                transformCopied[node] = 0;
+            }
+        }
+    }
+    transformBufferVersions[currImg] = version;
 
     UBO::MVP mvp = {};
-    mvp.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    mvp.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    mvp.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / static_cast<float>(swapChainExtent.height), 0.1f, 10.0f);
+    mvp.view = renderSnapshot->view;
+    mvp.proj = glm::perspective(glm::radians(cameraFovDegrees), swapChainExtent.width / static_cast<float>(swapChainExtent.height), 0.1f, 10.0f);
     // GLM was designed in OpenGL in mind and OpenGL inverts the Y axis
         // Vulkan however does not, so undo the inversion
     mvp.proj[1][1] *= -1;
+    frameCamera = mvp;
 
     // This is not the most efficient way to use a UBO
         // Look into passing a small buffer of push constants
@@ -1530,8 +2501,53 @@ auto TriangleApp::updateUniformBuffer(type::uint32 currImg) -> void
 
 auto TriangleApp::drawFrame() -> void
 {
+    // Nothing to draw to until the window is restored
+    if(swapChainStale)
+    {
+        recreateSwapChain();
+        if(swapChainStale)
+        {
+            return;
+        }
+    }
+
     // Sync queues before continuing
     vkWaitForFences(logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, type::uint64_max);
+    // Frames finish in order, so whatever the earlier frames retired is done with too
+    deletionQueue.collect(inFlightFrameNumbers[currentFrame]);
+    // Captured frames whose copies are done go to the writer thread. Has to happen before the fence is reset
+    if(enableFrameCapture)
+    {
+        frameCapture.poll();
+    }
+    // The GPU is done with this frame, so its timestamps are in. They decide the scale this frame renders at
+    if(dynamicResolutionEnabled)
+    {
+        dynamicResolution.update(static_cast<type::uint32>(currentFrame));
+        renderExtent = dynamicResolution.getExtent(swapChainExtent);
+    }
+    else
+    {
+        renderExtent = swapChainExtent;
+    }
+    if(occlusionCullingEnabled)
+    {
+        occlusionCuller.update(static_cast<type::uint32>(currentFrame));
+    }
+    // Textures get whatever is left of the device local heap's budget. When something else pushes
+        // the heap past it, the headroom goes negative and the streamer evicts mips to make up for it
+    memoryTracker.update();
+    type::int64 textureLimit = static_cast<type::int64>(textureStreamer.getResidentBytes())
+            + memoryTracker.getHeadroom(memoryTracker.getDeviceLocalHeap());
+    textureStreamer.setMemoryLimit(static_cast<VkDeviceSize>(std::max<type::int64>(textureLimit, 0)));
+    // Swap in streamed mips. Regular descriptor sets point at a single view, so they're rewritten
+        // when it changes. Bindless draws pick up the new index when recorded
+    if(textureStreamer.update() && !bindlessEnabled)
+    {
+        retireDescriptorSets();
+        createDescriptorSets();
+    }
+    drawSpriteOverlay();
 
     /* Submit image to queue */
     // Get image from swap chain
@@ -1559,21 +2575,45 @@ auto TriangleApp::drawFrame() -> void
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
     updateUniformBuffer(imageIndex);
+    if(occlusionCullingEnabled)
+    {
+        // Same order as the draws are recorded in, so the indirect draws line up with them
+        cullObjects.clear();
+        for(const auto& draw : renderSnapshot->opaqueDraws)
+        {
+            cullObjects.push_back({glm::vec4(draw.center, draw.radius), draw.indexCount, draw.firstIndex,
+                    draw.node, draw.object, draw.vertexOffset});
+        }
+        occlusionCuller.setObjects(static_cast<type::uint32>(currentFrame), cullObjects);
+    }
+    if(enableParticles)
+    {
+        simulateParticles();
+    }
+
+    vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     // Wait until image is available
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE};
     // Wait at the color attachment stage
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, ParticleSystem::DRAW_WAIT_STAGES};
     // Which semaphores to wait on and what stages in execution to wait at
     submitInfo.waitSemaphoreCount = 1;
+    // The particles are drawn from what the compute queue is writing
+    if(enableParticles && asyncComputeEnabled)
+    {
+        waitSemaphores[1] = computeFinishedSemaphores[currentFrame];
+        submitInfo.waitSemaphoreCount = 2;
+    }
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     // Which command buffers to submit for execution
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
     // Which semaphores to signal when the command buffers have finished
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
     submitInfo.signalSemaphoreCount = 1;
@@ -1584,6 +2624,8 @@ auto TriangleApp::drawFrame() -> void
     {
         throw std::runtime_error("Command buffer submission failed");
     }
+    inFlightFrameNumbers[currentFrame] = ++submittedFrames;
+    deletionQueue.frameSubmitted(submittedFrames);
 
     /* Presentation */
     VkPresentInfoKHR presentInfo = {};
@@ -1616,12 +2658,330 @@ auto TriangleApp::drawFrame() -> void
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+/**
+ * Job System
+ */
+auto TriangleApp::createJobSystem() -> void
+{
+    // The main thread sits in the event loop, so it isn't counted against the hardware threads.
+        // Two workers are left for the simulation and render threads to attach to
+    jobSystem.init(std::thread::hardware_concurrency() + 1, 2);
+    sceneGraph.setJobSystem(&jobSystem);
+    spriteBatch.setJobSystem(&jobSystem);
+    statsStart = std::chrono::steady_clock::now();
+}
+
+auto TriangleApp::updateFrameStats() -> void
+{
+    auto now = std::chrono::steady_clock::now();
+    float seconds = std::chrono::duration<float>(now - statsStart).count();
+    if(seconds < 1.0f)
+    {
+        return;
+    }
+
+    float totalUtilization = 0.0f;
+    float maxUtilization = 0.0f;
+    type::uint32 frames = renderedFrames.exchange(0);
+    auto stats = jobSystem.getStats();
+    for(const auto& worker : stats)
+    {
+        totalUtilization += worker.utilization;
+        maxUtilization = std::max(maxUtilization, worker.utilization);
+    }
+    auto percent = [](float fraction) { return std::to_string(static_cast<int>(fraction * 100.0f + 0.5f)); };
+
+    std::string title = "Vulkan App - " + std::to_string(static_cast<int>(frames / seconds + 0.5f)) + " fps - "
+            + std::to_string(stats.size()) + " workers, " + percent(totalUtilization / static_cast<float>(stats.size()))
+            + "% avg / " + percent(maxUtilization) + "% max busy";
+    MemoryTracker::HeapStats heap = memoryTracker.getHeapStats()[memoryTracker.getDeviceLocalHeap()];
+    title += " - " + std::to_string(heap.usage >> 20) + " / " + std::to_string(heap.budget >> 20) + " MiB device memory";
+    // Only measured when the device supports it
+    if(enableDynamicResolution && dynamicResolution.getGpuMilliseconds() > 0.0f)
+    {
+        title += " - " + percent(dynamicResolution.getScale()) + "% resolution, "
+                + std::to_string(static_cast<int>(dynamicResolution.getGpuMilliseconds() + 0.5f)) + " ms GPU";
+    }
+    if(occlusionCullingEnabled)
+    {
+        OcclusionCuller::Stats culled = occlusionCuller.getStats();
+        title += " - " + std::to_string(culled.frustumCulled) + " outside view / " + std::to_string(culled.occluded)
+                + " occluded, " + std::to_string(culled.drawnEarly) + " + " + std::to_string(culled.drawnLate) + " drawn";
+    }
+    if(frameCapture.isCapturing())
+    {
+        title += " - capturing, " + std::to_string(frameCapture.getFramesWritten()) + " written / "
+                + std::to_string(frameCapture.getFramesDropped()) + " dropped";
+    }
+    glfwSetWindowTitle(window, title.c_str());
+
+    jobSystem.resetStats();
+    statsStart = now;
+}
+
+/**
+ * Simulation Thread
+ */
+auto TriangleApp::simulationLoop() -> void
+{
+    jobSystem.attachThread();
+    try
+    {
+        auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / SIMULATION_RATE));
+        auto nextStep = std::chrono::steady_clock::now();
+        // The first snapshot is always needed
+        bool changed = true;
+        while(true)
+        {
+            // Read before checking for work, so anything arriving after the checks changes it and ends the wait
+            type::uint32 wake = simulationWake.load();
+            if(simulationStopping)
+            {
+                break;
+            }
+
+            changed |= handleSimulationEvents();
+            // Nobody would see the animation while the window is minimized
+            bool animating = !animationPaused && !simulationMinimized;
+            if(changed || animating || !renderOnDemand)
+            {
+                simulate(animating ? 1.0f / SIMULATION_RATE : 0.0f);
+                wakeRenderThread();
+                changed = false;
+            }
+
+            if(!animating && (renderOnDemand || simulationMinimized))
+            {
+                // Nothing moves on its own, so there's nothing to do until an event comes in
+                simulationWake.wait(wake);
+                nextStep = std::chrono::steady_clock::now();
+                continue;
+            }
+            // After a stall, carry on from now instead of running a burst of steps to catch up
+            nextStep = std::max(nextStep + step, std::chrono::steady_clock::now());
+            std::this_thread::sleep_until(nextStep);
+        }
+    }
+    catch(...)
+    {
+        reportThreadError();
+    }
+}
+
+auto TriangleApp::wakeSimulationThread() -> void
+{
+    simulationWake.fetch_add(1);
+    simulationWake.notify_one();
+}
+
+auto TriangleApp::handleSimulationEvents() -> bool
+{
+    bool changed = false;
+    WindowEvent event;
+    while(simulationEvents.pop(event))
+    {
+        switch(event.type)
+        {
+            case WindowEvent::Type::Resize:
+                simulationWidth = event.width;
+                simulationHeight = event.height;
+                changed = true;
+                break;
+            case WindowEvent::Type::Minimize:
+                simulationMinimized = true;
+                break;
+            case WindowEvent::Type::Restore:
+                simulationMinimized = false;
+                changed = true;
+                break;
+            case WindowEvent::Type::Key:
+                if(event.key == GLFW_KEY_SPACE && event.action == GLFW_PRESS)
+                {
+                    animationPaused = !animationPaused;
+                    changed = true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return changed;
+}
+
+auto TriangleApp::simulate(float deltaSeconds) -> void
+{
+    simulationTime += deltaSeconds;
+
+    FrameSnapshot& snapshot = snapshots.write();
+    snapshot.time = simulationTime;
+    snapshot.view = glm::lookAt(cameraEye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    // Only the spinner changes, so it and the nodes below it are all that get recomputed
+        // and written into this slot's copy. Without time passing not even that
+    if(deltaSeconds > 0.0f)
+    {
+        sceneGraph.setLocal(spinnerNode, glm::rotate(glm::mat4(1.0f), simulationTime * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+    }
+    sceneGraph.update(snapshots.getWriteIndex(), snapshot.worlds.data());
+
+    // The slot still has the history up to the version it last went out with, so it only needs the steps since
+    ++simulationVersion;
+    changedHistory[simulationVersion % TRANSFORM_HISTORY] = sceneGraph.getUpdated();
+    type::uint64 firstMissing = std::max(snapshot.version + 1,
+            simulationVersion > TRANSFORM_HISTORY ? simulationVersion - TRANSFORM_HISTORY + 1 : 1);
+    for(type::uint64 v = firstMissing; v <= simulationVersion; ++v)
+    {
+        snapshot.changedNodes[v % TRANSFORM_HISTORY] = changedHistory[v % TRANSFORM_HISTORY];
+    }
+    snapshot.version = simulationVersion;
+
+    selectLods(snapshot.worlds);
+    sortDrawsFrontToBack();
+    snapshot.opaqueDraws = opaqueDraws;
+    buildSpriteOverlay(snapshot.sprites, snapshot.time);
+
+    snapshots.publish();
+}
+
+/**
+ * Render Thread
+ */
+auto TriangleApp::renderLoop() -> void
+{
+    jobSystem.attachThread();
+    try
+    {
+        while(true)
+        {
+            // Read before checking for work, so anything arriving after the checks changes it and ends the wait
+            type::uint32 wake = renderWake.load();
+            if(renderStopping)
+            {
+                break;
+            }
+
+            bool redraw = handleRenderEvents();
+            if(snapshots.acquire())
+            {
+                renderSnapshot = &snapshots.read();
+                redraw = true;
+            }
+            // Streamed levels are only swapped in by drawing, and uploads finishing on the GPU wake nobody
+            if(textureStreamer.getPendingLoads() > 0)
+            {
+                redraw = true;
+            }
+            // A resize redraws the last snapshot even if the simulation hasn't produced a new one.
+                // A minimized window isn't drawn at all until it's restored
+            if(!redraw || windowMinimized || !renderSnapshot)
+            {
+                renderWake.wait(wake);
+                continue;
+            }
+
+            drawFrame();
+            renderedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch(...)
+    {
+        reportThreadError();
+    }
+}
+
+auto TriangleApp::wakeRenderThread() -> void
+{
+    renderWake.fetch_add(1);
+    renderWake.notify_one();
+}
+
+auto TriangleApp::handleRenderEvents() -> bool
+{
+    bool redraw = false;
+    WindowEvent event;
+    while(renderEvents.pop(event))
+    {
+        switch(event.type)
+        {
+            case WindowEvent::Type::Resize:
+                framebufferWidth = event.width;
+                framebufferHeight = event.height;
+                framebufferResized = true;
+                redraw = true;
+                break;
+            case WindowEvent::Type::Minimize:
+                windowMinimized = true;
+                break;
+            case WindowEvent::Type::Restore:
+                windowMinimized = false;
+                redraw = true;
+                break;
+            case WindowEvent::Type::Refresh:
+                redraw = true;
+                break;
+            case WindowEvent::Type::Key:
+                if(event.key == GLFW_KEY_C && event.action == GLFW_PRESS && captureSupported)
+                {
+                    if(frameCapture.isCapturing())
+                    {
+                        frameCapture.stop();
+                    }
+                    else
+                    {
+                        // Redrawn so the sequence starts with what's on screen, even if nothing is moving
+                        frameCapture.start();
+                        redraw = true;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return redraw;
+}
+
+auto TriangleApp::reportThreadError() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(threadErrorMutex);
+        if(!threadError)
+        {
+            threadError = std::current_exception();
+        }
+    }
+    // Closing the window brings the main loop down, which passes the error on
+    glfwSetWindowShouldClose(window, GLFW_TRUE);
+    glfwPostEmptyEvent();
+}
+
 auto TriangleApp::mainLoop() -> void
 {
+    simulationThread = std::thread(&TriangleApp::simulationLoop, this);
+    renderThread = std::thread(&TriangleApp::renderLoop, this);
+
+    // The main thread only handles events. It can get stuck in the OS's modal loops while the
+        // window is being moved or resized, and neither of the other threads ever waits on it
     while(!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
-        drawFrame();
+        // Wakes up for events, and otherwise only when the stats in the title are due
+        double untilStats = 1.0 - std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+        glfwWaitEventsTimeout(std::max(untilStats, 0.01));
+        updateFrameStats();
+    }
+
+    simulationStopping = true;
+    wakeSimulationThread();
+    simulationThread.join();
+    renderStopping = true;
+    wakeRenderThread();
+    renderThread.join();
+    {
+        std::lock_guard<std::mutex> lock(threadErrorMutex);
+        if(threadError)
+        {
+            std::rethrow_exception(threadError);
+        }
     }
     // Sync everything before exiting and cleaning up memory
     vkDeviceWaitIdle(logicalDevice);
@@ -1629,15 +2989,49 @@ auto TriangleApp::mainLoop() -> void
 
 auto TriangleApp::cleanup() -> void
 {
+    // Writes out whatever was still queued. The frames' fences have to be around for it
+    if(enableFrameCapture)
+    {
+        frameCapture.cleanup();
+    }
+
     cleanupSwapchain();
+    vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
+    // The device is idle, so whatever is still retired goes now. Before the subsystems
+        // whose deleters hand things back to them
+    deletionQueue.cleanup();
+    pipelineVariants.cleanup();
 
-    vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+    // Before the heap, which the streamer releases its slots back into
+    textureStreamer.cleanup();
+
+    // Also before the heap, since its pipeline layout may use the heap's set layout
+    spriteBatch.cleanup();
+    if(enableParticles)
+    {
+        particleSystem.cleanup();
+    }
+    if(enableDynamicResolution)
+    {
+        dynamicResolution.cleanup();
+    }
+    if(occlusionCullingEnabled)
+    {
+        occlusionCuller.cleanup();
+    }
 
-    vkDestroyBuffer(logicalDevice, indexBuffer, nullptr);
-    vkFreeMemory(logicalDevice, indexBufferMemory, nullptr);
+    descriptorSetCache.cleanup();
+    descriptorAllocator.cleanup();
+    if(bindlessEnabled)
+    {
+        bindlessHeap.cleanup();
+    }
+    else
+    {
+        vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+    }
 
-    vkDestroyBuffer(logicalDevice, vertexBuffer, nullptr);
-    vkFreeMemory(logicalDevice, vertexBufferMemory, nullptr);
+    geometryPool.cleanup();
 
     for(type::size i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
     {
@@ -1645,8 +3039,22 @@ auto TriangleApp::cleanup() -> void
         vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
     }
+    for(auto semaphore : computeFinishedSemaphores)
+    {
+        vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+    }
 
     vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+    if(asyncComputeEnabled)
+    {
+        vkDestroyCommandPool(logicalDevice, computeCommandPool, nullptr);
+    }
+
+    if(reportMemoryOnExit)
+    {
+        std::cerr << "Device memory high-water marks:\n" << memoryTracker.report() << std::flush;
+    }
+    memoryTracker.cleanup();
 
     vkDestroyDevice(logicalDevice, nullptr);
 
@@ -1658,6 +3066,13 @@ auto TriangleApp::cleanup() -> void
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
 
+    if(enableValidationLayers)
+    {
+        validationLog.cleanup();
+    }
+
+    jobSystem.cleanup();
+
     glfwDestroyWindow(window);
     glfwTerminate();
 }
\ No newline at end of file
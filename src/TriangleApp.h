@@ -8,12 +8,41 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <optional>
+#include <thread>
 #include <vector>
 
+#include <glm/glm.hpp>
+
 #include "types.h"
 #include "Vertex.h"
-#include <optional>
+#include "UBO.h"
+#include "DescriptorAllocator.h"
+#include "BindlessHeap.h"
+#include "RenderGraph.h"
+#include "TextureStreamer.h"
+#include "SpriteBatch.h"
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "TripleBuffer.h"
+#include "SpscQueue.h"
+#include "FrameCapture.h"
+#include "MemoryTracker.h"
+#include "ValidationLog.h"
+#include "DeletionQueue.h"
+#include "ParticleSystem.h"
+#include "MeshLod.h"
+#include "MeshCache.h"
+#include "PipelineVariants.h"
+#include "DynamicResolution.h"
+#include "OcclusionCuller.h"
+#include "GeometryPool.h"
 
 /**
  *
@@ -40,6 +69,18 @@ private:
 #else
     static constexpr bool enableValidationLayers = true;
 #endif
+    // Use one big descriptor indexing set instead of per-draw sets when the device supports it
+    static constexpr bool requestBindless = true;
+    // Whether bindless mode actually ended up enabled for the picked device
+    bool bindlessEnabled = false;
+    // Run the particle simulation on a compute only queue family when the device has one, so it
+        // can overlap with the graphics work
+    static constexpr bool requestAsyncCompute = true;
+    // Whether the device had one
+    bool asyncComputeEnabled = false;
+    // Only simulate and draw when something changed, instead of continuously. A static scene then
+        // leaves every thread asleep
+    static constexpr bool renderOnDemand = true;
 
 /*
  * Window Initialization
@@ -47,6 +88,37 @@ private:
     GLFWwindow* window;
     auto initWindow() -> void;
     static auto framebufferResizeCallback(GLFWwindow* window, int width, int height) -> void;
+    static auto windowIconifyCallback(GLFWwindow* window, int iconified) -> void;
+    static auto windowRefreshCallback(GLFWwindow* window) -> void;
+    static auto keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) -> void;
+
+/* Window Events */
+    // Something that happened to the window, passed on by the main thread's event loop
+    struct WindowEvent
+    {
+        enum class Type : type::uint8
+        {
+            Resize,
+            Minimize,
+            Restore,
+            // The window's contents were damaged and need to be drawn again
+            Refresh,
+            Key
+        };
+        Type type;
+        // Framebuffer size for Resize
+        int width = 0;
+        int height = 0;
+        // GLFW key and action for Key
+        int key = 0;
+        int action = 0;
+    };
+    // Far more than the other threads fall behind by. Events that don't fit are dropped
+    static constexpr type::uint32 EVENT_QUEUE_SIZE = 256;
+    SpscQueue<WindowEvent, EVENT_QUEUE_SIZE> simulationEvents;
+    SpscQueue<WindowEvent, EVENT_QUEUE_SIZE> renderEvents;
+    // Called from the main thread only
+    auto postWindowEvent(const WindowEvent& event, bool toSimulation, bool toRenderer) -> void;
     /*
  * Vulkan Initialization
  */
@@ -78,8 +150,10 @@ private:
             const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
             void* pUserData
     ) -> VKAPI_ATTR VkBool32 VKAPI_CALL;
+    // Messages go through this instead of straight to stderr. V lowers the severity that gets logged, wrapping around
+    ValidationLog validationLog;
     // Utility function to fill info struct
-    static auto populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) -> void;
+    auto populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) -> void;
     auto setupDebugMessenger() -> void;
 
 /* Surface Creation */
@@ -89,6 +163,8 @@ private:
 /* Logical and Physical Device Creation */
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice logicalDevice;
+    // Optional features that were turned on for the logical device
+    VkPhysicalDeviceFeatures enabledFeatures = {};
     // Check if a given device supports the required extensions
     auto checkDeviceExtensionSupport(VkPhysicalDevice device) -> bool;
     // Rate the device based on type and available features
@@ -97,9 +173,23 @@ private:
     auto pickPhysicalDevice() -> void;
     auto createLogicalDevice() -> void;
 
+/* Memory Tracking */
+    // Every device allocation goes through this, so usage can be watched against the heaps' budgets
+    MemoryTracker memoryTracker;
+    // Whether VK_EXT_memory_budget is on. Without it the budget is a guess
+    bool memoryBudgetEnabled = false;
+    // Whether VK_EXT_external_memory_host is on, so the GPU can copy geometry straight out of the mapped mesh cache
+    bool hostImportEnabled = false;
+    // Print the peak usage of every heap and category on exit
+    static constexpr bool reportMemoryOnExit = enableValidationLayers;
+    // Resources replaced while running are destroyed through this, once the frames using them are done
+    DeletionQueue deletionQueue;
+
 /* Queue Family Setup */
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    // Only used with async compute
+    VkQueue computeQueue = VK_NULL_HANDLE;
     // Hold the indices for the queue family from the list of queue families found
     struct QueueFamilyIndices
     {
@@ -107,13 +197,15 @@ private:
         std::optional<type::uint32> graphicsFamily;
         // Presentation command support (displaying to a surface)
         std::optional<type::uint32> presentFamily;
+        // Compute without graphics support. Optional, graphics queues can run compute too
+        std::optional<type::uint32> computeFamily;
         inline auto isComplete() -> bool { return graphicsFamily.has_value() && presentFamily.has_value(); }
     };
     // Check if the device supports the type of commands we want to send
     auto findQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices;
 
 /* Swap Chain Creation */
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     // Handles to swap chain images
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
@@ -135,82 +227,411 @@ private:
     auto chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) -> VkPresentModeKHR;
     // Choose the swap extent that matches the window resolution
     auto chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) -> VkExtent2D;
+    // Replaces the current swap chain if there is one, which is retired
     auto createSwapChain() -> void;
     auto createImageViews() -> void;
+    // Retire everything built on the swap chain, except the swap chain itself
     auto cleanupSwapchain() -> void;
-    // For recreating the swap chain in the event of something like a window resize
+    // For recreating the swap chain in the event of something like a window resize. Frames
+        // in flight finish with the old resources, so the device doesn't have to go idle
     auto recreateSwapChain() -> void;
 
 
-/* Render Pass Setup */
-    VkRenderPass renderPass;
-    auto createRenderPass() -> void;
+/* Image Creation */
+    // Lazily allocated memory in props is treated as a preference and dropped if the device has none
+    auto createImage(type::uint32 width, type::uint32 height, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
+            VkImageUsageFlags usage, VkMemoryPropertyFlags props, MemoryTracker::Category category,
+            VkImage& image, VkDeviceMemory& imageMemory) -> void;
+    auto createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) -> VkImageView;
+
+/* Multisampling Setup */
+    // Highest sample count we want to use. Clamped to what the device supports,
+        // VK_SAMPLE_COUNT_1_BIT turns multisampling off
+    static constexpr VkSampleCountFlagBits requestedMsaaSamples = VK_SAMPLE_COUNT_4_BIT;
+    VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    auto getMaxUsableSampleCount() -> VkSampleCountFlagBits;
+
+/* Depth Buffer Creation */
+    // Lay down depth for all opaque geometry in a first subpass so the color
+        // subpass only shades the fragments that end up visible
+    static constexpr bool enableDepthPrepass = false;
+    // Whether the prepass is actually there, since occlusion culling draws its first phase in it
+    bool depthPrepassEnabled = false;
+    VkFormat depthFormat;
+    // Pick the first candidate format that supports the features with the given tiling
+    auto findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) -> VkFormat;
+    auto findDepthFormat() -> VkFormat;
+
+/* Render Graph Setup */
+    // Owns the render pass, framebuffers, depth and multisampled color images,
+        // and works out the barriers between the passes
+    RenderGraph renderGraph;
+    RenderGraph::PassHandle depthPrepassPass = 0;
+    RenderGraph::PassHandle mainPass = 0;
+    // The pass the sprites are drawn in. The main pass, unless the scene is upscaled first
+    RenderGraph::PassHandle spritePass = 0;
+    // Declare the frame's passes and compile them. Redone with the swap chain
+    auto createRenderGraph() -> void;
 
 /* Graphics Pipeline Creation */
-    VkPipeline graphicsPipeline;
+    // Parts of the triangle fragment shaders that are compiled in or out through specialization
+        // constants instead of being branched on. Bit n is constant_id n
+    enum ShaderFeature : type::uint32
+    {
+        SHADER_TEXTURE = 1 << 0,
+        SHADER_VERTEX_COLOR = 1 << 1
+    };
+    static constexpr type::uint32 SHADER_FEATURE_COUNT = 2;
+    static constexpr type::uint32 ALL_SHADER_FEATURES = (1 << SHADER_FEATURE_COUNT) - 1;
+    // Feature combinations the scene's draws use. Only these get a pipeline, the first one being the base
+    static constexpr std::array<type::uint32, 2> shaderVariants = {ALL_SHADER_FEATURES, SHADER_VERTEX_COLOR};
+    // Every pipeline of the main pass and prepass, derived from one base and deduplicated by their state
+    PipelineVariants pipelineVariants;
+    // Main pass pipeline for each combination of shader features, null for the ones not in shaderVariants
+    std::array<VkPipeline, ALL_SHADER_FEATURES + 1> mainPipelines = {};
+    // Depth only version of the graphics pipeline. Only created when the prepass is enabled
+    VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
-    static auto readFile(const std::string& fileName, std::vector<char>& buffer) -> std::vector<char>;
-    auto createShaderModule(const std::vector<char>& code) -> VkShaderModule;
     auto createDescriptorSetLayout() -> void;
     auto createGraphicsPipeline() -> void;
 
-/* Swap Chain Framebuffers Creation */
-    std::vector<VkFramebuffer> swapChainFramebuffers;
-    auto createFramebuffers() -> void;
-
 /* Command Pool Creation */
     //** Command pools manage memory for buffers and command buffers
     VkCommandPool commandPool;
+    // For the async compute queue's family
+    VkCommandPool computeCommandPool = VK_NULL_HANDLE;
     auto createCommandPool() -> void;
 
 /* Buffer Creation */
-    static constexpr std::array<Vertex, 4> vertices =
+    static constexpr std::array<Vertex, 8> vertices =
             {
-                    Vertex{{-0.5f, -0.5f}, { 1.0f,  0.0f,  0.0f}},
-                    Vertex{{ 0.5f, -0.5f}, { 0.0f,  1.0f,  0.0f}},
-                    Vertex{{ 0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f}},
-                    Vertex{{-0.5f,  0.5f}, { 1.0f,  1.0f,  1.0f}}
+                    Vertex{{-0.5f, -0.5f,  0.0f}, { 1.0f,  0.0f,  0.0f}, {1.0f, 0.0f}},
+                    Vertex{{ 0.5f, -0.5f,  0.0f}, { 0.0f,  1.0f,  0.0f}, {0.0f, 0.0f}},
+                    Vertex{{ 0.5f,  0.5f,  0.0f}, { 0.0f,  0.0f,  1.0f}, {0.0f, 1.0f}},
+                    Vertex{{-0.5f,  0.5f,  0.0f}, { 1.0f,  1.0f,  1.0f}, {1.0f, 1.0f}},
 
+                    Vertex{{-0.5f, -0.5f, -0.5f}, { 1.0f,  0.0f,  0.0f}, {1.0f, 0.0f}},
+                    Vertex{{ 0.5f, -0.5f, -0.5f}, { 0.0f,  1.0f,  0.0f}, {0.0f, 0.0f}},
+                    Vertex{{ 0.5f,  0.5f, -0.5f}, { 0.0f,  0.0f,  1.0f}, {0.0f, 1.0f}},
+                    Vertex{{-0.5f,  0.5f, -0.5f}, { 1.0f,  1.0f,  1.0f}, {1.0f, 1.0f}}
             };
     // uint32 or uint16 can be used here, but uint16 is being used for now because
         // there are less than 65535 unique vertices
-    static constexpr std::array<type::uint16, 6> indices = {0, 1, 2, 2, 3, 0};
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    static constexpr std::array<type::uint16, 12> indices =
+            {
+                    0, 1, 2, 2, 3, 0,
+                    4, 5, 6, 6, 7, 4
+            };
+    // Every object's vertices and indices, each in a range of one shared pair of buffers
+    static constexpr GeometryPool::Config geometryPoolConfig = {sizeof(Vertex)};
+    GeometryPool geometryPool;
+    // Authored vertices an object's indices refer to
+    struct VertexRange
+    {
+        type::uint32 first;
+        type::uint32 count;
+    };
 
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBufferMemories;
+    // World matrix of every scene node, one buffer per swap chain image like the uniform buffers.
+        // Stay mapped so the scene graph can write into them directly
+    std::vector<VkBuffer> transformBuffers;
+    std::vector<VkDeviceMemory> transformBufferMemories;
+    std::vector<glm::mat4*> transformBufferMapped;
+    // Snapshot version each transform buffer was last brought up to, NO_TRANSFORM_VERSION until its first full copy
+    std::vector<type::uint64> transformBufferVersions;
+    // One flag per node, so a node changed in several snapshots is only copied once
+    std::vector<type::uint8> transformCopied;
 
-    VkDescriptorPool descriptorPool;
+    // Long lived sets. Reset in bulk when the swap chain is recreated
+    DescriptorAllocator descriptorAllocator;
+    DescriptorSetCache descriptorSetCache;
     std::vector<VkDescriptorSet> descriptorSets;
+    // Used instead of the descriptor sets above in bindless mode
+    BindlessHeap bindlessHeap;
+    // Index of each uniform and transform buffer in the bindless storage buffer array
+    std::vector<type::uint32> uniformBufferIndices;
+    std::vector<type::uint32> transformBufferIndices;
 
-    // Find memory specification and layout of GPU
-    auto findMemoryType(type::uint32 typeFilter, VkMemoryPropertyFlags properties) -> type::uint32;
     auto copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) -> void;
-    auto createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer& buffer, VkDeviceMemory &bufferMemory) -> void;
-    auto createVertexBuffer() -> void;
-    auto createIndexBuffer() -> void;
+    auto copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize srcOffset, VkDeviceSize size) -> void;
+    // Record commands into a one time command buffer and wait for the graphics queue to finish them
+    auto submitTransfer(const std::function<void(VkCommandBuffer)>& record) -> void;
+    // Give every opaque object a range of the geometry pool and copy its vertices and levels into it out of one
+        // buffer. Offsets are where the vertices and indices start in it. Points the draws at their ranges
+    auto copyGeometry(VkBuffer source, VkDeviceSize vertexOffset, VkDeviceSize indexOffset,
+                      const std::vector<VertexRange>& vertexRanges) -> void;
     auto createUniformBuffers() -> void;
-    // Allocate pool of descriptors from which to bind uniform buffers
-    auto createDescriptorPool() -> void;
+    // Setup the descriptor allocators from which to bind uniform buffers
+    auto createDescriptorAllocators() -> void;
+    // Drop every cached set without waiting on the frames in flight that still use them
+    auto retireDescriptorSets() -> void;
     auto createDescriptorSets() -> void;
 
+/* Texture Loading */
+    // Streamed in if it exists, otherwise a generated checkerboard is used
+    static constexpr type::cstr TEXTURE_PATH = "textures/texture.ktx2";
+    TextureStreamer textureStreamer;
+    TextureStreamer::TextureHandle texture = 0;
+    auto createTextures() -> void;
+
+/* Sprite Overlay */
+    // Screen space quads drawn on top of the scene. They stay at the swap chain's resolution when the scene is scaled
+    SpriteBatch spriteBatch;
+    static constexpr type::uint32 overlaySpriteCount = 2048;
+    // Arguments to one SpriteBatch::draw call
+    struct SpriteDraw
+    {
+        SpriteBatch::Sprite sprite;
+        SpriteBatch::TextureId texture;
+        SpriteBatch::BlendMode blend;
+        type::uint8 layer;
+    };
+    auto createSpriteBatch() -> void;
+    // Lay out this step's sprites. Runs on the simulation thread
+    auto buildSpriteOverlay(std::vector<SpriteDraw>& sprites, float time) -> void;
+    // Queue the snapshot's sprites. Runs after the frame's fence has been waited on
+    auto drawSpriteOverlay() -> void;
+
+/* GPU Particles */
+    // A fountain of particles simulated in compute shaders and drawn in the main pass
+    static constexpr bool enableParticles = true;
+    ParticleSystem particleSystem;
+    // Snapshot time the particles were last simulated up to
+    float particleTime = 0.0f;
+    auto createParticleSystem() -> void;
+
+/* Scene Graph */
+    // Every object's transform. Draws pick their world matrix by node through the instance index
+    SceneGraph sceneGraph;
+    // Spins everything below it
+    SceneGraph::NodeHandle spinnerNode = 0;
+    // Build the node hierarchy and size the snapshots for it. Must come before the transform buffers are sized
+    auto createScene() -> void;
+
+/* Draw Sorting */
+    // Where the camera sits. Used for the view matrix and for sorting draws
+    static constexpr glm::vec3 cameraEye = {2.0f, 2.0f, 2.0f};
+    // Vertical field of view of the projection. Also used to work out how big objects are on screen
+    static constexpr float cameraFovDegrees = 45.0f;
+    // Index buffer range of one level of detail of an object
+    struct LodRange
+    {
+        type::uint32 indexCount;
+        type::uint32 firstIndex;
+        // How far the level may be from the full detail object, in object space units
+        float error;
+    };
+    // Including full detail
+    static constexpr type::uint32 MAX_LODS = 4;
+    // Range of the geometry pool making up one opaque object
+    struct DrawItem
+    {
+        // The level of detail being drawn
+        type::uint32 indexCount;
+        type::uint32 firstIndex;
+        // Object space center, used as the sort key
+        glm::vec3 center;
+        // Picks the main pass pipeline. Has to be one of shaderVariants
+        type::uint32 shaderFeatures = ALL_SHADER_FEATURES;
+        // Scene node holding the object's world matrix
+        SceneGraph::NodeHandle node = 0;
+        // Every level generated for the object. Filled in when the index buffer is built
+        std::array<LodRange, MAX_LODS> lods = {};
+        type::uint32 lodCount = 0;
+        // Level picked in the last step. The next pick depends on it to avoid popping back and forth
+        type::uint32 lod = 0;
+        // Added to every index, moving the object's authored vertices to where they are in the geometry pool
+        type::int32 vertexOffset = 0;
+        // Bounding sphere radius around center, and the object's slot in the occlusion culler's visibility,
+            // which stays with it however the draws are sorted
+        float radius = 0.0f;
+        type::uint32 object = 0;
+    };
+    std::vector<DrawItem> opaqueDraws =
+            {
+                    {6, 0, {0.0f, 0.0f,  0.0f}},
+                    {6, 6, {0.0f, 0.0f, -0.5f}, SHADER_VERTEX_COLOR}
+            };
+    // Sort opaque draws nearest first so early depth testing rejects as much as possible
+    auto sortDrawsFrontToBack() -> void;
+
+/* Level of Detail */
+    // Part of the mesh cache's key, so changes here rebuild the cache
+    static constexpr meshlod::Config lodConfig = {MAX_LODS};
+    // A level is drawn once its error covers no more than this many pixels on screen
+    static constexpr float lodErrorPixels = 1.0f;
+    // Fraction of lodErrorPixels a level's error has to be under before switching down to it
+    static constexpr float lodHysteresis = 0.25f;
+    // Simplify every opaque object into a chain of levels, all indexing the same vertices. The
+        // levels of every object are appended to indexData
+    auto generateLods(std::vector<type::uint16>& indexData) -> void;
+    // Point every opaque draw at the level that fits its size on screen. Runs on the simulation thread
+    auto selectLods(const std::vector<glm::mat4>& worlds) -> void;
+
+/* Mesh Cache */
+    // The vertices, every level of every object and the level tables, as they're copied into the geometry pool. Relative
+        // to the working directory, and built again whenever it's missing or stale
+    static constexpr type::cstr MESH_CACHE_PATH = "cache/scene.vtmesh";
+    static constexpr type::uint32 VERTEX_BLOB = MeshCache::blobId("VERT");
+    static constexpr type::uint32 INDEX_BLOB = MeshCache::blobId("INDX");
+    // The lods array of every opaque draw, in order
+    static constexpr type::uint32 LOD_BLOB = MeshCache::blobId("LODS");
+    // Covers everything the cache is built from, so changing any of it makes the cache stale
+    auto meshCacheKey() -> type::uint64;
+    // Check the cache has everything and fits the scene, then take the level tables out of it
+    auto readMeshCache(const MeshCache& cache) -> bool;
+    // Fill the geometry pool from the cache, building it first if needed
+    auto createGeometryBuffers() -> void;
+
+/* Frame Snapshots */
+    // Snapshots back that a transform buffer can be caught up from. Older than that gets a full copy
+    static constexpr type::uint32 TRANSFORM_HISTORY = 16;
+    static constexpr type::uint64 NO_TRANSFORM_VERSION = 0;
+    // Everything the render thread needs from the simulation to draw a frame. Not touched by the
+        // simulation again until the render thread has moved on to a newer one
+    struct FrameSnapshot
+    {
+        // Simulated seconds
+        float time = 0.0f;
+        // Counts up from 1 with every simulation step
+        type::uint64 version = NO_TRANSFORM_VERSION;
+        glm::mat4 view = glm::mat4(1.0f);
+        // Indexed by scene node. Each slot is a scene graph target, so only changed matrices are rewritten
+        std::vector<glm::mat4> worlds;
+        // Nodes changed by each of the last TRANSFORM_HISTORY steps, up to and including this one,
+            // indexed by version % TRANSFORM_HISTORY
+        std::array<std::vector<SceneGraph::NodeHandle>, TRANSFORM_HISTORY> changedNodes;
+        // Nearest first
+        std::vector<DrawItem> opaqueDraws;
+        std::vector<SpriteDraw> sprites;
+    };
+    TripleBuffer<FrameSnapshot> snapshots;
+
+/* Simulation Thread */
+    // Steps at a fixed rate, independent of how long frames take to render and of the event loop
+    static constexpr type::uint32 SIMULATION_RATE = 120;
+    std::thread simulationThread;
+    std::atomic<bool> simulationStopping = false;
+    // Bumped whenever there's an event for the simulation thread, which sleeps on it while idle
+    std::atomic<type::uint32> simulationWake = 0;
+    // The simulation thread's view of the window, kept up to date by window events
+    int simulationWidth = 0;
+    int simulationHeight = 0;
+    bool simulationMinimized = false;
+    // Seconds simulated so far. Stands still while the animation is paused
+    float simulationTime = 0.0f;
+    // Version of the last snapshot, and the nodes each recent one changed. Copied into the snapshots
+        // since the render thread may skip some of them
+    type::uint64 simulationVersion = NO_TRANSFORM_VERSION;
+    std::array<std::vector<SceneGraph::NodeHandle>, TRANSFORM_HISTORY> changedHistory;
+    // Space toggles it
+    bool animationPaused = false;
+    auto simulationLoop() -> void;
+    auto wakeSimulationThread() -> void;
+    // True if something changed that has to be simulated and drawn
+    auto handleSimulationEvents() -> bool;
+    // Advance the scene by a step and publish it as a new snapshot
+    auto simulate(float deltaSeconds) -> void;
+
+/* Render Thread */
+    // Draws the newest snapshot whenever there is one, so rendering overlaps with simulating the next
+    std::thread renderThread;
+    std::atomic<bool> renderStopping = false;
+    // Bumped whenever there's something new for the render thread, a snapshot or an event
+    std::atomic<type::uint32> renderWake = 0;
+    const FrameSnapshot* renderSnapshot = nullptr;
+    // The render thread's view of the window, kept up to date by window events
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    bool framebufferResized = false;
+    bool windowMinimized = false;
+    // Frames presented since the stats were last updated
+    std::atomic<type::uint32> renderedFrames = 0;
+    auto renderLoop() -> void;
+    auto wakeRenderThread() -> void;
+    // True if something happened that needs the window redrawn
+    auto handleRenderEvents() -> bool;
+
+/* Dynamic Resolution */
+    // Renders the scene below the swap chain's resolution when the GPU can't keep up, and upscales it
+    static constexpr bool enableDynamicResolution = true;
+    static constexpr DynamicResolution::Config dynamicResolutionConfig = {};
+    DynamicResolution dynamicResolution;
+    // Whether the swap chain images can be blitted to and the queue can measure the frames
+    bool dynamicResolutionEnabled = false;
+    // What the frame being drawn renders the scene at, at most the swap chain extent
+    VkExtent2D renderExtent = {0, 0};
+    auto createDynamicResolution() -> void;
+    // Scene viewport and scissor for the frame being drawn
+    auto setSceneViewport(VkCommandBuffer commandBuffer) -> void;
+
+/* Occlusion Culling */
+    // Draws last frame's visible objects depth only, then tests everything else against a depth
+        // pyramid built from them on the GPU. Forces the depth prepass on, which the first phase draws in
+    static constexpr bool enableOcclusionCulling = true;
+    OcclusionCuller occlusionCuller;
+    // Whether indirect draws can pick their node through the first instance
+    bool occlusionCullingEnabled = false;
+    // Rebuilt from the snapshot every frame, in the order the draws are recorded in
+    std::vector<OcclusionCuller::Object> cullObjects;
+    RenderGraph::PassHandle occlusionCullPass = 0;
+    auto createOcclusionCuller() -> void;
+
+/* Frame Capture */
+    // C starts and stops writing every presented frame to disk, without holding up rendering
+    static constexpr bool enableFrameCapture = true;
+    static constexpr FrameCapture::Format CAPTURE_FORMAT = FrameCapture::Format::Y4M;
+    static constexpr type::cstr CAPTURE_DIRECTORY = "capture";
+    FrameCapture frameCapture;
+    // Whether the swap chain images can be copied from and are in a format that can be written out
+    bool captureSupported = false;
+    RenderGraph::PassHandle capturePass = 0;
+    auto createFrameCapture() -> void;
+
 /* Command Buffer Allocation */
     std::vector<VkCommandBuffer> commandBuffers;
+    // One per frame in flight for the particle simulation, with async compute
+    std::vector<VkCommandBuffer> computeCommandBuffers;
+    // Buffers and descriptors shared by every pass drawing the scene
+    auto bindDrawResources(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void;
+    // Recorded by the render graph inside its render pass. The opaque draws are replayed for as long
+        // as their key stays the same, the overlays change every frame and are recorded every time
+    auto recordDepthPrepass(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void;
+    auto recordMainPass(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void;
+    auto recordOverlays(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void;
+    // Covers the draw list and everything else the opaque draws are recorded with
+    auto opaqueDrawKey(type::uint32 imageIndex) -> type::uint64;
     auto createCommandBuffers() -> void;
+    // Record the frame targeting the given swap chain image
+    auto recordCommandBuffer(VkCommandBuffer commandBuffer, type::uint32 imageIndex) -> void;
 
 /* Semaphore and Fence Creation - For syncing command buffers */
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
+    // Signalled by the async compute submission, waited on by the frame's draws
+    std::vector<VkSemaphore> computeFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
     type::size currentFrame = 0;
-    bool framebufferResized = false;
+    // Frames are numbered from 1 as they're submitted. Number of the frame each in flight fence was last submitted with
+    type::uint64 submittedFrames = 0;
+    std::array<type::uint64, MAX_FRAMES_IN_FLIGHT> inFlightFrameNumbers = {};
+    // Set while the window is minimized and there's nothing to create a swap chain for
+    bool swapChainStale = false;
     auto createSyncObjects() -> void;
 
+/* Job System */
+    // Per-frame CPU work is spread across it. The main thread is worker 0, though it mostly sleeps
+        // in the event loop. The simulation and render threads attach as workers 1 and 2
+    JobSystem jobSystem;
+    std::chrono::steady_clock::time_point statsStart;
+    // Sized to the machine's hardware threads
+    auto createJobSystem() -> void;
+    // Once a second, put the frame rate and worker utilization in the window title
+    auto updateFrameStats() -> void;
 
 /*
  * Application Maintenance
@@ -219,7 +640,16 @@ private:
     // Execute image as attachment for framebuffer
     // Return image to swap chain for presentation
     auto updateUniformBuffer(type::uint32 currImg) -> void;
+    // Camera of the frame being drawn, as it was written to the uniform buffer
+    UBO::MVP frameCamera = {};
+    // Record the particle simulation for this frame and submit it if it goes to the compute queue
+    auto simulateParticles() -> void;
     auto drawFrame() -> void;
+    // What brought the simulation or render thread down, rethrown on the main thread
+    std::mutex threadErrorMutex;
+    std::exception_ptr threadError;
+    // Called from a catch block
+    auto reportThreadError() -> void;
     auto mainLoop() -> void;
     auto cleanup() -> void;
 };
@@ -0,0 +1,77 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_TRIPLEBUFFER_H
+#define VULKANTUTORIAL_TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+
+#include "types.h"
+
+/**
+ * Lock free mailbox handing values from one producer thread to one consumer thread
+ *
+ * There are three slots. The producer fills its back slot and swaps it with the
+ * middle one. The consumer swaps the middle slot with its front slot whenever
+ * the middle holds something newer. Neither side ever waits for the other, and
+ * values the consumer was too slow to pick up are simply overwritten, so the
+ * consumer always gets the newest finished one. Waking the consumer up when
+ * there's something new is left to the caller.
+ *
+ * Slots are reused, not recreated. A producer that keeps per-slot state, like
+ * buffers it only partially rewrites, can tell slots apart by getWriteIndex.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+    static constexpr type::uint32 SLOT_COUNT = 3;
+
+    // For setting the slots up before either thread starts using them
+    inline auto getSlot(type::uint32 index) -> T& { return slots[index]; }
+
+    /* Producer */
+    inline auto getWriteIndex() const -> type::uint32 { return back; }
+    inline auto write() -> T& { return slots[back]; }
+    // Hand the back slot over to the consumer and get an older one to fill next
+    auto publish() -> void
+    {
+        // Release makes the slot's contents visible to whoever swaps it out of the middle next.
+            // Acquire makes sure the consumer is done with the slot coming back
+        type::uint8 previous = middle.exchange(static_cast<type::uint8>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    /* Consumer */
+    // Swap in the newest published value, if there is one the consumer hasn't seen
+    auto acquire() -> bool
+    {
+        if(!(middle.load(std::memory_order_relaxed) & FRESH))
+        {
+            return false;
+        }
+        type::uint8 previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        return true;
+    }
+    // The value last acquired. Stays put until the next acquire
+    inline auto read() const -> const T& { return slots[front]; }
+
+private:
+    static constexpr type::uint8 INDEX_MASK = 0x3;
+    // Set while the middle slot holds a value the consumer hasn't taken yet
+    static constexpr type::uint8 FRESH = 0x4;
+
+    std::array<T, SLOT_COUNT> slots = {};
+    // Owned by the producer
+    type::uint8 back = 0;
+    // Shared. Slot index plus the fresh flag
+    alignas(64) std::atomic<type::uint8> middle = 1;
+    // Owned by the consumer
+    alignas(64) type::uint8 front = 2;
+};
+
+#endif //VULKANTUTORIAL_TRIPLEBUFFER_H
@@ -10,9 +10,9 @@
 
 namespace UBO
 {
+    // Model matrices come from the scene graph's transform buffer instead
     struct MVP
     {
-        glm::mat4 model;
         glm::mat4 view;
         glm::mat4 proj;
     };
@@ -0,0 +1,216 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#include <cstring>
+#include <iostream>
+#include "ValidationLog.h"
+
+namespace
+{
+    // Copy as much as fits, ending in "..." if it didn't all fit
+    auto copyTruncated(char* destination, type::size capacity, type::cstr source) -> void
+    {
+        if(source == nullptr)
+        {
+            destination[0] = '\0';
+            return;
+        }
+        type::size length = strnlen(source, capacity);
+        if(length < capacity)
+        {
+            std::memcpy(destination, source, length + 1);
+            return;
+        }
+        std::memcpy(destination, source, capacity - 4);
+        std::memcpy(destination + capacity - 4, "...", 4);
+    }
+
+    // FNV-1a
+    auto hashText(type::cstr text) -> type::uint64
+    {
+        type::uint64 hash = 14695981039346656037ull;
+        for(; *text != '\0'; ++text)
+        {
+            hash = (hash ^ static_cast<type::uint8>(*text)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    auto severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity) -> type::cstr
+    {
+        switch(severity)
+        {
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "Verbose";
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "Info";
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "Warning";
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT: return "Error";
+            default: return "Debug";
+        }
+    }
+}
+
+auto ValidationLog::severitiesFrom(VkDebugUtilsMessageSeverityFlagBitsEXT lowest) -> VkDebugUtilsMessageSeverityFlagsEXT
+{
+    // Severity bits go up with the severity
+    return ALL_SEVERITIES & ~(static_cast<VkDebugUtilsMessageSeverityFlagsEXT>(lowest) - 1);
+}
+
+auto ValidationLog::init() -> void
+{
+    init(Config());
+}
+
+auto ValidationLog::init(Config config) -> void
+{
+    this->config = config;
+    severities.store(config.severities, std::memory_order_relaxed);
+    types.store(config.types, std::memory_order_relaxed);
+    queue = std::make_unique<MpscQueue<Message, QUEUE_CAPACITY>>();
+    dropped = 0;
+    reportedDropped = 0;
+    ids.clear();
+
+    stopWriter = false;
+    writer = std::thread(&ValidationLog::writerMain, this);
+}
+
+auto ValidationLog::cleanup() -> void
+{
+    if(!writer.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopWriter = true;
+    }
+    writerSignal.notify_one();
+    writer.join();
+    queue.reset();
+}
+
+auto ValidationLog::submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+                           const VkDebugUtilsMessengerCallbackDataEXT* data) -> void
+{
+    if(!(severity & severities.load(std::memory_order_relaxed)) || !(type & types.load(std::memory_order_relaxed)))
+    {
+        return;
+    }
+
+    Message message;
+    message.severity = severity;
+    message.type = type;
+    message.id = data->messageIdNumber;
+    copyTruncated(message.idName, MAX_ID_NAME_LENGTH, data->pMessageIdName);
+    copyTruncated(message.text, MAX_MESSAGE_LENGTH, data->pMessage);
+
+    if(!queue->push(message))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    writerSignal.notify_one();
+}
+
+/**
+ * Writer Thread
+ */
+auto ValidationLog::writerMain() -> void
+{
+    std::string out;
+    Message message;
+    while(true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            if(!stopWriter)
+            {
+                writerSignal.wait_for(lock, config.interval);
+            }
+            stopping = stopWriter;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while(queue->pop(message))
+        {
+            format(message, now, out);
+        }
+
+        type::uint64 droppedNow = dropped.load(std::memory_order_relaxed);
+        if(droppedNow != reportedDropped)
+        {
+            out += "Validation Layer: " + std::to_string(droppedNow - reportedDropped)
+                    + " messages dropped, they came in faster than they could be written\n";
+            reportedDropped = droppedNow;
+        }
+        // Nothing more is coming when stopping, so every ID is summed up
+        flushSuppressed(now, stopping, out);
+
+        // One write for everything that came in since the last wakeup
+        if(!out.empty())
+        {
+            std::cerr << out << std::flush;
+            out.clear();
+        }
+        if(stopping)
+        {
+            return;
+        }
+    }
+}
+
+auto ValidationLog::format(const Message& message, std::chrono::steady_clock::time_point now, std::string& out) -> void
+{
+    std::string key = message.idName[0] != '\0' ? message.idName : std::to_string(message.id);
+    IdState& state = ids[key];
+    if(now - state.intervalStart >= config.interval)
+    {
+        if(state.suppressed > 0)
+        {
+            out += "Validation Layer: held back " + std::to_string(state.suppressed) + " more " + key + " messages\n";
+        }
+        state.intervalStart = now;
+        state.written = 0;
+        state.suppressed = 0;
+        state.seen.clear();
+    }
+
+    // An exact repeat, or one too many for the interval
+    type::uint64 hash = hashText(message.text);
+    if(state.written >= config.messagesPerId || !state.seen.insert(hash).second)
+    {
+        ++state.suppressed;
+        return;
+    }
+    ++state.written;
+
+    out += "Validation Layer ";
+    out += severityName(message.severity);
+    if(message.type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)
+    {
+        out += " (performance)";
+    }
+    out += " [" + key + "]:\n\t";
+    out += message.text;
+    out += '\n';
+}
+
+auto ValidationLog::flushSuppressed(std::chrono::steady_clock::time_point now, bool all, std::string& out) -> void
+{
+    for(auto& [key, state] : ids)
+    {
+        if(state.suppressed == 0 || (!all && now - state.intervalStart < config.interval))
+        {
+            continue;
+        }
+        out += "Validation Layer: held back " + std::to_string(state.suppressed) + " more " + key + " messages\n";
+        // Starting over, so the next message with the ID gets written again
+        state.intervalStart = now;
+        state.written = 0;
+        state.suppressed = 0;
+        state.seen.clear();
+    }
+}
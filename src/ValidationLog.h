@@ -0,0 +1,122 @@
+/**
+  * Created by Earl Kennedy
+  * https://github.com/Mnenmenth
+  */
+
+#ifndef VULKANTUTORIAL_VALIDATIONLOG_H
+#define VULKANTUTORIAL_VALIDATIONLOG_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "types.h"
+#include "MpscQueue.h"
+
+/**
+ * Writes validation layer messages out without holding up the threads that raise them
+ *
+ * The debug callback runs on whichever thread made the Vulkan call, in the middle
+ * of it. All it does here is check the filters and copy the message into a lock
+ * free queue. A writer thread formats and writes everything it finds there.
+ *
+ * Messages are grouped by their ID. Exact repeats of a message are only written
+ * the first time in every interval, and each ID only gets so many messages per
+ * interval. Whatever was held back is summed up in one line when the interval
+ * ends, so a message raised every draw shows up once a second instead of
+ * thousands of times. If the queue overflows, messages are dropped and counted
+ * rather than blocking the caller.
+ */
+class ValidationLog
+{
+public:
+    struct Config
+    {
+        // Severities and types that get logged. Both can be changed later
+        VkDebugUtilsMessageSeverityFlagsEXT severities =
+                VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        VkDebugUtilsMessageTypeFlagsEXT types = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
+                | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        // Different messages with the same ID written per interval. The rest are only counted
+        type::uint32 messagesPerId = 5;
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+    };
+
+    static constexpr VkDebugUtilsMessageSeverityFlagsEXT ALL_SEVERITIES =
+            VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
+            | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // The given severity and every one more severe
+    static auto severitiesFrom(VkDebugUtilsMessageSeverityFlagBitsEXT lowest) -> VkDebugUtilsMessageSeverityFlagsEXT;
+
+    auto init() -> void;
+    auto init(Config config) -> void;
+    // Writes out everything still queued
+    auto cleanup() -> void;
+
+    // Called from the debug callback, on any thread. Never blocks
+    auto submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+                const VkDebugUtilsMessengerCallbackDataEXT* data) -> void;
+
+    // Safe to call from any thread, take effect on the next message
+    inline auto setSeverities(VkDebugUtilsMessageSeverityFlagsEXT severities) -> void { this->severities.store(severities, std::memory_order_relaxed); }
+    inline auto getSeverities() const -> VkDebugUtilsMessageSeverityFlagsEXT { return severities.load(std::memory_order_relaxed); }
+    inline auto setTypes(VkDebugUtilsMessageTypeFlagsEXT types) -> void { this->types.store(types, std::memory_order_relaxed); }
+    inline auto getTypes() const -> VkDebugUtilsMessageTypeFlagsEXT { return types.load(std::memory_order_relaxed); }
+
+private:
+    // Longer messages are cut off. The callback copies into these instead of allocating
+    static constexpr type::size MAX_MESSAGE_LENGTH = 2048;
+    static constexpr type::size MAX_ID_NAME_LENGTH = 128;
+    static constexpr type::uint32 QUEUE_CAPACITY = 256;
+
+    struct Message
+    {
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        VkDebugUtilsMessageTypeFlagsEXT type;
+        type::int32 id;
+        char idName[MAX_ID_NAME_LENGTH];
+        char text[MAX_MESSAGE_LENGTH];
+    };
+
+    // What the writer has let through for an ID in the current interval
+    struct IdState
+    {
+        std::chrono::steady_clock::time_point intervalStart;
+        type::uint32 written = 0;
+        type::uint32 suppressed = 0;
+        // Hashes of the messages written this interval
+        std::unordered_set<type::uint64> seen;
+    };
+
+    Config config;
+    std::atomic<VkDebugUtilsMessageSeverityFlagsEXT> severities = 0;
+    std::atomic<VkDebugUtilsMessageTypeFlagsEXT> types = 0;
+    // Too big for the stack of a driver thread
+    std::unique_ptr<MpscQueue<Message, QUEUE_CAPACITY>> queue;
+    std::atomic<type::uint64> dropped = 0;
+
+    /* Writer Thread */
+    std::thread writer;
+    std::mutex writerMutex;
+    // Notified without the mutex, so a wakeup can be missed. The writer checks back on its own every interval
+    std::condition_variable writerSignal;
+    bool stopWriter = false;
+    auto writerMain() -> void;
+
+    /* Writer Thread State */
+    std::unordered_map<std::string, IdState> ids;
+    type::uint64 reportedDropped = 0;
+    // Append the message to out, unless it's held back
+    auto format(const Message& message, std::chrono::steady_clock::time_point now, std::string& out) -> void;
+    // Summaries of the IDs whose interval is over
+    auto flushSuppressed(std::chrono::steady_clock::time_point now, bool all, std::string& out) -> void;
+};
+
+#endif //VULKANTUTORIAL_VALIDATIONLOG_H
@@ -12,8 +12,9 @@
 
 struct Vertex
 {
-    glm::vec2 pos;
+    glm::vec3 pos;
     glm::vec3 color;
+    glm::vec2 texCoord;
 
     static auto getBindingDescription() -> VkVertexInputBindingDescription
     {
@@ -27,16 +28,16 @@ struct Vertex
         return bindingDesc;
     }
 
-    static auto getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 2>
+    static auto getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 3>
     {
-        std::array<VkVertexInputAttributeDescription, 2> descs = {};
+        std::array<VkVertexInputAttributeDescription, 3> descs = {};
         // Which binding the per-vertex data comes from
         descs[0].binding = 0;
         // Refers to the 'location =' in vertex layout
         descs[0].location = 0;
         // Byte size of attribute data
-            // VK_FORMAT_R32G32_SFLOAT = vec2
-        descs[0].format = VK_FORMAT_R32G32_SFLOAT;
+            // VK_FORMAT_R32G32B32_SFLOAT = vec3
+        descs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
         // Offset of pos member in struct in bytes
         descs[0].offset = offsetof(Vertex, pos);
 
@@ -44,6 +45,12 @@ struct Vertex
         descs[1].location = 1;
         descs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
         descs[1].offset = offsetof(Vertex, color);
+
+        descs[2].binding = 0;
+        descs[2].location = 2;
+        // vec2
+        descs[2].format = VK_FORMAT_R32G32_SFLOAT;
+        descs[2].offset = offsetof(Vertex, texCoord);
         return descs;
     }
 
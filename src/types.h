@@ -11,12 +11,15 @@
 
 namespace type
 {
+    using uint8 = std::uint8_t;
     using uint16 = std::uint16_t;
     constexpr uint16 uint16_max = UINT16_MAX;
     using uint32 = std::uint32_t;
     constexpr uint32 uint32_max = UINT32_MAX;
     using uint64 = std::uint64_t;
     constexpr uint64 uint64_max = UINT64_MAX;
+    using int32 = std::int32_t;
+    using int64 = std::int64_t;
     using size = std::size_t;
 
     using cstr = const char*;